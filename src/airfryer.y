@@ -9,18 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
-#include "semantic.h"
-#include "codegen.h"
-
-extern int yylex();
-extern int yyparse();
-extern FILE *yyin;
-extern int line_num;
-
-void yyerror(const char *s);
-
-/* Raiz da AST */
-ASTNode* root = NULL;
+#include "alloc.h"
 %}
 
 /* Listas temporarias para construcao de nos durante parsing */
@@ -32,9 +21,46 @@ ASTNode* root = NULL;
         int count;
         int capacity;
     } NodeList;
+    
+    /* Estado de uma analise sintatica (um arquivo por vez) */
+    /* Substitui as antigas variaveis globais para que varios arquivos */
+    /* possam ser analisados em paralelo */
+    typedef struct ParserState {
+        ASTNode *root;       /* Raiz da AST (preenchida ao reduzir 'programa') */
+        const char *source;  /* Buffer sendo analisado (yy_scan_buffer) */
+        int line;            /* Linha atual (atualizada pelo scanner) */
+        int line_start;      /* Offset do inicio da linha atual */
+        FILE *diag;          /* Destino das mensagens de erro */
+        
+        /* Modo streaming: cada item do nivel do programa e entregue a */
+        /* on_item assim que e reduzido, em vez de ficar na AST; root ja */
+        /* existe nesse momento (NULL = acumular o programa inteiro) */
+        void (*on_item)(struct ParserState *state, ASTNode *item);
+        void *stream;        /* Contexto de on_item */
+    } ParserState;
+    
+    /* Trecho do buffer de origem: IDs e strings nao sao copiados pelo */
+    /* scanner, apenas quando passam a fazer parte da AST */
+    typedef struct SourceView {
+        int offset;
+        int length;
+    } SourceView;
 }
 
+%define api.pure full
+%locations
+%lex-param {void *scanner}
+%parse-param {void *scanner} {ParserState *state}
+
 %code {
+    int yylex(YYSTYPE *yylval_param, YYLTYPE *yylloc_param, void *scanner);
+    void yyerror(YYLTYPE *loc, void *scanner, ParserState *state, const char *s);
+    
+    /* Copiar o texto de uma SourceView (a AST assume a posse) */
+    static char* view_str(ParserState *state, SourceView view) {
+        return mem_strndup(MEM_AST, state->source + view.offset, view.length);
+    }
+    
     NodeList* nodelist_create();
     void nodelist_add(NodeList *list, ASTNode *node);
     void nodelist_free(NodeList *list);
@@ -43,7 +69,7 @@ ASTNode* root = NULL;
 %union {
     int int_val;
     double double_val;
-    char *str_val;
+    SourceView view_val;
     ASTNode *node_val;
     DataType type_val;
     ModoKind modo_val;
@@ -51,21 +77,24 @@ ASTNode* root = NULL;
     BinOpKind binop_val;
     UnOpKind unop_val;
     NodeList *list_val;
+    SensorKind sensor_val;
 }
 
 /* Tokens terminais */
-%token <str_val> ID STR_LITERAL
+%token <view_val> ID STR_LITERAL
 %token <int_val> INT_LITERAL
 %token <double_val> DEC_LITERAL
 
 /* Palavras-chave */
-%token PROGRAMA RECEITA PASSO
+%token PROGRAMA RECEITA PASSO IMPORTAR
 %token VAR INTEIRO FRAC BOOL TEXTO
 %token PREAQUECER COZINHAR AQUECER AGITAR MODO
 %token TEMPERATURA GRAUS CELSIUS TEMPO MINUTOS SEGUNDOS AOS
 %token BATATA LEGUMES NUGGETS ESFIHAS
 %token PAUSAR CONTINUAR PARAR IMPRIMIR
-%token SE SENAO ENQUANTO
+%token SE SENAO ENQUANTO PARA DE ATE QUANDO
+%token ESCOLHA CASO PADRAO
+%token TEMP WEIGHT MODE STATE
 %token VERDADEIRO FALSO
 %token E OU NAO
 
@@ -75,21 +104,23 @@ ASTNode* root = NULL;
 %token ASSIGN
 
 /* Delimitadores */
-%token LBRACE RBRACE LPAREN RPAREN SEMICOLON COLON COMMA
+%token LBRACE RBRACE LPAREN RPAREN LBRACKET RBRACKET SEMICOLON COLON COMMA
 
 /* Tipos nao-terminais */
-%type <node_val> programa receita passo bloco
+%type <node_val> programa top_level_item receita passo bloco parametro importacao
 %type <node_val> declaracao comando atribuicao
 %type <node_val> preaquecer cozinhar aquecer agitar set_modo
-%type <node_val> pausar continuar parar imprimir
-%type <node_val> condicional repeticao
+%type <node_val> pausar continuar parar imprimir chamada
+%type <node_val> condicional repeticao evento selecao caso padrao_opt
 %type <node_val> temperatura_espec
 %type <node_val> expr disj conj neg rel soma produto unario primario
 %type <node_val> literal
-%type <list_val> top_level_list declaracao_comando_list expr_list
+%type <list_val> top_level_list declaracao_comando_list expr_list parametro_list caso_list
 %type <type_val> tipo
 %type <modo_val> modo_tipo
 %type <time_unit_val> unidade_tempo
+%type <int_val> passo_para valor_caso
+%type <sensor_val> sensor
 
 /* Precedencia e associatividade */
 %left OU
@@ -105,12 +136,20 @@ ASTNode* root = NULL;
 /* ===== PROGRAMA E ORGANIZACAO ===== */
 
 programa:
-    PROGRAMA ID LBRACE top_level_list RBRACE {
-        /* Criar no do programa com todos os itens */
-        $$ = ast_create_programa($2, $4->items, $4->count);
-        free($4);  /* Liberar a lista temporaria (mas nao os itens) */
-        free($2);
-        root = $$;
+    PROGRAMA ID LBRACE {
+        /* No modo streaming o programa existe antes dos itens */
+        if (state->on_item) state->root = ast_create_programa(view_str(state, $2), NULL, 0);
+    } top_level_list RBRACE {
+        if (state->on_item) {
+            /* Os itens ja foram entregues a on_item */
+            nodelist_free($5);
+            $$ = state->root;
+        } else {
+            /* Criar no do programa com todos os itens */
+            $$ = ast_create_programa(view_str(state, $2), $5->items, $5->count);
+            mem_free($5);  /* Liberar a lista temporaria (mas nao os itens) */
+            state->root = $$;
+        }
     }
     ;
 
@@ -118,38 +157,73 @@ top_level_list:
     /* vazio */ {
         $$ = nodelist_create();
     }
-    | top_level_list receita {
-        $$ = $1;
-        nodelist_add($$, $2);
-    }
-    | top_level_list declaracao {
+    | top_level_list top_level_item {
         $$ = $1;
-        nodelist_add($$, $2);
-    }
-    | top_level_list comando {
-        $$ = $1;
-        nodelist_add($$, $2);
+        if (state->on_item) {
+            state->on_item(state, $2);
+        } else {
+            nodelist_add($$, $2);
+        }
     }
     ;
 
+top_level_item:
+    receita { $$ = $1; }
+    | importacao { $$ = $1; }
+    | declaracao { $$ = $1; }
+    | comando { $$ = $1; }
+    ;
+
 receita:
     RECEITA ID bloco {
-        $$ = ast_create_receita($2, $3);
-        free($2);
+        $$ = ast_create_receita(view_str(state, $2), $3);
+    }
+    ;
+
+importacao:
+    IMPORTAR STR_LITERAL SEMICOLON {
+        $$ = ast_create_importar(view_str(state, $2));
+        $$->line = state->line;
     }
     ;
 
 passo:
     PASSO ID bloco {
-        $$ = ast_create_passo($2, $3);
-        free($2);
+        $$ = ast_create_passo(view_str(state, $2), $3);
+    }
+    | PASSO ID LPAREN RPAREN bloco {
+        $$ = ast_create_passo_sub(view_str(state, $2), NULL, 0, $5);
+        $$->line = state->line;
+    }
+    | PASSO ID LPAREN parametro_list RPAREN bloco {
+        $$ = ast_create_passo_sub(view_str(state, $2), $4->items, $4->count, $6);
+        $$->line = state->line;
+        mem_free($4);
+    }
+    ;
+
+parametro_list:
+    parametro {
+        $$ = nodelist_create();
+        nodelist_add($$, $1);
+    }
+    | parametro_list COMMA parametro {
+        $$ = $1;
+        nodelist_add($$, $3);
+    }
+    ;
+
+parametro:
+    ID COLON tipo {
+        $$ = ast_create_declaracao(view_str(state, $1), $3, NULL);
+        $$->line = state->line;
     }
     ;
 
 bloco:
     LBRACE declaracao_comando_list RBRACE {
         $$ = ast_create_bloco($2->items, $2->count);
-        free($2);
+        mem_free($2);
     }
     ;
 
@@ -171,14 +245,31 @@ declaracao_comando_list:
 
 declaracao:
     VAR ID COLON tipo SEMICOLON {
-        $$ = ast_create_declaracao($2, $4, NULL);
-        $$->line = line_num;
-        free($2);
+        $$ = ast_create_declaracao(view_str(state, $2), $4, NULL);
+        $$->line = state->line;
     }
     | VAR ID COLON tipo ASSIGN expr SEMICOLON {
-        $$ = ast_create_declaracao($2, $4, $6);
-        $$->line = line_num;
-        free($2);
+        $$ = ast_create_declaracao(view_str(state, $2), $4, $6);
+        $$->line = state->line;
+    }
+    | VAR ID COLON tipo LBRACKET INT_LITERAL RBRACKET SEMICOLON {
+        if ($6 <= 0) {
+            yyerror(&@6, scanner, state, "tamanho do vetor deve ser maior que zero");
+            YYERROR;
+        }
+        $$ = ast_create_declaracao_vetor(view_str(state, $2), $4, $6, NULL, 0);
+        $$->line = state->line;
+    }
+    | VAR ID COLON tipo LBRACKET INT_LITERAL RBRACKET ASSIGN LBRACKET expr_list RBRACKET SEMICOLON {
+        if ($6 <= 0) {
+            yyerror(&@6, scanner, state, "tamanho do vetor deve ser maior que zero");
+            for (int i = 0; i < $10->count; i++) ast_free($10->items[i]);
+            nodelist_free($10);
+            YYERROR;
+        }
+        $$ = ast_create_declaracao_vetor(view_str(state, $2), $4, $6, $10->items, $10->count);
+        $$->line = state->line;
+        mem_free($10);
     }
     ;
 
@@ -202,52 +293,58 @@ comando:
     | continuar SEMICOLON { $$ = $1; }
     | parar SEMICOLON { $$ = $1; }
     | imprimir SEMICOLON { $$ = $1; }
+    | chamada SEMICOLON { $$ = $1; }
     | condicional { $$ = $1; }
     | repeticao { $$ = $1; }
+    | evento { $$ = $1; }
+    | selecao { $$ = $1; }
     | passo { $$ = $1; }
     | bloco { $$ = $1; }
     ;
 
 atribuicao:
     ID ASSIGN expr {
-        $$ = ast_create_atribuicao($1, $3);
-        $$->line = line_num;
-        free($1);
+        $$ = ast_create_atribuicao(view_str(state, $1), $3);
+        $$->line = state->line;
+    }
+    | ID LBRACKET expr RBRACKET ASSIGN expr {
+        $$ = ast_create_atribuicao_indice(view_str(state, $1), $3, $6);
+        $$->line = state->line;
     }
     ;
 
 preaquecer:
     PREAQUECER temperatura_espec {
         $$ = ast_create_preaquecer($2);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 cozinhar:
     COZINHAR temperatura_espec TEMPO expr unidade_tempo {
         $$ = ast_create_cozinhar($2, $4, $5);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 aquecer:
     AQUECER TEMPO expr unidade_tempo {
         $$ = ast_create_aquecer($3, $4);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 agitar:
     AGITAR AOS expr MINUTOS {
         $$ = ast_create_agitar($3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 set_modo:
     MODO modo_tipo {
         $$ = ast_create_set_modo($2);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -266,29 +363,41 @@ unidade_tempo:
 pausar:
     PAUSAR {
         $$ = ast_create_pausar();
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 continuar:
     CONTINUAR {
         $$ = ast_create_continuar();
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 parar:
     PARAR {
         $$ = ast_create_parar();
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 imprimir:
     IMPRIMIR LPAREN expr_list RPAREN {
         $$ = ast_create_imprimir($3->items, $3->count);
-        $$->line = line_num;
-        free($3);
+        $$->line = state->line;
+        mem_free($3);
+    }
+    ;
+
+chamada:
+    ID LPAREN RPAREN {
+        $$ = ast_create_chamada(view_str(state, $1), NULL, 0);
+        $$->line = state->line;
+    }
+    | ID LPAREN expr_list RPAREN {
+        $$ = ast_create_chamada(view_str(state, $1), $3->items, $3->count);
+        $$->line = state->line;
+        mem_free($3);
     }
     ;
 
@@ -306,21 +415,77 @@ expr_list:
 condicional:
     SE LPAREN expr RPAREN bloco {
         $$ = ast_create_se($3, $5, NULL);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | SE LPAREN expr RPAREN bloco SENAO bloco {
         $$ = ast_create_se($3, $5, $7);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 repeticao:
     ENQUANTO LPAREN expr RPAREN bloco {
         $$ = ast_create_enquanto($3, $5);
-        $$->line = line_num;
+        $$->line = state->line;
+    }
+    | PARA ID DE expr ATE expr bloco {
+        $$ = ast_create_para(view_str(state, $2), $4, $6, 1, $7);
+        $$->line = state->line;
+    }
+    | PARA ID DE expr ATE expr PASSO passo_para bloco {
+        $$ = ast_create_para(view_str(state, $2), $4, $6, $8, $9);
+        $$->line = state->line;
+    }
+    ;
+
+passo_para:
+    INT_LITERAL { $$ = $1; }
+    | MINUS INT_LITERAL { $$ = -$2; }
+    ;
+
+evento:
+    QUANDO LPAREN expr RPAREN bloco {
+        $$ = ast_create_quando($3, $5);
+        $$->line = state->line;
+    }
+    ;
+
+selecao:
+    ESCOLHA LPAREN expr RPAREN LBRACE caso_list padrao_opt RBRACE {
+        $$ = ast_create_escolha($3, $6->items, $6->count, $7);
+        $$->line = state->line;
+        mem_free($6);
     }
     ;
 
+caso_list:
+    caso {
+        $$ = nodelist_create();
+        nodelist_add($$, $1);
+    }
+    | caso_list caso {
+        $$ = $1;
+        nodelist_add($$, $2);
+    }
+    ;
+
+caso:
+    CASO valor_caso COLON bloco {
+        $$ = ast_create_caso($2, $4);
+        $$->line = state->line;
+    }
+    ;
+
+valor_caso:
+    INT_LITERAL { $$ = $1; }
+    | MINUS INT_LITERAL { $$ = -$2; }
+    ;
+
+padrao_opt:
+    /* vazio */ { $$ = NULL; }
+    | PADRAO COLON bloco { $$ = $3; }
+    ;
+
 temperatura_espec:
     TEMPERATURA expr GRAUS CELSIUS {
         $$ = $2;
@@ -337,7 +502,7 @@ disj:
     conj { $$ = $1; }
     | disj OU conj {
         $$ = ast_create_binop(OP_OR, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -345,7 +510,7 @@ conj:
     neg { $$ = $1; }
     | conj E neg {
         $$ = ast_create_binop(OP_AND, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -353,7 +518,7 @@ neg:
     rel { $$ = $1; }
     | NAO neg {
         $$ = ast_create_unop(OP_NOT, $2);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -361,27 +526,27 @@ rel:
     soma { $$ = $1; }
     | soma EQ soma {
         $$ = ast_create_binop(OP_EQ, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | soma NE soma {
         $$ = ast_create_binop(OP_NE, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | soma LT soma {
         $$ = ast_create_binop(OP_LT, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | soma LE soma {
         $$ = ast_create_binop(OP_LE, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | soma GT soma {
         $$ = ast_create_binop(OP_GT, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | soma GE soma {
         $$ = ast_create_binop(OP_GE, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -389,11 +554,11 @@ soma:
     produto { $$ = $1; }
     | soma PLUS produto {
         $$ = ast_create_binop(OP_ADD, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | soma MINUS produto {
         $$ = ast_create_binop(OP_SUB, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -401,15 +566,15 @@ produto:
     unario { $$ = $1; }
     | produto MULT unario {
         $$ = ast_create_binop(OP_MUL, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | produto DIV unario {
         $$ = ast_create_binop(OP_DIV, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | produto MOD unario {
         $$ = ast_create_binop(OP_MOD, $1, $3);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -417,43 +582,56 @@ unario:
     primario { $$ = $1; }
     | MINUS unario %prec UMINUS {
         $$ = ast_create_unop(OP_NEG, $2);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
 primario:
     literal { $$ = $1; }
     | ID {
-        $$ = ast_create_variavel($1);
-        $$->line = line_num;
-        free($1);
+        $$ = ast_create_variavel(view_str(state, $1));
+        $$->line = state->line;
+    }
+    | ID LBRACKET expr RBRACKET {
+        $$ = ast_create_indice(view_str(state, $1), $3);
+        $$->line = state->line;
+    }
+    | sensor {
+        $$ = ast_create_sensor($1);
+        $$->line = state->line;
     }
     | LPAREN expr RPAREN {
         $$ = $2;
     }
     ;
 
+sensor:
+    TEMP { $$ = SENSOR_TEMP; }
+    | WEIGHT { $$ = SENSOR_WEIGHT; }
+    | MODE { $$ = SENSOR_MODE; }
+    | STATE { $$ = SENSOR_STATE; }
+    ;
+
 literal:
     INT_LITERAL {
         $$ = ast_create_literal_int($1);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | DEC_LITERAL {
         $$ = ast_create_literal_frac($1);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | STR_LITERAL {
-        $$ = ast_create_literal_str($1);
-        $$->line = line_num;
-        free($1);
+        $$ = ast_create_literal_str(view_str(state, $1));
+        $$->line = state->line;
     }
     | VERDADEIRO {
         $$ = ast_create_literal_bool(1);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     | FALSO {
         $$ = ast_create_literal_bool(0);
-        $$->line = line_num;
+        $$->line = state->line;
     }
     ;
 
@@ -461,16 +639,17 @@ literal:
 
 /* ===== FUNCOES AUXILIARES ===== */
 
-void yyerror(const char *s) {
-    fprintf(stderr, "Erro sintatico na linha %d: %s\n", line_num, s);
+void yyerror(YYLTYPE *loc, void *scanner, ParserState *state, const char *s) {
+    (void)scanner;
+    fprintf(state->diag, "Erro sintatico na linha %d, coluna %d: %s\n",
+            loc->first_line, loc->first_column, s);
 }
-
 /* Criar uma nova lista de nos */
 NodeList* nodelist_create() {
-    NodeList *list = (NodeList*)malloc(sizeof(NodeList));
+    NodeList *list = (NodeList*)mem_malloc(MEM_PARSER, sizeof(NodeList));
     list->capacity = 8;
     list->count = 0;
-    list->items = (ASTNode**)malloc(list->capacity * sizeof(ASTNode*));
+    list->items = (ASTNode**)mem_malloc(MEM_PARSER, list->capacity * sizeof(ASTNode*));
     return list;
 }
 
@@ -478,109 +657,13 @@ NodeList* nodelist_create() {
 void nodelist_add(NodeList *list, ASTNode *node) {
     if (list->count >= list->capacity) {
         list->capacity *= 2;
-        list->items = (ASTNode**)realloc(list->items, list->capacity * sizeof(ASTNode*));
+        list->items = (ASTNode**)mem_realloc(MEM_PARSER, list->items, list->capacity * sizeof(ASTNode*));
     }
     list->items[list->count++] = node;
 }
 
 /* Liberar a lista (mas nao os nos) */
 void nodelist_free(NodeList *list) {
-    free(list->items);
-    free(list);
-}
-
-/* ===== MAIN ===== */
-
-int main(int argc, char **argv) {
-    /* Verificar argumentos */
-    if (argc < 2) {
-        fprintf(stderr, "Uso: %s <arquivo.afs> [-o <saida.mwasm>] [-debug]\n", argv[0]);
-        return 1;
-    }
-    
-    /* Abrir arquivo de entrada */
-    FILE *file = fopen(argv[1], "r");
-    if (!file) {
-        fprintf(stderr, "Erro: nao foi possivel abrir o arquivo %s\n", argv[1]);
-        return 1;
-    }
-    yyin = file;
-    
-    /* Verificar opcoes */
-    int debug_mode = 0;
-    FILE *output = stdout;
-    for (int i = 2; i < argc; i++) {
-        if (strcmp(argv[i], "-debug") == 0) {
-            debug_mode = 1;
-        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
-            output = fopen(argv[i + 1], "w");
-            if (!output) {
-                fprintf(stderr, "Erro: nao foi possivel criar arquivo de saida %s\n", argv[i + 1]);
-                output = stdout;
-            }
-            i++;
-        }
-    }
-    
-    /* Parser */
-    fprintf(stderr, "Iniciando analise de %s...\n", argv[1]);
-    
-    if (yyparse() != 0) {
-        fprintf(stderr, "Erro: falha na analise sintatica.\n");
-        fclose(file);
-        if (output != stdout) fclose(output);
-        return 1;
-    }
-    
-    fprintf(stderr, "Analise sintatica concluida com sucesso.\n");
-    
-    /* Debug: imprimir AST */
-    if (debug_mode) {
-        fprintf(stderr, "\n=== Arvore Sintatica Abstrata ===\n");
-        ast_print(root, 0);
-        fprintf(stderr, "\n");
-    }
-    
-    /* Analise semantica */
-    fprintf(stderr, "Realizando analise semantica...\n");
-    SemanticErrorList *errors = error_list_create();
-    
-    if (!semantic_analyze(root, errors)) {
-        fprintf(stderr, "\n");
-        error_list_print(errors);
-        fprintf(stderr, "\nErro: falha na analise semantica.\n");
-        error_list_free(errors);
-        ast_free(root);
-        fclose(file);
-        if (output != stdout) fclose(output);
-        return 1;
-    }
-    
-    fprintf(stderr, "Analise semantica concluida com sucesso.\n");
-    error_list_free(errors);
-    
-    /* Geracao de codigo */
-    fprintf(stderr, "Gerando codigo assembly...\n");
-    CodeGenerator *codegen = codegen_create(output);
-    
-    if (!codegen_generate(codegen, root)) {
-        fprintf(stderr, "Erro: falha na geracao de codigo.\n");
-        codegen_free(codegen);
-        ast_free(root);
-        fclose(file);
-        if (output != stdout) fclose(output);
-        return 1;
-    }
-    
-    fprintf(stderr, "Codigo gerado com sucesso.\n");
-    
-    /* Limpeza */
-    codegen_free(codegen);
-    ast_free(root);
-    fclose(file);
-    if (output != stdout) fclose(output);
-    
-    fprintf(stderr, "Compilacao concluida!\n");
-    
-    return 0;
+    mem_free(list->items);
+    mem_free(list);
 }
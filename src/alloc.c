@@ -0,0 +1,279 @@
+/*
+ * alloc.c
+ * Funcoes mem_* e os contadores de alloc.h
+ */
+
+#include "alloc.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 1024
+
+static __thread AllocStats thread_stats;
+
+/* Maior que 0 enquanto alloc.c chama a libc: com os wrappers de */
+/* alloc_wrap.c ligados, essas chamadas nao sao contadas de novo */
+static __thread int inside;
+
+static void count(size_t bytes) {
+    thread_stats.allocations++;
+    thread_stats.bytes += bytes;
+}
+
+void alloc_count_external(size_t bytes) {
+    if (!inside) count(bytes);
+}
+
+/* ===== BLOCOS MARCADOS ===== */
+
+/* Bloco registrado (ptr NULL = posicao livre) */
+typedef struct MemBlock {
+    void *ptr;
+    size_t size;
+    MemTag tag;
+} MemBlock;
+
+/* Tabela de blocos da medicao (enderecamento aberto, sondagem linear) */
+/* A propria tabela fica fora dos contadores */
+typedef struct MemTracker {
+    MemBlock *blocks;
+    size_t capacity;               /* Potencia de 2 */
+    size_t count;
+    size_t live;                   /* Soma de live dos subsistemas */
+    int depth;                     /* mem_stats_begin aninhados */
+    MemStats stats;
+} MemTracker;
+
+static __thread MemTracker *tracker;
+
+static size_t slot_of(const MemTracker *t, const void *ptr) {
+    uintptr_t h = (uintptr_t)ptr >> 4;
+    h *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 16) & (t->capacity - 1);
+}
+
+static void tracker_insert(MemTracker *t, void *ptr, size_t size, MemTag tag);
+
+static void tracker_grow(MemTracker *t) {
+    MemBlock *old = t->blocks;
+    size_t old_capacity = t->capacity;
+    t->capacity = old_capacity ? old_capacity * 2 : INITIAL_CAPACITY;
+    inside++;
+    t->blocks = calloc(t->capacity, sizeof(MemBlock));
+    inside--;
+    t->count = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].ptr) tracker_insert(t, old[i].ptr, old[i].size, old[i].tag);
+    }
+    free(old);
+}
+
+static void tracker_insert(MemTracker *t, void *ptr, size_t size, MemTag tag) {
+    if ((t->count + 1) * 2 > t->capacity) tracker_grow(t);
+    size_t i = slot_of(t, ptr);
+    while (t->blocks[i].ptr) i = (i + 1) & (t->capacity - 1);
+    t->blocks[i].ptr = ptr;
+    t->blocks[i].size = size;
+    t->blocks[i].tag = tag;
+    t->count++;
+}
+
+/* Retirar ptr da tabela; retorna 1 e o bloco se estava registrado */
+static int tracker_remove(MemTracker *t, const void *ptr, MemBlock *out) {
+    if (!t->capacity) return 0;
+    size_t mask = t->capacity - 1;
+    size_t i = slot_of(t, ptr);
+    while (t->blocks[i].ptr != ptr) {
+        if (!t->blocks[i].ptr) return 0;
+        i = (i + 1) & mask;
+    }
+    *out = t->blocks[i];
+    t->count--;
+
+    /* Remocao sem lapides: puxar para tras os blocos do mesmo grupo */
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; t->blocks[j].ptr; j = (j + 1) & mask) {
+        size_t home = slot_of(t, t->blocks[j].ptr);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            t->blocks[hole] = t->blocks[j];
+            hole = j;
+        }
+    }
+    t->blocks[hole].ptr = NULL;
+    return 1;
+}
+
+static void add_live(MemTracker *t, MemTag tag, size_t size) {
+    MemTagStats *s = &t->stats.tags[tag];
+    s->live += size;
+    if (s->live > s->peak) s->peak = s->live;
+    t->live += size;
+    if (t->live > t->stats.peak) t->stats.peak = t->live;
+}
+
+static void sub_live(MemTracker *t, MemTag tag, size_t size) {
+    t->stats.tags[tag].live -= size;
+    t->live -= size;
+}
+
+/* Registrar um bloco novo do subsistema tag */
+static void track_new(MemTag tag, void *ptr, size_t size) {
+    MemTracker *t = tracker;
+    if (!t || !ptr) return;
+    /* Endereco de um bloco liberado sem mem_free: esquecer o antigo */
+    MemBlock stale;
+    if (tracker_remove(t, ptr, &stale)) sub_live(t, stale.tag, stale.size);
+    t->stats.tags[tag].allocations++;
+    t->stats.tags[tag].bytes += size;
+    tracker_insert(t, ptr, size, tag);
+    add_live(t, tag, size);
+}
+
+void alloc_stats_get(AllocStats *stats) {
+    *stats = thread_stats;
+}
+
+/* ===== ALOCACOES POR SUBSISTEMA ===== */
+
+void* mem_malloc(MemTag tag, size_t size) {
+    count(size);
+    inside++;
+    void *ptr = malloc(size);
+    inside--;
+    track_new(tag, ptr, size);
+    return ptr;
+}
+
+void* mem_calloc(MemTag tag, size_t nmemb, size_t size) {
+    count(nmemb * size);
+    inside++;
+    void *ptr = calloc(nmemb, size);
+    inside--;
+    track_new(tag, ptr, nmemb * size);
+    return ptr;
+}
+
+void* mem_realloc(MemTag tag, void *ptr, size_t size) {
+    if (!ptr) return mem_malloc(tag, size);
+
+    /* Retirado antes: depois do realloc o endereco antigo nao vale mais */
+    MemTracker *t = tracker;
+    MemBlock block;
+    int tracked = t && tracker_remove(t, ptr, &block);
+
+    count(size);
+    inside++;
+    void *moved = realloc(ptr, size);
+    inside--;
+
+    if (tracked && !moved) {
+        tracker_insert(t, block.ptr, block.size, block.tag);
+    } else if (tracked) {
+        MemTagStats *s = &t->stats.tags[block.tag];
+        s->reallocs++;
+        if (moved != ptr) s->moves++;
+        sub_live(t, block.tag, block.size);
+        tracker_insert(t, moved, size, block.tag);
+        add_live(t, block.tag, size);
+    }
+    return moved;
+}
+
+char* mem_strdup(MemTag tag, const char *s) {
+    size_t size = strlen(s) + 1;
+    count(size);
+    inside++;
+    char *copy = malloc(size);
+    inside--;
+    if (copy) memcpy(copy, s, size);
+    track_new(tag, copy, size);
+    return copy;
+}
+
+char* mem_strndup(MemTag tag, const char *s, size_t n) {
+    size_t len = strnlen(s, n);
+    count(len + 1);
+    inside++;
+    char *copy = malloc(len + 1);
+    inside--;
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    track_new(tag, copy, len + 1);
+    return copy;
+}
+
+void mem_free(void *ptr) {
+    MemTracker *t = tracker;
+    MemBlock block;
+    if (t && ptr && tracker_remove(t, ptr, &block)) sub_live(t, block.tag, block.size);
+    free(ptr);
+}
+
+/* ===== MEDICAO ===== */
+
+void mem_stats_begin(void) {
+    if (tracker) {
+        tracker->depth++;
+        return;
+    }
+    inside++;
+    tracker = calloc(1, sizeof(MemTracker));
+    inside--;
+    tracker->depth = 1;
+    tracker->stats.total = thread_stats;
+}
+
+void mem_stats_end(MemStats *stats) {
+    MemTracker *t = tracker;
+    if (!t) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = t->stats;
+    stats->total.allocations = thread_stats.allocations - t->stats.total.allocations;
+    stats->total.bytes = thread_stats.bytes - t->stats.total.bytes;
+    if (--t->depth > 0) return;
+
+    tracker = NULL;
+    free(t->blocks);
+    free(t);
+}
+
+static const char* tag_name(MemTag tag) {
+    switch (tag) {
+        case MEM_PARSER: return "parser";
+        case MEM_AST: return "ast";
+        case MEM_SEMANTIC: return "semantic";
+        case MEM_CODEGEN: return "codegen";
+        default: return "?";
+    }
+}
+
+void mem_stats_report(const MemStats *stats, const char *name, FILE *out) {
+    long allocations = 0;
+    size_t bytes = 0, live = 0;
+    long reallocs = 0, moves = 0;
+
+    fprintf(out, "\n=== Relatorio de memoria: %s ===\n", name);
+    fprintf(out, "%-12s %11s %12s %12s %10s %10s %10s\n",
+            "Subsistema", "Alocacoes", "Bytes", "Pico", "Reallocs", "Movidos", "Vivos");
+    for (int i = 0; i < MEM_NUM_TAGS; i++) {
+        const MemTagStats *s = &stats->tags[i];
+        fprintf(out, "%-12s %11ld %12zu %12zu %10ld %10ld %10zu\n", tag_name((MemTag)i),
+                s->allocations, s->bytes, s->peak, s->reallocs, s->moves, s->live);
+        allocations += s->allocations;
+        bytes += s->bytes;
+        reallocs += s->reallocs;
+        moves += s->moves;
+        live += s->live;
+    }
+    fprintf(out, "%-12s %11ld %12zu %12zu %10ld %10ld %10zu\n", "Total",
+            allocations, bytes, stats->peak, reallocs, moves, live);
+    /* Com alloc_wrap.c ligado inclui os modulos sem marcacao (peval, */
+    /* cache, ligador...); sem ele, so o que passou por mem_* */
+    fprintf(out, "%-12s %11ld %12zu   (malloc/calloc/realloc/strdup da thread)\n", "Todas",
+            stats->total.allocations, stats->total.bytes);
+}
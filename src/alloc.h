@@ -0,0 +1,87 @@
+/*
+ * alloc.h
+ * Contadores de alocacao de memoria do compilador
+ *
+ * Os subsistemas principais (parser, AST, analise semantica e geracao de
+ * codigo) alocam pelas funcoes mem_*, que contam cada alocacao e marcam o
+ * bloco com o subsistema (MemTag). Os contadores sao por thread, de modo
+ * que compilacoes paralelas (modo batch) nao se misturam.
+ *
+ * Entre mem_stats_begin e mem_stats_end (-mem-stats) cada bloco marcado e
+ * registrado numa tabela da thread: quando e liberado (mem_free) ou
+ * redimensionado (mem_realloc), a memoria viva e o pico do seu subsistema
+ * sao atualizados. Fora disso mem_* sao so as funcoes da libc mais os
+ * contadores.
+ *
+ * O executavel airfryer_parser liga tambem alloc_wrap.c com a opcao --wrap
+ * do ld (ALLOC_WRAP no Makefile), para contar as alocacoes dos modulos que
+ * chamam a libc direto (avaliacao parcial, cache, ligador...). A
+ * biblioteca nao depende disso.
+ */
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Totais acumulados na thread atual */
+typedef struct AllocStats {
+    long allocations;   /* Chamadas que criaram ou redimensionaram um bloco */
+    size_t bytes;       /* Bytes pedidos nessas chamadas */
+} AllocStats;
+
+/* Ler os contadores da thread atual */
+void alloc_stats_get(AllocStats *stats);
+
+/* Contar uma alocacao feita fora das funcoes mem_* (wrappers de */
+/* alloc_wrap.c); as que mem_* fazem na libc nao sao contadas de novo */
+void alloc_count_external(size_t bytes);
+
+/* ===== ALOCACOES POR SUBSISTEMA ===== */
+
+typedef enum {
+    MEM_PARSER,         /* Listas de nos do parser (NodeList) */
+    MEM_AST,            /* Nos da AST e os textos dos tokens que eles guardam */
+    MEM_SEMANTIC,       /* Tabela de simbolos e lista de erros */
+    MEM_CODEGEN,        /* Gerador: variaveis, strings, labels, registradores */
+    MEM_NUM_TAGS
+} MemTag;
+
+/* Contadores de um subsistema */
+typedef struct MemTagStats {
+    long allocations;   /* Blocos criados */
+    size_t bytes;       /* Bytes pedidos nesses blocos */
+    long reallocs;      /* Redimensionamentos de blocos do subsistema */
+    long moves;         /* ... que mudaram o bloco de lugar (copia) */
+    size_t live;        /* Bytes vivos agora */
+    size_t peak;        /* Maior valor de live */
+} MemTagStats;
+
+/* Contadores de uma medicao (mem_stats_begin .. mem_stats_end) */
+typedef struct MemStats {
+    MemTagStats tags[MEM_NUM_TAGS];
+    size_t peak;        /* Pico da soma dos subsistemas */
+    AllocStats total;   /* Todas as alocacoes da thread no periodo */
+} MemStats;
+
+void* mem_malloc(MemTag tag, size_t size);
+void* mem_calloc(MemTag tag, size_t nmemb, size_t size);
+/* Um bloco ja registrado continua com o subsistema em que foi criado */
+void* mem_realloc(MemTag tag, void *ptr, size_t size);
+char* mem_strdup(MemTag tag, const char *s);
+char* mem_strndup(MemTag tag, const char *s, size_t n);
+
+/* Liberar um bloco (marcado ou nao) */
+void mem_free(void *ptr);
+
+/* Comecar a medir na thread atual (medicoes aninhadas viram uma so) */
+void mem_stats_begin(void);
+
+/* Encerrar a medicao e ler os contadores */
+void mem_stats_end(MemStats *stats);
+
+/* Imprimir os contadores como tabela (-mem-stats) */
+void mem_stats_report(const MemStats *stats, const char *name, FILE *out);
+
+#endif /* ALLOC_H */
@@ -0,0 +1,44 @@
+/*
+ * alloc_wrap.c
+ * Wrappers opcionais de malloc/calloc/realloc/strdup/strndup
+ *
+ * Ligados so no executavel, com --wrap (ALLOC_WRAP no Makefile): as
+ * alocacoes de todos os modulos entram nos contadores de alloc.h, nao so
+ * as feitas pelas funcoes mem_*.
+ */
+
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Implementacoes originais (resolvidas pelo ligador com --wrap) */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *s);
+char *__real_strndup(const char *s, size_t n);
+
+void *__wrap_malloc(size_t size) {
+    alloc_count_external(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+    alloc_count_external(nmemb * size);
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    alloc_count_external(size);
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *s) {
+    alloc_count_external(strlen(s) + 1);
+    return __real_strdup(s);
+}
+
+char *__wrap_strndup(const char *s, size_t n) {
+    alloc_count_external(strnlen(s, n) + 1);
+    return __real_strndup(s, n);
+}
@@ -4,17 +4,22 @@
  */
 
 #include "ast.h"
+#include "alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Nos vivos na thread atual (cada compilacao roda em uma unica thread) */
+static __thread long live_nodes = 0;
+
 /* Funcao auxiliar para alocar um no da AST */
 static ASTNode* ast_alloc_node(NodeKind kind) {
-    ASTNode *node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode *node = (ASTNode*)mem_malloc(MEM_AST, sizeof(ASTNode));
     if (!node) {
         fprintf(stderr, "Erro fatal: falha ao alocar memoria para no da AST\n");
         exit(1);
     }
+    live_nodes++;
     node->kind = kind;
     node->data_type = TYPE_UNKNOWN;
     node->line = 0;  /* Sera preenchido pelo parser */
@@ -22,27 +27,59 @@ static ASTNode* ast_alloc_node(NodeKind kind) {
 }
 
 /* Criar no de programa */
-ASTNode* ast_create_programa(const char *nome, ASTNode **items, int num_items) {
+ASTNode* ast_create_programa(char *nome, ASTNode **items, int num_items) {
     ASTNode *node = ast_alloc_node(NODE_PROGRAMA);
-    node->data.programa.nome = strdup(nome);
+    node->data.programa.nome = nome;
     node->data.programa.top_level_items = items;
     node->data.programa.num_items = num_items;
     return node;
 }
 
 /* Criar no de receita */
-ASTNode* ast_create_receita(const char *nome, ASTNode *bloco) {
+ASTNode* ast_create_receita(char *nome, ASTNode *bloco) {
     ASTNode *node = ast_alloc_node(NODE_RECEITA);
-    node->data.receita.nome = strdup(nome);
+    node->data.receita.nome = nome;
     node->data.receita.bloco = bloco;
+    node->data.receita.cache_key = 0;
+    node->data.receita.cached = NULL;
     return node;
 }
 
 /* Criar no de passo */
-ASTNode* ast_create_passo(const char *nome, ASTNode *bloco) {
+ASTNode* ast_create_passo(char *nome, ASTNode *bloco) {
     ASTNode *node = ast_alloc_node(NODE_PASSO);
-    node->data.passo.nome = strdup(nome);
+    node->data.passo.nome = nome;
     node->data.passo.bloco = bloco;
+    node->data.passo.subrotina = 0;
+    node->data.passo.params = NULL;
+    node->data.passo.num_params = 0;
+    node->data.passo.chamado = 0;
+    node->data.passo.referenciado = 0;
+    node->data.passo.externo = 0;
+    return node;
+}
+
+/* Criar no de passo com parametros (subrotina) */
+ASTNode* ast_create_passo_sub(char *nome, ASTNode **params, int num_params, ASTNode *bloco) {
+    ASTNode *node = ast_create_passo(nome, bloco);
+    node->data.passo.subrotina = 1;
+    node->data.passo.params = params;
+    node->data.passo.num_params = num_params;
+    return node;
+}
+
+/* Criar declaracao de passo exportado por outro modulo */
+/* So a assinatura e conhecida: o corpo esta no objeto do modulo */
+ASTNode* ast_create_passo_externo(char *nome, ASTNode **params, int num_params) {
+    ASTNode *node = ast_create_passo_sub(nome, params, num_params, NULL);
+    node->data.passo.externo = 1;
+    return node;
+}
+
+/* Criar no de importacao de modulo */
+ASTNode* ast_create_importar(char *caminho) {
+    ASTNode *node = ast_alloc_node(NODE_IMPORTAR);
+    node->data.importar.caminho = caminho;
     return node;
 }
 
@@ -55,22 +92,43 @@ ASTNode* ast_create_bloco(ASTNode **statements, int num_statements) {
 }
 
 /* Criar no de declaracao */
-ASTNode* ast_create_declaracao(const char *nome, DataType tipo, ASTNode *init_expr) {
+ASTNode* ast_create_declaracao(char *nome, DataType tipo, ASTNode *init_expr) {
     ASTNode *node = ast_alloc_node(NODE_DECLARACAO);
-    node->data.declaracao.nome = strdup(nome);
+    node->data.declaracao.nome = nome;
     node->data.declaracao.tipo = tipo;
     node->data.declaracao.init_expr = init_expr;
+    node->data.declaracao.tamanho = 0;
+    node->data.declaracao.init_list = NULL;
+    node->data.declaracao.num_init = 0;
+    return node;
+}
+
+/* Criar no de declaracao de vetor */
+ASTNode* ast_create_declaracao_vetor(char *nome, DataType tipo, int tamanho,
+                                     ASTNode **init, int num_init) {
+    ASTNode *node = ast_create_declaracao(nome, tipo, NULL);
+    node->data.declaracao.tamanho = tamanho;
+    node->data.declaracao.init_list = init;
+    node->data.declaracao.num_init = num_init;
     return node;
 }
 
 /* Criar no de atribuicao */
-ASTNode* ast_create_atribuicao(const char *nome, ASTNode *expr) {
+ASTNode* ast_create_atribuicao(char *nome, ASTNode *expr) {
     ASTNode *node = ast_alloc_node(NODE_ATRIBUICAO);
-    node->data.atribuicao.nome = strdup(nome);
+    node->data.atribuicao.nome = nome;
+    node->data.atribuicao.indice = NULL;
     node->data.atribuicao.expr = expr;
     return node;
 }
 
+/* Criar no de atribuicao a elemento de vetor */
+ASTNode* ast_create_atribuicao_indice(char *nome, ASTNode *indice, ASTNode *expr) {
+    ASTNode *node = ast_create_atribuicao(nome, expr);
+    node->data.atribuicao.indice = indice;
+    return node;
+}
+
 /* Criar no de preaquecer */
 ASTNode* ast_create_preaquecer(ASTNode *temperatura) {
     ASTNode *node = ast_alloc_node(NODE_PREAQUECER);
@@ -149,6 +207,52 @@ ASTNode* ast_create_enquanto(ASTNode *condicao, ASTNode *bloco) {
     return node;
 }
 
+/* Criar no de para */
+ASTNode* ast_create_para(char *var, ASTNode *inicio, ASTNode *fim, int passo, ASTNode *bloco) {
+    ASTNode *node = ast_alloc_node(NODE_PARA);
+    node->data.para.var = var;
+    node->data.para.inicio = inicio;
+    node->data.para.fim = fim;
+    node->data.para.passo = passo;
+    node->data.para.bloco = bloco;
+    return node;
+}
+
+/* Criar no de quando */
+ASTNode* ast_create_quando(ASTNode *condicao, ASTNode *bloco) {
+    ASTNode *node = ast_alloc_node(NODE_QUANDO);
+    node->data.quando.condicao = condicao;
+    node->data.quando.bloco = bloco;
+    return node;
+}
+
+/* Criar no de chamada de passo */
+ASTNode* ast_create_chamada(char *nome, ASTNode **args, int num_args) {
+    ASTNode *node = ast_alloc_node(NODE_CHAMADA);
+    node->data.chamada.nome = nome;
+    node->data.chamada.args = args;
+    node->data.chamada.num_args = num_args;
+    return node;
+}
+
+/* Criar no de escolha */
+ASTNode* ast_create_escolha(ASTNode *expr, ASTNode **casos, int num_casos, ASTNode *padrao) {
+    ASTNode *node = ast_alloc_node(NODE_ESCOLHA);
+    node->data.escolha.expr = expr;
+    node->data.escolha.casos = casos;
+    node->data.escolha.num_casos = num_casos;
+    node->data.escolha.padrao = padrao;
+    return node;
+}
+
+/* Criar no de caso */
+ASTNode* ast_create_caso(int valor, ASTNode *bloco) {
+    ASTNode *node = ast_alloc_node(NODE_CASO);
+    node->data.caso.valor = valor;
+    node->data.caso.bloco = bloco;
+    return node;
+}
+
 /* Criar no de operacao binaria */
 ASTNode* ast_create_binop(BinOpKind op, ASTNode *left, ASTNode *right) {
     ASTNode *node = ast_alloc_node(NODE_BINOP);
@@ -191,17 +295,33 @@ ASTNode* ast_create_literal_bool(int value) {
 }
 
 /* Criar no de literal string */
-ASTNode* ast_create_literal_str(const char *value) {
+ASTNode* ast_create_literal_str(char *value) {
     ASTNode *node = ast_alloc_node(NODE_LITERAL_STR);
-    node->data.literal_str.value = strdup(value);
+    node->data.literal_str.value = value;
     node->data_type = TYPE_TEXTO;
     return node;
 }
 
 /* Criar no de variavel */
-ASTNode* ast_create_variavel(const char *nome) {
+ASTNode* ast_create_variavel(char *nome) {
     ASTNode *node = ast_alloc_node(NODE_VARIAVEL);
-    node->data.variavel.nome = strdup(nome);
+    node->data.variavel.nome = nome;
+    return node;
+}
+
+/* Criar no de leitura de sensor */
+ASTNode* ast_create_sensor(SensorKind sensor) {
+    ASTNode *node = ast_alloc_node(NODE_SENSOR);
+    node->data_type = TYPE_INTEIRO;
+    node->data.sensor.sensor = sensor;
+    return node;
+}
+
+/* Criar no de acesso a elemento de vetor */
+ASTNode* ast_create_indice(char *nome, ASTNode *indice) {
+    ASTNode *node = ast_alloc_node(NODE_INDICE);
+    node->data.indice.nome = nome;
+    node->data.indice.indice = indice;
     return node;
 }
 
@@ -213,7 +333,8 @@ void ast_bloco_add_statement(ASTNode *bloco, ASTNode *statement) {
     }
     
     int new_size = bloco->data.bloco.num_statements + 1;
-    bloco->data.bloco.statements = (ASTNode**)realloc(
+    bloco->data.bloco.statements = (ASTNode**)mem_realloc(
+        MEM_AST,
         bloco->data.bloco.statements,
         new_size * sizeof(ASTNode*)
     );
@@ -229,7 +350,8 @@ void ast_programa_add_item(ASTNode *programa, ASTNode *item) {
     }
     
     int new_size = programa->data.programa.num_items + 1;
-    programa->data.programa.top_level_items = (ASTNode**)realloc(
+    programa->data.programa.top_level_items = (ASTNode**)mem_realloc(
+        MEM_AST,
         programa->data.programa.top_level_items,
         new_size * sizeof(ASTNode*)
     );
@@ -245,7 +367,8 @@ void ast_imprimir_add_expr(ASTNode *imprimir, ASTNode *expr) {
     }
     
     int new_size = imprimir->data.imprimir.num_exprs + 1;
-    imprimir->data.imprimir.exprs = (ASTNode**)realloc(
+    imprimir->data.imprimir.exprs = (ASTNode**)mem_realloc(
+        MEM_AST,
         imprimir->data.imprimir.exprs,
         new_size * sizeof(ASTNode*)
     );
@@ -259,37 +382,50 @@ void ast_free(ASTNode *node) {
     
     switch (node->kind) {
         case NODE_PROGRAMA:
-            free(node->data.programa.nome);
+            mem_free(node->data.programa.nome);
             for (int i = 0; i < node->data.programa.num_items; i++) {
                 ast_free(node->data.programa.top_level_items[i]);
             }
-            free(node->data.programa.top_level_items);
+            mem_free(node->data.programa.top_level_items);
             break;
             
         case NODE_RECEITA:
-            free(node->data.receita.nome);
+            mem_free(node->data.receita.nome);
             ast_free(node->data.receita.bloco);
             break;
             
         case NODE_PASSO:
-            free(node->data.passo.nome);
+            mem_free(node->data.passo.nome);
+            for (int i = 0; i < node->data.passo.num_params; i++) {
+                ast_free(node->data.passo.params[i]);
+            }
+            mem_free(node->data.passo.params);
             ast_free(node->data.passo.bloco);
             break;
             
+        case NODE_IMPORTAR:
+            mem_free(node->data.importar.caminho);
+            break;
+            
         case NODE_BLOCO:
             for (int i = 0; i < node->data.bloco.num_statements; i++) {
                 ast_free(node->data.bloco.statements[i]);
             }
-            free(node->data.bloco.statements);
+            mem_free(node->data.bloco.statements);
             break;
             
         case NODE_DECLARACAO:
-            free(node->data.declaracao.nome);
+            mem_free(node->data.declaracao.nome);
             ast_free(node->data.declaracao.init_expr);
+            for (int i = 0; i < node->data.declaracao.num_init; i++) {
+                ast_free(node->data.declaracao.init_list[i]);
+            }
+            mem_free(node->data.declaracao.init_list);
             break;
             
         case NODE_ATRIBUICAO:
-            free(node->data.atribuicao.nome);
+            mem_free(node->data.atribuicao.nome);
+            ast_free(node->data.atribuicao.indice);
             ast_free(node->data.atribuicao.expr);
             break;
             
@@ -324,7 +460,7 @@ void ast_free(ASTNode *node) {
             for (int i = 0; i < node->data.imprimir.num_exprs; i++) {
                 ast_free(node->data.imprimir.exprs[i]);
             }
-            free(node->data.imprimir.exprs);
+            mem_free(node->data.imprimir.exprs);
             break;
             
         case NODE_SE:
@@ -338,6 +474,39 @@ void ast_free(ASTNode *node) {
             ast_free(node->data.enquanto.bloco);
             break;
             
+        case NODE_PARA:
+            mem_free(node->data.para.var);
+            ast_free(node->data.para.inicio);
+            ast_free(node->data.para.fim);
+            ast_free(node->data.para.bloco);
+            break;
+            
+        case NODE_QUANDO:
+            ast_free(node->data.quando.condicao);
+            ast_free(node->data.quando.bloco);
+            break;
+            
+        case NODE_CHAMADA:
+            mem_free(node->data.chamada.nome);
+            for (int i = 0; i < node->data.chamada.num_args; i++) {
+                ast_free(node->data.chamada.args[i]);
+            }
+            mem_free(node->data.chamada.args);
+            break;
+            
+        case NODE_ESCOLHA:
+            ast_free(node->data.escolha.expr);
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                ast_free(node->data.escolha.casos[i]);
+            }
+            mem_free(node->data.escolha.casos);
+            ast_free(node->data.escolha.padrao);
+            break;
+            
+        case NODE_CASO:
+            ast_free(node->data.caso.bloco);
+            break;
+            
         case NODE_BINOP:
             ast_free(node->data.binop.left);
             ast_free(node->data.binop.right);
@@ -350,19 +519,370 @@ void ast_free(ASTNode *node) {
         case NODE_LITERAL_INT:
         case NODE_LITERAL_FRAC:
         case NODE_LITERAL_BOOL:
+        case NODE_SENSOR:
             /* Nada para liberar */
             break;
             
         case NODE_LITERAL_STR:
-            free(node->data.literal_str.value);
+            mem_free(node->data.literal_str.value);
             break;
             
         case NODE_VARIAVEL:
-            free(node->data.variavel.nome);
+            mem_free(node->data.variavel.nome);
+            break;
+            
+        case NODE_INDICE:
+            mem_free(node->data.indice.nome);
+            ast_free(node->data.indice.indice);
             break;
     }
     
-    free(node);
+    mem_free(node);
+    live_nodes--;
+}
+
+long ast_live_nodes(void) {
+    return live_nodes;
+}
+
+/* ===== PERCURSO GENERICO ===== */
+
+void ast_for_each_child(ASTNode *node, ASTChildFn fn, void *data) {
+    if (!node) return;
+
+    switch (node->kind) {
+        case NODE_PROGRAMA:
+            for (int i = 0; i < node->data.programa.num_items; i++) {
+                fn(node->data.programa.top_level_items[i], data);
+            }
+            break;
+
+        case NODE_RECEITA:
+            fn(node->data.receita.bloco, data);
+            break;
+
+        case NODE_PASSO:
+            for (int i = 0; i < node->data.passo.num_params; i++) {
+                fn(node->data.passo.params[i], data);
+            }
+            if (node->data.passo.bloco) fn(node->data.passo.bloco, data);
+            break;
+
+        case NODE_BLOCO:
+            for (int i = 0; i < node->data.bloco.num_statements; i++) {
+                fn(node->data.bloco.statements[i], data);
+            }
+            break;
+
+        case NODE_DECLARACAO:
+            if (node->data.declaracao.init_expr) fn(node->data.declaracao.init_expr, data);
+            for (int i = 0; i < node->data.declaracao.num_init; i++) {
+                fn(node->data.declaracao.init_list[i], data);
+            }
+            break;
+
+        case NODE_ATRIBUICAO:
+            if (node->data.atribuicao.indice) fn(node->data.atribuicao.indice, data);
+            fn(node->data.atribuicao.expr, data);
+            break;
+
+        case NODE_PREAQUECER:
+            fn(node->data.preaquecer.temperatura, data);
+            break;
+
+        case NODE_COZINHAR:
+            fn(node->data.cozinhar.temperatura, data);
+            fn(node->data.cozinhar.tempo, data);
+            break;
+
+        case NODE_AQUECER:
+            fn(node->data.aquecer.tempo, data);
+            break;
+
+        case NODE_AGITAR:
+            fn(node->data.agitar.tempo, data);
+            break;
+
+        case NODE_IMPRIMIR:
+            for (int i = 0; i < node->data.imprimir.num_exprs; i++) {
+                fn(node->data.imprimir.exprs[i], data);
+            }
+            break;
+
+        case NODE_SE:
+            fn(node->data.se.condicao, data);
+            fn(node->data.se.bloco_then, data);
+            if (node->data.se.bloco_else) fn(node->data.se.bloco_else, data);
+            break;
+
+        case NODE_ENQUANTO:
+            fn(node->data.enquanto.condicao, data);
+            fn(node->data.enquanto.bloco, data);
+            break;
+
+        case NODE_PARA:
+            fn(node->data.para.inicio, data);
+            fn(node->data.para.fim, data);
+            fn(node->data.para.bloco, data);
+            break;
+
+        case NODE_QUANDO:
+            fn(node->data.quando.condicao, data);
+            fn(node->data.quando.bloco, data);
+            break;
+
+        case NODE_CHAMADA:
+            for (int i = 0; i < node->data.chamada.num_args; i++) {
+                fn(node->data.chamada.args[i], data);
+            }
+            break;
+
+        case NODE_ESCOLHA:
+            fn(node->data.escolha.expr, data);
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                fn(node->data.escolha.casos[i], data);
+            }
+            if (node->data.escolha.padrao) fn(node->data.escolha.padrao, data);
+            break;
+
+        case NODE_CASO:
+            fn(node->data.caso.bloco, data);
+            break;
+
+        case NODE_BINOP:
+            fn(node->data.binop.left, data);
+            fn(node->data.binop.right, data);
+            break;
+
+        case NODE_UNOP:
+            fn(node->data.unop.operand, data);
+            break;
+
+        case NODE_INDICE:
+            fn(node->data.indice.indice, data);
+            break;
+
+        default:
+            /* Folhas: literais, variaveis e comandos sem operandos */
+            break;
+    }
+}
+
+/* ===== HASH ESTRUTURAL ===== */
+
+#define FNV_PRIME 1099511628211ULL
+
+static unsigned long long hash_bytes(unsigned long long h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static unsigned long long hash_int(unsigned long long h, long long value) {
+    return hash_bytes(h, &value, sizeof(value));
+}
+
+/* Strings incluem o terminador para que "ab"+"c" difira de "a"+"bc" */
+static unsigned long long hash_str(unsigned long long h, const char *s) {
+    return s ? hash_bytes(h, s, strlen(s) + 1) : hash_int(h, -1);
+}
+
+unsigned long long ast_hash(ASTNode *node, unsigned long long h) {
+    if (!node) return hash_int(h, -1);
+
+    h = hash_int(h, node->kind);
+
+    switch (node->kind) {
+        case NODE_PROGRAMA:
+            h = hash_str(h, node->data.programa.nome);
+            h = hash_int(h, node->data.programa.num_items);
+            for (int i = 0; i < node->data.programa.num_items; i++) {
+                h = ast_hash(node->data.programa.top_level_items[i], h);
+            }
+            break;
+
+        case NODE_RECEITA:
+            h = hash_str(h, node->data.receita.nome);
+            h = ast_hash(node->data.receita.bloco, h);
+            break;
+
+        case NODE_PASSO:
+            h = hash_str(h, node->data.passo.nome);
+            h = hash_int(h, node->data.passo.subrotina);
+            h = hash_int(h, node->data.passo.num_params);
+            for (int i = 0; i < node->data.passo.num_params; i++) {
+                h = ast_hash(node->data.passo.params[i], h);
+            }
+            h = ast_hash(node->data.passo.bloco, h);
+            break;
+
+        case NODE_IMPORTAR:
+            h = hash_str(h, node->data.importar.caminho);
+            break;
+
+        case NODE_BLOCO:
+            h = hash_int(h, node->data.bloco.num_statements);
+            for (int i = 0; i < node->data.bloco.num_statements; i++) {
+                h = ast_hash(node->data.bloco.statements[i], h);
+            }
+            break;
+
+        case NODE_DECLARACAO:
+            h = hash_str(h, node->data.declaracao.nome);
+            h = hash_int(h, node->data.declaracao.tipo);
+            h = ast_hash(node->data.declaracao.init_expr, h);
+            h = hash_int(h, node->data.declaracao.tamanho);
+            h = hash_int(h, node->data.declaracao.num_init);
+            for (int i = 0; i < node->data.declaracao.num_init; i++) {
+                h = ast_hash(node->data.declaracao.init_list[i], h);
+            }
+            break;
+
+        case NODE_ATRIBUICAO:
+            h = hash_str(h, node->data.atribuicao.nome);
+            h = ast_hash(node->data.atribuicao.indice, h);
+            h = ast_hash(node->data.atribuicao.expr, h);
+            break;
+
+        case NODE_PREAQUECER:
+            h = ast_hash(node->data.preaquecer.temperatura, h);
+            break;
+
+        case NODE_COZINHAR:
+            h = ast_hash(node->data.cozinhar.temperatura, h);
+            h = ast_hash(node->data.cozinhar.tempo, h);
+            h = hash_int(h, node->data.cozinhar.unidade);
+            break;
+
+        case NODE_AQUECER:
+            h = ast_hash(node->data.aquecer.tempo, h);
+            h = hash_int(h, node->data.aquecer.unidade);
+            break;
+
+        case NODE_AGITAR:
+            h = ast_hash(node->data.agitar.tempo, h);
+            break;
+
+        case NODE_SET_MODO:
+            h = hash_int(h, node->data.set_modo.modo);
+            break;
+
+        case NODE_PAUSAR:
+        case NODE_CONTINUAR:
+        case NODE_PARAR:
+            break;
+
+        case NODE_IMPRIMIR:
+            h = hash_int(h, node->data.imprimir.num_exprs);
+            for (int i = 0; i < node->data.imprimir.num_exprs; i++) {
+                h = ast_hash(node->data.imprimir.exprs[i], h);
+            }
+            break;
+
+        case NODE_SE:
+            h = ast_hash(node->data.se.condicao, h);
+            h = ast_hash(node->data.se.bloco_then, h);
+            h = ast_hash(node->data.se.bloco_else, h);
+            break;
+
+        case NODE_ENQUANTO:
+            h = ast_hash(node->data.enquanto.condicao, h);
+            h = ast_hash(node->data.enquanto.bloco, h);
+            break;
+
+        case NODE_PARA:
+            h = hash_str(h, node->data.para.var);
+            h = ast_hash(node->data.para.inicio, h);
+            h = ast_hash(node->data.para.fim, h);
+            h = hash_int(h, node->data.para.passo);
+            h = ast_hash(node->data.para.bloco, h);
+            break;
+
+        case NODE_QUANDO:
+            h = ast_hash(node->data.quando.condicao, h);
+            h = ast_hash(node->data.quando.bloco, h);
+            break;
+
+        case NODE_CHAMADA:
+            h = hash_str(h, node->data.chamada.nome);
+            h = hash_int(h, node->data.chamada.num_args);
+            for (int i = 0; i < node->data.chamada.num_args; i++) {
+                h = ast_hash(node->data.chamada.args[i], h);
+            }
+            break;
+
+        case NODE_ESCOLHA:
+            h = ast_hash(node->data.escolha.expr, h);
+            h = hash_int(h, node->data.escolha.num_casos);
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                h = ast_hash(node->data.escolha.casos[i], h);
+            }
+            h = ast_hash(node->data.escolha.padrao, h);
+            break;
+
+        case NODE_CASO:
+            h = hash_int(h, node->data.caso.valor);
+            h = ast_hash(node->data.caso.bloco, h);
+            break;
+
+        case NODE_SENSOR:
+            h = hash_int(h, node->data.sensor.sensor);
+            break;
+
+        case NODE_BINOP:
+            h = hash_int(h, node->data.binop.op);
+            h = ast_hash(node->data.binop.left, h);
+            h = ast_hash(node->data.binop.right, h);
+            break;
+
+        case NODE_UNOP:
+            h = hash_int(h, node->data.unop.op);
+            h = ast_hash(node->data.unop.operand, h);
+            break;
+
+        case NODE_LITERAL_INT:
+            h = hash_int(h, node->data.literal_int.value);
+            break;
+
+        case NODE_LITERAL_FRAC:
+            h = hash_bytes(h, &node->data.literal_frac.value, sizeof(double));
+            break;
+
+        case NODE_LITERAL_BOOL:
+            h = hash_int(h, node->data.literal_bool.value);
+            break;
+
+        case NODE_LITERAL_STR:
+            h = hash_str(h, node->data.literal_str.value);
+            break;
+
+        case NODE_VARIAVEL:
+            h = hash_str(h, node->data.variavel.nome);
+            break;
+
+        case NODE_INDICE:
+            h = hash_str(h, node->data.indice.nome);
+            h = ast_hash(node->data.indice.indice, h);
+            break;
+    }
+
+    return h;
+}
+
+/* Procurar o passo com parametros de nome dado entre os itens do programa */
+ASTNode* ast_find_passo(ASTNode *programa, const char *nome) {
+    if (!programa || programa->kind != NODE_PROGRAMA) return NULL;
+    for (int i = 0; i < programa->data.programa.num_items; i++) {
+        ASTNode *item = programa->data.programa.top_level_items[i];
+        if (item->kind == NODE_PASSO && item->data.passo.subrotina &&
+            strcmp(item->data.passo.nome, nome) == 0) {
+            return item;
+        }
+    }
+    return NULL;
 }
 
 /* Imprimir a AST (para debug) */
@@ -388,10 +908,23 @@ void ast_print(ASTNode *node, int depth) {
             break;
             
         case NODE_PASSO:
-            printf("PASSO: %s\n", node->data.passo.nome);
+            if (node->data.passo.subrotina) {
+                printf("PASSO: %s (%d parametros)%s\n", node->data.passo.nome,
+                       node->data.passo.num_params,
+                       node->data.passo.externo ? " [importado]" : "");
+                for (int i = 0; i < node->data.passo.num_params; i++) {
+                    ast_print(node->data.passo.params[i], depth + 1);
+                }
+            } else {
+                printf("PASSO: %s\n", node->data.passo.nome);
+            }
             ast_print(node->data.passo.bloco, depth + 1);
             break;
             
+        case NODE_IMPORTAR:
+            printf("IMPORTAR: \"%s\"\n", node->data.importar.caminho);
+            break;
+            
         case NODE_BLOCO:
             printf("BLOCO (%d statements)\n", node->data.bloco.num_statements);
             for (int i = 0; i < node->data.bloco.num_statements; i++) {
@@ -400,16 +933,31 @@ void ast_print(ASTNode *node, int depth) {
             break;
             
         case NODE_DECLARACAO:
-            printf("DECLARACAO: %s : %s\n", 
-                   node->data.declaracao.nome,
-                   ast_type_name(node->data.declaracao.tipo));
+            if (node->data.declaracao.tamanho > 0) {
+                printf("DECLARACAO: %s : %s[%d]\n",
+                       node->data.declaracao.nome,
+                       ast_type_name(node->data.declaracao.tipo),
+                       node->data.declaracao.tamanho);
+            } else {
+                printf("DECLARACAO: %s : %s\n", 
+                       node->data.declaracao.nome,
+                       ast_type_name(node->data.declaracao.tipo));
+            }
             if (node->data.declaracao.init_expr) {
                 ast_print(node->data.declaracao.init_expr, depth + 1);
             }
+            for (int i = 0; i < node->data.declaracao.num_init; i++) {
+                ast_print(node->data.declaracao.init_list[i], depth + 1);
+            }
             break;
             
         case NODE_ATRIBUICAO:
-            printf("ATRIBUICAO: %s =\n", node->data.atribuicao.nome);
+            if (node->data.atribuicao.indice) {
+                printf("ATRIBUICAO: %s[] =\n", node->data.atribuicao.nome);
+                ast_print(node->data.atribuicao.indice, depth + 1);
+            } else {
+                printf("ATRIBUICAO: %s =\n", node->data.atribuicao.nome);
+            }
             ast_print(node->data.atribuicao.expr, depth + 1);
             break;
             
@@ -482,6 +1030,49 @@ void ast_print(ASTNode *node, int depth) {
             ast_print(node->data.enquanto.bloco, depth + 1);
             break;
             
+        case NODE_PARA:
+            printf("PARA: %s (passo %d)\n", node->data.para.var, node->data.para.passo);
+            ast_print(node->data.para.inicio, depth + 1);
+            ast_print(node->data.para.fim, depth + 1);
+            ast_print(node->data.para.bloco, depth + 1);
+            break;
+            
+        case NODE_QUANDO:
+            printf("QUANDO\n");
+            ast_print(node->data.quando.condicao, depth + 1);
+            ast_print(node->data.quando.bloco, depth + 1);
+            break;
+            
+        case NODE_CHAMADA:
+            printf("CHAMADA: %s (%d argumentos)\n", node->data.chamada.nome,
+                   node->data.chamada.num_args);
+            for (int i = 0; i < node->data.chamada.num_args; i++) {
+                ast_print(node->data.chamada.args[i], depth + 1);
+            }
+            break;
+            
+        case NODE_ESCOLHA:
+            printf("ESCOLHA (%d casos)\n", node->data.escolha.num_casos);
+            ast_print(node->data.escolha.expr, depth + 1);
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                ast_print(node->data.escolha.casos[i], depth + 1);
+            }
+            if (node->data.escolha.padrao) {
+                for (int i = 0; i < depth + 1; i++) printf("  ");
+                printf("PADRAO\n");
+                ast_print(node->data.escolha.padrao, depth + 1);
+            }
+            break;
+            
+        case NODE_CASO:
+            printf("CASO: %d\n", node->data.caso.valor);
+            ast_print(node->data.caso.bloco, depth + 1);
+            break;
+            
+        case NODE_SENSOR:
+            printf("SENSOR: %s\n", ast_sensor_name(node->data.sensor.sensor));
+            break;
+            
         case NODE_BINOP:
             printf("BINOP: %s\n", ast_binop_name(node->data.binop.op));
             ast_print(node->data.binop.left, depth + 1);
@@ -512,6 +1103,11 @@ void ast_print(ASTNode *node, int depth) {
         case NODE_VARIAVEL:
             printf("VAR: %s\n", node->data.variavel.nome);
             break;
+            
+        case NODE_INDICE:
+            printf("INDICE: %s[]\n", node->data.indice.nome);
+            ast_print(node->data.indice.indice, depth + 1);
+            break;
     }
 }
 
@@ -556,3 +1152,14 @@ const char* ast_unop_name(UnOpKind op) {
         default: return "???";
     }
 }
+
+/* Obter nome do sensor como string */
+const char* ast_sensor_name(SensorKind sensor) {
+    switch (sensor) {
+        case SENSOR_TEMP: return "TEMP";
+        case SENSOR_WEIGHT: return "WEIGHT";
+        case SENSOR_MODE: return "MODE";
+        case SENSOR_STATE: return "STATE";
+        default: return "???";
+    }
+}
@@ -29,6 +29,7 @@ typedef enum {
     NODE_RECEITA,
     NODE_PASSO,
     NODE_BLOCO,
+    NODE_IMPORTAR,     /* Diretiva importar "modulo.afs"; */
     
     /* Declaracoes */
     NODE_DECLARACAO,
@@ -46,6 +47,11 @@ typedef enum {
     NODE_IMPRIMIR,
     NODE_SE,
     NODE_ENQUANTO,
+    NODE_PARA,         /* Laco contado: para i de A ate B passo K */
+    NODE_QUANDO,       /* Espera por condicao sobre sensores */
+    NODE_CHAMADA,      /* Chamada de passo com parametros: nome(args) */
+    NODE_ESCOLHA,      /* Desvio multiplo: escolha (expr) { caso k: {...} } */
+    NODE_CASO,         /* Um caso do escolha: valor constante e bloco */
     
     /* Expressoes */
     NODE_BINOP,        /* Operacao binaria: +, -, *, /, ==, <, etc */
@@ -54,7 +60,9 @@ typedef enum {
     NODE_LITERAL_FRAC,
     NODE_LITERAL_BOOL,
     NODE_LITERAL_STR,
-    NODE_VARIAVEL      /* Referencia a uma variavel */
+    NODE_VARIAVEL,     /* Referencia a uma variavel */
+    NODE_INDICE,       /* Elemento de vetor: nome[indice] */
+    NODE_SENSOR        /* Leitura de sensor: TEMP, WEIGHT, MODE, STATE */
 } NodeKind;
 
 /* Tipos de operadores binarios */
@@ -88,12 +96,23 @@ typedef enum {
     MODE_ESFIHAS
 } ModoKind;
 
+/* Sensores somente leitura da VM (mesma ordem dos nomes em ast_sensor_name) */
+typedef enum {
+    SENSOR_TEMP,
+    SENSOR_WEIGHT,
+    SENSOR_MODE,
+    SENSOR_STATE
+} SensorKind;
+
 /* Unidade de tempo */
 typedef enum {
     TIME_MINUTOS,
     TIME_SEGUNDOS
 } TimeUnit;
 
+/* Fragmento de codigo compilado (definido em codegen.h) */
+struct CodeFragment;
+
 /* Estrutura generica para nos da AST */
 typedef struct ASTNode {
     NodeKind kind;
@@ -112,14 +131,27 @@ typedef struct ASTNode {
         struct {
             char *nome;
             struct ASTNode *bloco;
+            unsigned long long cache_key;   /* Chave no cache (0 = cache desligado) */
+            struct CodeFragment *cached;    /* Fragmento reaproveitado (NULL = compilar) */
         } receita;
         
         /* NODE_PASSO */
         struct {
             char *nome;
             struct ASTNode *bloco;
+            int subrotina;                /* 1 se declarado com (), chamavel pelo nome */
+            struct ASTNode **params;      /* NODE_DECLARACAO de cada parametro */
+            int num_params;
+            int chamado;                  /* 1 se o codegen ja emitiu CALL/GOTO para ele */
+            int referenciado;             /* 1 se alguma chamada da AST o nomeia (passo 'calls') */
+            int externo;                  /* 1 se definido em modulo importado (sem corpo) */
         } passo;
         
+        /* NODE_IMPORTAR */
+        struct {
+            char *caminho;                /* Como escrito, relativo ao arquivo que importa */
+        } importar;
+        
         /* NODE_BLOCO */
         struct {
             struct ASTNode **statements;
@@ -129,13 +161,17 @@ typedef struct ASTNode {
         /* NODE_DECLARACAO */
         struct {
             char *nome;
-            DataType tipo;
-            struct ASTNode *init_expr;  /* NULL se nao tem inicializacao */
+            DataType tipo;                /* Tipo (do elemento, se vetor) */
+            struct ASTNode *init_expr;    /* NULL se nao tem inicializacao */
+            int tamanho;                  /* Numero de elementos (0 = escalar) */
+            struct ASTNode **init_list;   /* Valores iniciais do vetor (NULL se nao tem) */
+            int num_init;
         } declaracao;
         
         /* NODE_ATRIBUICAO */
         struct {
             char *nome;
+            struct ASTNode *indice;       /* NULL para variavel escalar */
             struct ASTNode *expr;
         } atribuicao;
         
@@ -186,6 +222,42 @@ typedef struct ASTNode {
             struct ASTNode *bloco;
         } enquanto;
         
+        /* NODE_PARA */
+        struct {
+            char *var;                    /* Variavel de controle (so leitura) */
+            struct ASTNode *inicio;       /* A, inclusivo */
+            struct ASTNode *fim;          /* B, inclusivo */
+            int passo;                    /* K, constante diferente de zero */
+            struct ASTNode *bloco;
+        } para;
+        
+        /* NODE_QUANDO */
+        struct {
+            struct ASTNode *condicao;     /* Deve ler ao menos um sensor */
+            struct ASTNode *bloco;        /* Executado uma vez, quando a condicao vale */
+        } quando;
+        
+        /* NODE_CHAMADA */
+        struct {
+            char *nome;                   /* Passo chamado */
+            struct ASTNode **args;
+            int num_args;
+        } chamada;
+        
+        /* NODE_ESCOLHA */
+        struct {
+            struct ASTNode *expr;         /* Seletor inteiro */
+            struct ASTNode **casos;       /* NODE_CASO, na ordem do codigo-fonte */
+            int num_casos;
+            struct ASTNode *padrao;       /* Bloco de 'padrao' (NULL se nao tem) */
+        } escolha;
+        
+        /* NODE_CASO */
+        struct {
+            int valor;                    /* Constante comparada ao seletor */
+            struct ASTNode *bloco;
+        } caso;
+        
         /* NODE_BINOP */
         struct {
             BinOpKind op;
@@ -223,28 +295,57 @@ typedef struct ASTNode {
         struct {
             char *nome;
         } variavel;
+        
+        /* NODE_INDICE */
+        struct {
+            char *nome;
+            struct ASTNode *indice;
+        } indice;
+        
+        /* NODE_SENSOR */
+        struct {
+            SensorKind sensor;
+        } sensor;
     } data;
 } ASTNode;
 
 /* Funcoes para criacao de nos da AST */
+/* Nomes e textos recebidos (char *) passam a pertencer ao no e sao */
+/* liberados por ast_free; quem chama deve passar uma copia propria */
 
 /* Criar no de programa */
-ASTNode* ast_create_programa(const char *nome, ASTNode **items, int num_items);
+ASTNode* ast_create_programa(char *nome, ASTNode **items, int num_items);
 
 /* Criar no de receita */
-ASTNode* ast_create_receita(const char *nome, ASTNode *bloco);
+ASTNode* ast_create_receita(char *nome, ASTNode *bloco);
 
 /* Criar no de passo */
-ASTNode* ast_create_passo(const char *nome, ASTNode *bloco);
+ASTNode* ast_create_passo(char *nome, ASTNode *bloco);
+
+/* Criar no de passo com parametros (subrotina); params pode ser NULL */
+ASTNode* ast_create_passo_sub(char *nome, ASTNode **params, int num_params, ASTNode *bloco);
+
+/* Criar declaracao de passo exportado por outro modulo (bloco NULL) */
+ASTNode* ast_create_passo_externo(char *nome, ASTNode **params, int num_params);
+
+/* Criar no de importacao de modulo */
+ASTNode* ast_create_importar(char *caminho);
 
 /* Criar no de bloco */
 ASTNode* ast_create_bloco(ASTNode **statements, int num_statements);
 
 /* Criar no de declaracao */
-ASTNode* ast_create_declaracao(const char *nome, DataType tipo, ASTNode *init_expr);
+ASTNode* ast_create_declaracao(char *nome, DataType tipo, ASTNode *init_expr);
+
+/* Criar no de declaracao de vetor (init pode ser NULL) */
+ASTNode* ast_create_declaracao_vetor(char *nome, DataType tipo, int tamanho,
+                                     ASTNode **init, int num_init);
 
 /* Criar no de atribuicao */
-ASTNode* ast_create_atribuicao(const char *nome, ASTNode *expr);
+ASTNode* ast_create_atribuicao(char *nome, ASTNode *expr);
+
+/* Criar no de atribuicao a elemento de vetor */
+ASTNode* ast_create_atribuicao_indice(char *nome, ASTNode *indice, ASTNode *expr);
 
 /* Criar nos de comandos tematicos */
 ASTNode* ast_create_preaquecer(ASTNode *temperatura);
@@ -262,6 +363,15 @@ ASTNode* ast_create_imprimir(ASTNode **exprs, int num_exprs);
 /* Criar nos de controle de fluxo */
 ASTNode* ast_create_se(ASTNode *condicao, ASTNode *bloco_then, ASTNode *bloco_else);
 ASTNode* ast_create_enquanto(ASTNode *condicao, ASTNode *bloco);
+ASTNode* ast_create_para(char *var, ASTNode *inicio, ASTNode *fim, int passo, ASTNode *bloco);
+ASTNode* ast_create_quando(ASTNode *condicao, ASTNode *bloco);
+
+/* Criar no de chamada de passo (args pode ser NULL) */
+ASTNode* ast_create_chamada(char *nome, ASTNode **args, int num_args);
+
+/* Criar nos de desvio multiplo (padrao pode ser NULL) */
+ASTNode* ast_create_escolha(ASTNode *expr, ASTNode **casos, int num_casos, ASTNode *padrao);
+ASTNode* ast_create_caso(int valor, ASTNode *bloco);
 
 /* Criar nos de expressoes */
 ASTNode* ast_create_binop(BinOpKind op, ASTNode *left, ASTNode *right);
@@ -269,8 +379,10 @@ ASTNode* ast_create_unop(UnOpKind op, ASTNode *operand);
 ASTNode* ast_create_literal_int(int value);
 ASTNode* ast_create_literal_frac(double value);
 ASTNode* ast_create_literal_bool(int value);
-ASTNode* ast_create_literal_str(const char *value);
-ASTNode* ast_create_variavel(const char *nome);
+ASTNode* ast_create_literal_str(char *value);
+ASTNode* ast_create_variavel(char *nome);
+ASTNode* ast_create_indice(char *nome, ASTNode *indice);
+ASTNode* ast_create_sensor(SensorKind sensor);
 
 /* Adicionar um statement a um bloco (usado durante parsing) */
 void ast_bloco_add_statement(ASTNode *bloco, ASTNode *statement);
@@ -284,6 +396,22 @@ void ast_imprimir_add_expr(ASTNode *imprimir, ASTNode *expr);
 /* Liberar memoria da AST */
 void ast_free(ASTNode *node);
 
+/* Numero de nos alocados e ainda nao liberados na thread atual */
+long ast_live_nodes(void);
+
+/* Chamar fn para cada filho direto de node, na ordem do codigo-fonte */
+/* Filhos opcionais ausentes (NULL) sao omitidos */
+typedef void (*ASTChildFn)(ASTNode *child, void *data);
+void ast_for_each_child(ASTNode *node, ASTChildFn fn, void *data);
+
+/* Hash estrutural de uma subarvore (FNV-1a), combinado com h */
+/* Ignora numeros de linha: so muda quando o codigo muda */
+unsigned long long ast_hash(ASTNode *node, unsigned long long h);
+
+/* Procurar, entre os itens do programa, o passo com parametros de nome dado */
+/* Retorna NULL se nao existe */
+ASTNode* ast_find_passo(ASTNode *programa, const char *nome);
+
 /* Imprimir a AST (para debug) */
 void ast_print(ASTNode *node, int depth);
 
@@ -296,4 +424,7 @@ const char* ast_binop_name(BinOpKind op);
 /* Obter nome do operador unario como string */
 const char* ast_unop_name(UnOpKind op);
 
+/* Obter nome do sensor como string (nome do registrador na VM) */
+const char* ast_sensor_name(SensorKind sensor);
+
 #endif /* AST_H */
@@ -0,0 +1,330 @@
+/*
+ * batch.c
+ * Implementacao da compilacao em lote com pool de threads
+ */
+
+#define _GNU_SOURCE
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define INITIAL_CAPACITY 16
+#define SOURCE_EXT ".afs"
+#define OUTPUT_EXT ".mwasm"
+
+/* Um arquivo a ser compilado */
+typedef struct BatchJob {
+    char *input;           /* Caminho do .afs */
+    char *output;          /* Caminho do .mwasm derivado */
+    char *diag;            /* Diagnosticos capturados (open_memstream) */
+    size_t diag_len;
+    int ok;                /* Resultado da compilacao */
+} BatchJob;
+
+/* Lista dinamica de caminhos de entrada */
+typedef struct PathList {
+    char **paths;
+    int count;
+    int capacity;
+} PathList;
+
+/* Estado compartilhado entre as threads */
+typedef struct BatchQueue {
+    BatchJob *jobs;
+    int num_jobs;
+    int next;              /* Proximo job ainda nao reservado */
+    pthread_mutex_t lock;
+    const BatchOptions *opts;
+} BatchQueue;
+
+/* ===== COLETA DE ENTRADAS ===== */
+
+static void pathlist_add(PathList *list, const char *path) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : INITIAL_CAPACITY;
+        list->paths = realloc(list->paths, list->capacity * sizeof(char*));
+    }
+    list->paths[list->count++] = strdup(path);
+}
+
+static int has_suffix(const char *s, const char *suffix) {
+    size_t len = strlen(s), slen = strlen(suffix);
+    return len >= slen && strcmp(s + len - slen, suffix) == 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int collect_input(PathList *list, const char *path);
+
+/* Percorrer um diretorio recursivamente, em ordem alfabetica */
+static int collect_directory(PathList *list, const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        fprintf(stderr, "Erro: nao foi possivel abrir o diretorio %s\n", dir_path);
+        return 0;
+    }
+
+    PathList entries = {0};
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;  /* ".", ".." e ocultos */
+        char *child;
+        if (asprintf(&child, "%s/%s", dir_path, ent->d_name) < 0) continue;
+        pathlist_add(&entries, child);
+        free(child);
+    }
+    closedir(dir);
+
+    /* readdir nao garante ordem: ordenar para saida deterministica */
+    qsort(entries.paths, entries.count, sizeof(char*), compare_names);
+
+    int ok = 1;
+    for (int i = 0; i < entries.count; i++) {
+        struct stat st;
+        if (stat(entries.paths[i], &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                ok &= collect_directory(list, entries.paths[i]);
+            } else if (S_ISREG(st.st_mode) && has_suffix(entries.paths[i], SOURCE_EXT)) {
+                pathlist_add(list, entries.paths[i]);
+            }
+        }
+        free(entries.paths[i]);
+    }
+    free(entries.paths);
+    return ok;
+}
+
+/* Ler uma lista de entradas (um caminho por linha, '#' comenta) */
+static int collect_manifest(PathList *list, const char *manifest_path) {
+    FILE *f = fopen(manifest_path, "r");
+    if (!f) {
+        fprintf(stderr, "Erro: nao foi possivel abrir a lista %s\n", manifest_path);
+        return 0;
+    }
+
+    int ok = 1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, f)) != -1) {
+        /* Remover espacos nas pontas */
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                           line[len - 1] == ' ' || line[len - 1] == '\t')) {
+            line[--len] = '\0';
+        }
+        char *start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        if (*start == '\0' || *start == '#') continue;
+        ok &= collect_input(list, start);
+    }
+    free(line);
+    fclose(f);
+    return ok;
+}
+
+static int collect_input(PathList *list, const char *path) {
+    if (path[0] == '@') {
+        return collect_manifest(list, path + 1);
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Erro: entrada %s nao encontrada\n", path);
+        return 0;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        return collect_directory(list, path);
+    }
+    pathlist_add(list, path);
+    return 1;
+}
+
+/* ===== CAMINHOS DE SAIDA ===== */
+
+/* foo/bar.afs -> foo/bar.mwasm (ou <outdir>/bar.mwasm) */
+static char* derive_output_path(const char *input, const char *outdir) {
+    const char *base = input;
+    if (outdir) {
+        const char *slash = strrchr(input, '/');
+        if (slash) base = slash + 1;
+    }
+
+    size_t stem_len = strlen(base);
+    if (has_suffix(base, SOURCE_EXT)) stem_len -= strlen(SOURCE_EXT);
+
+    char *out;
+    int n;
+    if (outdir) {
+        n = asprintf(&out, "%s/%.*s%s", outdir, (int)stem_len, base, OUTPUT_EXT);
+    } else {
+        n = asprintf(&out, "%.*s%s", (int)stem_len, base, OUTPUT_EXT);
+    }
+    return n < 0 ? NULL : out;
+}
+
+static int compare_outputs(const void *a, const void *b) {
+    const BatchJob *ja = *(BatchJob* const*)a, *jb = *(BatchJob* const*)b;
+    return strcmp(ja->output, jb->output);
+}
+
+/* Duas entradas com a mesma saida (mesmo nome em diretorios diferentes */
+/* com -outdir, ou a mesma entrada repetida) gravariam o mesmo arquivo ao */
+/* mesmo tempo, e a limpeza de uma falha apagaria a saida da outra */
+/* Retorna 1 se todas as saidas sao distintas, 0 se alguma se repete */
+static int check_output_collisions(BatchJob *jobs, int num_jobs) {
+    BatchJob **sorted = malloc(num_jobs * sizeof(BatchJob*));
+    int count = 0;
+    for (int i = 0; i < num_jobs; i++) {
+        if (jobs[i].output) sorted[count++] = &jobs[i];
+    }
+    qsort(sorted, count, sizeof(BatchJob*), compare_outputs);
+
+    int ok = 1;
+    for (int i = 1; i < count; i++) {
+        if (strcmp(sorted[i - 1]->output, sorted[i]->output) == 0) {
+            fprintf(stderr, "Erro: %s e %s gravariam a mesma saida %s\n",
+                    sorted[i - 1]->input, sorted[i]->input, sorted[i]->output);
+            ok = 0;
+        }
+    }
+    free(sorted);
+    return ok;
+}
+
+/* ===== POOL DE THREADS ===== */
+
+static void run_job(BatchJob *job, const BatchOptions *opts) {
+    FILE *diag = open_memstream(&job->diag, &job->diag_len);
+    if (!diag) {
+        job->ok = 0;
+        return;
+    }
+
+    if (!job->output) {
+        fprintf(diag, "Erro: nao foi possivel derivar o caminho de saida\n");
+        job->ok = 0;
+    } else {
+        job->ok = compile_file(job->input, job->output, &opts->compile, diag);
+    }
+
+    fclose(diag);
+}
+
+static void* batch_worker(void *arg) {
+    BatchQueue *queue = (BatchQueue*)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int idx = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (idx >= queue->num_jobs) break;
+        run_job(&queue->jobs[idx], queue->opts);
+    }
+    return NULL;
+}
+
+static int default_jobs(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/* ===== FUNCAO PRINCIPAL ===== */
+
+void batch_options_init(BatchOptions *opts) {
+    opts->jobs = 0;
+    opts->outdir = NULL;
+    opts->verbose = 0;
+    compile_options_init(&opts->compile);
+    opts->compile.quiet = 1;
+}
+
+int batch_compile(char **inputs, int num_inputs, const BatchOptions *opts) {
+    PathList files = {0};
+    int inputs_ok = 1;
+    for (int i = 0; i < num_inputs; i++) {
+        inputs_ok &= collect_input(&files, inputs[i]);
+    }
+
+    if (files.count == 0) {
+        fprintf(stderr, "Erro: nenhum arquivo %s encontrado\n", SOURCE_EXT);
+        free(files.paths);
+        return 0;
+    }
+
+    BatchQueue queue;
+    queue.jobs = calloc(files.count, sizeof(BatchJob));
+    queue.num_jobs = files.count;
+    queue.next = 0;
+    queue.opts = opts;
+
+    for (int i = 0; i < files.count; i++) {
+        queue.jobs[i].input = files.paths[i];
+        queue.jobs[i].output = derive_output_path(files.paths[i], opts->outdir);
+    }
+
+    if (!check_output_collisions(queue.jobs, queue.num_jobs)) {
+        for (int i = 0; i < queue.num_jobs; i++) {
+            free(queue.jobs[i].input);
+            free(queue.jobs[i].output);
+        }
+        free(queue.jobs);
+        free(files.paths);
+        return 0;
+    }
+
+    if (opts->outdir) {
+        mkdir(opts->outdir, 0777);  /* Ignorar erro se ja existe */
+    }
+
+    pthread_mutex_init(&queue.lock, NULL);
+
+    /* Nao criar mais threads do que arquivos */
+    int num_threads = opts->jobs > 0 ? opts->jobs : default_jobs();
+    if (num_threads > files.count) num_threads = files.count;
+
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, &queue) != 0) break;
+        started++;
+    }
+    /* Sem threads extras, a propria thread principal processa a fila */
+    if (started == 0) batch_worker(&queue);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&queue.lock);
+
+    /* Diagnosticos agregados, na ordem das entradas */
+    int failures = 0;
+    for (int i = 0; i < queue.num_jobs; i++) {
+        BatchJob *job = &queue.jobs[i];
+        if (!job->ok) failures++;
+        if ((!job->ok || opts->verbose || opts->compile.time_report || opts->compile.mem_stats) && job->diag_len > 0) {
+            fprintf(stderr, "=== %s ===\n", job->input);
+            fwrite(job->diag, 1, job->diag_len, stderr);
+        }
+        if (!job->ok && !job->diag) {
+            fprintf(stderr, "=== %s ===\nErro: falha ao capturar diagnosticos\n", job->input);
+        }
+        free(job->diag);
+        free(job->input);
+        free(job->output);
+    }
+    free(queue.jobs);
+    free(files.paths);
+
+    fprintf(stderr, "Batch: %d arquivo(s) compilado(s), %d falha(s), %d thread(s)\n",
+            queue.num_jobs - failures, failures, started > 0 ? started : 1);
+
+    return inputs_ok && failures == 0;
+}
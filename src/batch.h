@@ -0,0 +1,32 @@
+/*
+ * batch.h
+ * Compilacao em lote de varios arquivos AirFryerScript
+ *
+ * Recebe arquivos, diretorios (percorridos recursivamente em busca de
+ * .afs) e listas "@arquivo" (um caminho por linha) e compila tudo em um
+ * pool de threads dentro de um unico processo. Os diagnosticos de cada
+ * arquivo sao capturados separadamente e impressos na ordem das entradas,
+ * de modo que a saida nao depende do escalonamento das threads.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "driver.h"
+
+/* Opcoes do modo batch */
+typedef struct BatchOptions {
+    int jobs;              /* Numero de threads (0 = numero de CPUs) */
+    const char *outdir;    /* Diretorio de saida (NULL = ao lado da entrada) */
+    int verbose;           /* 1 para imprimir diagnosticos de todos os arquivos */
+    CompileOptions compile;
+} BatchOptions;
+
+/* Preencher opcoes com valores padrao */
+void batch_options_init(BatchOptions *opts);
+
+/* Compilar todas as entradas */
+/* Retorna 1 se todos os arquivos compilaram, 0 se algum falhou */
+int batch_compile(char **inputs, int num_inputs, const BatchOptions *opts);
+
+#endif /* BATCH_H */
@@ -0,0 +1,402 @@
+/*
+ * cache.c
+ * Implementacao do cache incremental de receitas
+ */
+
+#define _GNU_SOURCE
+#include "cache.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Incrementar sempre que o formato do arquivo ou do fragmento mudar */
+#define CACHE_FORMAT_VERSION 2
+#define CACHE_EXT ".afc"
+#define INITIAL_CAPACITY 16
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* ===== HASH ===== */
+
+static unsigned long long mix_bytes(unsigned long long h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static unsigned long long mix_int(unsigned long long h, long long value) {
+    return mix_bytes(h, &value, sizeof(value));
+}
+
+static unsigned long long mix_str(unsigned long long h, const char *s) {
+    return mix_bytes(h, s, strlen(s) + 1);
+}
+
+/* Hash do executavel do compilador: qualquer mudanca no compilador */
+/* invalida todo o cache. Calculado uma vez por processo. */
+static unsigned long long compiler_hash_value;
+static pthread_once_t compiler_hash_once = PTHREAD_ONCE_INIT;
+
+static void compute_compiler_hash(void) {
+    unsigned long long h = mix_int(FNV_OFFSET, CACHE_FORMAT_VERSION);
+    FILE *exe = fopen("/proc/self/exe", "rb");
+    if (exe) {
+        unsigned char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), exe)) > 0) {
+            h = mix_bytes(h, buf, n);
+        }
+        fclose(exe);
+    } else {
+        /* Sem /proc: usar a data de compilacao deste modulo */
+        h = mix_str(h, __DATE__ " " __TIME__);
+    }
+    compiler_hash_value = h;
+}
+
+/* ===== ARQUIVOS DO CACHE ===== */
+
+static char* entry_path(RecipeCache *cache, unsigned long long key) {
+    char *path;
+    if (asprintf(&path, "%s/%016llx%s", cache->dir, key, CACHE_EXT) < 0) return NULL;
+    return path;
+}
+
+/* Ler um bloco "<tamanho>\n<bytes>\n" */
+static char* read_block(FILE *f, size_t *out_len) {
+    size_t len;
+    if (fscanf(f, "%zu", &len) != 1 || fgetc(f) != '\n') return NULL;
+    char *data = (char*)malloc(len + 1);
+    if (fread(data, 1, len, f) != len || fgetc(f) != '\n') {
+        free(data);
+        return NULL;
+    }
+    data[len] = '\0';
+    if (out_len) *out_len = len;
+    return data;
+}
+
+static void write_block(FILE *f, const char *data, size_t len) {
+    fprintf(f, "%zu\n", len);
+    fwrite(data, 1, len, f);
+    fputc('\n', f);
+}
+
+/* ===== FRAGMENTOS ===== */
+
+CodeFragment* cache_read_fragment(FILE *f) {
+    CodeFragment *frag = (CodeFragment*)calloc(1, sizeof(CodeFragment));
+    int ok = fscanf(f, "labels %d\nstrings %d\n", &frag->num_labels, &frag->num_strings) == 2 &&
+             frag->num_labels >= 0 && frag->num_strings >= 0;
+
+    if (ok) {
+        frag->strings = (char**)calloc(frag->num_strings + 1, sizeof(char*));
+        for (int i = 0; ok && i < frag->num_strings; i++) {
+            frag->strings[i] = read_block(f, NULL);
+            ok = frag->strings[i] != NULL;
+        }
+    } else {
+        frag->num_strings = 0;
+    }
+
+    if (ok) {
+        ok = fscanf(f, "vars %d\n", &frag->num_vars) == 1 && frag->num_vars >= 0;
+        if (ok) {
+            frag->vars = calloc(frag->num_vars + 1, sizeof(*frag->vars));
+            for (int i = 0; ok && i < frag->num_vars; i++) {
+                char name[256];
+                int type;
+                ok = fscanf(f, "%255s %d %d\n", name, &type, &frag->vars[i].location) == 3;
+                if (ok) {
+                    frag->vars[i].var_name = strdup(name);
+                    frag->vars[i].type = (DataType)type;
+                }
+            }
+        } else {
+            frag->num_vars = 0;
+        }
+    }
+
+    if (ok) {
+        ok = fscanf(f, "arrays %d\n", &frag->num_arrays) == 1 && frag->num_arrays >= 0;
+        if (ok) {
+            frag->arrays = calloc(frag->num_arrays + 1, sizeof(*frag->arrays));
+            for (int i = 0; ok && i < frag->num_arrays; i++) {
+                char name[256];
+                int type;
+                ok = fscanf(f, "%255s %d %d %d\n", name, &type,
+                            &frag->arrays[i].base, &frag->arrays[i].size) == 4;
+                if (ok) {
+                    frag->arrays[i].var_name = strdup(name);
+                    frag->arrays[i].type = (DataType)type;
+                }
+            }
+        } else {
+            frag->num_arrays = 0;
+        }
+    }
+
+    if (ok) {
+        ok = fscanf(f, "code ") == 0;
+        frag->code = ok ? read_block(f, &frag->code_len) : NULL;
+        ok = frag->code != NULL;
+    }
+
+    if (!ok) {
+        codegen_fragment_free(frag);
+        return NULL;
+    }
+    return frag;
+}
+
+void cache_write_fragment(FILE *f, const CodeFragment *frag) {
+    fprintf(f, "labels %d\nstrings %d\n", frag->num_labels, frag->num_strings);
+    for (int i = 0; i < frag->num_strings; i++) {
+        write_block(f, frag->strings[i], strlen(frag->strings[i]));
+    }
+    fprintf(f, "vars %d\n", frag->num_vars);
+    for (int i = 0; i < frag->num_vars; i++) {
+        fprintf(f, "%s %d %d\n", frag->vars[i].var_name,
+                (int)frag->vars[i].type, frag->vars[i].location);
+    }
+    fprintf(f, "arrays %d\n", frag->num_arrays);
+    for (int i = 0; i < frag->num_arrays; i++) {
+        fprintf(f, "%s %d %d %d\n", frag->arrays[i].var_name,
+                (int)frag->arrays[i].type, frag->arrays[i].base, frag->arrays[i].size);
+    }
+    fprintf(f, "code ");
+    write_block(f, frag->code, frag->code_len);
+}
+
+/* Carregar um fragmento; NULL se ausente ou invalido */
+static CodeFragment* cache_load(RecipeCache *cache, unsigned long long key) {
+    char *path = entry_path(cache, key);
+    if (!path) return NULL;
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (!f) return NULL;
+
+    int version;
+    unsigned long long file_key;
+    CodeFragment *frag = NULL;
+    if (fscanf(f, "AFC %d\nkey %llx\n", &version, &file_key) == 2 &&
+        version == CACHE_FORMAT_VERSION && file_key == key) {
+        frag = cache_read_fragment(f);
+    }
+    fclose(f);
+
+    /* Arquivo corrompido ou de outra versao: tratar como ausente */
+    if (frag) frag->key = key;
+    return frag;
+}
+
+/* Gravar um fragmento de forma atomica (arquivo temporario + rename) */
+static int cache_write(RecipeCache *cache, const CodeFragment *frag) {
+    char *path = entry_path(cache, frag->key);
+    char *tmp_path;
+    if (!path || asprintf(&tmp_path, "%s/.tmp-XXXXXX", cache->dir) < 0) {
+        free(path);
+        return 0;
+    }
+
+    int fd = mkstemp(tmp_path);
+    FILE *f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!f) {
+        if (fd >= 0) close(fd);
+        free(path);
+        free(tmp_path);
+        return 0;
+    }
+
+    fprintf(f, "AFC %d\nkey %016llx\n", CACHE_FORMAT_VERSION, frag->key);
+    cache_write_fragment(f, frag);
+
+    int ok = fclose(f) == 0 && rename(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+
+    free(path);
+    free(tmp_path);
+    return ok;
+}
+
+/* ===== PLANEJAMENTO ===== */
+
+/* Reproduzir, em um gerador auxiliar, as alocacoes de registradores e de */
+/* memoria que a geracao de codigo fara (mesma ordem de visita dos comandos) */
+static void replay_declarations(CodeGenerator *scratch, ASTNode *node) {
+    if (!node) return;
+
+    switch (node->kind) {
+        case NODE_RECEITA:
+            replay_declarations(scratch, node->data.receita.bloco);
+            break;
+        case NODE_PASSO:
+            /* Subrotinas sao geradas depois de todas as receitas */
+            if (node->data.passo.subrotina) break;
+            replay_declarations(scratch, node->data.passo.bloco);
+            break;
+        case NODE_BLOCO:
+            for (int i = 0; i < node->data.bloco.num_statements; i++) {
+                replay_declarations(scratch, node->data.bloco.statements[i]);
+            }
+            break;
+        case NODE_SE:
+            replay_declarations(scratch, node->data.se.bloco_then);
+            replay_declarations(scratch, node->data.se.bloco_else);
+            break;
+        case NODE_ENQUANTO:
+            replay_declarations(scratch, node->data.enquanto.bloco);
+            break;
+        case NODE_QUANDO:
+            replay_declarations(scratch, node->data.quando.bloco);
+            break;
+        case NODE_ESCOLHA:
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                replay_declarations(scratch, node->data.escolha.casos[i]->data.caso.bloco);
+            }
+            replay_declarations(scratch, node->data.escolha.padrao);
+            break;
+        case NODE_PARA: {
+            /* O registrador da variavel de controle volta ao fim do laco */
+            int vars_before = scratch->num_vars;
+            if (codegen_para_reads_var(node)) {
+                mem_free(codegen_alloc_register(scratch, node->data.para.var, TYPE_INTEIRO));
+            }
+            int fresh = scratch->num_vars > vars_before;
+            replay_declarations(scratch, node->data.para.bloco);
+            if (fresh) codegen_free_register(scratch, node->data.para.var);
+            break;
+        }
+        case NODE_DECLARACAO:
+            if (node->data.declaracao.tamanho > 0) {
+                codegen_alloc_array(scratch, node->data.declaracao.nome,
+                                    node->data.declaracao.tipo, node->data.declaracao.tamanho);
+            } else {
+                mem_free(codegen_alloc_register(scratch, node->data.declaracao.nome,
+                                            node->data.declaracao.tipo));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void remember_loaded(RecipeCache *cache, CodeFragment *frag) {
+    if (cache->num_loaded >= cache->loaded_capacity) {
+        cache->loaded_capacity = cache->loaded_capacity ?
+                                 cache->loaded_capacity * 2 : INITIAL_CAPACITY;
+        cache->loaded = realloc(cache->loaded, cache->loaded_capacity * sizeof(CodeFragment*));
+    }
+    cache->loaded[cache->num_loaded++] = frag;
+}
+
+void cache_plan(RecipeCache *cache, ASTNode *root) {
+    if (!cache || !root || root->kind != NODE_PROGRAMA) return;
+
+    CodeGenerator *scratch = codegen_create(NULL);
+    unsigned long long globals = FNV_OFFSET;
+
+    /* Chamadas podem expandir o corpo de um passo definido em qualquer */
+    /* ponto do programa: toda receita depende de todos eles */
+    unsigned long long steps = FNV_OFFSET;
+    for (int i = 0; i < root->data.programa.num_items; i++) {
+        ASTNode *item = root->data.programa.top_level_items[i];
+        if (item->kind == NODE_PASSO && item->data.passo.subrotina) {
+            steps = ast_hash(item, steps);
+        }
+    }
+
+    for (int i = 0; i < root->data.programa.num_items; i++) {
+        ASTNode *item = root->data.programa.top_level_items[i];
+
+        if (item->kind == NODE_RECEITA) {
+            unsigned long long key = cache->compiler_hash;
+            key = ast_hash(item, key);
+            key = mix_int(key, (long long)globals);
+            key = mix_int(key, (long long)steps);
+            for (int v = 0; v < scratch->num_vars; v++) {
+                key = mix_str(key, scratch->var_map[v].var_name);
+                key = mix_int(key, scratch->var_map[v].type);
+                key = mix_int(key, scratch->var_map[v].location);
+            }
+            for (int a = 0; a < scratch->num_arrays; a++) {
+                key = mix_str(key, scratch->arrays[a].var_name);
+                key = mix_int(key, scratch->arrays[a].type);
+                key = mix_int(key, scratch->arrays[a].base);
+                key = mix_int(key, scratch->arrays[a].size);
+            }
+            key = mix_int(key, scratch->memory_size);
+            if (key == 0) key = 1;  /* 0 significa "sem cache" */
+
+            item->data.receita.cache_key = key;
+            item->data.receita.cached = cache_load(cache, key);
+            if (item->data.receita.cached) {
+                cache->hits++;
+                remember_loaded(cache, item->data.receita.cached);
+            } else {
+                cache->misses++;
+            }
+        } else if (item->kind == NODE_DECLARACAO) {
+            globals = mix_str(globals, item->data.declaracao.nome);
+            globals = mix_int(globals, item->data.declaracao.tipo);
+            globals = mix_int(globals, item->data.declaracao.tamanho);
+        }
+
+        replay_declarations(scratch, item);
+    }
+
+    codegen_free(scratch);
+}
+
+/* ===== API ===== */
+
+unsigned long long cache_compiler_hash(void) {
+    pthread_once(&compiler_hash_once, compute_compiler_hash);
+    return compiler_hash_value;
+}
+
+RecipeCache* cache_open(const char *dir, FILE *diag) {
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(diag, "Aviso: nao foi possivel criar o diretorio de cache %s\n", dir);
+        return NULL;
+    }
+
+    RecipeCache *cache = (RecipeCache*)calloc(1, sizeof(RecipeCache));
+    cache->dir = strdup(dir);
+    cache->compiler_hash = cache_compiler_hash();
+    cache->diag = diag;
+    return cache;
+}
+
+void cache_store(RecipeCache *cache, CodeGenerator *gen) {
+    if (!cache) return;
+
+    for (int i = 0; i < gen->num_new_fragments; i++) {
+        if (cache_write(cache, gen->new_fragments[i])) {
+            cache->stored++;
+        } else {
+            fprintf(cache->diag, "Aviso: nao foi possivel gravar no cache %s\n", cache->dir);
+            break;
+        }
+    }
+}
+
+void cache_close(RecipeCache *cache) {
+    if (!cache) return;
+
+    for (int i = 0; i < cache->num_loaded; i++) {
+        codegen_fragment_free(cache->loaded[i]);
+    }
+    free(cache->loaded);
+    free(cache->dir);
+    free(cache);
+}
@@ -0,0 +1,67 @@
+/*
+ * cache.h
+ * Cache incremental de compilacao por receita
+ *
+ * Cada receita de nivel superior recebe uma chave (hash) que combina:
+ * - o binario do compilador e a versao do formato do cache;
+ * - a estrutura da propria receita (ast_hash, sem numeros de linha);
+ * - as declaracoes globais visiveis (nome e tipo);
+ * - o mapeamento de variaveis para registradores na entrada da receita.
+ * Se qualquer um deles muda, a chave muda e a receita e recompilada;
+ * entradas antigas simplesmente deixam de ser usadas (apagar o
+ * diretorio do cache e sempre seguro).
+ *
+ * Receitas encontradas no cache pulam analise semantica e geracao de
+ * codigo: seu fragmento relocavel e apenas inserido (codegen_link_fragment).
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "ast.h"
+#include "codegen.h"
+#include <stdio.h>
+
+/* Cache em disco (um arquivo .afc por fragmento) */
+typedef struct RecipeCache {
+    char *dir;                        /* Diretorio do cache */
+    unsigned long long compiler_hash; /* Hash do binario do compilador */
+    FILE *diag;                       /* Destino dos avisos */
+    
+    /* Fragmentos carregados (referenciados pelos nos da AST) */
+    CodeFragment **loaded;
+    int num_loaded;
+    int loaded_capacity;
+    
+    int hits;                         /* Receitas reaproveitadas */
+    int misses;                       /* Receitas recompiladas */
+    int stored;                       /* Fragmentos gravados */
+} RecipeCache;
+
+/* Abrir (criando se necessario) o diretorio do cache */
+/* Retorna NULL se o diretorio nao puder ser usado */
+RecipeCache* cache_open(const char *dir, FILE *diag);
+
+/* Calcular as chaves das receitas e carregar as que estao no cache */
+/* Preenche cache_key e cached nos nos NODE_RECEITA de root */
+void cache_plan(RecipeCache *cache, ASTNode *root);
+
+/* Gravar os fragmentos gerados por gen (gen->new_fragments) */
+void cache_store(RecipeCache *cache, CodeGenerator *gen);
+
+/* Hash do binario do compilador (muda a cada recompilacao do compilador) */
+unsigned long long cache_compiler_hash(void);
+
+/* Ler um fragmento (labels, strings, variaveis, vetores e codigo) no */
+/* formato dos arquivos do cache; tambem usado pelos objetos de modulo */
+/* Retorna NULL se o conteudo for invalido */
+CodeFragment* cache_read_fragment(FILE *f);
+
+/* Gravar um fragmento no formato lido por cache_read_fragment */
+void cache_write_fragment(FILE *f, const CodeFragment *frag);
+
+/* Liberar o cache e os fragmentos carregados */
+/* Deve ser chamado apenas apos a geracao de codigo */
+void cache_close(RecipeCache *cache);
+
+#endif /* CACHE_H */
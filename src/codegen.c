@@ -4,13 +4,20 @@
  */
 
 #include "codegen.h"
+#include "codegen_x86.h"
 #include "semantic.h"
+#include "alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define INITIAL_CAPACITY 16
 #define MAX_LABEL_LEN 64
+/* Nome de registrador: prefixo + qualquer int + terminador */
+#define MAX_REG_LEN 16
+
+/* Corpo de passo com ate este numero de nos e expandido em cada chamada */
+#define INLINE_MAX_NODES 12
 
 /* Registradores disponiveis para variaveis: R0, R1, R2, R3 */
 static const char* AVAILABLE_REGS[] = {"R0", "R1", "R2", "R3"};
@@ -24,22 +31,44 @@ static void codegen_collect_strings(CodeGenerator *gen, ASTNode *node);
 /* ===== CRIACAO E LIBERACAO ===== */
 
 CodeGenerator* codegen_create(FILE *output) {
-    CodeGenerator *gen = (CodeGenerator*)malloc(sizeof(CodeGenerator));
+    CodeGenerator *gen = (CodeGenerator*)mem_malloc(MEM_CODEGEN, sizeof(CodeGenerator));
     gen->output = output;
+    gen->diag = stderr;
+    gen->target = TARGET_AIRFRYER;
     gen->label_counter = 0;
     gen->string_counter = 0;
     gen->temp_reg_counter = 0;
     
     /* Inicializar mapeamento de variaveis */
-    gen->var_map = malloc(INITIAL_CAPACITY * sizeof(*gen->var_map));
+    gen->var_map = mem_malloc(MEM_CODEGEN, INITIAL_CAPACITY * sizeof(*gen->var_map));
     gen->num_vars = 0;
     gen->capacity = INITIAL_CAPACITY;
     
+    /* Inicializar vetores */
+    gen->arrays = NULL;
+    gen->num_arrays = 0;
+    gen->arrays_capacity = 0;
+    gen->memory_size = 0;
+    
     /* Inicializar string table */
-    gen->strings = malloc(INITIAL_CAPACITY * sizeof(*gen->strings));
+    gen->strings = mem_malloc(MEM_CODEGEN, INITIAL_CAPACITY * sizeof(*gen->strings));
     gen->num_strings = 0;
     gen->string_capacity = INITIAL_CAPACITY;
     
+    gen->num_errors = 0;
+    gen->fragment_mode = 0;
+    gen->module_mode = 0;
+    gen->export_all = 0;
+    gen->strings_collected = 0;
+    gen->calls_collected = 0;
+    gen->para_depth = 0;
+    gen->program = NULL;
+    gen->current_passo = NULL;
+    gen->in_tail = 0;
+    gen->new_fragments = NULL;
+    gen->num_new_fragments = 0;
+    gen->new_fragments_capacity = 0;
+    
     return gen;
 }
 
@@ -48,17 +77,29 @@ void codegen_free(CodeGenerator *gen) {
     
     /* Liberar mapeamento de variaveis */
     for (int i = 0; i < gen->num_vars; i++) {
-        free(gen->var_map[i].var_name);
+        mem_free(gen->var_map[i].var_name);
+    }
+    mem_free(gen->var_map);
+    
+    /* Liberar vetores */
+    for (int i = 0; i < gen->num_arrays; i++) {
+        mem_free(gen->arrays[i].var_name);
     }
-    free(gen->var_map);
+    mem_free(gen->arrays);
     
     /* Liberar string table */
     for (int i = 0; i < gen->num_strings; i++) {
-        free(gen->strings[i].text);
+        mem_free(gen->strings[i].text);
+    }
+    mem_free(gen->strings);
+    
+    /* Liberar fragmentos gerados */
+    for (int i = 0; i < gen->num_new_fragments; i++) {
+        codegen_fragment_free(gen->new_fragments[i]);
     }
-    free(gen->strings);
+    mem_free(gen->new_fragments);
     
-    free(gen);
+    mem_free(gen);
 }
 
 /* ===== EMISSAO DE CODIGO ===== */
@@ -89,8 +130,10 @@ void codegen_label(CodeGenerator *gen, const char *label) {
 }
 
 char* codegen_new_label(CodeGenerator *gen, const char *prefix) {
-    char *label = (char*)malloc(MAX_LABEL_LEN);
-    snprintf(label, MAX_LABEL_LEN, "%s_%d", prefix, gen->label_counter++);
+    char *label = (char*)mem_malloc(MEM_CODEGEN, MAX_LABEL_LEN);
+    /* Em fragmentos o numero e local e marcado com '@' para relocacao */
+    snprintf(label, MAX_LABEL_LEN, gen->fragment_mode ? "%s_@%d" : "%s_%d",
+             prefix, gen->label_counter++);
     return label;
 }
 
@@ -107,18 +150,95 @@ int codegen_add_string(CodeGenerator *gen, const char *text) {
     /* Expandir se necessario */
     if (gen->num_strings >= gen->string_capacity) {
         gen->string_capacity *= 2;
-        gen->strings = realloc(gen->strings, gen->string_capacity * sizeof(*gen->strings));
+        gen->strings = mem_realloc(MEM_CODEGEN, gen->strings, gen->string_capacity * sizeof(*gen->strings));
     }
     
     /* Adicionar nova string */
     int id = gen->string_counter++;
-    gen->strings[gen->num_strings].text = strdup(text);
+    gen->strings[gen->num_strings].text = mem_strdup(MEM_CODEGEN, text);
     gen->strings[gen->num_strings].id = id;
     gen->num_strings++;
     
     return id;
 }
 
+/* Operando que referencia uma string (relocavel em fragmentos) */
+static void codegen_string_operand(CodeGenerator *gen, int id, char *buf, size_t size) {
+    snprintf(buf, size, gen->fragment_mode ? "$%d" : "%d", id);
+}
+
+/* ===== TEMPLATES DE IMPRESSAO ===== */
+
+/* Texto de um argumento de imprimir conhecido em compilacao, como a VM o */
+/* imprimiria; retorna 0 se o valor so existe em execucao */
+int codegen_print_constant(ASTNode *expr, char *buf, size_t size) {
+    switch (expr->kind) {
+        case NODE_LITERAL_INT:
+            snprintf(buf, size, "%d", expr->data.literal_int.value);
+            return 1;
+        case NODE_LITERAL_FRAC:
+            snprintf(buf, size, "%.2f", expr->data.literal_frac.value);
+            return 1;
+        case NODE_LITERAL_BOOL:
+            snprintf(buf, size, "%s", expr->data.literal_bool.value ? "verdadeiro" : "falso");
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Marcador do template para um valor de execucao, pelo tipo */
+static const char* codegen_print_placeholder(DataType type) {
+    if (type == TYPE_FRAC) return "%f";
+    if (type == TYPE_BOOL) return "%b";
+    return "%d";
+}
+
+/* Template de um imprimir: os argumentos separados por espaco, com os */
+/* valores de execucao trocados por %d/%f/%b (e '%' do texto por "%%") */
+/* Sem valores de execucao, o texto final, impresso direto com SPRINT */
+/* Retorna NULL se nao ha string (nenhum argumento ou um unico valor) */
+char* codegen_print_template(ASTNode *node, int *num_values) {
+    int n = node->data.imprimir.num_exprs;
+    char piece[64];
+    size_t len = 1;
+
+    *num_values = 0;
+    for (int i = 0; i < n; i++) {
+        ASTNode *expr = node->data.imprimir.exprs[i];
+        if (expr->kind == NODE_LITERAL_STR) {
+            len += 2 * strlen(expr->data.literal_str.value) + 1;
+        } else if (codegen_print_constant(expr, piece, sizeof(piece))) {
+            len += strlen(piece) + 1;
+        } else {
+            len += 3;
+            (*num_values)++;
+        }
+    }
+    if (n == 0 || (n == 1 && *num_values == 1)) return NULL;
+
+    char *text = (char*)mem_malloc(MEM_CODEGEN, len);
+    char *p = text;
+    for (int i = 0; i < n; i++) {
+        ASTNode *expr = node->data.imprimir.exprs[i];
+        const char *s = piece;
+        if (i > 0) *p++ = ' ';
+        if (expr->kind == NODE_LITERAL_STR) {
+            s = expr->data.literal_str.value;
+        } else if (!codegen_print_constant(expr, piece, sizeof(piece))) {
+            strcpy(p, codegen_print_placeholder(expr->data_type));
+            p += 2;
+            continue;
+        }
+        for (; *s; s++) {
+            if (*s == '%' && *num_values > 0) *p++ = '%';
+            *p++ = *s;
+        }
+    }
+    *p = '\0';
+    return text;
+}
+
 void codegen_emit_string_table(CodeGenerator *gen) {
     if (gen->num_strings == 0) return;
     
@@ -132,18 +252,32 @@ void codegen_emit_string_table(CodeGenerator *gen) {
 
 /* ===== GERENCIAMENTO DE REGISTRADORES ===== */
 
+/* Nome do registrador de uma variavel (relocavel em modulos) */
+static char* codegen_register_name(CodeGenerator *gen, int location) {
+    char *reg = (char*)mem_malloc(MEM_CODEGEN, MAX_REG_LEN);
+    snprintf(reg, MAX_REG_LEN, gen->module_mode ? "%%%d" : "R%d", location);
+    return reg;
+}
+
+static int location_in_use(CodeGenerator *gen, int location) {
+    for (int i = 0; i < gen->num_vars; i++) {
+        if (gen->var_map[i].location == location) return 1;
+    }
+    return 0;
+}
+
 char* codegen_alloc_register(CodeGenerator *gen, const char *var_name, DataType type) {
     /* Verificar se ja tem registrador alocado */
     for (int i = 0; i < gen->num_vars; i++) {
         if (strcmp(gen->var_map[i].var_name, var_name) == 0) {
-            char *reg = (char*)malloc(8);
-            snprintf(reg, 8, "R%d", gen->var_map[i].location);
-            return reg;
+            return codegen_register_name(gen, gen->var_map[i].location);
         }
     }
     
-    /* Alocar novo registrador */
-    if (gen->num_vars >= NUM_REGS) {
+    /* Alocar o menor registrador livre (o de um 'para' volta ao fim do laco) */
+    int location = 0;
+    while (location_in_use(gen, location)) location++;
+    if (location >= NUM_REGS) {
         /* Todos os registradores em uso, usar pilha (simplificado) */
         /* Por enquanto vamos limitar a 4 variaveis */
         return NULL;
@@ -152,35 +286,97 @@ char* codegen_alloc_register(CodeGenerator *gen, const char *var_name, DataType
     /* Expandir array se necessario */
     if (gen->num_vars >= gen->capacity) {
         gen->capacity *= 2;
-        gen->var_map = realloc(gen->var_map, gen->capacity * sizeof(*gen->var_map));
+        gen->var_map = mem_realloc(MEM_CODEGEN, gen->var_map, gen->capacity * sizeof(*gen->var_map));
     }
     
     /* Adicionar mapeamento */
-    gen->var_map[gen->num_vars].var_name = strdup(var_name);
+    gen->var_map[gen->num_vars].var_name = mem_strdup(MEM_CODEGEN, var_name);
     gen->var_map[gen->num_vars].type = type;
-    gen->var_map[gen->num_vars].location = gen->num_vars;
+    gen->var_map[gen->num_vars].location = location;
     gen->num_vars++;
     
-    char *reg = (char*)malloc(8);
-    snprintf(reg, 8, "R%d", gen->num_vars - 1);
-    return reg;
+    return codegen_register_name(gen, location);
+}
+
+void codegen_free_register(CodeGenerator *gen, const char *var_name) {
+    for (int i = 0; i < gen->num_vars; i++) {
+        if (strcmp(gen->var_map[i].var_name, var_name) == 0) {
+            mem_free(gen->var_map[i].var_name);
+            memmove(&gen->var_map[i], &gen->var_map[i + 1],
+                    (gen->num_vars - i - 1) * sizeof(*gen->var_map));
+            gen->num_vars--;
+            return;
+        }
+    }
 }
 
 char* codegen_get_var_location(CodeGenerator *gen, const char *var_name) {
+    /* Parametros do passo sendo gerado ficam em A0-A3 */
+    if (gen->current_passo) {
+        for (int i = 0; i < gen->current_passo->data.passo.num_params; i++) {
+            if (strcmp(gen->current_passo->data.passo.params[i]->data.declaracao.nome,
+                       var_name) == 0) {
+                char *reg = (char*)mem_malloc(MEM_CODEGEN, MAX_REG_LEN);
+                snprintf(reg, MAX_REG_LEN, "A%d", i);
+                return reg;
+            }
+        }
+    }
+    
     for (int i = 0; i < gen->num_vars; i++) {
         if (strcmp(gen->var_map[i].var_name, var_name) == 0) {
-            char *reg = (char*)malloc(8);
-            snprintf(reg, 8, "R%d", gen->var_map[i].location);
-            return reg;
+            return codegen_register_name(gen, gen->var_map[i].location);
         }
     }
     return NULL;
 }
 
+/* ===== MEMORIA DE VETORES ===== */
+
+/* Registrar um segmento ja posicionado (alocacao ou reaplicacao de fragmento) */
+static void codegen_add_array(CodeGenerator *gen, const char *var_name, DataType type,
+                              int base, int size) {
+    if (gen->num_arrays >= gen->arrays_capacity) {
+        gen->arrays_capacity = gen->arrays_capacity ? gen->arrays_capacity * 2 : INITIAL_CAPACITY;
+        gen->arrays = mem_realloc(MEM_CODEGEN, gen->arrays, gen->arrays_capacity * sizeof(*gen->arrays));
+    }
+    gen->arrays[gen->num_arrays].var_name = mem_strdup(MEM_CODEGEN, var_name);
+    gen->arrays[gen->num_arrays].type = type;
+    gen->arrays[gen->num_arrays].base = base;
+    gen->arrays[gen->num_arrays].size = size;
+    gen->num_arrays++;
+    
+    if (base + size > gen->memory_size) {
+        gen->memory_size = base + size;
+    }
+}
+
+int codegen_alloc_array(CodeGenerator *gen, const char *var_name, DataType type, int size) {
+    /* Segmento proprio por declaracao: valores iniciais de vetores */
+    /* homonimos em receitas diferentes nao se sobrepoem */
+    int base = gen->memory_size;
+    codegen_add_array(gen, var_name, type, base, size);
+    return base;
+}
+
+/* Operando com o endereco base de um vetor (relocavel em modulos) */
+static void codegen_address_operand(CodeGenerator *gen, int base, char *buf, size_t size) {
+    snprintf(buf, size, gen->module_mode ? "&%d" : "%d", base);
+}
+
+int codegen_find_array(CodeGenerator *gen, const char *var_name) {
+    for (int i = gen->num_arrays - 1; i >= 0; i--) {
+        if (strcmp(gen->arrays[i].var_name, var_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 char* codegen_temp_register(CodeGenerator *gen) {
     /* Por simplicidade, usar TIME ou POWER como temporarios */
     /* Em uma implementacao real, seria mais sofisticado */
-    char *reg = (char*)malloc(8);
+    char *reg = (char*)mem_malloc(MEM_CODEGEN, 8);
     snprintf(reg, 8, "TIME");
     return reg;
 }
@@ -193,6 +389,47 @@ void codegen_free_temp_register(CodeGenerator *gen, const char *reg) {
 
 /* ===== GERACAO DE EXPRESSOES ===== */
 
+/* Literal frac como texto para SETF/DATA: o menor formato que volta */
+/* exatamente ao mesmo double */
+static void codegen_format_frac(double value, char *buf, size_t size) {
+    snprintf(buf, size, "%.15g", value);
+    if (strtod(buf, NULL) != value) {
+        snprintf(buf, size, "%.17g", value);
+    }
+    /* Sempre com ponto, para o assembly deixar claro que e frac */
+    if (!strpbrk(buf, ".eEni") && strlen(buf) + 2 < size) {
+        strcat(buf, ".0");
+    }
+}
+
+/* Converter o valor de reg do tipo from para o tipo to */
+/* So inteiro <-> frac precisa de instrucao; os demais sao iguais na VM */
+static void codegen_convert(CodeGenerator *gen, const char *reg, DataType from, DataType to) {
+    if (from == TYPE_INTEIRO && to == TYPE_FRAC) {
+        codegen_emit1(gen, "ITOF", reg);
+    } else if (from == TYPE_FRAC && to == TYPE_INTEIRO) {
+        codegen_emit1(gen, "FTOI", reg);
+    }
+}
+
+/* Tipo de uma variavel escalar visivel no ponto atual da geracao */
+static DataType codegen_var_type(CodeGenerator *gen, const char *var_name) {
+    if (gen->current_passo) {
+        for (int i = 0; i < gen->current_passo->data.passo.num_params; i++) {
+            ASTNode *param = gen->current_passo->data.passo.params[i];
+            if (strcmp(param->data.declaracao.nome, var_name) == 0) {
+                return param->data.declaracao.tipo;
+            }
+        }
+    }
+    for (int i = 0; i < gen->num_vars; i++) {
+        if (strcmp(gen->var_map[i].var_name, var_name) == 0) {
+            return gen->var_map[i].type;
+        }
+    }
+    return TYPE_UNKNOWN;
+}
+
 /* Gerar codigo para avaliar uma expressao e colocar resultado em dest_reg */
 static void codegen_expr(CodeGenerator *gen, ASTNode *node, const char *dest_reg) {
     if (!node) return;
@@ -206,13 +443,11 @@ static void codegen_expr(CodeGenerator *gen, ASTNode *node, const char *dest_reg
             codegen_emit2(gen, "SET", dest_reg, temp_str);
             break;
             
-        case NODE_LITERAL_FRAC: {
-            /* Converter frac para fixed-point (multiplicar por 100) */
-            int fixed_value = (int)(node->data.literal_frac.value * 100);
-            snprintf(temp_str, sizeof(temp_str), "%d", fixed_value);
-            codegen_emit2(gen, "SET", dest_reg, temp_str);
+        case NODE_LITERAL_FRAC:
+            /* frac e um double nativo na VM */
+            codegen_format_frac(node->data.literal_frac.value, temp_str, sizeof(temp_str));
+            codegen_emit2(gen, "SETF", dest_reg, temp_str);
             break;
-        }
             
         case NODE_LITERAL_BOOL:
             /* Booleano: 0 ou 1 */
@@ -229,27 +464,45 @@ static void codegen_expr(CodeGenerator *gen, ASTNode *node, const char *dest_reg
                     codegen_emit2(gen, "PUSH", var_loc, "");
                     codegen_emit2(gen, "POP", dest_reg, "");
                 }
-                free(var_loc);
+                mem_free(var_loc);
             }
             break;
         }
             
+        case NODE_SENSOR:
+            codegen_emit2(gen, "READ", dest_reg, ast_sensor_name(node->data.sensor.sensor));
+            break;
+            
+        case NODE_INDICE: {
+            /* Indice no proprio destino; LOAD le memoria[base + indice] */
+            int a = codegen_find_array(gen, node->data.indice.nome);
+            if (a < 0) break;
+            codegen_expr(gen, node->data.indice.indice, dest_reg);
+            codegen_address_operand(gen, gen->arrays[a].base, temp_str, sizeof(temp_str));
+            codegen_emit3(gen, "LOAD", dest_reg, temp_str, dest_reg);
+            break;
+        }
+            
         case NODE_BINOP: {
             /* Avaliar operacao binaria */
             /* Estrategia: avaliar left em dest_reg, right em TIME (se dest_reg != TIME), operar */
             /* Escolher registrador auxiliar diferente do destino */
             const char *aux_reg = (strcmp(dest_reg, "TIME") == 0) ? "POWER" : "TIME";
             
+            /* Determinar se e operacao com frac ou int; com frac, o operando */
+            /* inteiro e convertido antes da operacao */
+            DataType left_type = node->data.binop.left->data_type;
+            DataType right_type = node->data.binop.right->data_type;
+            int is_frac = (left_type == TYPE_FRAC || right_type == TYPE_FRAC);
+            
             codegen_expr(gen, node->data.binop.left, dest_reg);
+            if (is_frac) codegen_convert(gen, dest_reg, left_type, TYPE_FRAC);
             codegen_emit1(gen, "PUSH", dest_reg);
             
             codegen_expr(gen, node->data.binop.right, aux_reg);
+            if (is_frac) codegen_convert(gen, aux_reg, right_type, TYPE_FRAC);
             codegen_emit1(gen, "POP", dest_reg);
             
-            /* Determinar se e operacao com frac ou int */
-            int is_frac = (node->data.binop.left->data_type == TYPE_FRAC ||
-                          node->data.binop.right->data_type == TYPE_FRAC);
-            
             switch (node->data.binop.op) {
                 case OP_ADD:
                     if (is_frac) {
@@ -280,7 +533,11 @@ static void codegen_expr(CodeGenerator *gen, ASTNode *node, const char *dest_reg
                     }
                     break;
                 case OP_MOD:
-                    codegen_emit2(gen, "MOD", dest_reg, aux_reg);
+                    if (is_frac) {
+                        codegen_emit2(gen, "MODF", dest_reg, aux_reg);
+                    } else {
+                        codegen_emit2(gen, "MOD", dest_reg, aux_reg);
+                    }
                     break;
                 case OP_EQ:
                     codegen_emit2(gen, "EQ", dest_reg, aux_reg);
@@ -315,13 +572,21 @@ static void codegen_expr(CodeGenerator *gen, ASTNode *node, const char *dest_reg
             codegen_expr(gen, node->data.unop.operand, dest_reg);
             
             switch (node->data.unop.op) {
-                case OP_NEG:
-                    /* Negar: 0 - valor */
+                case OP_NEG: {
+                    /* Negar: 0 - valor (auxiliar diferente do destino, como na binaria) */
+                    const char *aux_reg = (strcmp(dest_reg, "POWER") == 0) ? "TIME" : "POWER";
                     codegen_emit1(gen, "PUSH", dest_reg);
-                    codegen_emit2(gen, "SET", dest_reg, "0");
-                    codegen_emit1(gen, "POP", "POWER");
-                    codegen_emit2(gen, "SUB", dest_reg, "POWER");
+                    if (node->data_type == TYPE_FRAC) {
+                        codegen_emit2(gen, "SETF", dest_reg, "0.0");
+                        codegen_emit1(gen, "POP", aux_reg);
+                        codegen_emit2(gen, "SUBF", dest_reg, aux_reg);
+                    } else {
+                        codegen_emit2(gen, "SET", dest_reg, "0");
+                        codegen_emit1(gen, "POP", aux_reg);
+                        codegen_emit2(gen, "SUB", dest_reg, aux_reg);
+                    }
                     break;
+                }
                 case OP_NOT:
                     /* NOT logico */
                     codegen_emit1(gen, "NOT", dest_reg);
@@ -335,128 +600,1059 @@ static void codegen_expr(CodeGenerator *gen, ASTNode *node, const char *dest_reg
     }
 }
 
+/* Avaliar uma expressao para um destino do tipo dado (ITOF/FTOI se preciso) */
+static void codegen_expr_as(CodeGenerator *gen, ASTNode *node, const char *dest_reg,
+                            DataType type) {
+    codegen_expr(gen, node, dest_reg);
+    codegen_convert(gen, dest_reg, node->data_type, type);
+}
+
 /* ===== COLETA DE STRINGS (PRE-PROCESSAMENTO) ===== */
 
-/* Percorrer a AST e coletar todos os literais de string */
-static void codegen_collect_strings(CodeGenerator *gen, ASTNode *node) {
-    if (!node) return;
-    
+/* Visitante da coleta de strings (ver codegen.h) */
+int codegen_string_visitor(CodeGenerator *gen, ASTNode *node) {
     switch (node->kind) {
-        case NODE_LITERAL_STR:
-            /* Adicionar string a tabela */
-            codegen_add_string(gen, node->data.literal_str.value);
-            break;
-            
-        case NODE_PROGRAMA:
-            for (int i = 0; i < node->data.programa.num_items; i++) {
-                codegen_collect_strings(gen, node->data.programa.top_level_items[i]);
+        case NODE_IMPRIMIR: {
+            /* Adicionar o template (ou o texto final) a tabela */
+            int num_values;
+            char *text = codegen_print_template(node, &num_values);
+            if (text) {
+                codegen_add_string(gen, text);
+                mem_free(text);
             }
-            break;
+            return 0;
+        }
             
         case NODE_RECEITA:
-            codegen_collect_strings(gen, node->data.receita.bloco);
-            break;
-            
-        case NODE_PASSO:
-            codegen_collect_strings(gen, node->data.passo.bloco);
-            break;
-            
-        case NODE_BLOCO:
-            for (int i = 0; i < node->data.bloco.num_statements; i++) {
-                codegen_collect_strings(gen, node->data.bloco.statements[i]);
-            }
-            break;
-            
-        case NODE_DECLARACAO:
-            codegen_collect_strings(gen, node->data.declaracao.init_expr);
-            break;
-            
-        case NODE_ATRIBUICAO:
-            codegen_collect_strings(gen, node->data.atribuicao.expr);
-            break;
-            
-        case NODE_PREAQUECER:
-            codegen_collect_strings(gen, node->data.preaquecer.temperatura);
-            break;
-            
-        case NODE_COZINHAR:
-            codegen_collect_strings(gen, node->data.cozinhar.temperatura);
-            codegen_collect_strings(gen, node->data.cozinhar.tempo);
-            break;
-            
-        case NODE_AQUECER:
-            codegen_collect_strings(gen, node->data.aquecer.tempo);
-            break;
-            
-        case NODE_AGITAR:
-            codegen_collect_strings(gen, node->data.agitar.tempo);
-            break;
-            
-        case NODE_IMPRIMIR:
-            for (int i = 0; i < node->data.imprimir.num_exprs; i++) {
-                codegen_collect_strings(gen, node->data.imprimir.exprs[i]);
+            if (node->data.receita.cached) {
+                /* Receita do cache: usar as strings registradas no fragmento */
+                for (int i = 0; i < node->data.receita.cached->num_strings; i++) {
+                    codegen_add_string(gen, node->data.receita.cached->strings[i]);
+                }
+                return 0;
             }
-            break;
-            
-        case NODE_SE:
-            codegen_collect_strings(gen, node->data.se.condicao);
-            codegen_collect_strings(gen, node->data.se.bloco_then);
-            codegen_collect_strings(gen, node->data.se.bloco_else);
-            break;
-            
-        case NODE_ENQUANTO:
-            codegen_collect_strings(gen, node->data.enquanto.condicao);
-            codegen_collect_strings(gen, node->data.enquanto.bloco);
-            break;
+            return 1;
             
+        default:
+            return 1;
+    }
+}
+
+static void codegen_collect_strings(CodeGenerator *gen, ASTNode *node);
+
+static void collect_strings_child(ASTNode *child, void *data) {
+    codegen_collect_strings((CodeGenerator*)data, child);
+}
+
+/* Percorrer a AST e coletar todos os literais de string */
+static void codegen_collect_strings(CodeGenerator *gen, ASTNode *node) {
+    if (!node) return;
+    
+    if (codegen_string_visitor(gen, node)) {
+        ast_for_each_child(node, collect_strings_child, gen);
+    }
+}
+
+/* ===== FRAGMENTOS RELOCAVEIS ===== */
+
+/* Compilar uma receita isoladamente, com labels e strings locais */
+/* O estado global do gerador (saida, labels, string table) e salvo e */
+/* restaurado; o var_map e compartilhado e o que a receita alocar fica */
+/* registrado no fragmento. Fragmentos com erro recebem key 0. */
+static CodeFragment* codegen_receita_fragment(CodeGenerator *gen, ASTNode *node) {
+    FILE *saved_output = gen->output;
+    int saved_labels = gen->label_counter;
+    int saved_string_counter = gen->string_counter;
+    void *saved_strings = gen->strings;
+    int saved_num_strings = gen->num_strings;
+    int saved_string_capacity = gen->string_capacity;
+    int vars_before = gen->num_vars;
+    int arrays_before = gen->num_arrays;
+    int saved_memory_size = gen->memory_size;
+    int errors_before = gen->num_errors;
+    
+    CodeFragment *frag = (CodeFragment*)mem_calloc(MEM_CODEGEN, 1, sizeof(CodeFragment));
+    frag->key = node->data.receita.cache_key;
+    
+    gen->output = open_memstream(&frag->code, &frag->code_len);
+    gen->label_counter = 0;
+    gen->string_counter = 0;
+    gen->strings = mem_malloc(MEM_CODEGEN, INITIAL_CAPACITY * sizeof(*gen->strings));
+    gen->num_strings = 0;
+    gen->string_capacity = INITIAL_CAPACITY;
+    gen->fragment_mode = 1;
+    
+    /* Ids locais seguem a mesma ordem da coleta global de strings */
+    codegen_collect_strings(gen, node);
+    
+    codegen_comment(gen, "===== RECEITA =====");
+    char temp_str[128];
+    snprintf(temp_str, sizeof(temp_str), "Receita: %s", node->data.receita.nome);
+    codegen_comment(gen, temp_str);
+    codegen_node(gen, node->data.receita.bloco);
+    fprintf(gen->output, "\n");
+    fclose(gen->output);
+    
+    /* Mover a string table local para o fragmento */
+    frag->num_labels = gen->label_counter;
+    frag->num_strings = gen->num_strings;
+    frag->strings = (char**)mem_malloc(MEM_CODEGEN, (gen->num_strings + 1) * sizeof(char*));
+    for (int i = 0; i < gen->num_strings; i++) {
+        frag->strings[gen->strings[i].id] = gen->strings[i].text;
+    }
+    mem_free(gen->strings);
+    
+    /* Registrar variaveis alocadas pela receita */
+    frag->num_vars = gen->num_vars - vars_before;
+    frag->vars = mem_malloc(MEM_CODEGEN, (frag->num_vars + 1) * sizeof(*frag->vars));
+    for (int i = 0; i < frag->num_vars; i++) {
+        frag->vars[i].var_name = mem_strdup(MEM_CODEGEN, gen->var_map[vars_before + i].var_name);
+        frag->vars[i].type = gen->var_map[vars_before + i].type;
+        frag->vars[i].location = gen->var_map[vars_before + i].location;
+    }
+    
+    /* Registrar vetores alocados pela receita (os nomes passam ao fragmento) */
+    frag->num_arrays = gen->num_arrays - arrays_before;
+    frag->arrays = mem_malloc(MEM_CODEGEN, (frag->num_arrays + 1) * sizeof(*frag->arrays));
+    for (int i = 0; i < frag->num_arrays; i++) {
+        frag->arrays[i].var_name = gen->arrays[arrays_before + i].var_name;
+        frag->arrays[i].type = gen->arrays[arrays_before + i].type;
+        frag->arrays[i].base = gen->arrays[arrays_before + i].base;
+        frag->arrays[i].size = gen->arrays[arrays_before + i].size;
+    }
+    
+    /* Restaurar estado global; var_map e vetores sao desfeitos e */
+    /* reaplicados no link */
+    for (int i = vars_before; i < gen->num_vars; i++) {
+        mem_free(gen->var_map[i].var_name);
+    }
+    gen->num_vars = vars_before;
+    gen->num_arrays = arrays_before;
+    gen->memory_size = saved_memory_size;
+    gen->output = saved_output;
+    gen->label_counter = saved_labels;
+    gen->string_counter = saved_string_counter;
+    gen->strings = saved_strings;
+    gen->num_strings = saved_num_strings;
+    gen->string_capacity = saved_string_capacity;
+    gen->fragment_mode = 0;
+    
+    /* Fragmentos com erro sao emitidos mas nao vao para o cache */
+    if (gen->num_errors != errors_before) frag->key = 0;
+    
+    return frag;
+}
+
+/* Guardar um fragmento recem-gerado para gravacao no cache */
+static void codegen_keep_fragment(CodeGenerator *gen, CodeFragment *frag) {
+    if (frag->key == 0) {
+        codegen_fragment_free(frag);
+        return;
+    }
+    if (gen->num_new_fragments >= gen->new_fragments_capacity) {
+        gen->new_fragments_capacity = gen->new_fragments_capacity ?
+                                      gen->new_fragments_capacity * 2 : INITIAL_CAPACITY;
+        gen->new_fragments = mem_realloc(MEM_CODEGEN, gen->new_fragments,
+                                         gen->new_fragments_capacity * sizeof(CodeFragment*));
+    }
+    gen->new_fragments[gen->num_new_fragments++] = frag;
+}
+
+/* Copiar o codigo de um fragmento reescrevendo "_@N" e "$N" e, se regs */
+/* nao for NULL, tambem "%N" (registrador regs[N]) e "&N" (mem_base + N) */
+static void codegen_relocate(CodeGenerator *gen, const CodeFragment *frag,
+                             const int *regs, int mem_base) {
+    /* Mapear ids locais de string para ids globais */
+    int *string_ids = (int*)mem_malloc(MEM_CODEGEN, (frag->num_strings + 1) * sizeof(int));
+    for (int i = 0; i < frag->num_strings; i++) {
+        string_ids[i] = codegen_add_string(gen, frag->strings[i]);
+    }
+    
+    int label_base = gen->label_counter;
+    gen->label_counter += frag->num_labels;
+    
+    const char *p = frag->code;
+    const char *end = frag->code + frag->code_len;
+    const char *run = p;
+    while (p < end) {
+        int is_label = (p[0] == '_' && p + 1 < end && p[1] == '@');
+        int is_string = (p[0] == '$');
+        int is_register = (regs && p[0] == '%');
+        int is_address = (regs && p[0] == '&');
+        if (!is_label && !is_string && !is_register && !is_address) {
+            p++;
+            continue;
+        }
+        
+        fwrite(run, 1, p - run, gen->output);
+        p += is_label ? 2 : 1;
+        int local = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            local = local * 10 + (*p - '0');
+            p++;
+        }
+        if (is_label) {
+            fprintf(gen->output, "_%d", label_base + local);
+        } else if (is_string) {
+            fprintf(gen->output, "%d", local < frag->num_strings ? string_ids[local] : local);
+        } else if (is_register) {
+            fprintf(gen->output, "R%d", local < NUM_REGS ? regs[local] : local);
+        } else {
+            fprintf(gen->output, "%d", mem_base + local);
+        }
+        run = p;
+    }
+    fwrite(run, 1, end - run, gen->output);
+    mem_free(string_ids);
+}
+
+void codegen_link_fragment(CodeGenerator *gen, const CodeFragment *frag) {
+    if (!frag) return;
+    
+    codegen_relocate(gen, frag, NULL, 0);
+    
+    /* Reaplicar as alocacoes de variaveis feitas pela receita */
+    for (int i = 0; i < frag->num_vars; i++) {
+        if (gen->num_vars >= gen->capacity) {
+            gen->capacity *= 2;
+            gen->var_map = mem_realloc(MEM_CODEGEN, gen->var_map, gen->capacity * sizeof(*gen->var_map));
+        }
+        gen->var_map[gen->num_vars].var_name = mem_strdup(MEM_CODEGEN, frag->vars[i].var_name);
+        gen->var_map[gen->num_vars].type = frag->vars[i].type;
+        gen->var_map[gen->num_vars].location = frag->vars[i].location;
+        gen->num_vars++;
+    }
+    for (int i = 0; i < frag->num_arrays; i++) {
+        codegen_add_array(gen, frag->arrays[i].var_name, frag->arrays[i].type,
+                          frag->arrays[i].base, frag->arrays[i].size);
+    }
+}
+
+int codegen_link_module(CodeGenerator *gen, const CodeFragment *frag, const char *escopo) {
+    int ok = 1;
+    char name[256];
+    
+    /* Registradores do programa ligado para cada variavel do modulo */
+    int regs[NUM_REGS];
+    memset(regs, 0, sizeof(regs));
+    for (int i = 0; i < frag->num_vars; i++) {
+        if (escopo) {
+            snprintf(name, sizeof(name), "%s.%s", escopo, frag->vars[i].var_name);
+        } else {
+            snprintf(name, sizeof(name), "%s", frag->vars[i].var_name);
+        }
+        char *reg = codegen_alloc_register(gen, name, frag->vars[i].type);
+        if (!reg) {
+            fprintf(gen->diag, "Erro: nao ha registradores disponiveis para '%s'\n", name);
+            gen->num_errors++;
+            ok = 0;
+            continue;
+        }
+        if (frag->vars[i].location >= 0 && frag->vars[i].location < NUM_REGS) {
+            regs[frag->vars[i].location] = atoi(reg + 1);
+        }
+        mem_free(reg);
+    }
+    
+    /* Segmento novo, no fim da memoria ja usada, para os vetores do modulo */
+    int mem_base = gen->memory_size;
+    for (int i = 0; i < frag->num_arrays; i++) {
+        if (escopo) {
+            snprintf(name, sizeof(name), "%s.%s", escopo, frag->arrays[i].var_name);
+        } else {
+            snprintf(name, sizeof(name), "%s", frag->arrays[i].var_name);
+        }
+        codegen_add_array(gen, name, frag->arrays[i].type,
+                          mem_base + frag->arrays[i].base, frag->arrays[i].size);
+    }
+    
+    codegen_relocate(gen, frag, regs, mem_base);
+    return ok;
+}
+
+void codegen_fragment_free(CodeFragment *frag) {
+    if (!frag) return;
+    
+    mem_free(frag->code);
+    for (int i = 0; i < frag->num_strings; i++) {
+        mem_free(frag->strings[i]);
+    }
+    mem_free(frag->strings);
+    for (int i = 0; i < frag->num_vars; i++) {
+        mem_free(frag->vars[i].var_name);
+    }
+    mem_free(frag->vars);
+    for (int i = 0; i < frag->num_arrays; i++) {
+        mem_free(frag->arrays[i].var_name);
+    }
+    mem_free(frag->arrays);
+    mem_free(frag);
+}
+
+/* ===== LACOS CONTADOS ===== */
+
+typedef struct VarSearch {
+    const char *name;
+    int found;
+} VarSearch;
+
+static void search_var_read(ASTNode *node, void *data) {
+    VarSearch *search = (VarSearch*)data;
+    if (search->found) return;
+    if (node->kind == NODE_VARIAVEL && strcmp(node->data.variavel.nome, search->name) == 0) {
+        search->found = 1;
+        return;
+    }
+    ast_for_each_child(node, search_var_read, search);
+}
+
+int codegen_para_reads_var(ASTNode *para) {
+    VarSearch search = { para->data.para.var, 0 };
+    search_var_read(para->data.para.bloco, &search);
+    return search.found;
+}
+
+/* Literal inteiro, possivelmente negado */
+int codegen_constant_int(ASTNode *node, int *value) {
+    if (node->kind == NODE_LITERAL_INT) {
+        *value = node->data.literal_int.value;
+        return 1;
+    }
+    if (node->kind == NODE_UNOP && node->data.unop.op == OP_NEG &&
+        codegen_constant_int(node->data.unop.operand, value)) {
+        *value = -*value;
+        return 1;
+    }
+    return 0;
+}
+
+/* Liberar o registrador que o laco alocou para a variavel de controle */
+static void codegen_para_end(CodeGenerator *gen, ASTNode *node, int vars_before) {
+    if (gen->module_mode) return;
+    for (int i = vars_before; i < gen->num_vars; i++) {
+        if (strcmp(gen->var_map[i].var_name, node->data.para.var) == 0) {
+            codegen_free_register(gen, node->data.para.var);
+            return;
+        }
+    }
+}
+
+/* para i de A ate B passo K: contagem regressiva no registrador CNT */
+/*   CNT = (B - A) / K + 1, pulando o laco se nao for positivo */
+/*   corpo; i = i + K (so se o corpo le i); DECJNZ CNT corpo */
+/* Com A e B constantes a contagem e calculada aqui e o teste de entrada */
+/* some. Lacos aninhados salvam o CNT do laco externo na pilha. */
+/* A variavel de controle so vale dentro do laco: o registrador e liberado */
+/* no fim (em modulos ele fica, pois o ligador so mapeia os que restam) */
+static void codegen_para(CodeGenerator *gen, ASTNode *node) {
+    char temp_str[128];
+    int passo = node->data.para.passo;
+    int step = passo > 0 ? passo : -passo;
+    
+    snprintf(temp_str, sizeof(temp_str), "para %s (passo %d)", node->data.para.var, passo);
+    codegen_comment(gen, temp_str);
+    
+    char *reg = NULL;
+    int vars_before = gen->num_vars;
+    if (codegen_para_reads_var(node)) {
+        reg = codegen_alloc_register(gen, node->data.para.var, TYPE_INTEIRO);
+        if (!reg) {
+            fprintf(gen->diag, "Erro: nao ha registradores disponiveis para '%s'\n",
+                   node->data.para.var);
+            gen->num_errors++;
+            return;
+        }
+    }
+    
+    int inicio, fim;
+    int constant = codegen_constant_int(node->data.para.inicio, &inicio) &&
+                   codegen_constant_int(node->data.para.fim, &fim);
+    long long count = 0;
+    if (constant) {
+        long long diff = passo > 0 ? (long long)fim - inicio : (long long)inicio - fim;
+        count = diff >= 0 ? diff / step + 1 : 0;
+        if (count == 0) {
+            codegen_comment(gen, "laco sem iteracoes");
+            codegen_para_end(gen, node, vars_before);
+            mem_free(reg);
+            return;
+        }
+    }
+    
+    char *body_label = codegen_new_label(gen, "para");
+    char *end_label = codegen_new_label(gen, "endpara");
+    
+    if (gen->para_depth > 0) {
+        codegen_emit1(gen, "PUSH", "CNT");
+    }
+    
+    if (constant) {
+        snprintf(temp_str, sizeof(temp_str), "%lld", count);
+        codegen_emit2(gen, "SET", "CNT", temp_str);
+        if (reg) {
+            snprintf(temp_str, sizeof(temp_str), "%d", inicio);
+            codegen_emit2(gen, "SET", reg, temp_str);
+        }
+    } else {
+        /* TIME = B, POWER = A */
+        codegen_expr(gen, node->data.para.fim, "TIME");
+        codegen_emit1(gen, "PUSH", "TIME");
+        codegen_expr(gen, node->data.para.inicio, "POWER");
+        codegen_emit1(gen, "POP", "TIME");
+        if (reg) {
+            codegen_emit1(gen, "PUSH", "POWER");
+            codegen_emit1(gen, "POP", reg);
+        }
+        
+        /* TIME = distancia no sentido do passo */
+        if (passo > 0) {
+            codegen_emit2(gen, "SUB", "TIME", "POWER");
+        } else {
+            codegen_emit2(gen, "SUB", "POWER", "TIME");
+            codegen_emit1(gen, "PUSH", "POWER");
+            codegen_emit1(gen, "POP", "TIME");
+        }
+        if (step > 1) {
+            snprintf(temp_str, sizeof(temp_str), "%d", step);
+            codegen_emit2(gen, "SET", "POWER", temp_str);
+            codegen_emit2(gen, "DIV", "TIME", "POWER");
+        }
+        codegen_emit1(gen, "INC", "TIME");
+        codegen_emit1(gen, "PUSH", "TIME");
+        codegen_emit1(gen, "POP", "CNT");
+        
+        /* Distancia negativa: nenhuma iteracao */
+        codegen_emit2(gen, "SET", "POWER", "0");
+        codegen_emit2(gen, "GT", "TIME", "POWER");
+        codegen_emit2(gen, "JZ", "TIME", end_label);
+    }
+    
+    codegen_label(gen, body_label);
+    gen->para_depth++;
+    codegen_node(gen, node->data.para.bloco);
+    gen->para_depth--;
+    
+    if (reg) {
+        if (passo == 1) {
+            codegen_emit1(gen, "INC", reg);
+        } else if (passo == -1) {
+            codegen_emit1(gen, "DEC", reg);
+        } else {
+            snprintf(temp_str, sizeof(temp_str), "%d", passo);
+            codegen_emit2(gen, "SET", "POWER", temp_str);
+            codegen_emit2(gen, "ADD", reg, "POWER");
+        }
+    }
+    codegen_emit2(gen, "DECJNZ", "CNT", body_label);
+    codegen_label(gen, end_label);
+    
+    if (gen->para_depth > 0) {
+        codegen_emit1(gen, "POP", "CNT");
+    }
+    
+    codegen_para_end(gen, node, vars_before);
+    mem_free(reg);
+    mem_free(body_label);
+    mem_free(end_label);
+}
+
+/* ===== ESPERA POR SENSORES ===== */
+
+/* Conjunto de sensores lidos pela expressao (bit = SensorKind) */
+unsigned codegen_sensors_read(ASTNode *node) {
+    if (!node) return 0;
+    switch (node->kind) {
+        case NODE_SENSOR:
+            return 1u << node->data.sensor.sensor;
         case NODE_BINOP:
-            codegen_collect_strings(gen, node->data.binop.left);
-            codegen_collect_strings(gen, node->data.binop.right);
-            break;
-            
+            return codegen_sensors_read(node->data.binop.left) |
+                   codegen_sensors_read(node->data.binop.right);
         case NODE_UNOP:
-            codegen_collect_strings(gen, node->data.unop.operand);
-            break;
-            
+            return codegen_sensors_read(node->data.unop.operand);
+        case NODE_INDICE:
+            return codegen_sensors_read(node->data.indice.indice);
         default:
-            /* Outros tipos nao tem strings */
-            break;
+            return 0;
+    }
+}
+
+/* Nome da comparacao na VM, com os operandos trocados se swap */
+static const char* wait_relation(BinOpKind op, int swap) {
+    switch (op) {
+        case OP_EQ: return "EQ";
+        case OP_NE: return "NE";
+        case OP_LT: return swap ? "GT" : "LT";
+        case OP_LE: return swap ? "GE" : "LE";
+        case OP_GT: return swap ? "LT" : "GT";
+        case OP_GE: return swap ? "LE" : "GE";
+        default: return NULL;
+    }
+}
+
+/* quando (cond) { corpo }: suspender ate a condicao valer e executar o corpo */
+/* Comparacao de um sensor com uma expressao sem sensores vira um unico */
+/* WAIT: o limiar e avaliado uma vez e a VM so acorda quando o sensor o */
+/* cruza. Nos demais casos a condicao e reavaliada a cada mudanca dos */
+/* sensores que ela le (WAITCHG). */
+static void codegen_quando(CodeGenerator *gen, ASTNode *node) {
+    ASTNode *cond = node->data.quando.condicao;
+    codegen_comment(gen, "quando");
+    
+    if (cond->kind == NODE_BINOP) {
+        ASTNode *left = cond->data.binop.left;
+        ASTNode *right = cond->data.binop.right;
+        int swap = (right->kind == NODE_SENSOR && left->kind != NODE_SENSOR);
+        ASTNode *sensor = swap ? right : left;
+        ASTNode *limit = swap ? left : right;
+        const char *rel = wait_relation(cond->data.binop.op, swap);
+        
+        if (rel && sensor->kind == NODE_SENSOR && codegen_sensors_read(limit) == 0) {
+            codegen_expr(gen, limit, "TIME");
+            fprintf(gen->output, "    WAIT %s %s TIME\n",
+                    ast_sensor_name(sensor->data.sensor.sensor), rel);
+            codegen_node(gen, node->data.quando.bloco);
+            return;
+        }
+    }
+    
+    char *check_label = codegen_new_label(gen, "quando");
+    char *body_label = codegen_new_label(gen, "quando_corpo");
+    
+    codegen_label(gen, check_label);
+    codegen_expr(gen, cond, "POWER");
+    codegen_emit2(gen, "JNZ", "POWER", body_label);
+    fprintf(gen->output, "    WAITCHG");
+    unsigned mask = codegen_sensors_read(cond);
+    for (int s = SENSOR_TEMP; s <= SENSOR_STATE; s++) {
+        if (mask & (1u << s)) fprintf(gen->output, " %s", ast_sensor_name((SensorKind)s));
+    }
+    fprintf(gen->output, "\n");
+    codegen_emit1(gen, "GOTO", check_label);
+    codegen_label(gen, body_label);
+    codegen_node(gen, node->data.quando.bloco);
+    
+    mem_free(check_label);
+    mem_free(body_label);
+}
+
+/* ===== DESVIO MULTIPLO ===== */
+
+/* escolha (expr) { caso k: {...} ... padrao: {...} }: o seletor vai para */
+/* TIME e o desvio escolhe o rotulo do caso; cada caso termina com GOTO */
+/* para o fim. Conforme a densidade dos valores o desvio e um JTABLE */
+/* (salto indexado, O(1)), uma busca binaria (O(log n) comparacoes) ou */
+/* uma cadeia de comparacoes. */
+
+typedef struct CasoLabel {
+    int valor;
+    char *label;
+} CasoLabel;
+
+static int compare_casos(const void *a, const void *b) {
+    int va = ((const CasoLabel*)a)->valor;
+    int vb = ((const CasoLabel*)b)->valor;
+    return (va > vb) - (va < vb);
+}
+
+/* Comparar TIME com cada valor de casos[lo..hi) e, sem acerto, ir para o padrao */
+static void codegen_escolha_chain(CodeGenerator *gen, CasoLabel *casos, int lo, int hi,
+                                  const char *default_label) {
+    char temp_str[32];
+    for (int i = lo; i < hi; i++) {
+        snprintf(temp_str, sizeof(temp_str), "%d", casos[i].valor);
+        codegen_emit2(gen, "SET", "POWER", temp_str);
+        codegen_emit2(gen, "EQ", "POWER", "TIME");
+        codegen_emit2(gen, "JNZ", "POWER", casos[i].label);
+    }
+    codegen_emit1(gen, "GOTO", default_label);
+}
+
+/* Busca binaria sobre casos[lo..hi), ordenados; trechos curtos viram cadeia */
+static void codegen_escolha_tree(CodeGenerator *gen, CasoLabel *casos, int lo, int hi,
+                                 const char *default_label) {
+    if (hi - lo < ESCOLHA_MIN_CASES) {
+        codegen_escolha_chain(gen, casos, lo, hi, default_label);
+        return;
+    }
+    
+    int mid = lo + (hi - lo) / 2;
+    char temp_str[32];
+    char *left_label = codegen_new_label(gen, "escolha_menor");
+    
+    /* TIME < casos[mid]: metade de baixo */
+    snprintf(temp_str, sizeof(temp_str), "%d", casos[mid].valor);
+    codegen_emit2(gen, "SET", "POWER", temp_str);
+    codegen_emit2(gen, "GT", "POWER", "TIME");
+    codegen_emit2(gen, "JNZ", "POWER", left_label);
+    codegen_escolha_tree(gen, casos, mid, hi, default_label);
+    codegen_label(gen, left_label);
+    codegen_escolha_tree(gen, casos, lo, mid, default_label);
+    
+    mem_free(left_label);
+}
+
+/* JTABLE TIME base padrao L0 .. Ln-1: salta para L(TIME - base), ou para o */
+/* padrao fora da faixa; valores sem caso dentro da faixa tambem vao ao padrao */
+static void codegen_escolha_table(CodeGenerator *gen, CasoLabel *casos, int n,
+                                  const char *default_label) {
+    int base = casos[0].valor;
+    int span = casos[n - 1].valor - base + 1;
+    
+    fprintf(gen->output, "    JTABLE TIME %d %s", base, default_label);
+    for (int v = 0, i = 0; v < span; v++) {
+        if (casos[i].valor == base + v) {
+            fprintf(gen->output, " %s", casos[i++].label);
+        } else {
+            fprintf(gen->output, " %s", default_label);
+        }
+    }
+    fprintf(gen->output, "\n");
+}
+
+static void codegen_escolha(CodeGenerator *gen, ASTNode *node, int tail) {
+    int n = node->data.escolha.num_casos;
+    ASTNode *padrao = node->data.escolha.padrao;
+    char *end_label = codegen_new_label(gen, "fim_escolha");
+    char *default_label = padrao ? codegen_new_label(gen, "padrao") : end_label;
+    
+    CasoLabel *casos = (CasoLabel*)mem_malloc(MEM_CODEGEN, n * sizeof(CasoLabel));
+    for (int i = 0; i < n; i++) {
+        casos[i].valor = node->data.escolha.casos[i]->data.caso.valor;
+        casos[i].label = codegen_new_label(gen, "caso");
+    }
+    
+    /* O desvio usa os casos ordenados; os blocos seguem a ordem do fonte */
+    CasoLabel *sorted = (CasoLabel*)mem_malloc(MEM_CODEGEN, n * sizeof(CasoLabel));
+    memcpy(sorted, casos, n * sizeof(CasoLabel));
+    qsort(sorted, n, sizeof(CasoLabel), compare_casos);
+    
+    /* Faixa em long long: valores extremos nao estouram */
+    long long span = (long long)sorted[n - 1].valor - sorted[0].valor + 1;
+    
+    int table = n >= ESCOLHA_MIN_CASES && span <= ESCOLHA_MAX_TABLE && span <= 2LL * n;
+    int tree = !table && n >= ESCOLHA_MIN_CASES;
+    
+    codegen_comment(gen, table ? "escolha (tabela de saltos)" :
+                         tree ? "escolha (busca binaria)" : "escolha (comparacoes)");
+    codegen_expr(gen, node->data.escolha.expr, "TIME");
+    if (table) {
+        codegen_escolha_table(gen, sorted, n, default_label);
+    } else if (tree) {
+        codegen_escolha_tree(gen, sorted, 0, n, default_label);
+    } else {
+        codegen_escolha_chain(gen, sorted, 0, n, default_label);
+    }
+    
+    for (int i = 0; i < n; i++) {
+        codegen_label(gen, casos[i].label);
+        gen->in_tail = tail;
+        codegen_node(gen, node->data.escolha.casos[i]->data.caso.bloco);
+        /* O ultimo caso sem padrao cai direto no fim */
+        if (i < n - 1 || padrao) codegen_emit1(gen, "GOTO", end_label);
+    }
+    if (padrao) {
+        codegen_label(gen, default_label);
+        codegen_comment(gen, "padrao");
+        gen->in_tail = tail;
+        codegen_node(gen, padrao);
+    }
+    codegen_label(gen, end_label);
+    
+    for (int i = 0; i < n; i++) {
+        mem_free(casos[i].label);
+    }
+    mem_free(casos);
+    mem_free(sorted);
+    if (padrao) mem_free(default_label);
+    mem_free(end_label);
+}
+
+/* ===== PASSOS COM PARAMETROS ===== */
+
+/* Chamada: argumentos na pilha, CALL passo_nome n (a VM salva A0-A3 do */
+/* chamador num quadro e desempilha os argumentos para A0..A(n-1)); RET */
+/* restaura A0-A3. Em posicao de cauda nao ha quadro: os argumentos vao */
+/* direto para A0..A(n-1) e um GOTO reaproveita o quadro atual. Passos */
+/* pequenos, sem chamadas, declaracoes nem 'para', sao expandidos no lugar. */
+
+typedef struct InlineScan {
+    int nodes;
+    int blocked;
+} InlineScan;
+
+static void scan_inline(ASTNode *node, void *data) {
+    InlineScan *scan = (InlineScan*)data;
+    scan->nodes++;
+    /* Declaracoes e 'para' alocam registradores; chamadas podem ser recursivas */
+    if (node->kind == NODE_CHAMADA || node->kind == NODE_DECLARACAO ||
+        node->kind == NODE_PARA) {
+        scan->blocked = 1;
+    }
+    if (scan->blocked || scan->nodes > INLINE_MAX_NODES) return;
+    ast_for_each_child(node, scan_inline, scan);
+}
+
+int codegen_passo_inlinable(ASTNode *passo) {
+    /* O corpo de um passo importado esta no objeto do outro modulo */
+    if (passo->data.passo.externo) return 0;
+    InlineScan scan = { 0, 0 };
+    scan_inline(passo->data.passo.bloco, &scan);
+    return !scan.blocked && scan.nodes <= INLINE_MAX_NODES;
+}
+
+/* Visitante dos passos chamados (ver codegen.h) */
+int codegen_call_visitor(ASTNode *programa, ASTNode *node) {
+    if (node->kind != NODE_CHAMADA) return 1;
+    ASTNode *passo = ast_find_passo(programa, node->data.chamada.nome);
+    if (passo) passo->data.passo.referenciado = 1;
+    /* Argumentos sao expressoes: nao contem chamadas */
+    return 0;
+}
+
+static void search_call(ASTNode *node, void *data) {
+    VarSearch *search = (VarSearch*)data;
+    if (search->found) return;
+    if (node->kind == NODE_CHAMADA && strcmp(node->data.chamada.nome, search->name) == 0) {
+        search->found = 1;
+        return;
+    }
+    ast_for_each_child(node, search_call, search);
+}
+
+/* Empilhar o valor de um argumento, ja no tipo do parametro */
+/* (variaveis do mesmo tipo sem passar por TIME) */
+static void codegen_push_arg(CodeGenerator *gen, ASTNode *arg, DataType type) {
+    if (arg->kind == NODE_VARIAVEL && arg->data_type == type) {
+        char *loc = codegen_get_var_location(gen, arg->data.variavel.nome);
+        if (loc) {
+            codegen_emit1(gen, "PUSH", loc);
+            mem_free(loc);
+            return;
+        }
+    }
+    codegen_expr_as(gen, arg, "TIME", type);
+    codegen_emit1(gen, "PUSH", "TIME");
+}
+
+/* Desempilhar para A(n-1)..A0, pulando os bits marcados em skip */
+static void codegen_pop_args(CodeGenerator *gen, int n, unsigned skip) {
+    char reg[16];
+    for (int i = n - 1; i >= 0; i--) {
+        if (skip & (1u << i)) continue;
+        snprintf(reg, sizeof(reg), "A%d", i);
+        codegen_emit1(gen, "POP", reg);
+    }
+}
+
+static void codegen_chamada(CodeGenerator *gen, ASTNode *node, int tail) {
+    char temp_str[128];
+    char reg[16];
+    ASTNode *passo = ast_find_passo(gen->program, node->data.chamada.nome);
+    if (!passo) return;
+    
+    int n = node->data.chamada.num_args;
+    int expand = codegen_passo_inlinable(passo);
+    /* A expansao sobrescreve A0..A(n-1), que podem ser parametros do chamador */
+    int save = expand && gen->current_passo && n > 0;
+    
+    snprintf(temp_str, sizeof(temp_str), "%s %s",
+             expand ? "expandir" : (tail ? "chamada de cauda" : "chamar"),
+             node->data.chamada.nome);
+    codegen_comment(gen, temp_str);
+    
+    /* Sem quadro novo (cauda ou expansao), argumento que ja e o parametro */
+    /* da mesma posicao fica onde esta */
+    unsigned same = 0;
+    for (int i = 0; (tail || expand) && i < n; i++) {
+        ASTNode *arg = node->data.chamada.args[i];
+        if (arg->kind != NODE_VARIAVEL) continue;
+        char *loc = codegen_get_var_location(gen, arg->data.variavel.nome);
+        snprintf(reg, sizeof(reg), "A%d", i);
+        if (loc && strcmp(loc, reg) == 0 &&
+            arg->data_type == passo->data.passo.params[i]->data.declaracao.tipo) {
+            same |= 1u << i;
+        }
+        mem_free(loc);
+    }
+    
+    for (int i = 0; save && i < n; i++) {
+        if (same & (1u << i)) continue;
+        snprintf(reg, sizeof(reg), "A%d", i);
+        codegen_emit1(gen, "PUSH", reg);
+    }
+    
+    /* Todos os argumentos sao avaliados antes de A0-A3 mudar */
+    for (int i = 0; i < n; i++) {
+        if (same & (1u << i)) continue;
+        codegen_push_arg(gen, node->data.chamada.args[i],
+                         passo->data.passo.params[i]->data.declaracao.tipo);
+    }
+    
+    if (!expand) {
+        char label[MAX_LABEL_LEN];
+        passo->data.passo.chamado = 1;
+        snprintf(label, sizeof(label), "passo_%s", node->data.chamada.nome);
+        if (tail) {
+            codegen_pop_args(gen, n, same);
+            codegen_emit1(gen, "GOTO", label);
+        } else {
+            snprintf(temp_str, sizeof(temp_str), "%d", n);
+            codegen_emit2(gen, "CALL", label, temp_str);
+        }
+        return;
+    }
+    
+    codegen_pop_args(gen, n, same);
+    ASTNode *saved = gen->current_passo;
+    gen->current_passo = passo;
+    codegen_node(gen, passo->data.passo.bloco);
+    gen->current_passo = saved;
+    if (save) codegen_pop_args(gen, n, same);
+}
+
+/* Emitir, depois do HALT, cada passo com parametros chamado e nao expandido */
+static void codegen_subrotinas(CodeGenerator *gen, ASTNode *programa) {
+    char temp_str[128];
+    
+    for (int i = 0; i < programa->data.programa.num_items; i++) {
+        ASTNode *item = programa->data.programa.top_level_items[i];
+        if (item->kind != NODE_PASSO || !item->data.passo.subrotina) continue;
+        if (item->data.passo.externo) continue;
+        
+        /* Passos exportados por um modulo podem ser chamados por outros */
+        /* modulos: sempre gerados, mesmo que pequenos ou sem chamadas aqui */
+        if (!gen->export_all) {
+            if (codegen_passo_inlinable(item)) continue;
+            
+            /* No modo streaming as receitas ja foram liberadas: as chamadas */
+            /* delas ficaram registradas no proprio passo. O passo 'calls' */
+            /* marca todos num unico percurso; sem ele, procurar na arvore */
+            int called = item->data.passo.chamado || item->data.passo.referenciado;
+            if (!called && !gen->calls_collected) {
+                VarSearch search = { item->data.passo.nome, 0 };
+                search_call(programa, &search);
+                called = search.found;
+            }
+            if (!called) continue;
+        }
+        
+        fprintf(gen->output, "\n");
+        codegen_comment(gen, "===== PASSO =====");
+        int len = snprintf(temp_str, sizeof(temp_str), "Passo: %s(", item->data.passo.nome);
+        for (int p = 0; p < item->data.passo.num_params && len < (int)sizeof(temp_str); p++) {
+            len += snprintf(temp_str + len, sizeof(temp_str) - len, "%s%s=A%d",
+                            p ? ", " : "", item->data.passo.params[p]->data.declaracao.nome, p);
+        }
+        if (len < (int)sizeof(temp_str)) {
+            snprintf(temp_str + len, sizeof(temp_str) - len, ")");
+        }
+        codegen_comment(gen, temp_str);
+        
+        snprintf(temp_str, sizeof(temp_str), "passo_%s", item->data.passo.nome);
+        codegen_label(gen, temp_str);
+        
+        /* O chamador pode estar dentro de um 'para': lacos do corpo salvam CNT */
+        int saved_depth = gen->para_depth;
+        gen->para_depth = 1;
+        gen->current_passo = item;
+        gen->in_tail = 1;
+        codegen_node(gen, item->data.passo.bloco);
+        gen->in_tail = 0;
+        gen->current_passo = NULL;
+        gen->para_depth = saved_depth;
+        
+        codegen_emit(gen, "RET");
     }
 }
 
 /* ===== GERACAO DE COMANDOS ===== */
 
+/* Valor de uma constante (literal, possivelmente negado) */
+/* A diretiva DATA grava frac como double e os demais tipos como inteiro */
+static double codegen_constant_value(ASTNode *node) {
+    switch (node->kind) {
+        case NODE_LITERAL_INT:
+            return node->data.literal_int.value;
+        case NODE_LITERAL_FRAC:
+            return node->data.literal_frac.value;
+        case NODE_LITERAL_BOOL:
+            return node->data.literal_bool.value;
+        case NODE_UNOP:
+            return -codegen_constant_value(node->data.unop.operand);
+        default:
+            return 0;
+    }
+}
+
+/* Declaracao de vetor: reservar o segmento e emitir a diretiva DATA */
+/* O armazenamento e estatico: a VM zera e inicializa o segmento na */
+/* carga do programa, nao a cada execucao da declaracao */
+static void codegen_array_declaration(CodeGenerator *gen, ASTNode *node) {
+    char temp_str[128];
+    char address[32];
+    int tamanho = node->data.declaracao.tamanho;
+    int base = codegen_alloc_array(gen, node->data.declaracao.nome,
+                                   node->data.declaracao.tipo, tamanho);
+    codegen_address_operand(gen, base, address, sizeof(address));
+    
+    snprintf(temp_str, sizeof(temp_str), "var %s : %s[%d] @ %s",
+            node->data.declaracao.nome,
+            ast_type_name(node->data.declaracao.tipo), tamanho, address);
+    codegen_comment(gen, temp_str);
+    
+    fprintf(gen->output, "    DATA %s %d", address, tamanho);
+    for (int i = 0; i < node->data.declaracao.num_init; i++) {
+        double value = codegen_constant_value(node->data.declaracao.init_list[i]);
+        if (node->data.declaracao.tipo == TYPE_FRAC) {
+            codegen_format_frac(value, temp_str, sizeof(temp_str));
+            fprintf(gen->output, " %s", temp_str);
+        } else {
+            fprintf(gen->output, " %d", (int)value);
+        }
+    }
+    fprintf(gen->output, "\n");
+}
+
+void codegen_program_header(CodeGenerator *gen, const char *nome) {
+    char temp_str[128];
+    codegen_comment(gen, "===========================================");
+    snprintf(temp_str, sizeof(temp_str), "Programa: %s", nome);
+    codegen_comment(gen, temp_str);
+    codegen_comment(gen, "Compilado por AirFryerScript Compiler");
+    codegen_comment(gen, "===========================================");
+    fprintf(gen->output, "\n");
+}
+
+/* Registrador que ja guarda o valor de expr (variavel em registrador) */
+/* ou NULL se for preciso avalia-la */
+static char* codegen_value_register(CodeGenerator *gen, ASTNode *expr) {
+    if (expr->kind != NODE_VARIAVEL) return NULL;
+    return codegen_get_var_location(gen, expr->data.variavel.nome);
+}
+
+/* imprimir: uma unica instrucao por comando. Argumentos constantes vao */
+/* para o template na string table (ver codegen_print_template) e os */
+/* valores de execucao sao passados em registradores para PRINTFMT: */
+/* variaveis no proprio registrador, o ultimo valor calculado em TIME e */
+/* os anteriores pela pilha (operando STACK) */
+static void codegen_imprimir(CodeGenerator *gen, ASTNode *node) {
+    char temp_str[128];
+    int n = node->data.imprimir.num_exprs;
+    int num_values;
+    char *text = codegen_print_template(node, &num_values);
+    
+    codegen_comment(gen, "imprimir");
+    
+    if (!text) {
+        if (n == 0) return;
+        
+        /* Um unico valor: PRINTI/PRINTF/PRINTB direto */
+        ASTNode *expr = node->data.imprimir.exprs[0];
+        const char *op = expr->data_type == TYPE_FRAC ? "PRINTF" :
+                         expr->data_type == TYPE_BOOL ? "PRINTB" : "PRINTI";
+        char *reg = codegen_value_register(gen, expr);
+        if (reg) {
+            codegen_emit1(gen, op, reg);
+            mem_free(reg);
+        } else {
+            codegen_expr(gen, expr, "TIME");
+            codegen_emit1(gen, op, "TIME");
+        }
+        return;
+    }
+    
+    int str_id = codegen_add_string(gen, text);
+    mem_free(text);
+    codegen_string_operand(gen, str_id, temp_str, sizeof(temp_str));
+    if (num_values == 0) {
+        codegen_emit1(gen, "SPRINT", temp_str);
+        return;
+    }
+    
+    /* Avaliar os valores que nao estao em registradores */
+    char **operands = (char**)mem_calloc(MEM_CODEGEN, n, sizeof(char*));
+    int last = -1;
+    for (int i = 0; i < n; i++) {
+        ASTNode *expr = node->data.imprimir.exprs[i];
+        char piece[64];
+        if (expr->kind == NODE_LITERAL_STR || codegen_print_constant(expr, piece, sizeof(piece))) {
+            continue;
+        }
+        operands[i] = codegen_value_register(gen, expr);
+        if (operands[i]) continue;
+        
+        if (last >= 0) {
+            codegen_emit1(gen, "PUSH", "TIME");
+            mem_free(operands[last]);
+            operands[last] = mem_strdup(MEM_CODEGEN, "STACK");
+        }
+        codegen_expr(gen, expr, "TIME");
+        operands[i] = mem_strdup(MEM_CODEGEN, "TIME");
+        last = i;
+    }
+    
+    fprintf(gen->output, "    PRINTFMT %s", temp_str);
+    for (int i = 0; i < n; i++) {
+        if (!operands[i]) continue;
+        fprintf(gen->output, " %s", operands[i]);
+        mem_free(operands[i]);
+    }
+    fprintf(gen->output, "\n");
+    mem_free(operands);
+}
+
 static void codegen_node(CodeGenerator *gen, ASTNode *node) {
     if (!node) return;
     
     char temp_str[128];
     
+    /* Posicao de cauda so passa adiante por blocos e pelos ramos do 'se' e do 'escolha' */
+    int tail = gen->in_tail;
+    gen->in_tail = 0;
+    
     switch (node->kind) {
         case NODE_PROGRAMA:
-            codegen_comment(gen, "===========================================");
-            snprintf(temp_str, sizeof(temp_str), "Programa: %s", node->data.programa.nome);
-            codegen_comment(gen, temp_str);
-            codegen_comment(gen, "Compilado por AirFryerScript Compiler");
-            codegen_comment(gen, "===========================================");
-            fprintf(gen->output, "\n");
+            codegen_program_header(gen, node->data.programa.nome);
             
             /* Pre-processar para coletar strings (primeira passagem) */
-            /* Fazemos isso percorrendo a arvore apenas para encontrar literais de string */
-            codegen_collect_strings(gen, node);
+            /* O gerenciador de passos normalmente ja fez isso junto com */
+            /* outros visitantes; so percorrer a arvore se ninguem fez */
+            if (!gen->strings_collected) {
+                codegen_collect_strings(gen, node);
+                gen->strings_collected = 1;
+            }
             
             /* Emitir string table */
             codegen_emit_string_table(gen);
             
             /* Gerar codigo para todos os itens */
+            gen->program = node;
             for (int i = 0; i < node->data.programa.num_items; i++) {
                 codegen_node(gen, node->data.programa.top_level_items[i]);
             }
             
             /* Adicionar HALT no final */
             codegen_emit(gen, "HALT");
+            
+            /* Subrotinas ficam depois do HALT, fora do fluxo principal */
+            codegen_subrotinas(gen, node);
             break;
             
         case NODE_RECEITA:
+            /* Receita reaproveitada do cache: apenas relocar e inserir */
+            if (node->data.receita.cached) {
+                codegen_link_fragment(gen, node->data.receita.cached);
+                break;
+            }
+            
+            /* Com cache ligado, compilar como fragmento para poder grava-lo */
+            if (node->data.receita.cache_key && !gen->fragment_mode) {
+                CodeFragment *frag = codegen_receita_fragment(gen, node);
+                codegen_link_fragment(gen, frag);
+                codegen_keep_fragment(gen, frag);
+                break;
+            }
+            
             codegen_comment(gen, "===== RECEITA =====");
             snprintf(temp_str, sizeof(temp_str), "Receita: %s", node->data.receita.nome);
             codegen_comment(gen, temp_str);
@@ -465,6 +1661,9 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             break;
             
         case NODE_PASSO:
+            /* Passo com parametros e gerado depois do HALT (ou expandido) */
+            if (node->data.passo.subrotina) break;
+            
             snprintf(temp_str, sizeof(temp_str), "Passo: %s", node->data.passo.nome);
             codegen_comment(gen, temp_str);
             codegen_node(gen, node->data.passo.bloco);
@@ -472,17 +1671,25 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             
         case NODE_BLOCO:
             for (int i = 0; i < node->data.bloco.num_statements; i++) {
+                gen->in_tail = tail && i == node->data.bloco.num_statements - 1;
                 codegen_node(gen, node->data.bloco.statements[i]);
             }
             break;
             
         case NODE_DECLARACAO: {
+            /* Vetores vivem na memoria, nao em registradores */
+            if (node->data.declaracao.tamanho > 0) {
+                codegen_array_declaration(gen, node);
+                break;
+            }
+            
             /* Alocar registrador para a variavel */
             char *reg = codegen_alloc_register(gen, node->data.declaracao.nome, 
                                               node->data.declaracao.tipo);
             if (!reg) {
-                fprintf(stderr, "Erro: nao ha registradores disponiveis para '%s'\n",
+                fprintf(gen->diag, "Erro: nao ha registradores disponiveis para '%s'\n",
                        node->data.declaracao.nome);
+                gen->num_errors++;
                 return;
             }
             
@@ -493,38 +1700,58 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             
             /* Se tem inicializacao, gerar codigo */
             if (node->data.declaracao.init_expr) {
-                codegen_expr(gen, node->data.declaracao.init_expr, reg);
+                codegen_expr_as(gen, node->data.declaracao.init_expr, reg,
+                                node->data.declaracao.tipo);
+            } else if (node->data.declaracao.tipo == TYPE_FRAC) {
+                codegen_emit2(gen, "SETF", reg, "0.0");
             } else {
                 /* Inicializar com 0 */
                 codegen_emit2(gen, "SET", reg, "0");
             }
             
-            free(reg);
+            mem_free(reg);
             break;
         }
             
         case NODE_ATRIBUICAO: {
+            if (node->data.atribuicao.indice) {
+                int a = codegen_find_array(gen, node->data.atribuicao.nome);
+                if (a < 0) break;
+                snprintf(temp_str, sizeof(temp_str), "%s[...] = ...", node->data.atribuicao.nome);
+                codegen_comment(gen, temp_str);
+                
+                /* Valor em TIME, indice em POWER, STORE grava memoria[base + POWER] */
+                codegen_expr_as(gen, node->data.atribuicao.expr, "TIME", gen->arrays[a].type);
+                codegen_emit1(gen, "PUSH", "TIME");
+                codegen_expr(gen, node->data.atribuicao.indice, "POWER");
+                codegen_emit1(gen, "POP", "TIME");
+                codegen_address_operand(gen, gen->arrays[a].base, temp_str, sizeof(temp_str));
+                codegen_emit3(gen, "STORE", "TIME", temp_str, "POWER");
+                break;
+            }
+            
             snprintf(temp_str, sizeof(temp_str), "%s = ...", node->data.atribuicao.nome);
             codegen_comment(gen, temp_str);
             
             char *reg = codegen_get_var_location(gen, node->data.atribuicao.nome);
             if (reg) {
-                codegen_expr(gen, node->data.atribuicao.expr, reg);
-                free(reg);
+                codegen_expr_as(gen, node->data.atribuicao.expr, reg,
+                                codegen_var_type(gen, node->data.atribuicao.nome));
+                mem_free(reg);
             }
             break;
         }
             
         case NODE_PREAQUECER:
             codegen_comment(gen, "preaquecer");
-            codegen_expr(gen, node->data.preaquecer.temperatura, "POWER");
+            codegen_expr_as(gen, node->data.preaquecer.temperatura, "POWER", TYPE_INTEIRO);
             codegen_emit2(gen, "SETMODE", "0", "");  /* Modo preaquecer */
             break;
             
         case NODE_COZINHAR: {
             codegen_comment(gen, "cozinhar");
-            codegen_expr(gen, node->data.cozinhar.temperatura, "POWER");
-            codegen_expr(gen, node->data.cozinhar.tempo, "TIME");
+            codegen_expr_as(gen, node->data.cozinhar.temperatura, "POWER", TYPE_INTEIRO);
+            codegen_expr_as(gen, node->data.cozinhar.tempo, "TIME", TYPE_INTEIRO);
             
             /* Converter tempo se for segundos */
             if (node->data.cozinhar.unidade == TIME_SEGUNDOS) {
@@ -539,14 +1766,14 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             codegen_emit2(gen, "DECJZ", "TIME", end_label);
             codegen_emit1(gen, "GOTO", loop_label);
             codegen_label(gen, end_label);
-            free(loop_label);
-            free(end_label);
+            mem_free(loop_label);
+            mem_free(end_label);
             break;
         }
             
         case NODE_AQUECER:
             codegen_comment(gen, "aquecer");
-            codegen_expr(gen, node->data.aquecer.tempo, "TIME");
+            codegen_expr_as(gen, node->data.aquecer.tempo, "TIME", TYPE_INTEIRO);
             /* Similar ao cozinhar, mas sem mudar POWER */
             break;
             
@@ -580,29 +1807,7 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             break;
             
         case NODE_IMPRIMIR:
-            codegen_comment(gen, "imprimir");
-            for (int i = 0; i < node->data.imprimir.num_exprs; i++) {
-                ASTNode *expr = node->data.imprimir.exprs[i];
-                
-                if (expr->kind == NODE_LITERAL_STR) {
-                    /* String literal: adicionar a string table e emitir SPRINT */
-                    int str_id = codegen_add_string(gen, expr->data.literal_str.value);
-                    snprintf(temp_str, sizeof(temp_str), "%d", str_id);
-                    codegen_emit1(gen, "SPRINT", temp_str);
-                } else {
-                    /* Avaliar expressao e imprimir */
-                    codegen_expr(gen, expr, "TIME");
-                    
-                    /* Escolher instrucao de print baseada no tipo */
-                    if (expr->data_type == TYPE_FRAC) {
-                        codegen_emit1(gen, "PRINTF", "TIME");
-                    } else if (expr->data_type == TYPE_BOOL) {
-                        codegen_emit1(gen, "PRINTB", "TIME");
-                    } else {
-                        codegen_emit1(gen, "PRINTI", "TIME");
-                    }
-                }
-            }
+            codegen_imprimir(gen, node);
             break;
             
         case NODE_SE: {
@@ -622,18 +1827,20 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             }
             
             /* Bloco then */
+            gen->in_tail = tail;
             codegen_node(gen, node->data.se.bloco_then);
             
             if (node->data.se.bloco_else) {
                 codegen_emit1(gen, "GOTO", end_label);
                 codegen_label(gen, else_label);
                 codegen_comment(gen, "senao");
+                gen->in_tail = tail;
                 codegen_node(gen, node->data.se.bloco_else);
             }
             
             codegen_label(gen, end_label);
-            free(else_label);
-            free(end_label);
+            mem_free(else_label);
+            mem_free(end_label);
             break;
         }
             
@@ -657,11 +1864,27 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
             codegen_emit1(gen, "GOTO", loop_label);
             
             codegen_label(gen, end_label);
-            free(loop_label);
-            free(end_label);
+            mem_free(loop_label);
+            mem_free(end_label);
             break;
         }
             
+        case NODE_PARA:
+            codegen_para(gen, node);
+            break;
+            
+        case NODE_QUANDO:
+            codegen_quando(gen, node);
+            break;
+            
+        case NODE_CHAMADA:
+            codegen_chamada(gen, node, tail);
+            break;
+            
+        case NODE_ESCOLHA:
+            codegen_escolha(gen, node, tail);
+            break;
+            
         default:
             break;
     }
@@ -669,11 +1892,110 @@ static void codegen_node(CodeGenerator *gen, ASTNode *node) {
 
 /* ===== FUNCAO PRINCIPAL ===== */
 
+int codegen_parse_target(const char *name, CodegenTarget *target) {
+    if (strcmp(name, "airfryer") == 0) {
+        *target = TARGET_AIRFRYER;
+    } else if (strcmp(name, "x86-64") == 0 || strcmp(name, "x86_64") == 0) {
+        *target = TARGET_X86_64;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
 int codegen_generate(CodeGenerator *gen, ASTNode *root) {
     if (!gen || !root) return 0;
     
+    if (gen->target == TARGET_X86_64) return codegen_x86_generate(gen, root);
+    
     /* Gerar codigo para a AST */
     codegen_node(gen, root);
     
-    return 1;
+    return gen->num_errors == 0;
+}
+
+/* ===== MODULOS ===== */
+
+CodeFragment* codegen_module(CodeGenerator *gen, ASTNode *programa, int exportar) {
+    char temp_str[128];
+    CodeFragment *frag = (CodeFragment*)mem_calloc(MEM_CODEGEN, 1, sizeof(CodeFragment));
+    FILE *saved_output = gen->output;
+    
+    gen->output = open_memstream(&frag->code, &frag->code_len);
+    gen->fragment_mode = 1;
+    gen->module_mode = 1;
+    gen->export_all = exportar;
+    gen->program = programa;
+    
+    /* Ids locais seguem a ordem da coleta de strings */
+    if (!gen->strings_collected) {
+        codegen_collect_strings(gen, programa);
+        gen->strings_collected = 1;
+    }
+    
+    codegen_comment(gen, "===== MODULO =====");
+    snprintf(temp_str, sizeof(temp_str), "Modulo: %s", programa->data.programa.nome);
+    codegen_comment(gen, temp_str);
+    snprintf(temp_str, sizeof(temp_str), "modulo_%s", programa->data.programa.nome);
+    codegen_label(gen, temp_str);
+    for (int i = 0; i < programa->data.programa.num_items; i++) {
+        codegen_node(gen, programa->data.programa.top_level_items[i]);
+    }
+    codegen_emit(gen, "RET");
+    codegen_subrotinas(gen, programa);
+    fprintf(gen->output, "\n");
+    fclose(gen->output);
+    gen->output = saved_output;
+    gen->fragment_mode = 0;
+    gen->module_mode = 0;
+    
+    /* String table, variaveis e vetores passam a ser do fragmento */
+    frag->num_labels = gen->label_counter;
+    frag->num_strings = gen->num_strings;
+    frag->strings = (char**)mem_malloc(MEM_CODEGEN, (gen->num_strings + 1) * sizeof(char*));
+    for (int i = 0; i < gen->num_strings; i++) {
+        frag->strings[gen->strings[i].id] = mem_strdup(MEM_CODEGEN, gen->strings[i].text);
+    }
+    
+    frag->num_vars = gen->num_vars;
+    frag->vars = mem_malloc(MEM_CODEGEN, (frag->num_vars + 1) * sizeof(*frag->vars));
+    for (int i = 0; i < frag->num_vars; i++) {
+        frag->vars[i].var_name = mem_strdup(MEM_CODEGEN, gen->var_map[i].var_name);
+        frag->vars[i].type = gen->var_map[i].type;
+        frag->vars[i].location = gen->var_map[i].location;
+    }
+    
+    frag->num_arrays = gen->num_arrays;
+    frag->arrays = mem_malloc(MEM_CODEGEN, (frag->num_arrays + 1) * sizeof(*frag->arrays));
+    for (int i = 0; i < frag->num_arrays; i++) {
+        frag->arrays[i].var_name = mem_strdup(MEM_CODEGEN, gen->arrays[i].var_name);
+        frag->arrays[i].type = gen->arrays[i].type;
+        frag->arrays[i].base = gen->arrays[i].base;
+        frag->arrays[i].size = gen->arrays[i].size;
+    }
+    
+    return frag;
+}
+
+/* ===== GERACAO INCREMENTAL ===== */
+
+/* Cada item e gerado assim que chega; as strings entram na tabela quando */
+/* aparecem e a tabela vai para o fim do arquivo (a VM le os SDEF antes */
+/* de executar, em qualquer posicao) */
+
+void codegen_stream_begin(CodeGenerator *gen, ASTNode *programa) {
+    codegen_program_header(gen, programa->data.programa.nome);
+    gen->program = programa;
+    gen->strings_collected = 1;
+}
+
+void codegen_stream_item(CodeGenerator *gen, ASTNode *item) {
+    codegen_node(gen, item);
+}
+
+void codegen_stream_end(CodeGenerator *gen) {
+    codegen_emit(gen, "HALT");
+    codegen_subrotinas(gen, gen->program);
+    fprintf(gen->output, "\n");
+    codegen_emit_string_table(gen);
 }
@@ -12,9 +12,54 @@
 #include "ast.h"
 #include <stdio.h>
 
+/* Arquitetura de saida do gerador */
+typedef enum {
+    TARGET_AIRFRYER,           /* Assembly textual da AirFryerVM (.mwasm) */
+    TARGET_X86_64              /* Assembly GNU x86-64 (ver codegen_x86.h) */
+} CodegenTarget;
+
+/* Desvio do 'escolha': tabela de saltos a partir deste numero de casos, */
+/* se ao menos metade das entradas tiver caso e a faixa couber no limite; */
+/* senao busca binaria a partir do mesmo numero, ou comparacoes em cadeia */
+#define ESCOLHA_MIN_CASES 4
+#define ESCOLHA_MAX_TABLE 256
+
+/* Fragmento de codigo relocavel (uma receita compilada isoladamente) */
+/* Labels sao emitidos como "prefixo_@N" e strings como "$N", com N local */
+/* ao fragmento; codegen_link_fragment reescreve ambos ao inseri-lo */
+typedef struct CodeFragment {
+    unsigned long long key;    /* Chave no cache de receitas */
+    char *code;                /* Assembly relocavel */
+    size_t code_len;
+    int num_labels;            /* Labels locais usados (0..num_labels-1) */
+    
+    /* Strings referenciadas, na ordem dos ids locais */
+    char **strings;
+    int num_strings;
+    
+    /* Variaveis alocadas pelo fragmento (aplicadas ao var_map no link) */
+    struct {
+        char *var_name;
+        DataType type;
+        int location;
+    } *vars;
+    int num_vars;
+    
+    /* Vetores alocados pelo fragmento (enderecos absolutos) */
+    struct {
+        char *var_name;
+        DataType type;
+        int base;
+        int size;
+    } *arrays;
+    int num_arrays;
+} CodeFragment;
+
 /* Estrutura para gerenciar a geracao de codigo */
 typedef struct CodeGenerator {
     FILE *output;              /* Arquivo de saida */
+    FILE *diag;                /* Destino das mensagens de erro (padrao: stderr) */
+    CodegenTarget target;      /* Arquitetura de saida (padrao: AirFryerVM) */
     int label_counter;         /* Contador para gerar labels unicos */
     int string_counter;        /* Contador para strings na string table */
     int temp_reg_counter;      /* Contador para registradores temporarios */
@@ -28,6 +73,17 @@ typedef struct CodeGenerator {
     int num_vars;
     int capacity;
     
+    /* Vetores na memoria linear da VM (um segmento por declaracao) */
+    struct {
+        char *var_name;
+        DataType type;
+        int base;              /* Endereco do primeiro elemento */
+        int size;              /* Numero de elementos */
+    } *arrays;
+    int num_arrays;
+    int arrays_capacity;
+    int memory_size;           /* Primeiro endereco livre */
+    
     /* String table (para literais de texto) */
     struct {
         char *text;
@@ -35,6 +91,25 @@ typedef struct CodeGenerator {
     } *strings;
     int num_strings;
     int string_capacity;
+    
+    int num_errors;            /* Erros de geracao reportados em diag */
+    int fragment_mode;         /* 1 enquanto gera um fragmento relocavel */
+    int module_mode;           /* 1 enquanto gera um modulo: registradores "%N" e */
+                               /* enderecos de vetores "&N" tambem sao relocaveis */
+    int export_all;            /* 1 para gerar todos os passos com parametros */
+    int strings_collected;     /* 1 se a string table ja foi preenchida */
+    int calls_collected;       /* 1 se os passos chamados ja foram marcados */
+    int para_depth;            /* Lacos 'para' abertos (CNT salvo na pilha se > 0) */
+    
+    /* Passos com parametros (subrotinas) */
+    ASTNode *program;          /* Programa sendo gerado (para achar os passos) */
+    ASTNode *current_passo;    /* Passo cujos parametros estao em A0-A3 (NULL fora) */
+    int in_tail;               /* Proximo comando esta em posicao de cauda */
+    
+    /* Fragmentos gerados para receitas com cache_key (a gravar no cache) */
+    CodeFragment **new_fragments;
+    int num_new_fragments;
+    int new_fragments_capacity;
 } CodeGenerator;
 
 /* Criar um novo gerador de codigo */
@@ -43,10 +118,33 @@ CodeGenerator* codegen_create(FILE *output);
 /* Liberar memoria do gerador */
 void codegen_free(CodeGenerator *gen);
 
-/* Gerar codigo para a AST completa */
+/* Gerar codigo para a AST completa, na arquitetura de gen->target */
 /* Retorna 1 se sucesso, 0 se erro */
 int codegen_generate(CodeGenerator *gen, ASTNode *root);
 
+/* Gerar o programa como modulo (ver link.h), sem string table nem HALT */
+/* O codigo comeca no label "modulo_<nome>" e roda os itens do programa */
+/* ate um RET; em seguida vem os passos com parametros (todos, se */
+/* exportar, ou so os chamados). Retorna o fragmento relocavel, com as */
+/* strings, as variaveis (location = N de "%N") e os vetores (base = N */
+/* de "&N") do modulo */
+CodeFragment* codegen_module(CodeGenerator *gen, ASTNode *programa, int exportar);
+
+/* Comentario de cabecalho do arquivo gerado */
+void codegen_program_header(CodeGenerator *gen, const char *nome);
+
+/* Geracao incremental (modo streaming), um item do programa por vez */
+/* begin emite o cabecalho; programa guarda so os passos com parametros */
+/* ja vistos, que devem continuar vivos ate end */
+void codegen_stream_begin(CodeGenerator *gen, ASTNode *programa);
+
+/* Gerar um item do nivel do programa; depois dele o item pode ser */
+/* liberado (exceto passos com parametros) */
+void codegen_stream_item(CodeGenerator *gen, ASTNode *item);
+
+/* Emitir HALT, as subrotinas chamadas e a string table */
+void codegen_stream_end(CodeGenerator *gen);
+
 /* Funcoes auxiliares para emitir codigo assembly */
 
 /* Emitir um comentario */
@@ -74,17 +172,82 @@ char* codegen_new_label(CodeGenerator *gen, const char *prefix);
 /* Adicionar uma string a string table e retornar seu ID */
 int codegen_add_string(CodeGenerator *gen, const char *text);
 
-/* Emitir a string table no inicio do arquivo */
+/* Visitante da coleta de literais de string (um no por chamada) */
+/* Retorna 1 se os filhos do no devem ser visitados */
+/* Quem percorre a arvore inteira deve marcar strings_collected */
+int codegen_string_visitor(CodeGenerator *gen, ASTNode *node);
+
+/* Visitante que marca passo.referenciado em cada passo nomeado por uma */
+/* chamada de programa (um no por chamada) */
+/* Retorna 1 se os filhos do no devem ser visitados */
+/* Quem percorre a arvore inteira deve marcar calls_collected */
+int codegen_call_visitor(ASTNode *programa, ASTNode *node);
+
+/* Template de um imprimir: os argumentos separados por espaco, com os */
+/* valores de execucao trocados por %d/%f/%b; num_values recebe quantos */
+/* Retorna NULL se nao ha string (nenhum argumento ou um unico valor); */
+/* quem chama libera o texto */
+char* codegen_print_template(ASTNode *node, int *num_values);
+
+/* O argumento de imprimir e conhecido em compilacao (entra no template)? */
+/* Se sim, escreve em buf o texto que a VM imprimiria e retorna 1 */
+int codegen_print_constant(ASTNode *expr, char *buf, size_t size);
+
+/* Converter o nome de uma arquitetura ("airfryer", "x86-64") */
+/* Retorna 1 se sucesso, 0 se o nome e desconhecido */
+int codegen_parse_target(const char *name, CodegenTarget *target);
+
+/* Emitir a string table (no inicio do arquivo, ou no fim no modo streaming) */
 void codegen_emit_string_table(CodeGenerator *gen);
 
+/* Inserir um fragmento no codigo de saida, relocando labels e strings */
+/* As strings do fragmento ja devem estar na string table */
+void codegen_link_fragment(CodeGenerator *gen, const CodeFragment *frag);
+
+/* Inserir o fragmento de um modulo (codegen_module), relocando tambem */
+/* registradores e vetores: cada variavel recebe um registrador do */
+/* programa ligado, com o nome qualificado "escopo.var" (escopo NULL = */
+/* nomes sem qualificacao), e os vetores um segmento novo */
+/* Retorna 1 se sucesso, 0 se faltarem registradores */
+int codegen_link_module(CodeGenerator *gen, const CodeFragment *frag, const char *escopo);
+
+/* Liberar um fragmento */
+void codegen_fragment_free(CodeFragment *frag);
+
 /* Alocar um registrador para uma variavel */
 /* Retorna o nome do registrador (R0-R3) ou NULL se nao houver disponivel */
 char* codegen_alloc_register(CodeGenerator *gen, const char *var_name, DataType type);
 
+/* Liberar o registrador de uma variavel (fim do escopo de um 'para') */
+void codegen_free_register(CodeGenerator *gen, const char *var_name);
+
 /* Obter o local (registrador/offset) de uma variavel */
 /* Retorna string com "R0", "R1", etc ou NULL se nao encontrado */
 char* codegen_get_var_location(CodeGenerator *gen, const char *var_name);
 
+/* Reservar um segmento de memoria para um vetor */
+/* Retorna o endereco base; cada chamada cria um segmento novo */
+int codegen_alloc_array(CodeGenerator *gen, const char *var_name, DataType type, int size);
+
+/* Obter o indice do vetor em gen->arrays (declaracao mais recente) */
+/* Retorna -1 se nao encontrado */
+int codegen_find_array(CodeGenerator *gen, const char *var_name);
+
+/* O corpo de um NODE_PARA le a variavel de controle? */
+/* Se nao, o laco usa apenas o contador e a variavel nao ganha registrador */
+int codegen_para_reads_var(ASTNode *para);
+
+/* A expressao e um literal inteiro, possivelmente negado? */
+/* Se sim, guarda o valor em value e retorna 1 */
+int codegen_constant_int(ASTNode *node, int *value);
+
+/* Conjunto de sensores lidos pela expressao (bit = SensorKind) */
+unsigned codegen_sensors_read(ASTNode *node);
+
+/* Um passo com parametros e pequeno o bastante para ser expandido */
+/* em cada chamada em vez de virar subrotina? */
+int codegen_passo_inlinable(ASTNode *passo);
+
 /* Obter um registrador temporario livre */
 char* codegen_temp_register(CodeGenerator *gen);
 
@@ -0,0 +1,1337 @@
+/*
+ * codegen_x86.c
+ * Implementacao da geracao de assembly x86-64
+ *
+ * Convencoes do codigo gerado:
+ *   - o valor de uma expressao fica em %rax (inteiro/bool) ou %xmm0 (frac);
+ *   - temporarios vao para a pilha; depth conta as palavras empilhadas
+ *     desde o alinhamento do quadro, para alinhar %rsp nas chamadas ao
+ *     runtime;
+ *   - caminhos de erro ficam fora do fluxo, depois do corpo da funcao,
+ *     e chamam o runtime, que encerra o programa.
+ */
+
+#include "codegen_x86.h"
+#include "semantic.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+/* Registradores callee-saved para variaveis inteiras e bool */
+static const char* VAR_REGS[] = {"%rbx", "%r12", "%r13", "%r14", "%r15"};
+#define NUM_VAR_REGS 5
+
+/* Bytes que main salva abaixo de %rbp (os registradores acima) */
+#define MAIN_SAVED (8 * NUM_VAR_REGS)
+
+/* Relacoes do WAIT na ordem de VMRelation (vm/native/asm.h) */
+enum { WAIT_EQ, WAIT_NE, WAIT_LT, WAIT_LE, WAIT_GT, WAIT_GE };
+
+/* Estado da geracao de uma unidade */
+typedef struct X86Gen {
+    CodeGenerator *gen;        /* var_map, vetores, string table e labels */
+    FILE *out;                 /* Saida final */
+
+    /* Funcao sendo gerada: corpo e caminhos de erro sao montados a parte */
+    /* e vao para out depois do prologo, quando o quadro ja e conhecido */
+    FILE *body;
+    char *body_buf;
+    size_t body_len;
+    FILE *cold;
+    char *cold_buf;
+    size_t cold_len;
+    int depth;                 /* Palavras de 8 bytes empilhadas */
+    int frame_base;            /* Bytes salvos abaixo de %rbp antes do quadro */
+    int loops;                 /* Lacos 'para' abertos (contadores no quadro) */
+    int max_loops;
+
+    /* Secoes acumuladas ate o fim */
+    FILE *rodata;              /* Constantes frac e tabelas de saltos */
+    char *rodata_buf;
+    size_t rodata_len;
+    FILE *data;                /* Valores iniciais da memoria de vetores */
+    char *data_buf;
+    size_t data_len;
+    int num_consts;
+    int num_slots;             /* Variaveis em posicoes estaticas */
+    int num_var_regs;          /* Registradores de VAR_REGS em uso */
+} X86Gen;
+
+static void x86_node(X86Gen *xg, ASTNode *node);
+static void x86_expr(X86Gen *xg, ASTNode *node);
+
+/* ===== EMISSAO ===== */
+
+static void x86_ins(X86Gen *xg, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/* Emitir uma instrucao no corpo da funcao atual */
+static void x86_ins(X86Gen *xg, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fputs("    ", xg->body);
+    vfprintf(xg->body, fmt, args);
+    fputc('\n', xg->body);
+    va_end(args);
+}
+
+static void x86_comment(X86Gen *xg, const char *comment) {
+    fprintf(xg->body, "    # %s\n", comment);
+}
+
+static void x86_label(X86Gen *xg, const char *label) {
+    fprintf(xg->body, "%s:\n", label);
+}
+
+/* Chamar uma funcao do runtime com %rsp alinhado em 16 bytes */
+static void x86_call(X86Gen *xg, const char *fn) {
+    if (xg->depth & 1) x86_ins(xg, "subq $8, %%rsp");
+    x86_ins(xg, "call %s@PLT", fn);
+    if (xg->depth & 1) x86_ins(xg, "addq $8, %%rsp");
+}
+
+static void x86_push(X86Gen *xg, const char *reg) {
+    x86_ins(xg, "pushq %s", reg);
+    xg->depth++;
+}
+
+static void x86_pop(X86Gen *xg, const char *reg) {
+    x86_ins(xg, "popq %s", reg);
+    xg->depth--;
+}
+
+static void x86_push_frac(X86Gen *xg) {
+    x86_ins(xg, "subq $8, %%rsp");
+    x86_ins(xg, "movsd %%xmm0, (%%rsp)");
+    xg->depth++;
+}
+
+static void x86_pop_frac(X86Gen *xg, const char *reg) {
+    x86_ins(xg, "movsd (%%rsp), %s", reg);
+    x86_ins(xg, "addq $8, %%rsp");
+    xg->depth--;
+}
+
+/* Caminho de erro: setup (instrucoes separadas por '\n', ou NULL) e a */
+/* chamada fn(line), que nao retorna; retorna o label para o salto */
+static char* x86_cold_fail(X86Gen *xg, const char *fn, int line, const char *setup) {
+    char *label = codegen_new_label(xg->gen, ".Lerro");
+    fprintf(xg->cold, "%s:\n", label);
+    if (setup) {
+        for (const char *p = setup; *p; ) {
+            const char *end = strchr(p, '\n');
+            size_t len = end ? (size_t)(end - p) : strlen(p);
+            fprintf(xg->cold, "    %.*s\n", (int)len, p);
+            p += len + (end ? 1 : 0);
+        }
+    }
+    fprintf(xg->cold, "    movl $%d, %%edi\n", line);
+    fprintf(xg->cold, "    andq $-16, %%rsp\n");
+    fprintf(xg->cold, "    call %s@PLT\n", fn);
+    return label;
+}
+
+/* Estouro de inteiro no ultimo add/sub/imul/neg */
+static void x86_check_overflow(X86Gen *xg, int line) {
+    char *fail = x86_cold_fail(xg, "afrt_overflow", line, NULL);
+    x86_ins(xg, "jo %s", fail);
+    mem_free(fail);
+}
+
+/* ===== CONSTANTES ===== */
+
+/* Carregar um frac constante em reg (zero sem acessar memoria) */
+static void x86_frac_const(X86Gen *xg, double value, const char *reg) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits == 0) {
+        x86_ins(xg, "xorpd %s, %s", reg, reg);
+        return;
+    }
+    int id = xg->num_consts++;
+    fprintf(xg->rodata, "    .p2align 3\n.Lconst_%d:\n    .quad 0x%016llx    # %.17g\n",
+            id, bits, value);
+    x86_ins(xg, "movsd .Lconst_%d(%%rip), %s", id, reg);
+}
+
+/* ===== VARIAVEIS ===== */
+
+/* Operando de uma entrada do var_map */
+static void x86_map_operand(X86Gen *xg, int index, char *buf, size_t size) {
+    int location = xg->gen->var_map[index].location;
+    if (location >= 0) {
+        snprintf(buf, size, "%s", VAR_REGS[location]);
+    } else {
+        snprintf(buf, size, ".Lvar_%d(%%rip)", -location - 1);
+    }
+}
+
+/* Alocar (ou reaproveitar, pelo nome) o lugar de uma variavel */
+/* Retorna o indice no var_map */
+static int x86_alloc_var(X86Gen *xg, const char *var_name, DataType type) {
+    CodeGenerator *gen = xg->gen;
+    for (int i = 0; i < gen->num_vars; i++) {
+        if (strcmp(gen->var_map[i].var_name, var_name) == 0) return i;
+    }
+
+    if (gen->num_vars >= gen->capacity) {
+        gen->capacity *= 2;
+        gen->var_map = mem_realloc(MEM_CODEGEN, gen->var_map, gen->capacity * sizeof(*gen->var_map));
+    }
+
+    /* frac nao tem registrador callee-saved no ABI: sempre em memoria */
+    int location;
+    if (type != TYPE_FRAC && xg->num_var_regs < NUM_VAR_REGS) {
+        location = xg->num_var_regs++;
+    } else {
+        location = -(++xg->num_slots);
+    }
+    gen->var_map[gen->num_vars].var_name = mem_strdup(MEM_CODEGEN, var_name);
+    gen->var_map[gen->num_vars].type = type;
+    gen->var_map[gen->num_vars].location = location;
+    return gen->num_vars++;
+}
+
+/* Operando e tipo de uma variavel escalar visivel (parametros primeiro) */
+/* Retorna 1 se encontrada */
+static int x86_var(X86Gen *xg, const char *var_name, char *buf, size_t size, DataType *type) {
+    ASTNode *passo = xg->gen->current_passo;
+    if (passo) {
+        int n = passo->data.passo.num_params;
+        for (int i = 0; i < n; i++) {
+            ASTNode *param = passo->data.passo.params[i];
+            if (strcmp(param->data.declaracao.nome, var_name) == 0) {
+                /* Argumentos empilhados na ordem: o ultimo logo acima do retorno */
+                snprintf(buf, size, "%d(%%rbp)", 16 + 8 * (n - 1 - i));
+                *type = param->data.declaracao.tipo;
+                return 1;
+            }
+        }
+    }
+
+    CodeGenerator *gen = xg->gen;
+    for (int i = 0; i < gen->num_vars; i++) {
+        if (strcmp(gen->var_map[i].var_name, var_name) == 0) {
+            x86_map_operand(xg, i, buf, size);
+            *type = gen->var_map[i].type;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Gravar o resultado (%rax ou %xmm0, conforme type) no operando */
+static void x86_store(X86Gen *xg, const char *operand, DataType type) {
+    if (type == TYPE_FRAC) {
+        x86_ins(xg, "movsd %%xmm0, %s", operand);
+    } else {
+        x86_ins(xg, "movq %%rax, %s", operand);
+    }
+}
+
+/* ===== CONVERSOES ===== */
+
+/* Converter o resultado do tipo from para o tipo to */
+static void x86_convert(X86Gen *xg, DataType from, DataType to, int line) {
+    if (from != TYPE_FRAC && to == TYPE_FRAC) {
+        x86_ins(xg, "cvtsi2sdq %%rax, %%xmm0");
+    } else if (from == TYPE_FRAC && to != TYPE_FRAC) {
+        /* Truncar; NaN, infinito e fora da faixa dao 0x8000...0, que */
+        /* e o unico valor com estouro em rax - 1 (o runtime decide) */
+        x86_ins(xg, "cvttsd2si %%xmm0, %%rax");
+        x86_ins(xg, "cmpq $1, %%rax");
+        x86_ins(xg, "jno 1f");
+        x86_ins(xg, "movl $%d, %%edi", line);
+        x86_call(xg, "afrt_ftoi");
+        fprintf(xg->body, "1:\n");
+    }
+}
+
+static void x86_expr_as(X86Gen *xg, ASTNode *node, DataType type) {
+    x86_expr(xg, node);
+    x86_convert(xg, node->data_type, type, node->line);
+}
+
+/* Valor de verdade do resultado em %rax (0 ou 1) */
+static void x86_truth(X86Gen *xg, ASTNode *node) {
+    x86_expr(xg, node);
+    if (node->data_type == TYPE_FRAC) {
+        /* Diferente de zero, inclusive NaN */
+        x86_ins(xg, "xorpd %%xmm1, %%xmm1");
+        x86_ins(xg, "ucomisd %%xmm1, %%xmm0");
+        x86_ins(xg, "setne %%al");
+        x86_ins(xg, "setp %%cl");
+        x86_ins(xg, "orb %%cl, %%al");
+        x86_ins(xg, "movzbl %%al, %%eax");
+    } else if (node->data_type != TYPE_BOOL) {
+        x86_ins(xg, "testq %%rax, %%rax");
+        x86_ins(xg, "setne %%al");
+        x86_ins(xg, "movzbl %%al, %%eax");
+    }
+}
+
+/* ===== EXPRESSOES ===== */
+
+static int is_comparison(BinOpKind op) {
+    return op == OP_EQ || op == OP_NE || op == OP_LT || op == OP_LE ||
+           op == OP_GT || op == OP_GE;
+}
+
+/* Sufixo do setcc/jcc da comparacao inteira (negada se negate) */
+static const char* x86_condition(BinOpKind op, int negate) {
+    switch (op) {
+        case OP_EQ: return negate ? "ne" : "e";
+        case OP_NE: return negate ? "e" : "ne";
+        case OP_LT: return negate ? "ge" : "l";
+        case OP_LE: return negate ? "g" : "le";
+        case OP_GT: return negate ? "le" : "g";
+        default:    return negate ? "l" : "ge";
+    }
+}
+
+/* Operando inteiro que nao precisa ser avaliado: literal ou variavel */
+static int x86_simple_operand(X86Gen *xg, ASTNode *node, char *buf, size_t size) {
+    DataType type;
+    switch (node->kind) {
+        case NODE_LITERAL_INT:
+            snprintf(buf, size, "$%d", node->data.literal_int.value);
+            return 1;
+        case NODE_LITERAL_BOOL:
+            snprintf(buf, size, "$%d", node->data.literal_bool.value);
+            return 1;
+        case NODE_VARIAVEL:
+            return x86_var(xg, node->data.variavel.nome, buf, size, &type) &&
+                   type != TYPE_FRAC && node->data_type != TYPE_FRAC;
+        default:
+            return 0;
+    }
+}
+
+/* Operandos inteiros de uma operacao binaria: esquerdo em %rax e o */
+/* direito em src (literal, variavel ou %rcx) */
+static void x86_int_operands(X86Gen *xg, ASTNode *node, char *src, size_t size) {
+    x86_expr(xg, node->data.binop.left);
+    if (x86_simple_operand(xg, node->data.binop.right, src, size)) return;
+    x86_push(xg, "%rax");
+    x86_expr(xg, node->data.binop.right);
+    x86_ins(xg, "movq %%rax, %%rcx");
+    x86_pop(xg, "%rax");
+    snprintf(src, size, "%%rcx");
+}
+
+/* Operandos frac: esquerdo em %xmm0 e direito em %xmm1, ambos ja frac */
+static void x86_frac_operands(X86Gen *xg, ASTNode *node) {
+    ASTNode *right = node->data.binop.right;
+    char src[64];
+    DataType type;
+
+    x86_expr_as(xg, node->data.binop.left, TYPE_FRAC);
+    if (right->kind == NODE_LITERAL_FRAC) {
+        x86_frac_const(xg, right->data.literal_frac.value, "%xmm1");
+    } else if (right->kind == NODE_LITERAL_INT) {
+        x86_frac_const(xg, right->data.literal_int.value, "%xmm1");
+    } else if (right->kind == NODE_VARIAVEL &&
+               x86_var(xg, right->data.variavel.nome, src, sizeof(src), &type)) {
+        if (type == TYPE_FRAC) {
+            x86_ins(xg, "movsd %s, %%xmm1", src);
+        } else {
+            x86_ins(xg, "cvtsi2sdq %s, %%xmm1", src);
+        }
+    } else {
+        x86_push_frac(xg);
+        x86_expr_as(xg, right, TYPE_FRAC);
+        x86_ins(xg, "movapd %%xmm0, %%xmm1");
+        x86_pop_frac(xg, "%xmm0");
+    }
+}
+
+/* Divisao e resto inteiros arredondando para baixo (como a VM) */
+/* Divisor 0 ou -1 vai ao runtime: erro, estouro ou resto 0 */
+static void x86_divmod(X86Gen *xg, BinOpKind op, const char *src, int line) {
+    int safe = src[0] == '$' && strcmp(src, "$0") != 0 && strcmp(src, "$-1") != 0;
+    char *slow = NULL;
+    char *done = codegen_new_label(xg->gen, ".Ldiv");
+
+    if (strcmp(src, "%rcx") != 0) x86_ins(xg, "movq %s, %%rcx", src);
+    if (!safe) {
+        slow = codegen_new_label(xg->gen, ".Ldiv_lento");
+        x86_ins(xg, "leaq 1(%%rcx), %%rdx");
+        x86_ins(xg, "cmpq $1, %%rdx");
+        x86_ins(xg, "jbe %s", slow);
+    }
+    x86_ins(xg, "cqto");
+    x86_ins(xg, "idivq %%rcx");
+    if (op == OP_MOD) x86_ins(xg, "movq %%rdx, %%rax");
+    /* Resto diferente de zero com sinal oposto ao divisor: corrigir */
+    x86_ins(xg, "testq %%rdx, %%rdx");
+    x86_ins(xg, "je %s", done);
+    x86_ins(xg, "xorq %%rcx, %%rdx");
+    x86_ins(xg, "jns %s", done);
+    if (op == OP_MOD) {
+        x86_ins(xg, "addq %%rcx, %%rax");
+    } else {
+        x86_ins(xg, "decq %%rax");
+    }
+    x86_label(xg, done);
+
+    if (slow) {
+        fprintf(xg->cold, "%s:\n", slow);
+        fprintf(xg->cold, "    movq %%rax, %%rdi\n");
+        fprintf(xg->cold, "    movq %%rcx, %%rsi\n");
+        fprintf(xg->cold, "    movl $%d, %%edx\n", line);
+        if (xg->depth & 1) fprintf(xg->cold, "    subq $8, %%rsp\n");
+        fprintf(xg->cold, "    call %s@PLT\n", op == OP_MOD ? "afrt_mod" : "afrt_div");
+        if (xg->depth & 1) fprintf(xg->cold, "    addq $8, %%rsp\n");
+        fprintf(xg->cold, "    jmp %s\n", done);
+        mem_free(slow);
+    }
+    mem_free(done);
+}
+
+static void x86_binop(X86Gen *xg, ASTNode *node) {
+    BinOpKind op = node->data.binop.op;
+    ASTNode *left = node->data.binop.left;
+    ASTNode *right = node->data.binop.right;
+    char src[64];
+
+    /* e/ou: valor de verdade de cada lado (a VM avalia os dois) */
+    if (op == OP_AND || op == OP_OR) {
+        x86_truth(xg, left);
+        x86_push(xg, "%rax");
+        x86_truth(xg, right);
+        x86_ins(xg, "movq %%rax, %%rcx");
+        x86_pop(xg, "%rax");
+        x86_ins(xg, "%s %%rcx, %%rax", op == OP_AND ? "andq" : "orq");
+        return;
+    }
+
+    /* Com um lado frac, o outro e convertido e a operacao e em SSE2 */
+    if (left->data_type == TYPE_FRAC || right->data_type == TYPE_FRAC) {
+        x86_frac_operands(xg, node);
+        switch (op) {
+            case OP_ADD: x86_ins(xg, "addsd %%xmm1, %%xmm0"); break;
+            case OP_SUB: x86_ins(xg, "subsd %%xmm1, %%xmm0"); break;
+            case OP_MUL: x86_ins(xg, "mulsd %%xmm1, %%xmm0"); break;
+            case OP_DIV: {
+                /* Divisor zero (ou -0.0) e erro; NaN nao */
+                char *fail = x86_cold_fail(xg, "afrt_div_zero", node->line, NULL);
+                x86_ins(xg, "xorpd %%xmm2, %%xmm2");
+                x86_ins(xg, "ucomisd %%xmm2, %%xmm1");
+                x86_ins(xg, "jp 1f");
+                x86_ins(xg, "je %s", fail);
+                fprintf(xg->body, "1:\n");
+                x86_ins(xg, "divsd %%xmm1, %%xmm0");
+                mem_free(fail);
+                break;
+            }
+            case OP_MOD:
+                x86_ins(xg, "movl $%d, %%edi", node->line);
+                x86_call(xg, "afrt_fmod");
+                break;
+            default: {
+                /* Comparacoes: ucomisd deixa "unordered" (NaN) em ZF=PF=CF=1 */
+                int swap = op == OP_LT || op == OP_LE;
+                x86_ins(xg, swap ? "ucomisd %%xmm0, %%xmm1" : "ucomisd %%xmm1, %%xmm0");
+                if (op == OP_EQ) {
+                    x86_ins(xg, "sete %%al");
+                    x86_ins(xg, "setnp %%cl");
+                    x86_ins(xg, "andb %%cl, %%al");
+                } else if (op == OP_NE) {
+                    x86_ins(xg, "setne %%al");
+                    x86_ins(xg, "setp %%cl");
+                    x86_ins(xg, "orb %%cl, %%al");
+                } else {
+                    x86_ins(xg, "%s %%al", (op == OP_LT || op == OP_GT) ? "seta" : "setae");
+                }
+                x86_ins(xg, "movzbl %%al, %%eax");
+                break;
+            }
+        }
+        return;
+    }
+
+    x86_int_operands(xg, node, src, sizeof(src));
+    switch (op) {
+        case OP_ADD:
+            x86_ins(xg, "addq %s, %%rax", src);
+            x86_check_overflow(xg, node->line);
+            break;
+        case OP_SUB:
+            x86_ins(xg, "subq %s, %%rax", src);
+            x86_check_overflow(xg, node->line);
+            break;
+        case OP_MUL:
+            x86_ins(xg, "imulq %s, %%rax", src);
+            x86_check_overflow(xg, node->line);
+            break;
+        case OP_DIV:
+        case OP_MOD:
+            x86_divmod(xg, op, src, node->line);
+            break;
+        default:
+            x86_ins(xg, "cmpq %s, %%rax", src);
+            x86_ins(xg, "set%s %%al", x86_condition(op, 0));
+            x86_ins(xg, "movzbl %%al, %%eax");
+            break;
+    }
+}
+
+/* Limites do vetor: indice em %rax, comparado sem sinal ao tamanho */
+static void x86_check_index(X86Gen *xg, int a, int line) {
+    char setup[128];
+    snprintf(setup, sizeof(setup), "movq %%rax, %%rsi\nmovq $%d, %%rdx\nmovq $%d, %%rcx",
+             xg->gen->arrays[a].base, xg->gen->arrays[a].size);
+    char *fail = x86_cold_fail(xg, "afrt_bad_index", line, setup);
+    x86_ins(xg, "cmpq $%d, %%rax", xg->gen->arrays[a].size);
+    x86_ins(xg, "jae %s", fail);
+    x86_ins(xg, "leaq .Lmemoria(%%rip), %%rdx");
+    mem_free(fail);
+}
+
+static void x86_expr(X86Gen *xg, ASTNode *node) {
+    if (!node) return;
+
+    char operand[64];
+    DataType type;
+
+    switch (node->kind) {
+        case NODE_LITERAL_INT:
+            if (node->data.literal_int.value == 0) {
+                x86_ins(xg, "xorl %%eax, %%eax");
+            } else {
+                x86_ins(xg, "movq $%d, %%rax", node->data.literal_int.value);
+            }
+            break;
+
+        case NODE_LITERAL_FRAC:
+            x86_frac_const(xg, node->data.literal_frac.value, "%xmm0");
+            break;
+
+        case NODE_LITERAL_BOOL:
+            x86_ins(xg, "movl $%d, %%eax", node->data.literal_bool.value);
+            break;
+
+        case NODE_VARIAVEL:
+            if (!x86_var(xg, node->data.variavel.nome, operand, sizeof(operand), &type)) break;
+            if (type == TYPE_FRAC) {
+                x86_ins(xg, "movsd %s, %%xmm0", operand);
+                x86_convert(xg, TYPE_FRAC, node->data_type, node->line);
+            } else {
+                x86_ins(xg, "movq %s, %%rax", operand);
+                x86_convert(xg, type, node->data_type, node->line);
+            }
+            break;
+
+        case NODE_SENSOR:
+            x86_ins(xg, "movl $%d, %%edi", (int)node->data.sensor.sensor);
+            x86_call(xg, "afrt_read");
+            break;
+
+        case NODE_INDICE: {
+            int a = codegen_find_array(xg->gen, node->data.indice.nome);
+            if (a < 0) break;
+            x86_expr(xg, node->data.indice.indice);
+            x86_check_index(xg, a, node->line);
+            if (xg->gen->arrays[a].type == TYPE_FRAC) {
+                x86_ins(xg, "movsd %d(%%rdx,%%rax,8), %%xmm0", 8 * xg->gen->arrays[a].base);
+            } else {
+                x86_ins(xg, "movq %d(%%rdx,%%rax,8), %%rax", 8 * xg->gen->arrays[a].base);
+            }
+            break;
+        }
+
+        case NODE_BINOP:
+            x86_binop(xg, node);
+            break;
+
+        case NODE_UNOP:
+            if (node->data.unop.op == OP_NOT) {
+                x86_truth(xg, node->data.unop.operand);
+                x86_ins(xg, "xorl $1, %%eax");
+            } else if (node->data_type == TYPE_FRAC) {
+                /* 0.0 - x, como a VM (nunca -0.0 para x = 0.0) */
+                x86_expr_as(xg, node->data.unop.operand, TYPE_FRAC);
+                x86_ins(xg, "movapd %%xmm0, %%xmm1");
+                x86_ins(xg, "xorpd %%xmm0, %%xmm0");
+                x86_ins(xg, "subsd %%xmm1, %%xmm0");
+            } else {
+                x86_expr(xg, node->data.unop.operand);
+                x86_ins(xg, "negq %%rax");
+                x86_check_overflow(xg, node->line);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Saltar para label se a condicao for falsa; comparacao inteira vira */
+/* cmp e um salto condicional, sem materializar o bool */
+static void x86_jump_if_false(X86Gen *xg, ASTNode *cond, const char *label) {
+    if (cond->kind == NODE_BINOP && is_comparison(cond->data.binop.op) &&
+        cond->data.binop.left->data_type != TYPE_FRAC &&
+        cond->data.binop.right->data_type != TYPE_FRAC) {
+        char src[64];
+        x86_int_operands(xg, cond, src, sizeof(src));
+        x86_ins(xg, "cmpq %s, %%rax", src);
+        x86_ins(xg, "j%s %s", x86_condition(cond->data.binop.op, 1), label);
+        return;
+    }
+    x86_truth(xg, cond);
+    x86_ins(xg, "testq %%rax, %%rax");
+    x86_ins(xg, "je %s", label);
+}
+
+/* ===== FUNCOES ===== */
+
+static void x86_function_begin(X86Gen *xg, int is_main) {
+    xg->body = open_memstream(&xg->body_buf, &xg->body_len);
+    xg->cold = open_memstream(&xg->cold_buf, &xg->cold_len);
+    xg->depth = 0;
+    xg->frame_base = is_main ? MAIN_SAVED : 0;
+    xg->loops = 0;
+    xg->max_loops = 0;
+}
+
+/* Escrever prologo, corpo, epilogo e caminhos de erro da funcao */
+/* O prologo realinha %rsp: passos sao chamados com qualquer profundidade */
+static void x86_function_end(X86Gen *xg, const char *name, int is_main) {
+    FILE *out = xg->out;
+    fclose(xg->body);
+    fclose(xg->cold);
+
+    fprintf(out, "\n");
+    if (is_main) fprintf(out, "    .globl %s\n", name);
+    fprintf(out, "    .type %s, @function\n", name);
+    fprintf(out, "    .p2align 4\n");
+    fprintf(out, "%s:\n", name);
+    fprintf(out, "    pushq %%rbp\n");
+    fprintf(out, "    movq %%rsp, %%rbp\n");
+    if (is_main) {
+        for (int i = 0; i < NUM_VAR_REGS; i++) fprintf(out, "    pushq %s\n", VAR_REGS[i]);
+    }
+    if (xg->max_loops > 0) fprintf(out, "    subq $%d, %%rsp\n", 8 * xg->max_loops);
+    fprintf(out, "    andq $-16, %%rsp\n");
+    if (is_main) {
+        fprintf(out, "    call afrt_iniciar@PLT\n");
+        for (int i = 0; i < xg->num_var_regs; i++) {
+            fprintf(out, "    xorq %s, %s\n", VAR_REGS[i], VAR_REGS[i]);
+        }
+    }
+
+    fwrite(xg->body_buf, 1, xg->body_len, out);
+
+    if (is_main) {
+        fprintf(out, "    call afrt_finalizar@PLT\n");
+        fprintf(out, "    xorl %%eax, %%eax\n");
+        fprintf(out, "    leaq -%d(%%rbp), %%rsp\n", MAIN_SAVED);
+        for (int i = NUM_VAR_REGS - 1; i >= 0; i--) fprintf(out, "    popq %s\n", VAR_REGS[i]);
+        fprintf(out, "    popq %%rbp\n");
+    } else {
+        fprintf(out, "    leave\n");
+    }
+    fprintf(out, "    ret\n");
+    fwrite(xg->cold_buf, 1, xg->cold_len, out);
+    fprintf(out, "    .size %s, .-%s\n", name, name);
+
+    mem_free(xg->body_buf);
+    mem_free(xg->cold_buf);
+    xg->body = NULL;
+    xg->cold = NULL;
+}
+
+/* ===== COMANDOS ===== */
+
+/* Declaracao de vetor: segmento estatico com os valores iniciais */
+static void x86_array_declaration(X86Gen *xg, ASTNode *node) {
+    int tamanho = node->data.declaracao.tamanho;
+    DataType tipo = node->data.declaracao.tipo;
+    int base = codegen_alloc_array(xg->gen, node->data.declaracao.nome, tipo, tamanho);
+    char temp_str[128];
+
+    snprintf(temp_str, sizeof(temp_str), "var %s : %s[%d] @ %d", node->data.declaracao.nome,
+             ast_type_name(tipo), tamanho, base);
+    x86_comment(xg, temp_str);
+
+    /* Segmentos sao alocados em sequencia: a memoria cresce na ordem */
+    fprintf(xg->data, "    # %s\n", temp_str);
+    for (int i = 0; i < node->data.declaracao.num_init; i++) {
+        ASTNode *init = node->data.declaracao.init_list[i];
+        int negative = init->kind == NODE_UNOP;
+        if (negative) init = init->data.unop.operand;
+        if (tipo == TYPE_FRAC) {
+            double value = init->kind == NODE_LITERAL_FRAC ? init->data.literal_frac.value :
+                           init->kind == NODE_LITERAL_INT ? init->data.literal_int.value : 0;
+            if (negative) value = -value;
+            unsigned long long bits;
+            memcpy(&bits, &value, sizeof(bits));
+            fprintf(xg->data, "    .quad 0x%016llx\n", bits);
+        } else {
+            long long value = init->kind == NODE_LITERAL_INT ? init->data.literal_int.value :
+                              init->kind == NODE_LITERAL_BOOL ? init->data.literal_bool.value : 0;
+            fprintf(xg->data, "    .quad %lld\n", negative ? -value : value);
+        }
+    }
+    if (tamanho > node->data.declaracao.num_init) {
+        fprintf(xg->data, "    .zero %d\n", 8 * (tamanho - node->data.declaracao.num_init));
+    }
+}
+
+/* imprimir: um valor direto pelo tipo, texto fixo, ou o template com os */
+/* valores de execucao num vetor na pilha (ver afrt_print_fmt) */
+static void x86_imprimir(X86Gen *xg, ASTNode *node) {
+    int n = node->data.imprimir.num_exprs;
+    int num_values;
+    char *text = codegen_print_template(node, &num_values);
+
+    x86_comment(xg, "imprimir");
+
+    if (!text) {
+        if (n == 0) return;
+        ASTNode *expr = node->data.imprimir.exprs[0];
+        x86_expr(xg, expr);
+        if (expr->data_type == TYPE_FRAC) {
+            x86_call(xg, "afrt_print_frac");
+        } else {
+            x86_ins(xg, "movq %%rax, %%rdi");
+            x86_call(xg, expr->data_type == TYPE_BOOL ? "afrt_print_bool" : "afrt_print_int");
+        }
+        return;
+    }
+
+    int str_id = codegen_add_string(xg->gen, text);
+    mem_free(text);
+    if (num_values == 0) {
+        x86_ins(xg, "leaq .Lstr_%d(%%rip), %%rdi", str_id);
+        x86_call(xg, "afrt_print_text");
+        return;
+    }
+
+    /* Vetor de valores com numero par de palavras (nao muda o alinhamento) */
+    int words = (num_values + 1) & ~1;
+    x86_ins(xg, "subq $%d, %%rsp", 8 * words);
+    xg->depth += words;
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        ASTNode *expr = node->data.imprimir.exprs[i];
+        char piece[64];
+        if (expr->kind == NODE_LITERAL_STR || codegen_print_constant(expr, piece, sizeof(piece))) {
+            continue;
+        }
+        x86_expr(xg, expr);
+        if (expr->data_type == TYPE_FRAC) {
+            x86_ins(xg, "movsd %%xmm0, %d(%%rsp)", 8 * k);
+        } else {
+            x86_ins(xg, "movq %%rax, %d(%%rsp)", 8 * k);
+        }
+        k++;
+    }
+    x86_ins(xg, "leaq .Lstr_%d(%%rip), %%rdi", str_id);
+    x86_ins(xg, "movq %%rsp, %%rsi");
+    x86_ins(xg, "movl $%d, %%edx", num_values);
+    x86_ins(xg, "movl $%d, %%ecx", node->line);
+    x86_call(xg, "afrt_print_fmt");
+    x86_ins(xg, "addq $%d, %%rsp", 8 * words);
+    xg->depth -= words;
+}
+
+/* para i de A ate B passo K: contagem regressiva num contador do quadro */
+/*   contador = (B - A) / K + 1, pulando o laco se B - A < 0 */
+/*   corpo; i += K (so se o corpo le i); decrementar e repetir */
+static void x86_para(X86Gen *xg, ASTNode *node) {
+    char temp_str[128];
+    char var[64];
+    char counter[32];
+    int passo = node->data.para.passo;
+    int step = passo > 0 ? passo : -passo;
+    int has_var = codegen_para_reads_var(node);
+
+    snprintf(temp_str, sizeof(temp_str), "para %s (passo %d)", node->data.para.var, passo);
+    x86_comment(xg, temp_str);
+
+    if (has_var) {
+        int v = x86_alloc_var(xg, node->data.para.var, TYPE_INTEIRO);
+        x86_map_operand(xg, v, var, sizeof(var));
+    }
+
+    int inicio, fim;
+    int constant = codegen_constant_int(node->data.para.inicio, &inicio) &&
+                   codegen_constant_int(node->data.para.fim, &fim);
+    long long count = 0;
+    if (constant) {
+        long long diff = passo > 0 ? (long long)fim - inicio : (long long)inicio - fim;
+        count = diff >= 0 ? diff / step + 1 : 0;
+        if (count == 0) {
+            x86_comment(xg, "laco sem iteracoes");
+            return;
+        }
+    }
+
+    char *body_label = codegen_new_label(xg->gen, ".Lpara");
+    char *end_label = codegen_new_label(xg->gen, ".Lfim_para");
+
+    int level = xg->loops++;
+    if (xg->loops > xg->max_loops) xg->max_loops = xg->loops;
+    snprintf(counter, sizeof(counter), "-%d(%%rbp)", xg->frame_base + 8 * (level + 1));
+
+    if (constant) {
+        x86_ins(xg, "movq $%lld, %%rax", count);
+        x86_ins(xg, "movq %%rax, %s", counter);
+        if (has_var) x86_ins(xg, "movq $%d, %s", inicio, var);
+    } else {
+        /* %rcx = B, %rax = A */
+        x86_expr(xg, node->data.para.fim);
+        x86_push(xg, "%rax");
+        x86_expr(xg, node->data.para.inicio);
+        x86_pop(xg, "%rcx");
+        if (has_var) x86_ins(xg, "movq %%rax, %s", var);
+
+        /* Distancia no sentido do passo */
+        if (passo > 0) {
+            x86_ins(xg, "subq %%rax, %%rcx");
+        } else {
+            x86_ins(xg, "subq %%rcx, %%rax");
+            x86_ins(xg, "movq %%rax, %%rcx");
+        }
+        x86_check_overflow(xg, node->line);
+        x86_ins(xg, "testq %%rcx, %%rcx");
+        x86_ins(xg, "js %s", end_label);
+        if (step > 1) {
+            x86_ins(xg, "movq %%rcx, %%rax");
+            x86_ins(xg, "movq $%d, %%rcx", step);
+            x86_ins(xg, "cqto");
+            x86_ins(xg, "idivq %%rcx");
+            x86_ins(xg, "movq %%rax, %%rcx");
+        }
+        x86_ins(xg, "incq %%rcx");
+        x86_ins(xg, "movq %%rcx, %s", counter);
+    }
+
+    x86_ins(xg, ".p2align 4");
+    x86_label(xg, body_label);
+    x86_node(xg, node->data.para.bloco);
+    if (has_var) {
+        x86_ins(xg, "addq $%d, %s", passo, var);
+        x86_check_overflow(xg, node->line);
+    }
+    x86_ins(xg, "decq %s", counter);
+    x86_ins(xg, "jnz %s", body_label);
+    x86_label(xg, end_label);
+
+    xg->loops--;
+    mem_free(body_label);
+    mem_free(end_label);
+}
+
+/* Relacao do WAIT, com os operandos trocados se swap; -1 se nao e comparacao */
+static int x86_wait_relation(BinOpKind op, int swap) {
+    switch (op) {
+        case OP_EQ: return WAIT_EQ;
+        case OP_NE: return WAIT_NE;
+        case OP_LT: return swap ? WAIT_GT : WAIT_LT;
+        case OP_LE: return swap ? WAIT_GE : WAIT_LE;
+        case OP_GT: return swap ? WAIT_LT : WAIT_GT;
+        case OP_GE: return swap ? WAIT_LE : WAIT_GE;
+        default: return -1;
+    }
+}
+
+/* quando (cond) { corpo }: sensor comparado a um limiar sem sensores */
+/* vira uma unica espera no runtime; os demais casos reavaliam a */
+/* condicao a cada mudanca dos sensores que ela le (como na VM) */
+static void x86_quando(X86Gen *xg, ASTNode *node) {
+    ASTNode *cond = node->data.quando.condicao;
+    x86_comment(xg, "quando");
+
+    if (cond->kind == NODE_BINOP) {
+        ASTNode *left = cond->data.binop.left;
+        ASTNode *right = cond->data.binop.right;
+        int swap = (right->kind == NODE_SENSOR && left->kind != NODE_SENSOR);
+        ASTNode *sensor = swap ? right : left;
+        ASTNode *limit = swap ? left : right;
+        int rel = x86_wait_relation(cond->data.binop.op, swap);
+
+        if (rel >= 0 && sensor->kind == NODE_SENSOR && codegen_sensors_read(limit) == 0) {
+            int frac = limit->data_type == TYPE_FRAC;
+            x86_expr(xg, limit);
+            x86_ins(xg, frac ? "movq %%xmm0, %%rdx" : "movq %%rax, %%rdx");
+            x86_ins(xg, "movl $%d, %%edi", (int)sensor->data.sensor.sensor);
+            x86_ins(xg, "movl $%d, %%esi", rel);
+            x86_ins(xg, "movl $%d, %%ecx", frac);
+            x86_ins(xg, "movl $%d, %%r8d", node->line);
+            x86_call(xg, "afrt_wait");
+            x86_node(xg, node->data.quando.bloco);
+            return;
+        }
+    }
+
+    char *wait_label = codegen_new_label(xg->gen, ".Lquando_espera");
+    char *check_label = codegen_new_label(xg->gen, ".Lquando");
+
+    x86_ins(xg, "jmp %s", check_label);
+    x86_label(xg, wait_label);
+    x86_ins(xg, "movl $%u, %%edi", codegen_sensors_read(cond));
+    x86_ins(xg, "movl $%d, %%esi", node->line);
+    x86_call(xg, "afrt_wait_change");
+    x86_label(xg, check_label);
+    x86_jump_if_false(xg, cond, wait_label);
+    x86_node(xg, node->data.quando.bloco);
+
+    mem_free(wait_label);
+    mem_free(check_label);
+}
+
+/* ===== DESVIO MULTIPLO ===== */
+
+typedef struct X86Caso {
+    int valor;
+    char *label;
+} X86Caso;
+
+static int compare_x86_casos(const void *a, const void *b) {
+    int va = ((const X86Caso*)a)->valor;
+    int vb = ((const X86Caso*)b)->valor;
+    return (va > vb) - (va < vb);
+}
+
+/* Busca binaria sobre casos[lo..hi) com o seletor em %rax; trechos */
+/* curtos viram comparacoes em cadeia */
+static void x86_escolha_tree(X86Gen *xg, X86Caso *casos, int lo, int hi,
+                             const char *default_label) {
+    if (hi - lo < ESCOLHA_MIN_CASES) {
+        for (int i = lo; i < hi; i++) {
+            x86_ins(xg, "cmpq $%d, %%rax", casos[i].valor);
+            x86_ins(xg, "je %s", casos[i].label);
+        }
+        x86_ins(xg, "jmp %s", default_label);
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    char *left_label = codegen_new_label(xg->gen, ".Lescolha_menor");
+    x86_ins(xg, "cmpq $%d, %%rax", casos[mid].valor);
+    x86_ins(xg, "jl %s", left_label);
+    x86_escolha_tree(xg, casos, mid, hi, default_label);
+    x86_label(xg, left_label);
+    x86_escolha_tree(xg, casos, lo, mid, default_label);
+    mem_free(left_label);
+}
+
+/* Salto indexado: deslocamentos de 32 bits relativos a tabela (sem */
+/* relocacoes no executavel PIE) */
+static void x86_escolha_table(X86Gen *xg, X86Caso *casos, int n, const char *default_label) {
+    int base = casos[0].valor;
+    int span = casos[n - 1].valor - base + 1;
+    char *table = codegen_new_label(xg->gen, ".Ltabela");
+
+    x86_ins(xg, "subq $%d, %%rax", base);
+    x86_ins(xg, "cmpq $%d, %%rax", span);
+    x86_ins(xg, "jae %s", default_label);
+    x86_ins(xg, "leaq %s(%%rip), %%rdx", table);
+    x86_ins(xg, "movslq (%%rdx,%%rax,4), %%rax");
+    x86_ins(xg, "addq %%rdx, %%rax");
+    x86_ins(xg, "jmp *%%rax");
+
+    fprintf(xg->rodata, "    .p2align 2\n%s:\n", table);
+    for (int v = 0, i = 0; v < span; v++) {
+        const char *target = default_label;
+        if (casos[i].valor == base + v) target = casos[i++].label;
+        fprintf(xg->rodata, "    .long %s-%s\n", target, table);
+    }
+    mem_free(table);
+}
+
+static void x86_escolha(X86Gen *xg, ASTNode *node, int tail) {
+    int n = node->data.escolha.num_casos;
+    ASTNode *padrao = node->data.escolha.padrao;
+    char *end_label = codegen_new_label(xg->gen, ".Lfim_escolha");
+    char *default_label = padrao ? codegen_new_label(xg->gen, ".Lpadrao") : end_label;
+
+    X86Caso *casos = (X86Caso*)malloc(n * sizeof(X86Caso));
+    for (int i = 0; i < n; i++) {
+        casos[i].valor = node->data.escolha.casos[i]->data.caso.valor;
+        casos[i].label = codegen_new_label(xg->gen, ".Lcaso");
+    }
+    X86Caso *sorted = (X86Caso*)malloc(n * sizeof(X86Caso));
+    memcpy(sorted, casos, n * sizeof(X86Caso));
+    qsort(sorted, n, sizeof(X86Caso), compare_x86_casos);
+
+    /* Mesma escolha de estrategia do gerador da VM */
+    long long span = (long long)sorted[n - 1].valor - sorted[0].valor + 1;
+    int table = n >= ESCOLHA_MIN_CASES && span <= ESCOLHA_MAX_TABLE && span <= 2LL * n;
+
+    x86_comment(xg, table ? "escolha (tabela de saltos)" : "escolha (comparacoes)");
+    x86_expr(xg, node->data.escolha.expr);
+    if (table) {
+        x86_escolha_table(xg, sorted, n, default_label);
+    } else {
+        x86_escolha_tree(xg, sorted, 0, n, default_label);
+    }
+
+    for (int i = 0; i < n; i++) {
+        x86_label(xg, casos[i].label);
+        xg->gen->in_tail = tail;
+        x86_node(xg, node->data.escolha.casos[i]->data.caso.bloco);
+        if (i < n - 1 || padrao) x86_ins(xg, "jmp %s", end_label);
+    }
+    if (padrao) {
+        x86_label(xg, default_label);
+        xg->gen->in_tail = tail;
+        x86_node(xg, padrao);
+    }
+    x86_label(xg, end_label);
+
+    for (int i = 0; i < n; i++) {
+        mem_free(casos[i].label);
+    }
+    mem_free(casos);
+    mem_free(sorted);
+    if (padrao) mem_free(default_label);
+    mem_free(end_label);
+}
+
+/* ===== PASSOS COM PARAMETROS ===== */
+
+/* Chamada: argumentos empilhados em ordem, call e descarte. Em posicao */
+/* de cauda com o mesmo numero de parametros do passo atual, os */
+/* argumentos substituem os do quadro atual e um jmp reaproveita o */
+/* retorno: recursao em cauda nao cresce a pilha */
+static void x86_chamada(X86Gen *xg, ASTNode *node, int tail) {
+    char temp_str[128];
+    ASTNode *passo = ast_find_passo(xg->gen->program, node->data.chamada.nome);
+    if (!passo) return;
+
+    int n = node->data.chamada.num_args;
+    ASTNode *current = xg->gen->current_passo;
+    int reuse = tail && current && current->data.passo.num_params == n;
+
+    snprintf(temp_str, sizeof(temp_str), "%s %s", reuse ? "chamada de cauda" : "chamar",
+             node->data.chamada.nome);
+    x86_comment(xg, temp_str);
+
+    for (int i = 0; i < n; i++) {
+        DataType type = passo->data.passo.params[i]->data.declaracao.tipo;
+        x86_expr_as(xg, node->data.chamada.args[i], type);
+        if (type == TYPE_FRAC) x86_ins(xg, "movq %%xmm0, %%rax");
+        x86_push(xg, "%rax");
+    }
+
+    if (reuse) {
+        for (int i = n - 1; i >= 0; i--) {
+            x86_ins(xg, "popq %d(%%rbp)", 16 + 8 * (n - 1 - i));
+            xg->depth--;
+        }
+        x86_ins(xg, "leave");
+        x86_ins(xg, "jmp afs_passo_%s", node->data.chamada.nome);
+        return;
+    }
+
+    x86_ins(xg, "call afs_passo_%s", node->data.chamada.nome);
+    if (n > 0) {
+        x86_ins(xg, "addq $%d, %%rsp", 8 * n);
+        xg->depth -= n;
+    }
+}
+
+/* ===== GERACAO DE COMANDOS ===== */
+
+static void x86_node(X86Gen *xg, ASTNode *node) {
+    if (!node) return;
+
+    CodeGenerator *gen = xg->gen;
+    char temp_str[128];
+    char operand[64];
+    DataType type;
+
+    /* Posicao de cauda so passa adiante por blocos e pelos ramos do 'se' e do 'escolha' */
+    int tail = gen->in_tail;
+    gen->in_tail = 0;
+
+    switch (node->kind) {
+        case NODE_RECEITA:
+            snprintf(temp_str, sizeof(temp_str), "===== Receita: %s =====", node->data.receita.nome);
+            x86_comment(xg, temp_str);
+            x86_node(xg, node->data.receita.bloco);
+            break;
+
+        case NODE_PASSO:
+            /* Passo com parametros vira funcao propria */
+            if (node->data.passo.subrotina) break;
+
+            snprintf(temp_str, sizeof(temp_str), "Passo: %s", node->data.passo.nome);
+            x86_comment(xg, temp_str);
+            x86_node(xg, node->data.passo.bloco);
+            break;
+
+        case NODE_BLOCO:
+            for (int i = 0; i < node->data.bloco.num_statements; i++) {
+                gen->in_tail = tail && i == node->data.bloco.num_statements - 1;
+                x86_node(xg, node->data.bloco.statements[i]);
+            }
+            break;
+
+        case NODE_DECLARACAO: {
+            if (node->data.declaracao.tamanho > 0) {
+                x86_array_declaration(xg, node);
+                break;
+            }
+
+            int v = x86_alloc_var(xg, node->data.declaracao.nome, node->data.declaracao.tipo);
+            type = gen->var_map[v].type;
+            x86_map_operand(xg, v, operand, sizeof(operand));
+            snprintf(temp_str, sizeof(temp_str), "var %s : %s -> %s", node->data.declaracao.nome,
+                     ast_type_name(node->data.declaracao.tipo), operand);
+            x86_comment(xg, temp_str);
+
+            if (node->data.declaracao.init_expr) {
+                x86_expr_as(xg, node->data.declaracao.init_expr, type);
+                x86_store(xg, operand, type);
+            } else {
+                /* Zero inteiro e 0.0 tem os mesmos bits */
+                x86_ins(xg, "movq $0, %s", operand);
+            }
+            break;
+        }
+
+        case NODE_ATRIBUICAO: {
+            if (node->data.atribuicao.indice) {
+                int a = codegen_find_array(gen, node->data.atribuicao.nome);
+                if (a < 0) break;
+                snprintf(temp_str, sizeof(temp_str), "%s[...] = ...", node->data.atribuicao.nome);
+                x86_comment(xg, temp_str);
+
+                /* Valor na pilha, indice em %rax, valor de volta em %rcx/%xmm0 */
+                type = gen->arrays[a].type;
+                x86_expr_as(xg, node->data.atribuicao.expr, type);
+                if (type == TYPE_FRAC) x86_ins(xg, "movq %%xmm0, %%rax");
+                x86_push(xg, "%rax");
+                x86_expr(xg, node->data.atribuicao.indice);
+                x86_pop(xg, "%rcx");
+                x86_check_index(xg, a, node->line);
+                x86_ins(xg, "movq %%rcx, %d(%%rdx,%%rax,8)", 8 * gen->arrays[a].base);
+                break;
+            }
+
+            snprintf(temp_str, sizeof(temp_str), "%s = ...", node->data.atribuicao.nome);
+            x86_comment(xg, temp_str);
+            if (x86_var(xg, node->data.atribuicao.nome, operand, sizeof(operand), &type)) {
+                x86_expr_as(xg, node->data.atribuicao.expr, type);
+                x86_store(xg, operand, type);
+            }
+            break;
+        }
+
+        case NODE_PREAQUECER:
+            x86_comment(xg, "preaquecer");
+            x86_expr_as(xg, node->data.preaquecer.temperatura, TYPE_INTEIRO);
+            x86_ins(xg, "movq %%rax, %%rdi");
+            x86_call(xg, "afrt_preaquecer");
+            break;
+
+        case NODE_COZINHAR:
+            x86_comment(xg, "cozinhar");
+            x86_expr_as(xg, node->data.cozinhar.temperatura, TYPE_INTEIRO);
+            x86_push(xg, "%rax");
+            x86_expr_as(xg, node->data.cozinhar.tempo, TYPE_INTEIRO);
+            x86_ins(xg, "movq %%rax, %%rsi");
+            x86_pop(xg, "%rdi");
+            x86_call(xg, "afrt_cozinhar");
+            break;
+
+        case NODE_AQUECER:
+            x86_comment(xg, "aquecer");
+            x86_expr_as(xg, node->data.aquecer.tempo, TYPE_INTEIRO);
+            x86_ins(xg, "movq %%rax, %%rdi");
+            x86_call(xg, "afrt_aquecer");
+            break;
+
+        case NODE_AGITAR:
+            x86_comment(xg, "agitar");
+            x86_call(xg, "afrt_agitar");
+            break;
+
+        case NODE_SET_MODO:
+            x86_comment(xg, "modo");
+            x86_ins(xg, "movl $%d, %%edi", node->data.set_modo.modo + 1);
+            x86_call(xg, "afrt_modo");
+            break;
+
+        case NODE_PAUSAR:
+            x86_comment(xg, "pausar");
+            x86_call(xg, "afrt_pausar");
+            break;
+
+        case NODE_CONTINUAR:
+            x86_comment(xg, "continuar");
+            x86_call(xg, "afrt_continuar");
+            break;
+
+        case NODE_PARAR:
+            x86_comment(xg, "parar");
+            x86_call(xg, "afrt_parar");
+            break;
+
+        case NODE_IMPRIMIR:
+            x86_imprimir(xg, node);
+            break;
+
+        case NODE_SE: {
+            char *else_label = codegen_new_label(gen, ".Lsenao");
+            char *end_label = codegen_new_label(gen, ".Lfim_se");
+
+            x86_comment(xg, "se");
+            x86_jump_if_false(xg, node->data.se.condicao,
+                              node->data.se.bloco_else ? else_label : end_label);
+            gen->in_tail = tail;
+            x86_node(xg, node->data.se.bloco_then);
+            if (node->data.se.bloco_else) {
+                x86_ins(xg, "jmp %s", end_label);
+                x86_label(xg, else_label);
+                gen->in_tail = tail;
+                x86_node(xg, node->data.se.bloco_else);
+            }
+            x86_label(xg, end_label);
+            mem_free(else_label);
+            mem_free(end_label);
+            break;
+        }
+
+        case NODE_ENQUANTO: {
+            /* Teste no fim: um unico salto por iteracao */
+            char *loop_label = codegen_new_label(gen, ".Lenquanto");
+            char *check_label = codegen_new_label(gen, ".Lenquanto_teste");
+            char *end_label = codegen_new_label(gen, ".Lfim_enquanto");
+
+            x86_comment(xg, "enquanto");
+            x86_ins(xg, "jmp %s", check_label);
+            x86_ins(xg, ".p2align 4");
+            x86_label(xg, loop_label);
+            x86_node(xg, node->data.enquanto.bloco);
+            x86_label(xg, check_label);
+            x86_jump_if_false(xg, node->data.enquanto.condicao, end_label);
+            x86_ins(xg, "jmp %s", loop_label);
+            x86_label(xg, end_label);
+            mem_free(loop_label);
+            mem_free(check_label);
+            mem_free(end_label);
+            break;
+        }
+
+        case NODE_PARA:
+            x86_para(xg, node);
+            break;
+
+        case NODE_QUANDO:
+            x86_quando(xg, node);
+            break;
+
+        case NODE_CHAMADA:
+            x86_chamada(xg, node, tail);
+            break;
+
+        case NODE_ESCOLHA:
+            x86_escolha(xg, node, tail);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* ===== SECOES ===== */
+
+/* Texto de uma string da tabela como literal do GNU as */
+static void x86_emit_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char*)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20 || *c >= 0x7f) {
+            fprintf(out, "\\%03o", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void x86_emit_sections(X86Gen *xg) {
+    CodeGenerator *gen = xg->gen;
+    FILE *out = xg->out;
+
+    fclose(xg->rodata);
+    fprintf(out, "\n    .section .rodata\n");
+    for (int i = 0; i < gen->num_strings; i++) {
+        fprintf(out, ".Lstr_%d:\n    .string ", gen->strings[i].id);
+        x86_emit_string(out, gen->strings[i].text);
+        fprintf(out, "\n");
+    }
+    fwrite(xg->rodata_buf, 1, xg->rodata_len, out);
+    mem_free(xg->rodata_buf);
+
+    fclose(xg->data);
+    if (gen->memory_size > 0) {
+        fprintf(out, "\n    .data\n    .p2align 4\n.Lmemoria:\n");
+        fwrite(xg->data_buf, 1, xg->data_len, out);
+    }
+    mem_free(xg->data_buf);
+
+    if (xg->num_slots > 0) {
+        fprintf(out, "\n    .bss\n    .p2align 3\n");
+        for (int i = 0; i < gen->num_vars; i++) {
+            if (gen->var_map[i].location >= 0) continue;
+            fprintf(out, ".Lvar_%d:    # %s\n    .zero 8\n",
+                    -gen->var_map[i].location - 1, gen->var_map[i].var_name);
+        }
+    }
+
+    fprintf(out, "\n    .section .note.GNU-stack,\"\",@progbits\n");
+}
+
+/* ===== FUNCAO PRINCIPAL ===== */
+
+int codegen_x86_generate(CodeGenerator *gen, ASTNode *root) {
+    X86Gen xg;
+    memset(&xg, 0, sizeof(xg));
+    xg.gen = gen;
+    xg.out = gen->output;
+    xg.rodata = open_memstream(&xg.rodata_buf, &xg.rodata_len);
+    xg.data = open_memstream(&xg.data_buf, &xg.data_len);
+
+    fprintf(xg.out, "# ===========================================\n");
+    fprintf(xg.out, "# Programa: %s\n", root->data.programa.nome);
+    fprintf(xg.out, "# Compilado por AirFryerScript Compiler (x86-64)\n");
+    fprintf(xg.out, "# gcc programa.s build/libairfryer_rt.a -lm -o programa\n");
+    fprintf(xg.out, "# ===========================================\n");
+    fprintf(xg.out, "    .text\n");
+
+    gen->program = root;
+    x86_function_begin(&xg, 1);
+    for (int i = 0; i < root->data.programa.num_items; i++) {
+        x86_node(&xg, root->data.programa.top_level_items[i]);
+    }
+    x86_function_end(&xg, "main", 1);
+
+    /* Passos com parametros, depois de main */
+    for (int i = 0; i < root->data.programa.num_items; i++) {
+        ASTNode *item = root->data.programa.top_level_items[i];
+        if (item->kind != NODE_PASSO || !item->data.passo.subrotina) continue;
+        if (item->data.passo.externo) continue;
+
+        char name[128];
+        snprintf(name, sizeof(name), "afs_passo_%s", item->data.passo.nome);
+        x86_function_begin(&xg, 0);
+        gen->current_passo = item;
+        gen->in_tail = 1;
+        x86_node(&xg, item->data.passo.bloco);
+        gen->in_tail = 0;
+        gen->current_passo = NULL;
+        x86_function_end(&xg, name, 0);
+    }
+
+    x86_emit_sections(&xg);
+    return gen->num_errors == 0;
+}
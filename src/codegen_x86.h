@@ -0,0 +1,29 @@
+/*
+ * codegen_x86.h
+ * Geracao de assembly x86-64 (GNU as, sintaxe AT&T)
+ *
+ * Segunda arquitetura atras de codegen_generate (-target x86-64): a AST
+ * vira um programa nativo, sem VM, montado e ligado pelo gcc do sistema
+ * junto com o runtime de vm/native/afrt.c (em build/libairfryer_rt.a):
+ *
+ *   gcc programa.s build/libairfryer_rt.a -lm -o programa
+ *
+ * Variaveis inteiras e bool ficam nos registradores callee-saved rbx e
+ * r12-r15 (as cinco primeiras); frac, em SSE2, e as demais ficam em
+ * posicoes estaticas, visiveis de todos os passos como os registradores
+ * da VM. Passos com parametros viram funcoes com os argumentos na pilha
+ * e os contadores de 'para' no proprio quadro. imprimir, sensores e
+ * comandos da air fryer chamam o runtime.
+ */
+
+#ifndef CODEGEN_X86_H
+#define CODEGEN_X86_H
+
+#include "codegen.h"
+
+/* Gerar o programa em assembly x86-64 na saida de gen */
+/* Usa o var_map, os vetores e a string table de gen */
+/* Retorna 1 se sucesso, 0 se erro */
+int codegen_x86_generate(CodeGenerator *gen, ASTNode *root);
+
+#endif /* CODEGEN_X86_H */
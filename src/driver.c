@@ -0,0 +1,711 @@
+/*
+ * driver.c
+ * Implementacao do pipeline de compilacao de um arquivo
+ */
+
+#define _GNU_SOURCE
+#include "driver.h"
+#include "ast.h"
+#include "semantic.h"
+#include "codegen.h"
+#include "cache.h"
+#include "peval.h"
+#include "pass.h"
+#include "link.h"
+#include "alloc.h"
+#include "airfryer.tab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Interface do scanner reentrante gerado pelo Flex */
+int yylex_init_extra(ParserState *extra, void **scanner);
+void *yy_scan_buffer(char *base, size_t size, void *scanner);
+int yylex_destroy(void *scanner);
+
+#define INITIAL_CAPACITY 16
+
+/* Cadeia maxima de modulos importados sendo resolvidos ao mesmo tempo */
+#define MODULE_MAX_DEPTH 64
+
+/* Mensagem de progresso (suprimida em modo silencioso) */
+#define PROGRESS(opts, diag, ...) \
+    do { if (!(opts)->quiet) fprintf((diag), __VA_ARGS__); } while (0)
+
+void compile_options_init(CompileOptions *opts) {
+    opts->debug = 0;
+    opts->quiet = 0;
+    opts->cache_dir = NULL;
+    opts->time_report = 0;
+    opts->mem_stats = 0;
+    opts->peval = 0;
+    opts->peval_fuel = PEVAL_DEFAULT_FUEL;
+    opts->stream = 0;
+    opts->module = 0;
+    opts->target = TARGET_AIRFRYER;
+}
+
+/* ===== MODULOS ===== */
+
+/* Modulos importados por um programa, na ordem de ligacao (cada modulo */
+/* depois dos que ele importa) */
+typedef struct ModuleSet {
+    struct {
+        char *path;            /* Caminho do fonte (canonico, se existir) */
+        ObjectFile *obj;
+    } *modules;
+    int num_modules;
+    int capacity;
+    
+    /* Modulos sendo resolvidos agora (deteccao de importacao circular) */
+    const char *pending[MODULE_MAX_DEPTH];
+    int num_pending;
+    
+    int compiled;              /* Objetos gerados nesta compilacao */
+    int reused;                /* Objetos reaproveitados do disco */
+} ModuleSet;
+
+static int compile_pipeline(PassContext *ctx);
+
+static void module_set_init(ModuleSet *set) {
+    set->modules = NULL;
+    set->num_modules = 0;
+    set->capacity = 0;
+    set->num_pending = 0;
+    set->compiled = 0;
+    set->reused = 0;
+}
+
+static void module_set_free(ModuleSet *set) {
+    for (int i = 0; i < set->num_modules; i++) {
+        free(set->modules[i].path);
+        object_free(set->modules[i].obj);
+    }
+    free(set->modules);
+}
+
+static ObjectFile* module_set_find(ModuleSet *set, const char *path) {
+    for (int i = 0; i < set->num_modules; i++) {
+        if (strcmp(set->modules[i].path, path) == 0) return set->modules[i].obj;
+    }
+    return NULL;
+}
+
+static void module_set_add(ModuleSet *set, const char *path, ObjectFile *obj) {
+    if (set->num_modules >= set->capacity) {
+        set->capacity = set->capacity ? set->capacity * 2 : INITIAL_CAPACITY;
+        set->modules = realloc(set->modules, set->capacity * sizeof(*set->modules));
+    }
+    set->modules[set->num_modules].path = strdup(path);
+    set->modules[set->num_modules].obj = obj;
+    set->num_modules++;
+}
+
+/* Caminho de um modulo importado, relativo ao arquivo que importa */
+/* Canonico quando o arquivo existe: o mesmo modulo importado por */
+/* caminhos diferentes e ligado uma vez so */
+static char* module_path(const char *importer, const char *caminho) {
+    char *joined;
+    const char *slash = strrchr(importer, '/');
+    if (caminho[0] == '/' || !slash) {
+        joined = strdup(caminho);
+    } else if (asprintf(&joined, "%.*s/%s", (int)(slash - importer), importer, caminho) < 0) {
+        return NULL;
+    }
+    
+    char *real = realpath(joined, NULL);
+    if (!real) return joined;
+    free(joined);
+    return real;
+}
+
+/* Objeto ao lado do fonte: x.afs -> x.afo */
+static char* module_object_path(const char *path) {
+    char *obj_path;
+    size_t len = strlen(path);
+    if (len > 4 && strcmp(path + len - 4, ".afs") == 0) len -= 4;
+    if (asprintf(&obj_path, "%.*s%s", (int)len, path, OBJECT_EXT) < 0) return NULL;
+    return obj_path;
+}
+
+static ObjectFile* module_require(PassContext *ctx, const char *path);
+
+/* O objeto ainda vale para o fonte e para as interfaces que importou? */
+/* Retorna 1 se sim, 0 se precisa recompilar, -1 se um import falhou */
+static int module_fresh(PassContext *ctx, ObjectFile *obj, unsigned long long key,
+                        const char *path) {
+    if (obj->source_key != key) return 0;
+    
+    for (int i = 0; i < obj->num_imports; i++) {
+        char *dep_path = module_path(path, obj->imports[i].caminho);
+        ObjectFile *dep = dep_path ? module_require(ctx, dep_path) : NULL;
+        free(dep_path);
+        if (!dep) return -1;
+        if (dep->interface_key != obj->imports[i].interface_key) return 0;
+    }
+    return 1;
+}
+
+/* Compilar um modulo (pipeline aninhado, sem cache) para um objeto */
+static ObjectFile* module_compile(PassContext *parent, SourceBuffer *src, const char *path) {
+    PassContext ctx;
+    ctx.src = src;
+    ctx.name = path;
+    ctx.output = NULL;
+    ctx.opts = parent->opts;
+    ctx.diag = parent->diag;
+    ctx.root = NULL;
+    ctx.codegen = codegen_create(NULL);
+    ctx.codegen->diag = parent->diag;
+    ctx.cache = NULL;
+    ctx.modules = parent->modules;
+    ctx.module = 1;
+    ctx.object = NULL;
+    
+    ObjectFile *obj = NULL;
+    if (compile_pipeline(&ctx)) {
+        obj = ctx.object;
+    } else {
+        object_free(ctx.object);
+    }
+    
+    codegen_free(ctx.codegen);
+    ast_free(ctx.root);
+    return obj;
+}
+
+/* Obter o objeto do modulo em path: ja ligado, reaproveitado do disco */
+/* ou compilado agora (e gravado ao lado do fonte) */
+static ObjectFile* module_require(PassContext *ctx, const char *path) {
+    ModuleSet *set = ctx->modules;
+    FILE *diag = ctx->diag;
+    
+    ObjectFile *obj = module_set_find(set, path);
+    if (obj) return obj;
+    
+    for (int i = 0; i < set->num_pending; i++) {
+        if (strcmp(set->pending[i], path) == 0) {
+            fprintf(diag, "Erro: importacao circular envolvendo %s\n", path);
+            return NULL;
+        }
+    }
+    if (set->num_pending >= MODULE_MAX_DEPTH) {
+        fprintf(diag, "Erro: importacoes aninhadas demais (mais de %d niveis)\n", MODULE_MAX_DEPTH);
+        return NULL;
+    }
+    
+    SourceBuffer *src = source_open(path);
+    if (!src) {
+        fprintf(diag, "Erro: nao foi possivel abrir o modulo %s\n", path);
+        return NULL;
+    }
+    char *obj_path = module_object_path(path);
+    set->pending[set->num_pending++] = path;
+    
+    unsigned long long key = object_source_key(src->data, src->size);
+    obj = object_load(obj_path);
+    int fresh = obj ? module_fresh(ctx, obj, key, path) : 0;
+    if (fresh > 0) {
+        set->reused++;
+        PROGRESS(ctx->opts, diag, "Modulo %s: objeto %s reaproveitado\n", path, obj_path);
+    } else {
+        object_free(obj);
+        obj = fresh < 0 ? NULL : module_compile(ctx, src, path);
+        if (obj) {
+            set->compiled++;
+            if (object_save(obj, obj_path)) {
+                PROGRESS(ctx->opts, diag, "Modulo %s compilado para %s\n", path, obj_path);
+            } else {
+                fprintf(diag, "Aviso: nao foi possivel gravar o objeto %s\n", obj_path);
+            }
+        }
+    }
+    
+    set->num_pending--;
+    free(obj_path);
+    source_close(src);
+    
+    if (obj) module_set_add(set, path, obj);
+    return obj;
+}
+
+/* ===== PASSOS DO PIPELINE ===== */
+
+/* Executar o parser sobre o buffer de origem com o estado dado */
+/* Retorna 1 se sucesso, 0 se erro */
+static int parse_source(PassContext *ctx, ParserState *state) {
+    FILE *diag = ctx->diag;
+
+    state->root = NULL;
+    state->source = ctx->src->data;
+    state->line = 1;
+    state->line_start = 0;
+    state->diag = diag;
+
+    void *scanner;
+    if (yylex_init_extra(state, &scanner) != 0) {
+        fprintf(diag, "Erro: falha ao inicializar o analisador lexico.\n");
+        return 0;
+    }
+    /* Escanear direto do buffer (inclui os dois '\0' finais) */
+    if (!yy_scan_buffer(ctx->src->data, ctx->src->size + 2, scanner)) {
+        fprintf(diag, "Erro: buffer de entrada invalido.\n");
+        yylex_destroy(scanner);
+        return 0;
+    }
+
+    int parse_result = yyparse(scanner, state);
+    yylex_destroy(scanner);
+
+    if (parse_result != 0) {
+        fprintf(diag, "Erro: falha na analise sintatica.\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int run_parse(PassContext *ctx) {
+    const CompileOptions *opts = ctx->opts;
+    FILE *diag = ctx->diag;
+
+    PROGRESS(opts, diag, "Iniciando analise de %s...\n", ctx->name);
+
+    ParserState state;
+    state.on_item = NULL;
+    state.stream = NULL;
+    if (!parse_source(ctx, &state)) return 0;
+
+    PROGRESS(opts, diag, "Analise sintatica concluida com sucesso.\n");
+    ctx->root = state.root;
+
+    /* Debug: imprimir AST */
+    if (opts->debug) {
+        fprintf(diag, "\n=== Arvore Sintatica Abstrata ===\n");
+        ast_print(ctx->root, 0);
+        fprintf(diag, "\n");
+    }
+    return 1;
+}
+
+/* O item i repete um 'importar' anterior do mesmo modulo? */
+static int repeated_import(PassContext *ctx, int i, const char *path) {
+    int repeated = 0;
+    for (int j = 0; j < i && !repeated; j++) {
+        ASTNode *item = ctx->root->data.programa.top_level_items[j];
+        if (item->kind != NODE_IMPORTAR) continue;
+        char *other = module_path(ctx->name, item->data.importar.caminho);
+        repeated = other && strcmp(other, path) == 0;
+        free(other);
+    }
+    return repeated;
+}
+
+/* Resolver cada 'importar': reaproveitar ou compilar o objeto do modulo */
+/* e declarar no programa os passos que ele exporta */
+static int run_imports(PassContext *ctx) {
+    ASTNode *root = ctx->root;
+    
+    for (int i = 0; i < root->data.programa.num_items; i++) {
+        ASTNode *item = root->data.programa.top_level_items[i];
+        if (item->kind != NODE_IMPORTAR) continue;
+        
+        /* Receitas em cache tem registradores absolutos, nao relocaveis */
+        if (ctx->cache) {
+            fprintf(ctx->diag, "Erro: -cache nao pode ser combinado com 'importar'\n");
+            return 0;
+        }
+        
+        /* Objetos de modulo sao codigo da AirFryerVM */
+        if (ctx->opts->target != TARGET_AIRFRYER) {
+            fprintf(ctx->diag, "Erro: -target x86-64 nao pode ser combinado com 'importar'\n");
+            return 0;
+        }
+        
+        char *path = module_path(ctx->name, item->data.importar.caminho);
+        ObjectFile *obj = path ? module_require(ctx, path) : NULL;
+        if (!obj) {
+            fprintf(ctx->diag, "Erro: falha ao importar \"%s\" (%s, linha %d)\n",
+                    item->data.importar.caminho, ctx->name, item->line);
+            free(path);
+            return 0;
+        }
+        if (!repeated_import(ctx, i, path)) object_declare_exports(obj, root, item->line);
+        free(path);
+    }
+    return 1;
+}
+
+/* Cache incremental: marcar receitas que nao mudaram */
+static int run_cache_plan(PassContext *ctx) {
+    cache_plan(ctx->cache, ctx->root);
+    return 1;
+}
+
+static int run_semantic(PassContext *ctx) {
+    PROGRESS(ctx->opts, ctx->diag, "Realizando analise semantica...\n");
+    SemanticErrorList *errors = error_list_create();
+
+    if (!semantic_analyze(ctx->root, errors)) {
+        fprintf(ctx->diag, "\n");
+        error_list_print(errors, ctx->diag);
+        fprintf(ctx->diag, "\nErro: falha na analise semantica.\n");
+        error_list_free(errors);
+        return 0;
+    }
+
+    PROGRESS(ctx->opts, ctx->diag, "Analise semantica concluida com sucesso.\n");
+    error_list_free(errors);
+    return 1;
+}
+
+/* Avaliacao parcial: regioes sem sensores viram seus efeitos residuais */
+static int run_peval(PassContext *ctx) {
+    PevalStats stats;
+    peval_program(ctx->root, ctx->opts->peval_fuel, &stats);
+
+    if (stats.skipped) {
+        PROGRESS(ctx->opts, ctx->diag, "Avaliacao parcial: programa mantido (%s)\n", stats.skipped);
+    } else {
+        PROGRESS(ctx->opts, ctx->diag,
+                 "Avaliacao parcial: %d comando(s) resolvido(s) em compilacao, %d mantido(s)\n",
+                 stats.collapsed, stats.kept);
+    }
+
+    if (ctx->opts->debug) {
+        fprintf(ctx->diag, "\n=== Arvore Apos Avaliacao Parcial ===\n");
+        ast_print(ctx->root, 0);
+        fprintf(ctx->diag, "\n");
+    }
+    return 1;
+}
+
+static int visit_strings(PassContext *ctx, ASTNode *node) {
+    /* O percurso comeca pela raiz e cobre a arvore inteira */
+    if (node == ctx->root) ctx->codegen->strings_collected = 1;
+    return codegen_string_visitor(ctx->codegen, node);
+}
+
+static int visit_calls(PassContext *ctx, ASTNode *node) {
+    if (node == ctx->root) ctx->codegen->calls_collected = 1;
+    return codegen_call_visitor(ctx->root, node);
+}
+
+/* Modulo, ou programa que importa modulos: gerar o objeto relocavel e, */
+/* no programa principal, liga-lo aos objetos dos modulos */
+static int run_object(PassContext *ctx) {
+    const CompileOptions *opts = ctx->opts;
+    FILE *diag = ctx->diag;
+    ASTNode *root = ctx->root;
+    
+    PROGRESS(opts, diag, "Gerando codigo do modulo %s...\n", root->data.programa.nome);
+    CodeFragment *code = codegen_module(ctx->codegen, root, ctx->module);
+    if (ctx->codegen->num_errors > 0) {
+        codegen_fragment_free(code);
+        fprintf(diag, "Erro: falha na geracao de codigo.\n");
+        return 0;
+    }
+    
+    ObjectFile *obj = object_create(root, code);
+    obj->source_key = object_source_key(ctx->src->data, ctx->src->size);
+    for (int i = 0; i < root->data.programa.num_items; i++) {
+        ASTNode *item = root->data.programa.top_level_items[i];
+        if (item->kind != NODE_IMPORTAR) continue;
+        char *path = module_path(ctx->name, item->data.importar.caminho);
+        ObjectFile *dep = module_set_find(ctx->modules, path);
+        if (dep && !repeated_import(ctx, i, path)) {
+            object_add_import(obj, item->data.importar.caminho, dep->interface_key);
+        }
+        free(path);
+    }
+    
+    if (ctx->module) {
+        ctx->object = obj;
+        if (ctx->output && !object_write(ctx->output, obj)) {
+            fprintf(diag, "Erro: falha ao gravar o objeto.\n");
+            return 0;
+        }
+        PROGRESS(opts, diag, "Objeto gerado: %d passo(s) exportado(s), %d chamada(s) externa(s)\n",
+                 obj->num_passos, obj->num_externos);
+        return 1;
+    }
+    
+    /* Dependencias na ordem de inicializacao e o programa por ultimo */
+    ModuleSet *set = ctx->modules;
+    ObjectFile **objs = (ObjectFile**)malloc((set->num_modules + 1) * sizeof(ObjectFile*));
+    for (int i = 0; i < set->num_modules; i++) {
+        objs[i] = set->modules[i].obj;
+    }
+    objs[set->num_modules] = obj;
+    
+    LinkStats stats;
+    int ok = link_program(objs, set->num_modules + 1, ctx->output, diag, &stats);
+    if (ok) {
+        PROGRESS(opts, diag, "Ligacao: %d modulo(s) (%d compilado(s), %d reaproveitado(s)), "
+                 "%d string(s), %d repetida(s) mesclada(s)\n",
+                 stats.modules, set->compiled, set->reused, stats.strings, stats.merged);
+        PROGRESS(opts, diag, "Codigo gerado com sucesso.\n");
+    } else {
+        fprintf(diag, "Erro: falha na ligacao.\n");
+    }
+    
+    free(objs);
+    object_free(obj);
+    return ok;
+}
+
+static int run_codegen(PassContext *ctx) {
+    if (ctx->module || ctx->modules->num_modules > 0) return run_object(ctx);
+    
+    PROGRESS(ctx->opts, ctx->diag, "Gerando codigo assembly...\n");
+
+    if (!codegen_generate(ctx->codegen, ctx->root)) {
+        fprintf(ctx->diag, "Erro: falha na geracao de codigo.\n");
+        return 0;
+    }
+
+    PROGRESS(ctx->opts, ctx->diag, "Codigo gerado com sucesso.\n");
+
+    if (ctx->cache) {
+        cache_store(ctx->cache, ctx->codegen);
+        PROGRESS(ctx->opts, ctx->diag, "Cache: %d receita(s) reaproveitada(s), %d recompilada(s)\n",
+                 ctx->cache->hits, ctx->cache->misses);
+    }
+    return 1;
+}
+
+/* ===== MODO STREAMING ===== */
+
+/* Parsing, analise semantica e geracao intercalados: cada item do nivel */
+/* do programa e analisado, gerado e liberado assim que o parser o reduz. */
+/* So os passos com parametros ficam vivos (podem ser chamados depois e */
+/* sao gerados apos o HALT); a string table vai para o fim da saida. */
+typedef struct StreamState {
+    PassContext *ctx;
+    SymbolTable *table;
+    SemanticErrorList *errors;
+    int items;
+    long peak_nodes;        /* Maior numero de nos da AST vivos */
+} StreamState;
+
+static void stream_item(ParserState *state, ASTNode *item) {
+    StreamState *st = (StreamState*)state->stream;
+    PassContext *ctx = st->ctx;
+
+    if (st->items++ == 0) {
+        codegen_stream_begin(ctx->codegen, state->root);
+        st->table->program = state->root;
+    }
+
+    long live = ast_live_nodes();
+    if (live > st->peak_nodes) st->peak_nodes = live;
+
+    /* Modulos sao ligados depois de gerar o programa inteiro */
+    if (item->kind == NODE_IMPORTAR) {
+        error_list_add(st->errors, "'importar' nao e suportado no modo streaming", item->line);
+    }
+    
+    /* Antes da analise: o passo pode chamar a si mesmo */
+    int keep = item->kind == NODE_PASSO && item->data.passo.subrotina;
+    if (keep) ast_programa_add_item(state->root, item);
+
+    semantic_analyze_item(st->table, item, st->errors);
+    if (ctx->opts->debug) ast_print(item, 1);
+
+    /* Depois do primeiro erro o parsing continua so para reportar os demais */
+    if (st->errors->num_errors == 0) codegen_stream_item(ctx->codegen, item);
+
+    if (!keep) ast_free(item);
+}
+
+static int run_stream(PassContext *ctx) {
+    const CompileOptions *opts = ctx->opts;
+    FILE *diag = ctx->diag;
+
+    PROGRESS(opts, diag, "Iniciando analise de %s (streaming)...\n", ctx->name);
+    if (opts->debug) fprintf(diag, "\n=== Arvore Sintatica Abstrata (por item) ===\n");
+
+    StreamState st;
+    st.ctx = ctx;
+    st.table = symtable_create();
+    st.errors = error_list_create();
+    st.items = 0;
+    st.peak_nodes = 0;
+
+    ParserState state;
+    state.on_item = stream_item;
+    state.stream = &st;
+    int ok = parse_source(ctx, &state);
+    ctx->root = state.root;
+
+    if (ok && st.errors->num_errors > 0) {
+        fprintf(diag, "\n");
+        error_list_print(st.errors, diag);
+        fprintf(diag, "\nErro: falha na analise semantica.\n");
+        ok = 0;
+    }
+    if (ok && ctx->codegen->num_errors > 0) {
+        fprintf(diag, "Erro: falha na geracao de codigo.\n");
+        ok = 0;
+    }
+
+    if (ok) {
+        /* Programa sem itens: o cabecalho ainda nao foi emitido */
+        if (st.items == 0) codegen_stream_begin(ctx->codegen, ctx->root);
+        codegen_stream_end(ctx->codegen);
+        PROGRESS(opts, diag, "Streaming: %d item(ns) gerado(s), no maximo %ld no(s) da AST vivos\n",
+                 st.items, st.peak_nodes);
+        PROGRESS(opts, diag, "Codigo gerado com sucesso.\n");
+    }
+
+    symtable_free(st.table);
+    error_list_free(st.errors);
+    return ok;
+}
+
+static const Pass PASS_PARSE = {
+    "parse", PASS_TRANSFORM, { NULL }, run_parse, NULL
+};
+static const Pass PASS_IMPORTS = {
+    "imports", PASS_TRANSFORM, { "parse", NULL }, run_imports, NULL
+};
+static const Pass PASS_CACHE = {
+    "cache", PASS_ANALYSIS, { "parse", NULL }, run_cache_plan, NULL
+};
+static const Pass PASS_SEMANTIC = {
+    "semantic", PASS_ANALYSIS, { "imports", NULL }, run_semantic, NULL
+};
+static const Pass PASS_PEVAL = {
+    "peval", PASS_TRANSFORM, { "semantic", NULL }, run_peval, NULL
+};
+static const Pass PASS_STRINGS = {
+    "strings", PASS_ANALYSIS, { "parse", NULL }, NULL, visit_strings
+};
+/* Fundido com 'strings': as duas coletas num so percurso da AST */
+static const Pass PASS_CALLS = {
+    "calls", PASS_ANALYSIS, { "parse", NULL }, NULL, visit_calls
+};
+static const Pass PASS_CODEGEN = {
+    "codegen", PASS_EMIT, { "semantic", "strings", "calls", NULL }, run_codegen, NULL
+};
+static const Pass PASS_STREAM = {
+    "stream", PASS_EMIT, { NULL }, run_stream, NULL
+};
+
+/* ===== COMPILACAO ===== */
+
+/* Registrar e executar os passos de ctx (programa ou modulo) */
+/* Retorna 1 se sucesso, 0 se erro */
+static int compile_pipeline(PassContext *ctx) {
+    const CompileOptions *opts = ctx->opts;
+    FILE *diag = ctx->diag;
+
+    PassManager *pm = pass_manager_create(opts->time_report);
+    int ok;
+    if (opts->target != TARGET_AIRFRYER && (opts->stream || opts->cache_dir || ctx->module)) {
+        /* Fragmentos, objetos e streaming sao codigo da AirFryerVM */
+        fprintf(diag, "Erro: -target x86-64 nao pode ser combinado com -stream, -cache nem -c\n");
+        ok = 0;
+    } else if (opts->stream) {
+        /* Cache, avaliacao parcial e modulos precisam do programa inteiro */
+        ok = !opts->peval && !opts->cache_dir && !ctx->module;
+        if (!ok) fprintf(diag, "Erro: -stream nao pode ser combinado com -peval, -cache nem -c\n");
+        ok = ok && pass_manager_add(pm, &PASS_STREAM, diag);
+    } else if (ctx->module && ctx->cache) {
+        fprintf(diag, "Erro: -c nao pode ser combinado com -cache\n");
+        ok = 0;
+    } else {
+        /* Com avaliacao parcial, as chaves do cache sao calculadas sobre a */
+        /* AST ja reescrita: o residuo de uma receita depende do que veio antes */
+        ok = pass_manager_add(pm, &PASS_PARSE, diag) &&
+             pass_manager_add(pm, &PASS_IMPORTS, diag) &&
+             (!ctx->cache || opts->peval || pass_manager_add(pm, &PASS_CACHE, diag)) &&
+             pass_manager_add(pm, &PASS_SEMANTIC, diag) &&
+             (!opts->peval || pass_manager_add(pm, &PASS_PEVAL, diag)) &&
+             (!ctx->cache || !opts->peval || pass_manager_add(pm, &PASS_CACHE, diag)) &&
+             pass_manager_add(pm, &PASS_STRINGS, diag) &&
+             pass_manager_add(pm, &PASS_CALLS, diag) &&
+             pass_manager_add(pm, &PASS_CODEGEN, diag);
+    }
+
+    if (ok) ok = pass_manager_run(pm, ctx);
+
+    if (opts->time_report) pass_manager_report(pm, ctx->name, diag);
+    pass_manager_free(pm);
+    return ok;
+}
+
+int compile_source(SourceBuffer *src, const char *name, FILE *output,
+                   const CompileOptions *opts, FILE *diag) {
+    if (opts->mem_stats) mem_stats_begin();
+
+    ModuleSet modules;
+    module_set_init(&modules);
+
+    PassContext ctx;
+    ctx.src = src;
+    ctx.name = name;
+    ctx.output = output;
+    ctx.opts = opts;
+    ctx.diag = diag;
+    ctx.root = NULL;
+    ctx.codegen = codegen_create(output);
+    ctx.codegen->diag = diag;
+    ctx.codegen->target = (CodegenTarget)opts->target;
+    ctx.cache = opts->cache_dir && !opts->stream ? cache_open(opts->cache_dir, diag) : NULL;
+    ctx.modules = &modules;
+    ctx.module = opts->module;
+    ctx.object = NULL;
+
+    int ok = compile_pipeline(&ctx);
+
+    /* Limpeza (fragmentos do cache sao usados ate o fim da geracao) */
+    codegen_free(ctx.codegen);
+    ast_free(ctx.root);
+    cache_close(ctx.cache);
+    object_free(ctx.object);
+    module_set_free(&modules);
+
+    /* Depois da limpeza: o que continua vivo e vazamento */
+    if (opts->mem_stats) {
+        MemStats stats;
+        mem_stats_end(&stats);
+        mem_stats_report(&stats, name, diag);
+    }
+
+    if (ok) PROGRESS(opts, diag, "Compilacao concluida!\n");
+
+    return ok;
+}
+
+int compile_file(const char *input_path, const char *output_path,
+                 const CompileOptions *opts, FILE *diag) {
+    SourceBuffer *src = source_open(input_path);
+    if (!src) {
+        fprintf(diag, "Erro: nao foi possivel abrir o arquivo %s\n", input_path);
+        return 0;
+    }
+
+    FILE *output = stdout;
+    if (output_path) {
+        output = fopen(output_path, "w");
+        if (!output) {
+            fprintf(diag, "Erro: nao foi possivel criar arquivo de saida %s\n", output_path);
+            source_close(src);
+            return 0;
+        }
+    }
+
+    int ok = compile_source(src, input_path, output, opts, diag);
+
+    source_close(src);
+    if (output != stdout) {
+        if (fclose(output) != 0) {
+            fprintf(diag, "Erro: falha ao gravar %s\n", output_path);
+            ok = 0;
+        }
+        /* Nao deixar saida parcial para tras */
+        if (!ok) remove(output_path);
+    }
+
+    return ok;
+}
@@ -0,0 +1,47 @@
+/*
+ * driver.h
+ * Pipeline de compilacao de um unico arquivo AirFryerScript
+ *
+ * Encapsula analise lexica/sintatica, analise semantica e geracao de
+ * codigo (registradas como passos, ver pass.h) sem usar estado global,
+ * de modo que varios arquivos possam ser compilados ao mesmo tempo
+ * (ver batch.h).
+ */
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdio.h>
+#include "source.h"
+
+/* Opcoes de uma compilacao */
+typedef struct CompileOptions {
+    int debug;     /* 1 para imprimir a AST apos o parsing */
+    int quiet;     /* 1 para omitir mensagens de progresso (so erros) */
+    const char *cache_dir;  /* Diretorio do cache de receitas (NULL = sem cache) */
+    int time_report;        /* 1 para imprimir tempo/alocacoes/nos por passo */
+    int mem_stats;          /* 1 para imprimir a memoria por subsistema (ver alloc.h) */
+    int peval;              /* 1 para avaliar em compilacao o que nao depende de sensores */
+    long peval_fuel;        /* Passos de avaliacao por comando (ver peval.h) */
+    int stream;             /* 1 para gerar e liberar cada item assim que e lido */
+    int module;             /* 1 para gerar o objeto do modulo (.afo), sem ligar */
+    int target;             /* Arquitetura de saida (CodegenTarget, ver codegen.h) */
+} CompileOptions;
+
+/* Preencher opcoes com valores padrao */
+void compile_options_init(CompileOptions *opts);
+
+/* Compilar o programa em src, escrevendo assembly em output */
+/* O scanner le o buffer no lugar; name e usado nas mensagens e para */
+/* localizar os modulos importados (relativos ao diretorio de name); */
+/* os diagnosticos vao para diag */
+/* Retorna 1 se sucesso, 0 se erro */
+int compile_source(SourceBuffer *src, const char *name, FILE *output,
+                   const CompileOptions *opts, FILE *diag);
+
+/* Compilar input_path para output_path (mapeia a entrada em memoria) */
+/* Retorna 1 se sucesso, 0 se erro */
+int compile_file(const char *input_path, const char *output_path,
+                 const CompileOptions *opts, FILE *diag);
+
+#endif /* DRIVER_H */
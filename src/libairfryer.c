@@ -0,0 +1,268 @@
+/*
+ * libairfryer.c
+ * Implementacao da biblioteca: driver de compilacao + VM nativa
+ */
+
+#define _GNU_SOURCE
+#include "libairfryer.h"
+#include "driver.h"
+#include "source.h"
+#include "asm.h"
+#include "vm.h"
+#include "jit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* codegen.h (via ast.h) e asm.h nao podem ser incluidos juntos: os */
+/* AFS_TARGET_* sao conferidos em main.c */
+_Static_assert(AFS_SENSOR_TEMP == SENSOR_TEMP && AFS_SENSOR_STATE == SENSOR_STATE,
+               "AFS_SENSOR_* deve seguir VMSensor");
+
+/* Nome usado nas mensagens quando o chamador nao da um */
+#define DEFAULT_NAME "<memoria>"
+
+struct AfsProgram {
+    char *text;                /* Saida do compilador */
+    size_t text_size;
+    Program *image;            /* Programa carregado (NULL se nao executavel) */
+};
+
+struct AfsVM {
+    VM *vm;
+    FILE *out;                 /* Saida da VM (stdout ou o callback) */
+    AfsCallbacks callbacks;
+};
+
+void afs_options_init(AfsOptions *opts) {
+    /* Mesmos padroes do driver, mas sem mensagens de progresso */
+    CompileOptions copts;
+    compile_options_init(&copts);
+    opts->name = NULL;
+    opts->quiet = 1;
+    opts->debug = copts.debug;
+    opts->cache_dir = copts.cache_dir;
+    opts->time_report = copts.time_report;
+    opts->mem_stats = copts.mem_stats;
+    opts->peval = copts.peval;
+    opts->peval_fuel = copts.peval_fuel;
+    opts->stream = copts.stream;
+    opts->module = copts.module;
+    opts->target = copts.target;
+}
+
+/* ===== COMPILACAO ===== */
+
+/* Opcoes do driver equivalentes (opts NULL = padrao) */
+static void driver_options(const AfsOptions *opts, CompileOptions *copts) {
+    AfsOptions defaults;
+    if (!opts) {
+        afs_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    compile_options_init(copts);
+    copts->quiet = opts->quiet;
+    copts->debug = opts->debug;
+    copts->cache_dir = opts->cache_dir;
+    copts->time_report = opts->time_report;
+    copts->mem_stats = opts->mem_stats;
+    copts->peval = opts->peval;
+    copts->peval_fuel = opts->peval_fuel;
+    copts->stream = opts->stream;
+    copts->module = opts->module;
+    copts->target = opts->target;
+}
+
+/* Compilar buf (NULL = sem memoria) para um programa em memoria */
+/* Retorna o programa ou NULL se erro */
+static AfsProgram* compile_program(SourceBuffer *buf, const char *name,
+                                   const AfsOptions *opts, char **diagnostics) {
+    CompileOptions copts;
+    driver_options(opts, &copts);
+
+    /* Saida e diagnosticos em buffers de memoria */
+    char *text = NULL, *diag_text = NULL;
+    size_t text_size = 0, diag_size = 0;
+    FILE *output = open_memstream(&text, &text_size);
+    FILE *diag = open_memstream(&diag_text, &diag_size);
+
+    int ok = 0;
+    if (output && diag && buf) {
+        ok = compile_source(buf, name, output, &copts, diag);
+    } else if (diag) {
+        fprintf(diag, "Erro: memoria insuficiente\n");
+    }
+    if (output) fclose(output);
+
+    AfsProgram *prog = NULL;
+    if (ok) {
+        prog = malloc(sizeof(AfsProgram));
+        prog->text = text;
+        prog->text_size = text_size;
+        prog->image = NULL;
+        text = NULL;
+
+        /* Codigo da AirFryerVM ligado: decodificar ja para a VM */
+        if (copts.target == AFS_TARGET_AIRFRYER && !copts.module) {
+            char err[512];
+            prog->image = asm_load(prog->text, prog->text_size, err, sizeof(err));
+            if (!prog->image) {
+                fprintf(diag, "Erro: assembly gerado invalido: %s\n", err);
+                afs_program_free(prog);
+                prog = NULL;
+            }
+        }
+    }
+    free(text);
+
+    if (diag) fclose(diag);
+    if (diagnostics) {
+        *diagnostics = diag_text ? diag_text : strdup("");
+    } else {
+        free(diag_text);
+    }
+    return prog;
+}
+
+AfsProgram* afs_compile(const char *src, size_t len, const AfsOptions *opts,
+                        char **diagnostics) {
+    const char *name = opts && opts->name ? opts->name : DEFAULT_NAME;
+    SourceBuffer *buf = source_from_memory(src, len);
+    AfsProgram *prog = compile_program(buf, name, opts, diagnostics);
+    source_close(buf);
+    return prog;
+}
+
+AfsProgram* afs_compile_file(const char *path, const AfsOptions *opts,
+                             char **diagnostics) {
+    const char *name = opts && opts->name ? opts->name : path;
+    SourceBuffer *buf = source_open(path);
+    if (!buf) {
+        if (diagnostics &&
+            asprintf(diagnostics, "Erro: nao foi possivel abrir o arquivo %s\n", path) < 0) {
+            *diagnostics = strdup("");
+        }
+        return NULL;
+    }
+    AfsProgram *prog = compile_program(buf, name, opts, diagnostics);
+    source_close(buf);
+    return prog;
+}
+
+int afs_compile_to(const char *path, const char *output_path,
+                   const AfsOptions *opts, FILE *diag) {
+    CompileOptions copts;
+    driver_options(opts, &copts);
+    return compile_file(path, output_path, &copts, diag);
+}
+
+const char* afs_program_text(const AfsProgram *prog, size_t *size) {
+    if (size) *size = prog->text_size;
+    return prog->text;
+}
+
+int afs_program_runnable(const AfsProgram *prog) {
+    return prog->image != NULL;
+}
+
+void afs_program_free(AfsProgram *prog) {
+    if (!prog) return;
+    asm_free(prog->image);
+    free(prog->text);
+    free(prog);
+}
+
+/* ===== EXECUCAO ===== */
+
+/* Stream de saida que repassa cada escrita ao callback */
+static ssize_t output_write(void *cookie, const char *data, size_t size) {
+    AfsVM *vm = (AfsVM*)cookie;
+    vm->callbacks.output(vm->callbacks.user, data, size);
+    return (ssize_t)size;
+}
+
+static int64_t hook_sensor(void *user, int sensor, int64_t value) {
+    AfsVM *vm = (AfsVM*)user;
+    return vm->callbacks.sensor(vm->callbacks.user, sensor, value);
+}
+
+static void hook_actuator(void *user, Opcode op, int64_t arg) {
+    AfsVM *vm = (AfsVM*)user;
+    int command;
+    switch (op) {
+        case OP_SETMODE: command = AFS_CMD_SETMODE; break;
+        case OP_PAUSE: command = AFS_CMD_PAUSE; break;
+        case OP_RESUME: command = AFS_CMD_RESUME; break;
+        case OP_STOP: command = AFS_CMD_STOP; break;
+        default: return;
+    }
+    vm->callbacks.actuator(vm->callbacks.user, command, arg);
+}
+
+AfsVM* afs_vm_create(const AfsProgram *prog, const AfsCallbacks *callbacks) {
+    if (!prog || !prog->image) return NULL;
+
+    AfsVM *vm = calloc(1, sizeof(AfsVM));
+    if (callbacks) vm->callbacks = *callbacks;
+
+    vm->out = stdout;
+    if (vm->callbacks.output) {
+        cookie_io_functions_t io = { NULL, output_write, NULL, NULL };
+        vm->out = fopencookie(vm, "w", io);
+        if (!vm->out) {
+            free(vm);
+            return NULL;
+        }
+    }
+
+    vm->vm = vm_create(prog->image, vm->out);
+    vm->vm->hooks.user = vm;
+    if (vm->callbacks.sensor) vm->vm->hooks.sensor = hook_sensor;
+    if (vm->callbacks.actuator) vm->vm->hooks.actuator = hook_actuator;
+
+    /* O codigo do JIT le os sensores direto do modelo */
+    if (!vm->callbacks.sensor) vm->vm->jit = jit_create(vm->vm);
+    return vm;
+}
+
+void afs_vm_set_max_steps(AfsVM *vm, int64_t max_steps) {
+    vm->vm->max_steps = max_steps;
+}
+
+int afs_vm_step(AfsVM *vm) {
+    int ok = vm_step(vm->vm);
+    fflush(vm->out);
+    return ok;
+}
+
+int afs_vm_run(AfsVM *vm) {
+    int ok = vm_run(vm->vm);
+    fflush(vm->out);
+    return ok;
+}
+
+int afs_vm_halted(const AfsVM *vm) {
+    return vm->vm->halted;
+}
+
+int64_t afs_vm_steps(const AfsVM *vm) {
+    return vm->vm->steps;
+}
+
+const char* afs_vm_error(const AfsVM *vm) {
+    return vm->vm->error;
+}
+
+void afs_vm_print_state(AfsVM *vm) {
+    vm_print_state(vm->vm, vm->out);
+    fflush(vm->out);
+}
+
+void afs_vm_destroy(AfsVM *vm) {
+    if (!vm) return;
+    jit_free(vm->vm->jit);
+    vm_free(vm->vm);
+    if (vm->out != stdout) fclose(vm->out);
+    free(vm);
+}
@@ -0,0 +1,150 @@
+/*
+ * libairfryer.h
+ * Compilador e AirFryerVM nativa embutidos num processo (libairfryer)
+ *
+ * Compila um programa AirFryerScript de um buffer para um programa em
+ * memoria e o executa no interpretador nativo (vm/native), sem arquivos
+ * intermediarios nem processos filhos:
+ *
+ *   char *diag;
+ *   AfsProgram *prog = afs_compile(fonte, tamanho, NULL, &diag);
+ *   AfsVM *vm = prog ? afs_vm_create(prog, &callbacks) : NULL;
+ *   if (vm && !afs_vm_run(vm)) fprintf(stderr, "%s\n", afs_vm_error(vm));
+ *   afs_vm_destroy(vm);
+ *   afs_program_free(prog);
+ *   free(diag);
+ *
+ * build/libairfryer.a e build/libairfryer.so (make lib). Com a biblioteca
+ * estatica, ligar tambem com -lpthread -lm.
+ *
+ * Um AfsProgram pode ser executado por varias VMs; cada AfsVM e usada por
+ * uma thread por vez. Compilacoes em threads diferentes sao independentes.
+ */
+
+#ifndef LIBAIRFRYER_H
+#define LIBAIRFRYER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Arquiteturas de saida (as mesmas de -target) */
+#define AFS_TARGET_AIRFRYER 0
+#define AFS_TARGET_X86_64 1
+
+/* Sensores (READ) */
+#define AFS_SENSOR_TEMP 0
+#define AFS_SENSOR_WEIGHT 1
+#define AFS_SENSOR_MODE 2
+#define AFS_SENSOR_STATE 3
+
+/* Comandos da air fryer (atuadores) */
+#define AFS_CMD_SETMODE 0   /* arg = modo (0 = manual, 1-4 = presets) */
+#define AFS_CMD_PAUSE 1
+#define AFS_CMD_RESUME 2
+#define AFS_CMD_STOP 3
+
+/* Opcoes de afs_compile (ver afs_options_init) */
+typedef struct AfsOptions {
+    const char *name;       /* Nome nas mensagens e base dos caminhos de 'importar' */
+    int quiet;              /* 1 para so erros nos diagnosticos (padrao) */
+    int debug;              /* 1 para incluir a AST nos diagnosticos */
+    const char *cache_dir;  /* Cache de receitas (NULL = sem cache) */
+    int time_report;        /* 1 para tempo/alocacoes por passo nos diagnosticos */
+    int mem_stats;          /* 1 para a memoria por subsistema nos diagnosticos */
+    int peval;              /* 1 para avaliacao parcial */
+    long peval_fuel;        /* Passos de avaliacao por comando */
+    int stream;             /* 1 para o modo streaming */
+    int module;             /* 1 para gerar o objeto do modulo (.afo), sem ligar */
+    int target;             /* AFS_TARGET_* */
+} AfsOptions;
+
+/* Callbacks de uma VM; campos NULL usam o padrao */
+typedef struct AfsCallbacks {
+    /* Saida do programa (imprimir, PRINT...); padrao: stdout */
+    void (*output)(void *user, const char *text, size_t size);
+    /* Valor lido por READ; recebe o valor do modelo termico (padrao) */
+    /* Com este callback a VM roda sem JIT */
+    int64_t (*sensor)(void *user, int sensor, int64_t value);
+    /* Comando executado (AFS_CMD_*), depois de aplicado ao modelo termico */
+    void (*actuator)(void *user, int command, int64_t arg);
+    void *user;
+} AfsCallbacks;
+
+typedef struct AfsProgram AfsProgram;
+typedef struct AfsVM AfsVM;
+
+/* Preencher opcoes com valores padrao (silencioso, AirFryerVM) */
+void afs_options_init(AfsOptions *opts);
+
+/* Compilar src (len bytes; nao precisa terminar em '\0') */
+/* opts NULL = padrao. Os diagnosticos (mensagens de progresso e erros) */
+/* vao para *diagnostics, alocado com malloc, se diagnostics nao e NULL */
+/* Retorna o programa ou NULL se erro */
+AfsProgram* afs_compile(const char *src, size_t len, const AfsOptions *opts,
+                        char **diagnostics);
+
+/* Como afs_compile, mas o fonte e o arquivo em path, lido do mapeamento */
+/* em memoria (sem copia); opts->name NULL = path nas mensagens */
+/* Retorna o programa ou NULL se erro */
+AfsProgram* afs_compile_file(const char *path, const AfsOptions *opts,
+                             char **diagnostics);
+
+/* Compilar o arquivo em path para output_path (NULL = stdout) sem montar */
+/* um programa: o fonte e mapeado e o texto e gravado a medida que e */
+/* gerado (com stream, a memoria nao cresce com o tamanho do programa). */
+/* Os diagnosticos vao direto para diag; as mensagens usam path */
+/* Retorna 1 se sucesso, 0 se erro */
+int afs_compile_to(const char *path, const char *output_path,
+                   const AfsOptions *opts, FILE *diag);
+
+/* Texto gerado: assembly .mwasm, assembly x86-64 ou objeto .afo */
+const char* afs_program_text(const AfsProgram *prog, size_t *size);
+
+/* 1 se o programa pode ser executado por afs_vm_create (codigo da */
+/* AirFryerVM ligado), 0 se nao (-target x86-64 ou objeto de modulo) */
+int afs_program_runnable(const AfsProgram *prog);
+
+/* Liberar o programa (depois das VMs que o usam) */
+void afs_program_free(AfsProgram *prog);
+
+/* Criar uma VM para prog; callbacks NULL = saida em stdout, sem atuadores */
+/* Retorna NULL se o programa nao e executavel */
+AfsVM* afs_vm_create(const AfsProgram *prog, const AfsCallbacks *callbacks);
+
+/* Limite de instrucoes executadas (padrao 100000, 0 = sem limite) */
+void afs_vm_set_max_steps(AfsVM *vm, int64_t max_steps);
+
+/* Executar uma instrucao */
+/* Retorna 1 se sucesso, 0 se erro (mensagem em afs_vm_error) */
+int afs_vm_step(AfsVM *vm);
+
+/* Executar ate HALT, o fim do programa ou um erro */
+/* Retorna 1 se sucesso, 0 se erro (mensagem em afs_vm_error) */
+int afs_vm_run(AfsVM *vm);
+
+/* 1 se o programa terminou */
+int afs_vm_halted(const AfsVM *vm);
+
+/* Instrucoes executadas */
+int64_t afs_vm_steps(const AfsVM *vm);
+
+/* Mensagem do ultimo erro ("" se nao houve) */
+const char* afs_vm_error(const AfsVM *vm);
+
+/* Imprimir o estado como a VM em Python ("Steps executados: ..."), pela */
+/* saida da VM */
+void afs_vm_print_state(AfsVM *vm);
+
+/* Liberar a VM */
+void afs_vm_destroy(AfsVM *vm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBAIRFRYER_H */
@@ -0,0 +1,383 @@
+/*
+ * link.c
+ * Implementacao dos objetos de modulo e do ligador
+ */
+
+#define _GNU_SOURCE
+#include "link.h"
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Incrementar sempre que o formato do objeto mudar */
+#define OBJECT_FORMAT_VERSION 1
+#define INITIAL_CAPACITY 16
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* ===== HASH ===== */
+
+static unsigned long long mix_bytes(unsigned long long h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static unsigned long long mix_int(unsigned long long h, long long value) {
+    return mix_bytes(h, &value, sizeof(value));
+}
+
+static unsigned long long mix_str(unsigned long long h, const char *s) {
+    return mix_bytes(h, s, strlen(s) + 1);
+}
+
+unsigned long long object_source_key(const char *data, size_t size) {
+    unsigned long long h = mix_int(FNV_OFFSET, OBJECT_FORMAT_VERSION);
+    h = mix_int(h, (long long)cache_compiler_hash());
+    return mix_bytes(h, data, size);
+}
+
+/* Interface de um modulo: o que quem o importa enxerga */
+static unsigned long long object_interface_key(const ObjectFile *obj) {
+    unsigned long long h = mix_str(FNV_OFFSET, obj->modulo);
+    for (int i = 0; i < obj->num_passos; i++) {
+        h = mix_str(h, obj->passos[i].nome);
+        h = mix_int(h, obj->passos[i].num_params);
+        for (int p = 0; p < obj->passos[i].num_params; p++) {
+            h = mix_int(h, obj->passos[i].tipos[p]);
+        }
+    }
+    return h;
+}
+
+/* ===== CONSTRUCAO ===== */
+
+/* Novo passo exportado, ainda sem parametros (espaco para n) */
+static ObjectSymbol* object_add_passo(ObjectFile *obj, const char *nome, int n) {
+    if (obj->num_passos >= obj->passos_capacity) {
+        obj->passos_capacity = obj->passos_capacity ? obj->passos_capacity * 2 : INITIAL_CAPACITY;
+        obj->passos = realloc(obj->passos, obj->passos_capacity * sizeof(ObjectSymbol));
+    }
+    ObjectSymbol *sym = &obj->passos[obj->num_passos++];
+    sym->nome = strdup(nome);
+    sym->num_params = 0;
+    sym->params = (char**)malloc((n + 1) * sizeof(char*));
+    sym->tipos = (DataType*)malloc((n + 1) * sizeof(DataType));
+    return sym;
+}
+
+static void object_add_externo(ObjectFile *obj, const char *nome) {
+    if (obj->num_externos >= obj->externos_capacity) {
+        obj->externos_capacity = obj->externos_capacity ? obj->externos_capacity * 2 : INITIAL_CAPACITY;
+        obj->externos = realloc(obj->externos, obj->externos_capacity * sizeof(char*));
+    }
+    obj->externos[obj->num_externos++] = strdup(nome);
+}
+
+ObjectFile* object_create(ASTNode *programa, CodeFragment *code) {
+    ObjectFile *obj = (ObjectFile*)calloc(1, sizeof(ObjectFile));
+    obj->modulo = strdup(programa->data.programa.nome);
+    obj->code = code;
+
+    for (int i = 0; i < programa->data.programa.num_items; i++) {
+        ASTNode *item = programa->data.programa.top_level_items[i];
+        if (item->kind != NODE_PASSO || !item->data.passo.subrotina) continue;
+        if (!item->data.passo.externo) {
+            ObjectSymbol *sym = object_add_passo(obj, item->data.passo.nome,
+                                                 item->data.passo.num_params);
+            for (int p = 0; p < item->data.passo.num_params; p++) {
+                ASTNode *param = item->data.passo.params[p];
+                sym->params[p] = strdup(param->data.declaracao.nome);
+                sym->tipos[p] = param->data.declaracao.tipo;
+                sym->num_params++;
+            }
+        } else if (item->data.passo.chamado) {
+            object_add_externo(obj, item->data.passo.nome);
+        }
+    }
+
+    obj->interface_key = object_interface_key(obj);
+    return obj;
+}
+
+void object_add_import(ObjectFile *obj, const char *caminho, unsigned long long interface_key) {
+    if (obj->num_imports >= obj->imports_capacity) {
+        obj->imports_capacity = obj->imports_capacity ? obj->imports_capacity * 2 : INITIAL_CAPACITY;
+        obj->imports = realloc(obj->imports, obj->imports_capacity * sizeof(*obj->imports));
+    }
+    obj->imports[obj->num_imports].caminho = strdup(caminho);
+    obj->imports[obj->num_imports].interface_key = interface_key;
+    obj->num_imports++;
+}
+
+void object_declare_exports(const ObjectFile *obj, ASTNode *programa, int line) {
+    for (int i = 0; i < obj->num_passos; i++) {
+        const ObjectSymbol *sym = &obj->passos[i];
+        ASTNode **params = NULL;
+        if (sym->num_params > 0) {
+            params = (ASTNode**)malloc(sym->num_params * sizeof(ASTNode*));
+            for (int p = 0; p < sym->num_params; p++) {
+                params[p] = ast_create_declaracao(strdup(sym->params[p]), sym->tipos[p], NULL);
+                params[p]->line = line;
+            }
+        }
+        ASTNode *passo = ast_create_passo_externo(strdup(sym->nome), params, sym->num_params);
+        passo->line = line;
+        ast_programa_add_item(programa, passo);
+    }
+}
+
+void object_free(ObjectFile *obj) {
+    if (!obj) return;
+
+    free(obj->modulo);
+    for (int i = 0; i < obj->num_imports; i++) {
+        free(obj->imports[i].caminho);
+    }
+    free(obj->imports);
+    for (int i = 0; i < obj->num_passos; i++) {
+        free(obj->passos[i].nome);
+        for (int p = 0; p < obj->passos[i].num_params; p++) {
+            free(obj->passos[i].params[p]);
+        }
+        free(obj->passos[i].params);
+        free(obj->passos[i].tipos);
+    }
+    free(obj->passos);
+    for (int i = 0; i < obj->num_externos; i++) {
+        free(obj->externos[i]);
+    }
+    free(obj->externos);
+    codegen_fragment_free(obj->code);
+    free(obj);
+}
+
+/* ===== ARQUIVOS ===== */
+
+/* Caminhos podem ter espacos: gravados como "<tamanho>\n<bytes>\n" */
+static char* read_text(FILE *f) {
+    size_t len;
+    if (fscanf(f, "%zu", &len) != 1 || fgetc(f) != '\n') return NULL;
+    char *text = (char*)malloc(len + 1);
+    if (fread(text, 1, len, f) != len || fgetc(f) != '\n') {
+        free(text);
+        return NULL;
+    }
+    text[len] = '\0';
+    return text;
+}
+
+static void write_text(FILE *f, const char *text) {
+    fprintf(f, "%zu\n%s\n", strlen(text), text);
+}
+
+int object_write(FILE *f, const ObjectFile *obj) {
+    fprintf(f, "AFO %d\nmodulo %s\nfonte %016llx\ninterface %016llx\n",
+            OBJECT_FORMAT_VERSION, obj->modulo, obj->source_key, obj->interface_key);
+
+    fprintf(f, "imports %d\n", obj->num_imports);
+    for (int i = 0; i < obj->num_imports; i++) {
+        fprintf(f, "%016llx ", obj->imports[i].interface_key);
+        write_text(f, obj->imports[i].caminho);
+    }
+
+    fprintf(f, "passos %d\n", obj->num_passos);
+    for (int i = 0; i < obj->num_passos; i++) {
+        fprintf(f, "%s %d\n", obj->passos[i].nome, obj->passos[i].num_params);
+        for (int p = 0; p < obj->passos[i].num_params; p++) {
+            fprintf(f, "%s %d\n", obj->passos[i].params[p], (int)obj->passos[i].tipos[p]);
+        }
+    }
+
+    fprintf(f, "externos %d\n", obj->num_externos);
+    for (int i = 0; i < obj->num_externos; i++) {
+        fprintf(f, "%s\n", obj->externos[i]);
+    }
+
+    cache_write_fragment(f, obj->code);
+    return !ferror(f);
+}
+
+ObjectFile* object_read(FILE *f) {
+    ObjectFile *obj = (ObjectFile*)calloc(1, sizeof(ObjectFile));
+    char name[256];
+    int version, count;
+
+    int ok = fscanf(f, "AFO %d\nmodulo %255s\nfonte %llx\ninterface %llx\n",
+                    &version, name, &obj->source_key, &obj->interface_key) == 4 &&
+             version == OBJECT_FORMAT_VERSION;
+    if (ok) obj->modulo = strdup(name);
+
+    ok = ok && fscanf(f, "imports %d\n", &count) == 1 && count >= 0;
+    for (int i = 0; ok && i < count; i++) {
+        unsigned long long key;
+        ok = fscanf(f, "%llx ", &key) == 1;
+        char *caminho = ok ? read_text(f) : NULL;
+        ok = caminho != NULL;
+        if (ok) object_add_import(obj, caminho, key);
+        free(caminho);
+    }
+
+    ok = ok && fscanf(f, "passos %d\n", &count) == 1 && count >= 0;
+    for (int i = 0; ok && i < count; i++) {
+        int n;
+        ok = fscanf(f, "%255s %d\n", name, &n) == 2 && n >= 0;
+        if (!ok) break;
+        ObjectSymbol *sym = object_add_passo(obj, name, n);
+        for (int p = 0; ok && p < n; p++) {
+            int tipo;
+            ok = fscanf(f, "%255s %d\n", name, &tipo) == 2;
+            if (ok) {
+                sym->params[p] = strdup(name);
+                sym->tipos[p] = (DataType)tipo;
+                sym->num_params++;
+            }
+        }
+    }
+
+    ok = ok && fscanf(f, "externos %d\n", &count) == 1 && count >= 0;
+    for (int i = 0; ok && i < count; i++) {
+        ok = fscanf(f, "%255s\n", name) == 1;
+        if (ok) object_add_externo(obj, name);
+    }
+
+    if (ok) {
+        obj->code = cache_read_fragment(f);
+        ok = obj->code != NULL;
+    }
+
+    /* Conferir a interface gravada com a recalculada */
+    if (ok && object_interface_key(obj) != obj->interface_key) ok = 0;
+
+    if (!ok) {
+        object_free(obj);
+        return NULL;
+    }
+    return obj;
+}
+
+ObjectFile* object_load(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    ObjectFile *obj = object_read(f);
+    fclose(f);
+    return obj;
+}
+
+int object_save(const ObjectFile *obj, const char *path) {
+    char *tmp_path;
+    if (asprintf(&tmp_path, "%s.tmp-XXXXXX", path) < 0) return 0;
+
+    int fd = mkstemp(tmp_path);
+    FILE *f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!f) {
+        if (fd >= 0) close(fd);
+        free(tmp_path);
+        return 0;
+    }
+
+    int ok = object_write(f, obj);
+    ok = fclose(f) == 0 && ok && rename(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+
+    free(tmp_path);
+    return ok;
+}
+
+/* ===== LIGACAO ===== */
+
+/* Modulo que exporta o passo nome (NULL se nenhum) */
+static const ObjectFile* find_definition(ObjectFile **objs, int num_objs, const char *nome) {
+    for (int i = 0; i < num_objs; i++) {
+        for (int p = 0; p < objs[i]->num_passos; p++) {
+            if (strcmp(objs[i]->passos[p].nome, nome) == 0) return objs[i];
+        }
+    }
+    return NULL;
+}
+
+/* Conferir os simbolos globais antes de gerar qualquer saida */
+static int check_symbols(ObjectFile **objs, int num_objs, FILE *diag) {
+    int ok = 1;
+
+    for (int i = 0; i < num_objs; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(objs[i]->modulo, objs[j]->modulo) == 0) {
+                fprintf(diag, "Erro: dois modulos com o nome '%s'\n", objs[i]->modulo);
+                ok = 0;
+            }
+        }
+
+        /* Labels "passo_<nome>" sao globais no programa ligado */
+        for (int p = 0; p < objs[i]->num_passos; p++) {
+            const ObjectFile *def = find_definition(objs, i, objs[i]->passos[p].nome);
+            if (def) {
+                fprintf(diag, "Erro: passo '%s' definido nos modulos '%s' e '%s'\n",
+                        objs[i]->passos[p].nome, def->modulo, objs[i]->modulo);
+                ok = 0;
+            }
+        }
+
+        for (int e = 0; e < objs[i]->num_externos; e++) {
+            if (!find_definition(objs, num_objs, objs[i]->externos[e])) {
+                fprintf(diag, "Erro: passo '%s', chamado em '%s', nao e exportado por nenhum modulo ligado\n",
+                        objs[i]->externos[e], objs[i]->modulo);
+                ok = 0;
+            }
+        }
+    }
+    return ok;
+}
+
+int link_program(ObjectFile **objs, int num_objs, FILE *output, FILE *diag,
+                 LinkStats *stats) {
+    char label[128];
+    stats->modules = num_objs;
+    stats->strings = 0;
+    stats->merged = 0;
+    if (num_objs == 0 || !check_symbols(objs, num_objs, diag)) return 0;
+
+    CodeGenerator *gen = codegen_create(output);
+    gen->diag = diag;
+    ObjectFile *entry = objs[num_objs - 1];
+
+    codegen_program_header(gen, entry->modulo);
+
+    /* String table unica: textos iguais em modulos diferentes viram um id */
+    int total = 0;
+    for (int i = 0; i < num_objs; i++) {
+        for (int s = 0; s < objs[i]->code->num_strings; s++) {
+            codegen_add_string(gen, objs[i]->code->strings[s]);
+            total++;
+        }
+    }
+    stats->strings = gen->num_strings;
+    stats->merged = total - gen->num_strings;
+    codegen_emit_string_table(gen);
+
+    /* Cada modulo e inicializado uma vez, dependencias antes */
+    codegen_comment(gen, "Inicializacao dos modulos e programa principal");
+    for (int i = 0; i < num_objs; i++) {
+        snprintf(label, sizeof(label), "modulo_%s", objs[i]->modulo);
+        codegen_emit2(gen, "CALL", label, "0");
+    }
+    codegen_emit(gen, "HALT");
+
+    /* Variaveis do programa principal mantem o proprio nome */
+    int ok = 1;
+    for (int i = 0; i < num_objs; i++) {
+        fprintf(output, "\n");
+        if (!codegen_link_module(gen, objs[i]->code, objs[i] == entry ? NULL : objs[i]->modulo)) {
+            ok = 0;
+        }
+    }
+
+    codegen_free(gen);
+    return ok;
+}
@@ -0,0 +1,115 @@
+/*
+ * link.h
+ * Objetos de modulo e ligador
+ *
+ * Um arquivo importado com 'importar "x.afs";' e compilado uma vez para
+ * um objeto (x.afo, ao lado do fonte) e reaproveitado enquanto o fonte,
+ * o compilador e a interface dos modulos que ele importa nao mudarem.
+ * O objeto guarda:
+ * - os passos com parametros exportados (nome e tipos dos parametros);
+ * - os passos importados que o codigo chama (referencias externas);
+ * - os modulos importados e a interface que cada um tinha na compilacao;
+ * - o codigo como fragmento relocavel (ver codegen_module): labels "_@N",
+ *   strings "$N", registradores "%N" e enderecos de vetores "&N".
+ *
+ * O codigo comeca no simbolo "modulo_<nome>", que roda as receitas e os
+ * comandos do nivel do programa e retorna; os passos exportados usam o
+ * simbolo global "passo_<nome>". O ligador chama a inicializacao de cada
+ * modulo uma vez, dependencias antes, e depois o programa principal.
+ * Ao ligar, as string tables sao mescladas sem repeticao, os labels
+ * locais renumerados, as variaveis de cada modulo recebem registradores
+ * proprios (nome qualificado "Modulo.var") e os vetores um segmento
+ * proprio. Chamadas entre modulos sao verificadas contra os passos
+ * exportados antes de gerar a saida.
+ */
+
+#ifndef LINK_H
+#define LINK_H
+
+#include "ast.h"
+#include "codegen.h"
+#include <stdio.h>
+
+/* Extensao dos objetos de modulo */
+#define OBJECT_EXT ".afo"
+
+/* Passo exportado por um modulo */
+typedef struct ObjectSymbol {
+    char *nome;
+    char **params;             /* Nomes dos parametros */
+    DataType *tipos;           /* Tipos dos parametros */
+    int num_params;
+} ObjectSymbol;
+
+/* Objeto de um modulo compilado */
+typedef struct ObjectFile {
+    char *modulo;                     /* Nome do programa do modulo */
+    unsigned long long source_key;    /* Fonte + compilador (validade do objeto) */
+    unsigned long long interface_key; /* Nome e passos exportados */
+
+    /* Modulos importados, como escritos no fonte */
+    struct {
+        char *caminho;
+        unsigned long long interface_key;  /* Interface usada na compilacao */
+    } *imports;
+    int num_imports;
+    int imports_capacity;
+
+    ObjectSymbol *passos;             /* Passos exportados */
+    int num_passos;
+    int passos_capacity;
+
+    char **externos;                  /* Passos importados chamados pelo codigo */
+    int num_externos;
+    int externos_capacity;
+
+    CodeFragment *code;               /* Codigo relocavel */
+} ObjectFile;
+
+/* Resultado de uma ligacao */
+typedef struct LinkStats {
+    int modules;                      /* Objetos ligados (inclui o programa) */
+    int strings;                      /* Strings na tabela final */
+    int merged;                       /* Strings repetidas entre objetos */
+} LinkStats;
+
+/* Hash de um codigo-fonte combinado ao hash do compilador */
+unsigned long long object_source_key(const char *data, size_t size);
+
+/* Criar o objeto de um programa ja gerado com codegen_module */
+/* Exporta os passos com parametros definidos no programa e registra os */
+/* importados que foram chamados; o objeto assume a posse de code */
+ObjectFile* object_create(ASTNode *programa, CodeFragment *code);
+
+/* Registrar um modulo importado e a interface com que foi compilado */
+void object_add_import(ObjectFile *obj, const char *caminho, unsigned long long interface_key);
+
+/* Declarar em programa os passos exportados por obj (sem corpo), para a */
+/* analise semantica e a geracao das chamadas; line e a do 'importar' */
+void object_declare_exports(const ObjectFile *obj, ASTNode *programa, int line);
+
+/* Gravar o objeto em f */
+/* Retorna 1 se sucesso, 0 se erro */
+int object_write(FILE *f, const ObjectFile *obj);
+
+/* Ler um objeto de f; NULL se o conteudo for invalido */
+ObjectFile* object_read(FILE *f);
+
+/* Carregar o objeto de path; NULL se ausente ou invalido */
+ObjectFile* object_load(const char *path);
+
+/* Gravar o objeto em path de forma atomica (temporario + rename) */
+/* Retorna 1 se sucesso, 0 se erro */
+int object_save(const ObjectFile *obj, const char *path);
+
+/* Liberar um objeto */
+void object_free(ObjectFile *obj);
+
+/* Ligar os objetos em um programa executavel, escrito em output */
+/* objs esta em ordem de inicializacao e o ultimo e o programa principal */
+/* Erros (simbolos repetidos ou nao definidos, falta de registradores) */
+/* vao para diag. Retorna 1 se sucesso, 0 se erro */
+int link_program(ObjectFile **objs, int num_objs, FILE *output, FILE *diag,
+                 LinkStats *stats);
+
+#endif /* LINK_H */
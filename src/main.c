@@ -0,0 +1,188 @@
+/*
+ * main.c
+ * Ponto de entrada do compilador (airfryer_parser)
+ *
+ * Os modos -server, -client e -batch usam server.h e batch.h; um arquivo
+ * unico e compilado pela libairfryer: direto para a saida ou, com -run,
+ * para um programa em memoria executado na VM nativa.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libairfryer.h"
+#include "codegen.h"
+#include "batch.h"
+#include "server.h"
+
+_Static_assert(AFS_TARGET_AIRFRYER == TARGET_AIRFRYER && AFS_TARGET_X86_64 == TARGET_X86_64,
+               "AFS_TARGET_* deve seguir CodegenTarget");
+
+/* Compilar um arquivo; com run = 1, executar na VM nativa em vez de */
+/* gravar o assembly (mesma saida de vm/native/main.c) */
+/* Retorna 1 se sucesso, 0 se erro */
+static int compile_single(const char *path, const AfsOptions *opts,
+                          const char *output_path, int run) {
+    /* Sem -run o assembly vai direto para a saida, sem passar pela memoria */
+    if (!run) return afs_compile_to(path, output_path, opts, stderr);
+
+    char *diag = NULL;
+    AfsProgram *prog = afs_compile_file(path, opts, &diag);
+    fputs(diag, stderr);
+    free(diag);
+    if (!prog) return 0;
+
+    AfsVM *vm = afs_vm_create(prog, NULL);
+    if (!vm) {
+        fprintf(stderr, "Erro: -run requer o codigo da AirFryerVM ligado (sem -c nem -target)\n");
+        afs_program_free(prog);
+        return 0;
+    }
+    printf("=== EXECUTANDO ===\n\n");
+    fflush(stdout);
+    int ok = afs_vm_run(vm);
+    if (ok) {
+        printf("\n\n=== ESTADO FINAL ===\n");
+        fflush(stdout);
+        afs_vm_print_state(vm);
+    } else {
+        printf("\nERRO: %s\n", afs_vm_error(vm));
+    }
+    afs_vm_destroy(vm);
+
+    afs_program_free(prog);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    /* Verificar argumentos */
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s <arquivo.afs> [-o <saida.mwasm>] [-debug] [-cache <dir>] [-time-report] [-mem-stats] [-peval] [-peval-fuel <n>] [-stream] [-target <airfryer|x86-64>]\n", argv[0]);
+        fprintf(stderr, "     %s <arquivo.afs> -run [-debug] [-cache <dir>] [-time-report] [-mem-stats] [-peval] [-peval-fuel <n>] [-stream]\n", argv[0]);
+        fprintf(stderr, "     %s <modulo.afs> -c [-o <modulo.afo>] [-debug] [-time-report] [-mem-stats] [-peval]\n", argv[0]);
+        fprintf(stderr, "     %s -batch [-j <n>] [-outdir <dir>] [-cache <dir>] [-time-report] [-mem-stats] [-peval] [-stream] <arquivo.afs|diretorio|@lista>...\n", argv[0]);
+        fprintf(stderr, "     %s -server <socket> [-cache <dir>] [-time-report] [-mem-stats] [-peval] [-stream] [-v]\n", argv[0]);
+        fprintf(stderr, "     %s -client <socket> (<arquivo.afs> [-o <saida.mwasm>] [-time-report] [-mem-stats] [-peval] [-peval-fuel <n>] [-stream] [-c] [-target <airfryer|x86-64>] | -stop)\n", argv[0]);
+        return 1;
+    }
+
+    /* Modo servidor: compilador residente atendendo em um socket Unix */
+    if (strcmp(argv[1], "-server") == 0 && argc >= 3) {
+        ServerOptions server;
+        server_options_init(&server);
+        server.socket_path = argv[2];
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc) {
+                server.compile.cache_dir = argv[++i];
+            } else if (strcmp(argv[i], "-time-report") == 0) {
+                server.compile.time_report = 1;
+            } else if (strcmp(argv[i], "-mem-stats") == 0) {
+                server.compile.mem_stats = 1;
+            } else if (strcmp(argv[i], "-peval") == 0) {
+                server.compile.peval = 1;
+            } else if (strcmp(argv[i], "-stream") == 0) {
+                server.compile.stream = 1;
+            } else if (strcmp(argv[i], "-v") == 0) {
+                server.verbose = 1;
+            }
+        }
+        return server_run(&server) ? 0 : 1;
+    }
+
+    /* Cliente do modo servidor */
+    if (strcmp(argv[1], "-client") == 0 && argc >= 4) {
+        if (strcmp(argv[3], "-stop") == 0) {
+            return server_client_shutdown(argv[2], stderr) ? 0 : 1;
+        }
+        /* Demais opcoes seguem para o servidor, que as valida */
+        const char *output_path = NULL;
+        char **options = malloc(argc * sizeof(char*));
+        int num_options = 0;
+        for (int i = 4; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                output_path = argv[++i];
+            } else {
+                options[num_options++] = argv[i];
+            }
+        }
+        int ok = server_client_compile(argv[2], argv[3], options, num_options,
+                                       output_path, stderr);
+        free(options);
+        return ok ? 0 : 1;
+    }
+
+    /* Modo batch: varios arquivos compilados em paralelo */
+    if (strcmp(argv[1], "-batch") == 0) {
+        BatchOptions batch;
+        batch_options_init(&batch);
+        int first_input = argc;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                batch.jobs = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-outdir") == 0 && i + 1 < argc) {
+                batch.outdir = argv[++i];
+            } else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc) {
+                batch.compile.cache_dir = argv[++i];
+            } else if (strcmp(argv[i], "-time-report") == 0) {
+                batch.compile.time_report = 1;
+            } else if (strcmp(argv[i], "-mem-stats") == 0) {
+                batch.compile.mem_stats = 1;
+            } else if (strcmp(argv[i], "-peval") == 0) {
+                batch.compile.peval = 1;
+            } else if (strcmp(argv[i], "-stream") == 0) {
+                batch.compile.stream = 1;
+            } else if (strcmp(argv[i], "-v") == 0) {
+                batch.verbose = 1;
+            } else {
+                first_input = i;
+                break;
+            }
+        }
+        if (first_input >= argc) {
+            fprintf(stderr, "Erro: nenhuma entrada para o modo batch\n");
+            return 1;
+        }
+        return batch_compile(&argv[first_input], argc - first_input, &batch) ? 0 : 1;
+    }
+
+    /* Verificar opcoes */
+    AfsOptions opts;
+    afs_options_init(&opts);
+    opts.name = argv[1];
+    opts.quiet = 0;
+    const char *output_path = NULL;
+    int run = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-debug") == 0) {
+            opts.debug = 1;
+        } else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc) {
+            opts.cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "-time-report") == 0) {
+            opts.time_report = 1;
+        } else if (strcmp(argv[i], "-mem-stats") == 0) {
+            opts.mem_stats = 1;
+        } else if (strcmp(argv[i], "-peval") == 0) {
+            opts.peval = 1;
+        } else if (strcmp(argv[i], "-peval-fuel") == 0 && i + 1 < argc) {
+            opts.peval = 1;
+            opts.peval_fuel = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-stream") == 0) {
+            opts.stream = 1;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            opts.module = 1;
+        } else if (strcmp(argv[i], "-run") == 0) {
+            run = 1;
+        } else if (strcmp(argv[i], "-target") == 0 && i + 1 < argc) {
+            CodegenTarget target;
+            if (!codegen_parse_target(argv[++i], &target)) {
+                fprintf(stderr, "Erro: arquitetura desconhecida '%s' (use airfryer ou x86-64)\n", argv[i]);
+                return 1;
+            }
+            opts.target = target;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        }
+    }
+
+    return compile_single(argv[1], &opts, output_path, run) ? 0 : 1;
+}
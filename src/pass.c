@@ -0,0 +1,186 @@
+/*
+ * pass.c
+ * Implementacao do gerenciador de passos
+ */
+
+#include "pass.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define INITIAL_CAPACITY 16
+
+/* ===== REGISTRO ===== */
+
+PassManager* pass_manager_create(int report) {
+    PassManager *pm = (PassManager*)calloc(1, sizeof(PassManager));
+    pm->report = report;
+    return pm;
+}
+
+static int pass_registered(PassManager *pm, const char *name) {
+    for (int i = 0; i < pm->num_passes; i++) {
+        if (strcmp(pm->passes[i]->name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+int pass_manager_add(PassManager *pm, const Pass *pass, FILE *diag) {
+    for (int d = 0; d < PASS_MAX_DEPS && pass->requires[d]; d++) {
+        if (!pass_registered(pm, pass->requires[d])) {
+            fprintf(diag, "Erro interno: passo '%s' requer '%s', que nao foi registrado antes\n",
+                    pass->name, pass->requires[d]);
+            return 0;
+        }
+    }
+
+    if (pm->num_passes >= pm->capacity) {
+        pm->capacity = pm->capacity ? pm->capacity * 2 : INITIAL_CAPACITY;
+        pm->passes = realloc(pm->passes, pm->capacity * sizeof(Pass*));
+    }
+    pm->passes[pm->num_passes++] = pass;
+    return 1;
+}
+
+/* ===== MEDICAO ===== */
+
+typedef struct Measure {
+    struct timespec start;
+    AllocStats allocs;
+} Measure;
+
+static void measure_begin(PassManager *pm, Measure *m) {
+    if (!pm->report) return;
+    alloc_stats_get(&m->allocs);
+    clock_gettime(CLOCK_MONOTONIC, &m->start);
+}
+
+static void measure_end(PassManager *pm, Measure *m, const char *name, PassKind kind) {
+    if (!pm->report) return;
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    AllocStats allocs;
+    alloc_stats_get(&allocs);
+
+    if (pm->num_timings >= pm->timings_capacity) {
+        pm->timings_capacity = pm->timings_capacity ? pm->timings_capacity * 2 : INITIAL_CAPACITY;
+        pm->timings = realloc(pm->timings, pm->timings_capacity * sizeof(PassTiming));
+    }
+    PassTiming *t = &pm->timings[pm->num_timings++];
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->kind = kind;
+    t->ms = (end.tv_sec - m->start.tv_sec) * 1e3 + (end.tv_nsec - m->start.tv_nsec) / 1e6;
+    t->allocations = allocs.allocations - m->allocs.allocations;
+    t->nodes = ast_live_nodes();
+}
+
+/* ===== VISITANTES FUNDIDOS ===== */
+
+typedef struct FusedWalk {
+    PassContext *ctx;
+    const Pass *group[PASS_MAX_FUSED];
+    int count;
+} FusedWalk;
+
+typedef struct FusedStep {
+    FusedWalk *walk;
+    unsigned mask;     /* Bit k ligado: group[k] ainda visita esta subarvore */
+} FusedStep;
+
+static void fused_visit(ASTNode *node, void *data) {
+    FusedStep *step = (FusedStep*)data;
+    FusedWalk *walk = step->walk;
+
+    FusedStep child = { walk, 0 };
+    for (int k = 0; k < walk->count; k++) {
+        if ((step->mask & (1u << k)) && walk->group[k]->visit(walk->ctx, node)) {
+            child.mask |= 1u << k;
+        }
+    }
+    if (child.mask) ast_for_each_child(node, fused_visit, &child);
+}
+
+/* O passo depende de algum passo ja presente no grupo? */
+static int depends_on_group(const Pass *pass, const FusedWalk *walk) {
+    for (int d = 0; d < PASS_MAX_DEPS && pass->requires[d]; d++) {
+        for (int k = 0; k < walk->count; k++) {
+            if (strcmp(pass->requires[d], walk->group[k]->name) == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+/* ===== EXECUCAO ===== */
+
+int pass_manager_run(PassManager *pm, PassContext *ctx) {
+    int i = 0;
+    while (i < pm->num_passes) {
+        const Pass *pass = pm->passes[i];
+        Measure m;
+
+        if (pass->run) {
+            measure_begin(pm, &m);
+            int ok = pass->run(ctx);
+            measure_end(pm, &m, pass->name, pass->kind);
+            if (!ok) return 0;
+            i++;
+            continue;
+        }
+
+        /* Agrupar visitantes consecutivos que nao dependem uns dos outros */
+        FusedWalk walk;
+        walk.ctx = ctx;
+        walk.count = 0;
+        char name[128] = "";
+        PassKind kind = PASS_ANALYSIS;
+        while (i < pm->num_passes && pm->passes[i]->visit && walk.count < PASS_MAX_FUSED &&
+               !depends_on_group(pm->passes[i], &walk)) {
+            if (walk.count > 0) strncat(name, "+", sizeof(name) - strlen(name) - 1);
+            strncat(name, pm->passes[i]->name, sizeof(name) - strlen(name) - 1);
+            if (pm->passes[i]->kind != PASS_ANALYSIS) kind = pm->passes[i]->kind;
+            walk.group[walk.count++] = pm->passes[i++];
+        }
+
+        measure_begin(pm, &m);
+        if (ctx->root) {
+            FusedStep root = { &walk, (1u << walk.count) - 1 };
+            fused_visit(ctx->root, &root);
+        }
+        measure_end(pm, &m, name, kind);
+    }
+    return 1;
+}
+
+static const char* kind_name(PassKind kind) {
+    switch (kind) {
+        case PASS_ANALYSIS: return "analise";
+        case PASS_TRANSFORM: return "transformacao";
+        case PASS_EMIT: return "emissao";
+    }
+    return "?";
+}
+
+void pass_manager_report(PassManager *pm, const char *name, FILE *out) {
+    double total_ms = 0;
+    long total_allocs = 0;
+
+    fprintf(out, "\n=== Relatorio de tempo: %s ===\n", name);
+    fprintf(out, "%-24s %-14s %12s %12s %10s\n", "Passo", "Tipo", "Tempo (ms)", "Alocacoes", "Nos");
+    for (int i = 0; i < pm->num_timings; i++) {
+        PassTiming *t = &pm->timings[i];
+        fprintf(out, "%-24s %-14s %12.3f %12ld %10ld\n", t->name, kind_name(t->kind),
+                t->ms, t->allocations, t->nodes);
+        total_ms += t->ms;
+        total_allocs += t->allocations;
+    }
+    fprintf(out, "%-24s %-14s %12.3f %12ld\n", "Total", "", total_ms, total_allocs);
+}
+
+void pass_manager_free(PassManager *pm) {
+    if (!pm) return;
+    free(pm->passes);
+    free(pm->timings);
+    free(pm);
+}
@@ -0,0 +1,111 @@
+/*
+ * pass.h
+ * Gerenciador de passos do compilador
+ *
+ * O pipeline (parsing, analises, transformacoes e geracao de codigo) e
+ * descrito como uma lista de passos registrados em ordem. Cada passo
+ * declara de quais outros depende; o gerenciador valida a ordem no
+ * registro e executa os passos em sequencia.
+ *
+ * Passos podem ser escritos como um percurso proprio (run) ou como um
+ * visitante de no (visit). Visitantes consecutivos e independentes entre
+ * si sao fundidos em um unico percurso da AST, em pre-ordem (ex.: a
+ * coleta de strings e a de passos chamados, "strings+calls").
+ *
+ * Com report ligado, cada unidade executada (um passo ou um grupo
+ * fundido) registra tempo de parede, alocacoes (ver alloc.h) e numero de
+ * nos da AST vivos ao final.
+ */
+
+#ifndef PASS_H
+#define PASS_H
+
+#include "ast.h"
+#include "codegen.h"
+#include "driver.h"
+#include <stdio.h>
+
+struct RecipeCache;
+struct ModuleSet;
+struct ObjectFile;
+
+#define PASS_MAX_DEPS 4
+#define PASS_MAX_FUSED 8
+
+/* Estado compartilhado entre os passos de uma compilacao */
+typedef struct PassContext {
+    SourceBuffer *src;             /* Codigo-fonte */
+    const char *name;              /* Nome do arquivo (mensagens) */
+    FILE *output;                  /* Destino do assembly */
+    const CompileOptions *opts;
+    FILE *diag;                    /* Destino dos diagnosticos */
+
+    ASTNode *root;                 /* AST (preenchida pelo parsing) */
+    CodeGenerator *codegen;        /* Gerador (criado antes dos passos) */
+    struct RecipeCache *cache;     /* Cache de receitas (NULL = desligado) */
+
+    struct ModuleSet *modules;     /* Modulos importados (compartilhado com as */
+                                   /* compilacoes aninhadas dos modulos) */
+    int module;                    /* 1 para gerar objeto de modulo em vez de programa */
+    struct ObjectFile *object;     /* Objeto gerado quando module = 1 */
+} PassContext;
+
+/* Tipo do passo (informativo no relatorio) */
+typedef enum {
+    PASS_ANALYSIS,     /* So le a AST */
+    PASS_TRANSFORM,    /* Pode alterar a AST */
+    PASS_EMIT          /* Produz a saida */
+} PassKind;
+
+/* Descricao de um passo */
+typedef struct Pass {
+    const char *name;
+    PassKind kind;
+    const char *requires[PASS_MAX_DEPS];   /* Nomes de passos anteriores (NULL = fim) */
+
+    /* Exatamente um dos dois deve ser preenchido */
+    /* Retorna 1 se sucesso, 0 se erro (interrompe o pipeline) */
+    int (*run)(PassContext *ctx);
+    /* Retorna 1 se os filhos do no devem ser visitados por este passo */
+    int (*visit)(PassContext *ctx, ASTNode *node);
+} Pass;
+
+/* Medicao de uma unidade executada */
+typedef struct PassTiming {
+    char name[128];                /* Passo ou grupo fundido ("a+b") */
+    PassKind kind;
+    double ms;
+    long allocations;
+    long nodes;                    /* Nos vivos ao final */
+} PassTiming;
+
+/* Lista de passos de uma compilacao */
+typedef struct PassManager {
+    const Pass **passes;
+    int num_passes;
+    int capacity;
+
+    int report;                    /* 1 para medir cada unidade */
+    PassTiming *timings;
+    int num_timings;
+    int timings_capacity;
+} PassManager;
+
+/* Criar um gerenciador vazio */
+PassManager* pass_manager_create(int report);
+
+/* Registrar um passo ao final do pipeline */
+/* Retorna 0 (e escreve em diag) se alguma dependencia nao foi registrada antes */
+int pass_manager_add(PassManager *pm, const Pass *pass, FILE *diag);
+
+/* Executar todos os passos em ordem, parando no primeiro erro */
+/* Retorna 1 se sucesso, 0 se erro */
+int pass_manager_run(PassManager *pm, PassContext *ctx);
+
+/* Imprimir o relatorio de tempos em out */
+void pass_manager_report(PassManager *pm, const char *name, FILE *out);
+
+/* Liberar o gerenciador (os passos sao estaticos e nao sao liberados) */
+void pass_manager_free(PassManager *pm);
+
+#endif /* PASS_H */
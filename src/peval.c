@@ -0,0 +1,1002 @@
+/*
+ * peval.c
+ * Implementacao da avaliacao parcial em tempo de compilacao
+ *
+ * O programa e percorrido na ordem de execucao (itens do programa,
+ * receitas e passos sem parametros em sequencia). Cada comando dessa
+ * espinha e executado pelo interpretador; se termina com sucesso, entra
+ * na regiao atual, senao a regiao e descarregada (substituida pelo seu
+ * residuo) e o comando e mantido. Comandos consecutivos avaliados formam
+ * uma unica regiao, com um unico residuo.
+ *
+ * As variaveis sao identificadas pelo nome, como no codegen (um
+ * registrador por nome). O residuo preserva a ordem de alocacao dos
+ * registradores: declaracoes da regiao viram declaracoes com o valor
+ * final, na mesma ordem do codigo.
+ */
+
+#include "peval.h"
+#include "semantic.h"
+#include "codegen.h"
+#include "alloc.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 16
+
+/* Profundidade maxima de chamadas de passo durante a avaliacao */
+#define PEVAL_MAX_DEPTH 64
+
+/* Valor de uma variavel ou expressao */
+typedef struct {
+    DataType type;
+    long long i;        /* inteiro e bool */
+    double f;           /* frac */
+} PeValue;
+
+/* Variavel (um registrador por nome) */
+typedef struct {
+    char *name;
+    DataType type;      /* Tipo declarado (unico por nome) */
+    PeValue value;
+    int known;          /* 1 se o valor e conhecido neste ponto */
+    int allocated;      /* 1 se o codegen ja alocou o registrador */
+    int written;        /* 1 se escrita pela regiao atual */
+    int site;           /* 1 se declarada por um comando da regiao atual */
+} PeVar;
+
+/* Estado do avaliador */
+typedef struct {
+    ASTNode *program;
+    PevalStats *stats;
+
+    PeVar *vars;
+    int num_vars;
+    int vars_capacity;
+
+    /* Passo em execucao e seus parametros (NULL = nivel do programa) */
+    ASTNode *passo;
+    PeValue params[MAX_STEP_PARAMS];
+    int depth;
+
+    long fuel_limit;
+    long fuel;
+
+    /* Regiao atual: comandos avaliados e seus efeitos residuais */
+    ASTNode **stmts;
+    int num_stmts;
+    int stmts_capacity;
+    ASTNode **effects;
+    int num_effects;
+    int effects_capacity;
+    int units;          /* Pedacos de imprimir e comandos, limitado a PEVAL_MAX_EFFECTS */
+
+    /* Comandos substituidos, liberados so no fim (os itens do programa */
+    /* continuam sendo consultados por ast_find_passo durante o percurso) */
+    ASTNode **dead;
+    int num_dead;
+    int dead_capacity;
+} Peval;
+
+/* Lista de nos em construcao (residuo de um bloco) */
+typedef struct {
+    ASTNode **items;
+    int count;
+    int capacity;
+} PeList;
+
+static void pe_list_add(PeList *list, ASTNode *node) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : INITIAL_CAPACITY;
+        list->items = realloc(list->items, list->capacity * sizeof(ASTNode*));
+    }
+    list->items[list->count++] = node;
+}
+
+/* ===== VARIAVEIS ===== */
+
+static int pe_find_var(Peval *pe, const char *name) {
+    for (int i = 0; i < pe->num_vars; i++) {
+        if (strcmp(pe->vars[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Registrar o nome com seu tipo; retorna 0 se ja existe com outro tipo */
+static int pe_declare_var(Peval *pe, const char *name, DataType type) {
+    int v = pe_find_var(pe, name);
+    if (v >= 0) return pe->vars[v].type == type;
+
+    if (pe->num_vars >= pe->vars_capacity) {
+        pe->vars_capacity *= 2;
+        pe->vars = realloc(pe->vars, pe->vars_capacity * sizeof(PeVar));
+    }
+    PeVar *var = &pe->vars[pe->num_vars++];
+    var->name = strdup(name);
+    var->type = type;
+    var->value.type = type;
+    var->value.i = 0;
+    var->value.f = 0.0;
+    var->known = 0;
+    var->allocated = 0;
+    var->written = 0;
+    var->site = 0;
+    return 1;
+}
+
+/* Parametro do passo em execucao com o nome dado (-1 se nao e parametro) */
+static int pe_find_param(Peval *pe, const char *name) {
+    if (!pe->passo) return -1;
+    for (int i = 0; i < pe->passo->data.passo.num_params; i++) {
+        if (strcmp(pe->passo->data.passo.params[i]->data.declaracao.nome, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Coletar tipos de todas as variaveis escalares do programa */
+/* Retorna o motivo para nao avaliar o programa, ou NULL */
+static const char* pe_collect(Peval *pe, ASTNode *node) {
+    const char *reason = NULL;
+
+    switch (node->kind) {
+        case NODE_AGITAR:
+            /* PRINT mostra o registrador TIME, que depende do codigo gerado */
+            return "'agitar' imprime o registrador TIME";
+
+        case NODE_DECLARACAO:
+            if (node->data.declaracao.tamanho == 0 &&
+                !pe_declare_var(pe, node->data.declaracao.nome, node->data.declaracao.tipo)) {
+                return "variavel declarada com tipos diferentes";
+            }
+            break;
+
+        case NODE_PARA:
+            if (!pe_declare_var(pe, node->data.para.var, TYPE_INTEIRO)) {
+                return "variavel declarada com tipos diferentes";
+            }
+            break;
+
+        case NODE_PASSO:
+            /* Parametros vivem em A0-A3, fora do mapa de nomes */
+            /* Passos importados nao tem corpo nem variaveis deste programa */
+            return node->data.passo.externo ? NULL : pe_collect(pe, node->data.passo.bloco);
+
+        default:
+            break;
+    }
+
+    /* Percorrer filhos manualmente para propagar o motivo */
+    switch (node->kind) {
+        case NODE_PROGRAMA:
+            for (int i = 0; i < node->data.programa.num_items && !reason; i++) {
+                reason = pe_collect(pe, node->data.programa.top_level_items[i]);
+            }
+            break;
+        case NODE_RECEITA:
+            reason = pe_collect(pe, node->data.receita.bloco);
+            break;
+        case NODE_BLOCO:
+            for (int i = 0; i < node->data.bloco.num_statements && !reason; i++) {
+                reason = pe_collect(pe, node->data.bloco.statements[i]);
+            }
+            break;
+        case NODE_SE:
+            reason = pe_collect(pe, node->data.se.bloco_then);
+            if (!reason && node->data.se.bloco_else) {
+                reason = pe_collect(pe, node->data.se.bloco_else);
+            }
+            break;
+        case NODE_ENQUANTO:
+            reason = pe_collect(pe, node->data.enquanto.bloco);
+            break;
+        case NODE_PARA:
+            reason = pe_collect(pe, node->data.para.bloco);
+            break;
+        case NODE_QUANDO:
+            reason = pe_collect(pe, node->data.quando.bloco);
+            break;
+        case NODE_ESCOLHA:
+            for (int i = 0; i < node->data.escolha.num_casos && !reason; i++) {
+                reason = pe_collect(pe, node->data.escolha.casos[i]->data.caso.bloco);
+            }
+            if (!reason && node->data.escolha.padrao) {
+                reason = pe_collect(pe, node->data.escolha.padrao);
+            }
+            break;
+        default:
+            break;
+    }
+    return reason;
+}
+
+/* Esquecer o valor das variaveis que um comando mantido pode escrever */
+static void pe_forget(ASTNode *node, void *data) {
+    Peval *pe = (Peval*)data;
+    int v = -1;
+
+    switch (node->kind) {
+        case NODE_DECLARACAO:
+            v = pe_find_var(pe, node->data.declaracao.nome);
+            break;
+        case NODE_ATRIBUICAO:
+            v = pe_find_var(pe, node->data.atribuicao.nome);
+            break;
+        case NODE_PARA:
+            v = pe_find_var(pe, node->data.para.var);
+            break;
+        case NODE_CHAMADA:
+            /* O passo chamado pode escrever qualquer variavel */
+            for (int i = 0; i < pe->num_vars; i++) pe->vars[i].known = 0;
+            return;
+        default:
+            break;
+    }
+    if (v >= 0) pe->vars[v].known = 0;
+    ast_for_each_child(node, pe_forget, pe);
+}
+
+/* ===== VALORES ===== */
+
+static double pe_to_frac(PeValue v) {
+    return v.type == TYPE_FRAC ? v.f : (double)v.i;
+}
+
+static int pe_truthy(PeValue v) {
+    return v.type == TYPE_FRAC ? v.f != 0.0 : v.i != 0;
+}
+
+static PeValue pe_int(DataType type, long long i) {
+    PeValue v;
+    v.type = type;
+    v.i = i;
+    v.f = 0.0;
+    return v;
+}
+
+static PeValue pe_frac(double f) {
+    PeValue v;
+    v.type = TYPE_FRAC;
+    v.i = 0;
+    v.f = f;
+    return v;
+}
+
+/* Converter como ITOF/FTOI (FTOI trunca em direcao a zero) */
+/* Retorna 1 se sucesso, 0 se o valor nao cabe */
+static int pe_convert(PeValue v, DataType to, PeValue *out) {
+    if (to == TYPE_FRAC) {
+        *out = pe_frac(pe_to_frac(v));
+        return 1;
+    }
+    if (v.type == TYPE_FRAC) {
+        if (!(v.f > (double)LLONG_MIN && v.f < (double)LLONG_MAX)) return 0;
+        *out = pe_int(to, (long long)v.f);
+        return 1;
+    }
+    *out = pe_int(to, v.i);
+    return 1;
+}
+
+/* Literal com o valor dado; retorna NULL se nao cabe em um literal */
+static ASTNode* pe_literal(PeValue v) {
+    switch (v.type) {
+        case TYPE_FRAC:
+            return ast_create_literal_frac(v.f);
+        case TYPE_BOOL:
+            return ast_create_literal_bool(v.i != 0);
+        default:
+            if (v.i < INT_MIN || v.i > INT_MAX) return NULL;
+            return ast_create_literal_int((int)v.i);
+    }
+}
+
+/* ===== EXPRESSOES ===== */
+
+static int pe_expr(Peval *pe, ASTNode *node, PeValue *out);
+
+/* Operacao inteira com a semantica da VM (DIV e MOD arredondam para baixo) */
+static int pe_int_op(BinOpKind op, long long a, long long b, long long *out) {
+    switch (op) {
+        case OP_ADD: return !__builtin_add_overflow(a, b, out);
+        case OP_SUB: return !__builtin_sub_overflow(a, b, out);
+        case OP_MUL: return !__builtin_mul_overflow(a, b, out);
+        case OP_DIV:
+            if (b == 0 || (a == LLONG_MIN && b == -1)) return 0;
+            *out = a / b;
+            if (a % b != 0 && (a < 0) != (b < 0)) (*out)--;
+            return 1;
+        case OP_MOD:
+            if (b == 0 || (a == LLONG_MIN && b == -1)) return 0;
+            *out = a % b;
+            if (*out != 0 && (*out < 0) != (b < 0)) *out += b;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Operacao frac com a semantica da VM (MODF com o sinal do divisor) */
+static int pe_frac_op(BinOpKind op, double a, double b, double *out) {
+    switch (op) {
+        case OP_ADD: *out = a + b; break;
+        case OP_SUB: *out = a - b; break;
+        case OP_MUL: *out = a * b; break;
+        case OP_DIV:
+            if (b == 0.0) return 0;
+            *out = a / b;
+            break;
+        case OP_MOD:
+            if (b == 0.0) return 0;
+            *out = fmod(a, b);
+            if (*out != 0.0 && (*out < 0.0) != (b < 0.0)) {
+                *out += b;
+            } else if (*out == 0.0) {
+                *out = copysign(0.0, b);
+            }
+            break;
+        default:
+            return 0;
+    }
+    return isfinite(*out);
+}
+
+static int pe_binop(ASTNode *node, PeValue l, PeValue r, PeValue *out) {
+    BinOpKind op = node->data.binop.op;
+    int is_frac = node->data.binop.left->data_type == TYPE_FRAC ||
+                  node->data.binop.right->data_type == TYPE_FRAC;
+
+    switch (op) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+            if (is_frac) {
+                double f;
+                if (!pe_frac_op(op, pe_to_frac(l), pe_to_frac(r), &f)) return 0;
+                *out = pe_frac(f);
+            } else {
+                long long i;
+                if (!pe_int_op(op, l.i, r.i, &i)) return 0;
+                *out = pe_int(TYPE_INTEIRO, i);
+            }
+            return 1;
+
+        case OP_AND:
+            *out = pe_int(TYPE_BOOL, pe_truthy(l) && pe_truthy(r));
+            return 1;
+
+        case OP_OR:
+            *out = pe_int(TYPE_BOOL, pe_truthy(l) || pe_truthy(r));
+            return 1;
+
+        default:
+            break;
+    }
+
+    /* Comparacao: -1, 0 ou 1 */
+    int cmp;
+    if (l.type == TYPE_FRAC || r.type == TYPE_FRAC) {
+        double a = pe_to_frac(l), b = pe_to_frac(r);
+        cmp = a < b ? -1 : (a > b ? 1 : 0);
+    } else {
+        cmp = l.i < r.i ? -1 : (l.i > r.i ? 1 : 0);
+    }
+
+    int result = 0;
+    switch (op) {
+        case OP_EQ: result = cmp == 0; break;
+        case OP_NE: result = cmp != 0; break;
+        case OP_LT: result = cmp < 0; break;
+        case OP_LE: result = cmp <= 0; break;
+        case OP_GT: result = cmp > 0; break;
+        case OP_GE: result = cmp >= 0; break;
+        default: break;
+    }
+    *out = pe_int(TYPE_BOOL, result);
+    return 1;
+}
+
+/* Avaliar expressao; retorna 0 se depende de sensor, vetor ou valor desconhecido */
+static int pe_expr(Peval *pe, ASTNode *node, PeValue *out) {
+    switch (node->kind) {
+        case NODE_LITERAL_INT:
+            *out = pe_int(TYPE_INTEIRO, node->data.literal_int.value);
+            return 1;
+
+        case NODE_LITERAL_FRAC:
+            *out = pe_frac(node->data.literal_frac.value);
+            return 1;
+
+        case NODE_LITERAL_BOOL:
+            *out = pe_int(TYPE_BOOL, node->data.literal_bool.value);
+            return 1;
+
+        case NODE_VARIAVEL: {
+            int p = pe_find_param(pe, node->data.variavel.nome);
+            if (p >= 0) {
+                *out = pe->params[p];
+                return 1;
+            }
+            int v = pe_find_var(pe, node->data.variavel.nome);
+            if (v < 0 || !pe->vars[v].known) return 0;
+            *out = pe->vars[v].value;
+            return 1;
+        }
+
+        case NODE_BINOP: {
+            PeValue l, r;
+            return pe_expr(pe, node->data.binop.left, &l) &&
+                   pe_expr(pe, node->data.binop.right, &r) &&
+                   pe_binop(node, l, r, out);
+        }
+
+        case NODE_UNOP: {
+            PeValue v;
+            if (!pe_expr(pe, node->data.unop.operand, &v)) return 0;
+            if (node->data.unop.op == OP_NOT) {
+                *out = pe_int(TYPE_BOOL, !pe_truthy(v));
+            } else if (node->data_type == TYPE_FRAC) {
+                *out = pe_frac(0.0 - pe_to_frac(v));
+            } else {
+                long long i;
+                if (__builtin_sub_overflow(0LL, v.i, &i)) return 0;
+                *out = pe_int(TYPE_INTEIRO, i);
+            }
+            return 1;
+        }
+
+        default:
+            /* Sensores, vetores e textos */
+            return 0;
+    }
+}
+
+/* Avaliar expressao e converter para o tipo de destino */
+static int pe_expr_as(Peval *pe, ASTNode *node, DataType type, PeValue *out) {
+    PeValue v;
+    return pe_expr(pe, node, &v) && pe_convert(v, type, out);
+}
+
+/* ===== COMANDOS ===== */
+
+static int pe_stmt(Peval *pe, ASTNode *node);
+
+static int pe_block(Peval *pe, ASTNode *bloco) {
+    for (int i = 0; i < bloco->data.bloco.num_statements; i++) {
+        if (!pe_stmt(pe, bloco->data.bloco.statements[i])) return 0;
+    }
+    return 1;
+}
+
+/* Escrever variavel escalar (fora dos parametros) */
+static int pe_write(Peval *pe, const char *name, PeValue value) {
+    int v = pe_find_var(pe, name);
+    if (v < 0) return 0;
+    PeVar *var = &pe->vars[v];
+    if (!pe_convert(value, var->type, &var->value)) return 0;
+    var->known = 1;
+    var->written = 1;
+    return 1;
+}
+
+/* Acrescentar efeito residual (o no passa a pertencer a regiao) */
+static int pe_effect(Peval *pe, ASTNode *node) {
+    if (pe->units >= PEVAL_MAX_EFFECTS) {
+        ast_free(node);
+        return 0;
+    }
+    pe->units++;
+    if (pe->num_effects >= pe->effects_capacity) {
+        pe->effects_capacity *= 2;
+        pe->effects = realloc(pe->effects, pe->effects_capacity * sizeof(ASTNode*));
+    }
+    pe->effects[pe->num_effects++] = node;
+    return 1;
+}
+
+/* Acrescentar um pedaco de impressao, juntando com o imprimir anterior */
+static int pe_print(Peval *pe, ASTNode *piece) {
+    if (pe->num_effects > 0 && pe->effects[pe->num_effects - 1]->kind == NODE_IMPRIMIR) {
+        if (pe->units >= PEVAL_MAX_EFFECTS) {
+            ast_free(piece);
+            return 0;
+        }
+        pe->units++;
+        ast_imprimir_add_expr(pe->effects[pe->num_effects - 1], piece);
+        return 1;
+    }
+    ASTNode *imprimir = ast_create_imprimir(NULL, 0);
+    ast_imprimir_add_expr(imprimir, piece);
+    return pe_effect(pe, imprimir);
+}
+
+/* Argumento inteiro de comando da air fryer, como literal */
+static ASTNode* pe_command_arg(Peval *pe, ASTNode *expr) {
+    PeValue v;
+    if (!pe_expr_as(pe, expr, TYPE_INTEIRO, &v)) return NULL;
+    return pe_literal(v);
+}
+
+static int pe_para(Peval *pe, ASTNode *node) {
+    PeValue inicio, fim;
+    if (!pe_expr_as(pe, node->data.para.inicio, TYPE_INTEIRO, &inicio) ||
+        !pe_expr_as(pe, node->data.para.fim, TYPE_INTEIRO, &fim)) {
+        return 0;
+    }
+
+    /* Mesma contagem do codegen: distancia no sentido do passo */
+    long long passo = node->data.para.passo;
+    long long step = passo > 0 ? passo : -passo;
+    long long diff;
+    if (__builtin_sub_overflow(passo > 0 ? fim.i : inicio.i,
+                               passo > 0 ? inicio.i : fim.i, &diff)) {
+        return 0;
+    }
+    long long count = diff >= 0 ? diff / step + 1 : 0;
+
+    /* A variavel de controle so existe na VM se o corpo a le */
+    int reads = codegen_para_reads_var(node);
+    long long i = inicio.i;
+    if (count > 0 && reads && !pe_write(pe, node->data.para.var, inicio)) return 0;
+
+    for (long long k = 0; k < count; k++) {
+        if (--pe->fuel < 0) return 0;
+        if (!pe_block(pe, node->data.para.bloco)) return 0;
+        if (reads) {
+            if (__builtin_add_overflow(i, passo, &i)) return 0;
+            if (!pe_write(pe, node->data.para.var, pe_int(TYPE_INTEIRO, i))) return 0;
+        }
+    }
+    return 1;
+}
+
+static int pe_chamada(Peval *pe, ASTNode *node) {
+    ASTNode *passo = ast_find_passo(pe->program, node->data.chamada.nome);
+    /* O corpo de um passo importado so existe no objeto do modulo */
+    if (!passo || passo->data.passo.externo || pe->depth >= PEVAL_MAX_DEPTH) return 0;
+
+    /* Argumentos avaliados no passo de quem chama */
+    PeValue args[MAX_STEP_PARAMS];
+    for (int i = 0; i < node->data.chamada.num_args; i++) {
+        if (!pe_expr_as(pe, node->data.chamada.args[i],
+                        passo->data.passo.params[i]->data.declaracao.tipo, &args[i])) {
+            return 0;
+        }
+    }
+
+    ASTNode *saved_passo = pe->passo;
+    PeValue saved_params[MAX_STEP_PARAMS];
+    memcpy(saved_params, pe->params, sizeof(saved_params));
+
+    pe->passo = passo;
+    memcpy(pe->params, args, node->data.chamada.num_args * sizeof(PeValue));
+    pe->depth++;
+    int ok = pe_block(pe, passo->data.passo.bloco);
+    pe->depth--;
+    pe->passo = saved_passo;
+    memcpy(pe->params, saved_params, sizeof(saved_params));
+    return ok;
+}
+
+/* Executar comando; retorna 0 se nao pode ser resolvido em compilacao */
+static int pe_stmt(Peval *pe, ASTNode *node) {
+    if (--pe->fuel < 0) return 0;
+
+    switch (node->kind) {
+        case NODE_BLOCO:
+            return pe_block(pe, node);
+
+        case NODE_PASSO:
+            /* Passo com parametros so executa quando chamado */
+            return node->data.passo.subrotina || pe_block(pe, node->data.passo.bloco);
+
+        case NODE_DECLARACAO: {
+            if (node->data.declaracao.tamanho > 0) return 0;
+            PeValue v = pe_int(TYPE_INTEIRO, 0);
+            if (node->data.declaracao.init_expr &&
+                !pe_expr(pe, node->data.declaracao.init_expr, &v)) {
+                return 0;
+            }
+            return pe_write(pe, node->data.declaracao.nome, v);
+        }
+
+        case NODE_ATRIBUICAO: {
+            if (node->data.atribuicao.indice) return 0;
+            PeValue v;
+            if (!pe_expr(pe, node->data.atribuicao.expr, &v)) return 0;
+            int p = pe_find_param(pe, node->data.atribuicao.nome);
+            if (p >= 0) {
+                return pe_convert(v, pe->passo->data.passo.params[p]->data.declaracao.tipo,
+                                  &pe->params[p]);
+            }
+            return pe_write(pe, node->data.atribuicao.nome, v);
+        }
+
+        case NODE_PREAQUECER: {
+            ASTNode *temperatura = pe_command_arg(pe, node->data.preaquecer.temperatura);
+            return temperatura && pe_effect(pe, ast_create_preaquecer(temperatura));
+        }
+
+        case NODE_COZINHAR: {
+            ASTNode *temperatura = pe_command_arg(pe, node->data.cozinhar.temperatura);
+            if (!temperatura) return 0;
+            ASTNode *tempo = pe_command_arg(pe, node->data.cozinhar.tempo);
+            if (!tempo) {
+                ast_free(temperatura);
+                return 0;
+            }
+            return pe_effect(pe, ast_create_cozinhar(temperatura, tempo,
+                                                     node->data.cozinhar.unidade));
+        }
+
+        case NODE_AQUECER: {
+            ASTNode *tempo = pe_command_arg(pe, node->data.aquecer.tempo);
+            return tempo && pe_effect(pe, ast_create_aquecer(tempo, node->data.aquecer.unidade));
+        }
+
+        case NODE_SET_MODO:
+            return pe_effect(pe, ast_create_set_modo(node->data.set_modo.modo));
+
+        case NODE_PAUSAR:
+            return pe_effect(pe, ast_create_pausar());
+
+        case NODE_CONTINUAR:
+            return pe_effect(pe, ast_create_continuar());
+
+        case NODE_PARAR:
+            return pe_effect(pe, ast_create_parar());
+
+        case NODE_IMPRIMIR:
+            for (int i = 0; i < node->data.imprimir.num_exprs; i++) {
+                ASTNode *expr = node->data.imprimir.exprs[i];
+                ASTNode *piece;
+                if (expr->kind == NODE_LITERAL_STR) {
+                    piece = ast_create_literal_str(strdup(expr->data.literal_str.value));
+                } else {
+                    PeValue v;
+                    if (!pe_expr(pe, expr, &v)) return 0;
+                    piece = pe_literal(v);
+                    if (!piece) return 0;
+                }
+                if (!pe_print(pe, piece)) return 0;
+            }
+            return 1;
+
+        case NODE_SE: {
+            PeValue cond;
+            if (!pe_expr(pe, node->data.se.condicao, &cond)) return 0;
+            if (pe_truthy(cond)) return pe_block(pe, node->data.se.bloco_then);
+            return !node->data.se.bloco_else || pe_block(pe, node->data.se.bloco_else);
+        }
+
+        case NODE_ESCOLHA: {
+            PeValue sel;
+            if (!pe_expr(pe, node->data.escolha.expr, &sel)) return 0;
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                ASTNode *caso = node->data.escolha.casos[i];
+                if (caso->data.caso.valor == sel.i) return pe_block(pe, caso->data.caso.bloco);
+            }
+            return !node->data.escolha.padrao || pe_block(pe, node->data.escolha.padrao);
+        }
+
+        case NODE_ENQUANTO:
+            for (;;) {
+                PeValue cond;
+                if (--pe->fuel < 0) return 0;
+                if (!pe_expr(pe, node->data.enquanto.condicao, &cond)) return 0;
+                if (!pe_truthy(cond)) return 1;
+                if (!pe_block(pe, node->data.enquanto.bloco)) return 0;
+            }
+
+        case NODE_PARA:
+            return pe_para(pe, node);
+
+        case NODE_CHAMADA:
+            return pe_chamada(pe, node);
+
+        default:
+            /* quando, agitar */
+            return 0;
+    }
+}
+
+/* ===== REGIOES ===== */
+
+/* Estado salvo antes de tentar um comando */
+typedef struct {
+    PeVar *vars;
+    int num_effects;
+    int units;
+    int last_exprs;     /* Pedacos do ultimo imprimir (-1 se nao ha) */
+} PeSnapshot;
+
+static void pe_save(Peval *pe, PeSnapshot *snap) {
+    snap->vars = malloc(pe->num_vars * sizeof(PeVar) + 1);
+    memcpy(snap->vars, pe->vars, pe->num_vars * sizeof(PeVar));
+    snap->num_effects = pe->num_effects;
+    snap->units = pe->units;
+    snap->last_exprs = -1;
+    if (pe->num_effects > 0 && pe->effects[pe->num_effects - 1]->kind == NODE_IMPRIMIR) {
+        snap->last_exprs = pe->effects[pe->num_effects - 1]->data.imprimir.num_exprs;
+    }
+}
+
+static void pe_restore(Peval *pe, PeSnapshot *snap) {
+    memcpy(pe->vars, snap->vars, pe->num_vars * sizeof(PeVar));
+    while (pe->num_effects > snap->num_effects) {
+        ast_free(pe->effects[--pe->num_effects]);
+    }
+    if (snap->last_exprs >= 0) {
+        ASTNode *last = pe->effects[pe->num_effects - 1];
+        while (last->data.imprimir.num_exprs > snap->last_exprs) {
+            ast_free(last->data.imprimir.exprs[--last->data.imprimir.num_exprs]);
+        }
+    }
+    pe->units = snap->units;
+}
+
+/* Declaracoes da regiao, na ordem em que o codegen aloca registradores */
+static void pe_collect_sites(ASTNode *node, void *data) {
+    PeList *sites = (PeList*)data;
+    if ((node->kind == NODE_DECLARACAO && node->data.declaracao.tamanho == 0) ||
+        (node->kind == NODE_PARA && codegen_para_reads_var(node))) {
+        pe_list_add(sites, node);
+    }
+    ast_for_each_child(node, pe_collect_sites, data);
+}
+
+/* Variavel alocada por uma declaracao (ou por um 'para' que le a variavel) */
+static PeVar* pe_site_var(Peval *pe, ASTNode *site) {
+    const char *name = site->kind == NODE_PARA ? site->data.para.var
+                                               : site->data.declaracao.nome;
+    return &pe->vars[pe_find_var(pe, name)];
+}
+
+/* Tentar resolver um comando da espinha; se sucesso, ele entra na regiao */
+static int pe_try(Peval *pe, ASTNode *node) {
+    PeSnapshot snap;
+    pe_save(pe, &snap);
+
+    pe->fuel = pe->fuel_limit;
+    pe->passo = NULL;
+    pe->depth = 0;
+    int ok = pe_stmt(pe, node);
+
+    if (ok) {
+        PeList sites = { NULL, 0, 0 };
+        pe_collect_sites(node, &sites);
+        for (int i = 0; i < sites.count; i++) {
+            pe_site_var(pe, sites.items[i])->site = 1;
+        }
+        free(sites.items);
+    }
+
+    /* Valores finais precisam caber em literais, em registradores que ja */
+    /* existem no ponto do residuo (locais de passos so sao alocados depois */
+    /* do HALT: um comando que os escreve fica para a VM) */
+    for (int i = 0; ok && i < pe->num_vars; i++) {
+        PeVar *var = &pe->vars[i];
+        if (!var->written) continue;
+        if (!var->allocated && !var->site) ok = 0;
+        if (var->type == TYPE_INTEIRO &&
+            (var->value.i < INT_MIN || var->value.i > INT_MAX)) {
+            ok = 0;
+        }
+    }
+
+    if (ok) {
+        if (pe->num_stmts >= pe->stmts_capacity) {
+            pe->stmts_capacity *= 2;
+            pe->stmts = realloc(pe->stmts, pe->stmts_capacity * sizeof(ASTNode*));
+        }
+        pe->stmts[pe->num_stmts++] = node;
+    } else {
+        pe_restore(pe, &snap);
+    }
+    free(snap.vars);
+    return ok;
+}
+
+/* Substituir a regiao atual pelo seu residuo, acrescentado a out */
+static void pe_flush(Peval *pe, PeList *out) {
+    if (pe->num_stmts == 0) return;
+    int line = pe->stmts[0]->line;
+
+    PeList sites = { NULL, 0, 0 };
+    for (int i = 0; i < pe->num_stmts; i++) {
+        pe_collect_sites(pe->stmts[i], &sites);
+    }
+
+    /* Registradores ainda nao alocados: declaracao com o valor final */
+    for (int i = 0; i < sites.count; i++) {
+        PeVar *var = pe_site_var(pe, sites.items[i]);
+        var->site = 0;
+        /* A variavel de controle de um 'para' so existe dentro do laco */
+        if (var->allocated || sites.items[i]->kind == NODE_PARA) continue;
+
+        ASTNode *init = var->written ? pe_literal(var->value) : NULL;
+        ASTNode *decl = ast_create_declaracao(strdup(var->name), var->type, init);
+        decl->line = line;
+        pe_list_add(out, decl);
+        var->allocated = 1;
+        var->written = 0;
+    }
+
+    /* Demais variaveis escritas: atribuicao do valor final (as de lacos */
+    /* resolvidos, sem registrador, nao tem mais leitores) */
+    for (int i = 0; i < pe->num_vars; i++) {
+        PeVar *var = &pe->vars[i];
+        if (!var->written) continue;
+        var->written = 0;
+        if (!var->allocated) continue;
+        ASTNode *assign = ast_create_atribuicao(strdup(var->name), pe_literal(var->value));
+        assign->line = line;
+        pe_list_add(out, assign);
+    }
+
+    for (int i = 0; i < pe->num_effects; i++) {
+        pe->effects[i]->line = line;
+        pe_list_add(out, pe->effects[i]);
+    }
+
+    for (int i = 0; i < pe->num_stmts; i++) {
+        if (pe->num_dead >= pe->dead_capacity) {
+            pe->dead_capacity *= 2;
+            pe->dead = realloc(pe->dead, pe->dead_capacity * sizeof(ASTNode*));
+        }
+        pe->dead[pe->num_dead++] = pe->stmts[i];
+    }
+    pe->stats->collapsed += pe->num_stmts;
+    pe->num_stmts = 0;
+    pe->num_effects = 0;
+    pe->units = 0;
+    free(sites.items);
+}
+
+static void pe_spine(Peval *pe, ASTNode ***items, int *count);
+
+static void pe_spine_block(Peval *pe, ASTNode *bloco) {
+    pe_spine(pe, &bloco->data.bloco.statements, &bloco->data.bloco.num_statements);
+}
+
+/* Comando mantido: esquecer o que ele escreve e avaliar seus blocos */
+/* com o que continua valendo em qualquer execucao deles */
+static void pe_keep(Peval *pe, ASTNode *node) {
+    pe->stats->kept++;
+    pe_forget(node, pe);
+
+    switch (node->kind) {
+        case NODE_DECLARACAO: {
+            int v = pe_find_var(pe, node->data.declaracao.nome);
+            if (v >= 0) pe->vars[v].allocated = 1;
+            break;
+        }
+        case NODE_SE:
+            pe_spine_block(pe, node->data.se.bloco_then);
+            pe_forget(node, pe);
+            if (node->data.se.bloco_else) {
+                pe_spine_block(pe, node->data.se.bloco_else);
+                pe_forget(node, pe);
+            }
+            break;
+        case NODE_ENQUANTO:
+            pe_spine_block(pe, node->data.enquanto.bloco);
+            pe_forget(node, pe);
+            break;
+        case NODE_PARA:
+            pe_spine_block(pe, node->data.para.bloco);
+            pe_forget(node, pe);
+            break;
+        case NODE_ESCOLHA:
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                pe_spine_block(pe, node->data.escolha.casos[i]->data.caso.bloco);
+                pe_forget(node, pe);
+            }
+            if (node->data.escolha.padrao) {
+                pe_spine_block(pe, node->data.escolha.padrao);
+                pe_forget(node, pe);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Percorrer uma lista de comandos na ordem de execucao */
+static void pe_spine(Peval *pe, ASTNode ***items, int *count) {
+    PeList out = { NULL, 0, 0 };
+
+    for (int i = 0; i < *count; i++) {
+        ASTNode *node = (*items)[i];
+
+        switch (node->kind) {
+            case NODE_RECEITA:
+                pe_flush(pe, &out);
+                pe_spine_block(pe, node->data.receita.bloco);
+                break;
+
+            case NODE_PASSO:
+                pe_flush(pe, &out);
+                if (!node->data.passo.subrotina) pe_spine_block(pe, node->data.passo.bloco);
+                break;
+
+            case NODE_BLOCO:
+                pe_flush(pe, &out);
+                pe_spine_block(pe, node);
+                break;
+
+            case NODE_IMPORTAR:
+                /* Sem efeito em execucao: so torna os passos do modulo visiveis */
+                break;
+
+            case NODE_QUANDO:
+                /* A espera le sensores; o corpo roda uma vez, logo depois */
+                pe_flush(pe, &out);
+                pe->stats->kept++;
+                pe_spine_block(pe, node->data.quando.bloco);
+                break;
+
+            default:
+                if (pe_try(pe, node)) continue;
+                pe_flush(pe, &out);
+                pe_keep(pe, node);
+                break;
+        }
+        pe_list_add(&out, node);
+    }
+    pe_flush(pe, &out);
+
+    mem_free(*items);
+    *items = out.items;
+    *count = out.count;
+}
+
+/* ===== ENTRADA ===== */
+
+void peval_program(ASTNode *programa, long fuel, PevalStats *stats) {
+    stats->collapsed = 0;
+    stats->kept = 0;
+    stats->skipped = NULL;
+    if (!programa || programa->kind != NODE_PROGRAMA) return;
+
+    Peval pe;
+    pe.program = programa;
+    pe.stats = stats;
+    pe.vars_capacity = INITIAL_CAPACITY;
+    pe.vars = malloc(pe.vars_capacity * sizeof(PeVar));
+    pe.num_vars = 0;
+    pe.passo = NULL;
+    pe.depth = 0;
+    pe.fuel_limit = fuel;
+    pe.fuel = fuel;
+    pe.stmts_capacity = INITIAL_CAPACITY;
+    pe.stmts = malloc(pe.stmts_capacity * sizeof(ASTNode*));
+    pe.num_stmts = 0;
+    pe.effects_capacity = INITIAL_CAPACITY;
+    pe.effects = malloc(pe.effects_capacity * sizeof(ASTNode*));
+    pe.num_effects = 0;
+    pe.units = 0;
+    pe.dead_capacity = INITIAL_CAPACITY;
+    pe.dead = malloc(pe.dead_capacity * sizeof(ASTNode*));
+    pe.num_dead = 0;
+
+    stats->skipped = pe_collect(&pe, programa);
+    if (!stats->skipped) {
+        pe_spine(&pe, &programa->data.programa.top_level_items, &programa->data.programa.num_items);
+    }
+
+    for (int i = 0; i < pe.num_vars; i++) {
+        free(pe.vars[i].name);
+    }
+    free(pe.vars);
+    for (int i = 0; i < pe.num_dead; i++) {
+        ast_free(pe.dead[i]);
+    }
+    free(pe.dead);
+    free(pe.stmts);
+    free(pe.effects);
+}
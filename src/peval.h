@@ -0,0 +1,40 @@
+/*
+ * peval.h
+ * Avaliacao parcial do programa em tempo de compilacao
+ *
+ * Depois da analise semantica, o avaliador interpreta a AST com os
+ * valores conhecidos das variaveis. Cada regiao cujo resultado nao
+ * depende de sensores (nem de vetores) e substituida pelos seus efeitos
+ * residuais: impressoes de literais, comandos da air fryer com argumentos
+ * constantes e os valores finais das variaveis escritas. Lacos e contas
+ * deixam de rodar na VM; a saida do programa nao muda.
+ *
+ * Cada comando tem um limite de passos de avaliacao (combustivel): um
+ * laco que nao termina dentro do limite e mantido para o codegen normal,
+ * assim como qualquer comando que leia um sensor, use vetores ou dependa
+ * de uma variavel de valor desconhecido.
+ */
+
+#ifndef PEVAL_H
+#define PEVAL_H
+
+#include "ast.h"
+
+/* Passos de avaliacao por comando antes de desistir */
+#define PEVAL_DEFAULT_FUEL 100000
+
+/* Efeitos residuais (pedacos de imprimir e comandos) por regiao */
+#define PEVAL_MAX_EFFECTS 256
+
+/* Resultado da avaliacao parcial */
+typedef struct PevalStats {
+    int collapsed;      /* Comandos substituidos pelos seus efeitos */
+    int kept;           /* Comandos mantidos para o codegen */
+    const char *skipped;  /* Motivo, se o programa inteiro foi mantido (NULL = avaliado) */
+} PevalStats;
+
+/* Avaliar parcialmente o programa, ja analisado, reescrevendo a AST no lugar */
+/* fuel e o limite de passos de avaliacao por comando */
+void peval_program(ASTNode *programa, long fuel, PevalStats *stats);
+
+#endif /* PEVAL_H */
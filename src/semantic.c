@@ -4,6 +4,7 @@
  */
 
 #include "semantic.h"
+#include "alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,11 +16,12 @@
 
 /* Criar uma nova tabela de simbolos */
 SymbolTable* symtable_create(void) {
-    SymbolTable *table = (SymbolTable*)malloc(sizeof(SymbolTable));
-    table->symbols = (Symbol*)malloc(INITIAL_CAPACITY * sizeof(Symbol));
+    SymbolTable *table = (SymbolTable*)mem_malloc(MEM_SEMANTIC, sizeof(SymbolTable));
+    table->symbols = (Symbol*)mem_malloc(MEM_SEMANTIC, INITIAL_CAPACITY * sizeof(Symbol));
     table->num_symbols = 0;
     table->capacity = INITIAL_CAPACITY;
     table->current_scope = 0;
+    table->program = NULL;
     return table;
 }
 
@@ -28,10 +30,10 @@ void symtable_free(SymbolTable *table) {
     if (!table) return;
     
     for (int i = 0; i < table->num_symbols; i++) {
-        free(table->symbols[i].name);
+        mem_free(table->symbols[i].name);
     }
-    free(table->symbols);
-    free(table);
+    mem_free(table->symbols);
+    mem_free(table);
 }
 
 /* Entrar em um novo escopo */
@@ -46,7 +48,7 @@ void symtable_exit_scope(SymbolTable *table) {
     while (i < table->num_symbols) {
         if (table->symbols[i].scope_level == table->current_scope) {
             /* Remove este simbolo */
-            free(table->symbols[i].name);
+            mem_free(table->symbols[i].name);
             /* Move os simbolos seguintes para tras */
             for (int j = i; j < table->num_symbols - 1; j++) {
                 table->symbols[j] = table->symbols[j + 1];
@@ -73,16 +75,18 @@ int symtable_add(SymbolTable *table, const char *name, DataType type, int is_ini
     /* Expandir array se necessario */
     if (table->num_symbols >= table->capacity) {
         table->capacity *= 2;
-        table->symbols = (Symbol*)realloc(table->symbols, 
-                                         table->capacity * sizeof(Symbol));
+        table->symbols = (Symbol*)mem_realloc(MEM_SEMANTIC, table->symbols,
+                                                      table->capacity * sizeof(Symbol));
     }
     
     /* Adicionar novo simbolo */
     Symbol *sym = &table->symbols[table->num_symbols];
-    sym->name = strdup(name);
+    sym->name = mem_strdup(MEM_SEMANTIC, name);
     sym->type = type;
     sym->is_initialized = is_initialized;
     sym->scope_level = table->current_scope;
+    sym->array_size = 0;
+    sym->is_readonly = 0;
     table->num_symbols++;
     
     return 1;  /* Sucesso */
@@ -111,8 +115,8 @@ void symtable_mark_initialized(SymbolTable *table, const char *name) {
 
 /* Criar uma nova lista de erros */
 SemanticErrorList* error_list_create(void) {
-    SemanticErrorList *list = (SemanticErrorList*)malloc(sizeof(SemanticErrorList));
-    list->errors = (SemanticError*)malloc(INITIAL_CAPACITY * sizeof(SemanticError));
+    SemanticErrorList *list = (SemanticErrorList*)mem_malloc(MEM_SEMANTIC, sizeof(SemanticErrorList));
+    list->errors = (SemanticError*)mem_malloc(MEM_SEMANTIC, INITIAL_CAPACITY * sizeof(SemanticError));
     list->num_errors = 0;
     list->capacity = INITIAL_CAPACITY;
     return list;
@@ -123,10 +127,10 @@ void error_list_free(SemanticErrorList *list) {
     if (!list) return;
     
     for (int i = 0; i < list->num_errors; i++) {
-        free(list->errors[i].message);
+        mem_free(list->errors[i].message);
     }
-    free(list->errors);
-    free(list);
+    mem_free(list->errors);
+    mem_free(list);
 }
 
 /* Adicionar um erro a lista */
@@ -134,26 +138,26 @@ void error_list_add(SemanticErrorList *list, const char *message, int line) {
     /* Expandir array se necessario */
     if (list->num_errors >= list->capacity) {
         list->capacity *= 2;
-        list->errors = (SemanticError*)realloc(list->errors,
-                                              list->capacity * sizeof(SemanticError));
+        list->errors = (SemanticError*)mem_realloc(MEM_SEMANTIC, list->errors,
+                                                           list->capacity * sizeof(SemanticError));
     }
     
     SemanticError *err = &list->errors[list->num_errors];
-    err->message = strdup(message);
+    err->message = mem_strdup(MEM_SEMANTIC, message);
     err->line = line;
     list->num_errors++;
 }
 
 /* Imprimir todos os erros */
-void error_list_print(SemanticErrorList *list) {
+void error_list_print(SemanticErrorList *list, FILE *out) {
     if (list->num_errors == 0) {
-        printf("Analise semantica: nenhum erro encontrado.\n");
+        fprintf(out, "Analise semantica: nenhum erro encontrado.\n");
         return;
     }
     
-    printf("Erros semanticos encontrados:\n");
+    fprintf(out, "Erros semanticos encontrados:\n");
     for (int i = 0; i < list->num_errors; i++) {
-        printf("  Linha %d: %s\n", list->errors[i].line, list->errors[i].message);
+        fprintf(out, "  Linha %d: %s\n", list->errors[i].line, list->errors[i].message);
     }
 }
 
@@ -252,6 +256,86 @@ const char* type_description(DataType type) {
 static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *errors);
 static void analyze_expr(ASTNode *node, SymbolTable *table, SemanticErrorList *errors);
 
+/* Literal inteiro, possivelmente negado: retorna 1 e o valor em *value */
+static int constant_int(ASTNode *node, int *value) {
+    if (node->kind == NODE_LITERAL_INT) {
+        *value = node->data.literal_int.value;
+        return 1;
+    }
+    if (node->kind == NODE_UNOP && node->data.unop.op == OP_NEG &&
+        constant_int(node->data.unop.operand, value)) {
+        *value = -*value;
+        return 1;
+    }
+    return 0;
+}
+
+/* A expressao le algum sensor? */
+static int reads_sensor(ASTNode *node) {
+    if (!node) return 0;
+    switch (node->kind) {
+        case NODE_SENSOR:
+            return 1;
+        case NODE_BINOP:
+            return reads_sensor(node->data.binop.left) || reads_sensor(node->data.binop.right);
+        case NODE_UNOP:
+            return reads_sensor(node->data.unop.operand);
+        case NODE_INDICE:
+            return reads_sensor(node->data.indice.indice);
+        default:
+            return 0;
+    }
+}
+
+/* Literal numerico ou booleano, possivelmente negado */
+static int is_constant(ASTNode *node) {
+    switch (node->kind) {
+        case NODE_LITERAL_INT:
+        case NODE_LITERAL_FRAC:
+        case NODE_LITERAL_BOOL:
+            return 1;
+        case NODE_UNOP:
+            return node->data.unop.op == OP_NEG && is_constant(node->data.unop.operand);
+        default:
+            return 0;
+    }
+}
+
+/* Verificar o indice de um acesso a vetor (leitura ou escrita) */
+static void analyze_index(const char *nome, Symbol *sym, ASTNode *indice, int line,
+                          SymbolTable *table, SemanticErrorList *errors) {
+    char error_msg[256];
+    
+    analyze_expr(indice, table, errors);
+    
+    if (!sym) {
+        snprintf(error_msg, sizeof(error_msg), "Variavel '%s' nao declarada", nome);
+        error_list_add(errors, error_msg, line);
+        return;
+    }
+    if (sym->array_size == 0) {
+        snprintf(error_msg, sizeof(error_msg), "Variavel '%s' nao e um vetor", nome);
+        error_list_add(errors, error_msg, line);
+        return;
+    }
+    if (indice->data_type != TYPE_INTEIRO) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Indice do vetor '%s' deve ser inteiro, obtido '%s'",
+                nome, type_description(indice->data_type));
+        error_list_add(errors, error_msg, line);
+        return;
+    }
+    
+    /* Indices constantes sao verificados aqui; os demais, pela VM */
+    int value;
+    if (constant_int(indice, &value) && (value < 0 || value >= sym->array_size)) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Indice %d fora dos limites do vetor '%s' (tamanho %d)",
+                value, nome, sym->array_size);
+        error_list_add(errors, error_msg, line);
+    }
+}
+
 /* Analisar uma expressao e determinar seu tipo */
 static void analyze_expr(ASTNode *node, SymbolTable *table, SemanticErrorList *errors) {
     if (!node) return;
@@ -266,6 +350,11 @@ static void analyze_expr(ASTNode *node, SymbolTable *table, SemanticErrorList *e
             /* Literais ja tem tipo definido */
             break;
             
+        case NODE_SENSOR:
+            /* Sensores da VM sao inteiros */
+            node->data_type = TYPE_INTEIRO;
+            break;
+            
         case NODE_VARIAVEL: {
             /* Verificar se a variavel foi declarada */
             Symbol *sym = symtable_lookup(table, node->data.variavel.nome);
@@ -274,12 +363,25 @@ static void analyze_expr(ASTNode *node, SymbolTable *table, SemanticErrorList *e
                         "Variavel '%s' nao declarada", node->data.variavel.nome);
                 error_list_add(errors, error_msg, node->line);
                 node->data_type = TYPE_UNKNOWN;
+            } else if (sym->array_size > 0) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Vetor '%s' deve ser indexado", node->data.variavel.nome);
+                error_list_add(errors, error_msg, node->line);
+                node->data_type = TYPE_UNKNOWN;
             } else {
                 node->data_type = sym->type;
             }
             break;
         }
             
+        case NODE_INDICE: {
+            Symbol *sym = symtable_lookup(table, node->data.indice.nome);
+            analyze_index(node->data.indice.nome, sym, node->data.indice.indice,
+                          node->line, table, errors);
+            node->data_type = (sym && sym->array_size > 0) ? sym->type : TYPE_UNKNOWN;
+            break;
+        }
+            
         case NODE_BINOP: {
             /* Analisar operandos */
             analyze_expr(node->data.binop.left, table, errors);
@@ -329,6 +431,139 @@ static void analyze_expr(ASTNode *node, SymbolTable *table, SemanticErrorList *e
     }
 }
 
+/* Verificar tamanho e valores iniciais de um vetor ja registrado na tabela */
+static void analyze_array_declaration(ASTNode *node, SymbolTable *table,
+                                      SemanticErrorList *errors) {
+    char error_msg[256];
+    const char *nome = node->data.declaracao.nome;
+    DataType tipo = node->data.declaracao.tipo;
+    int tamanho = node->data.declaracao.tamanho;
+    
+    Symbol *sym = symtable_lookup(table, nome);
+    if (sym && sym->scope_level == table->current_scope) {
+        sym->array_size = tamanho;
+        sym->is_initialized = 1;
+    }
+    
+    if (tipo == TYPE_TEXTO) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Vetor '%s': vetores de texto nao sao suportados", nome);
+        error_list_add(errors, error_msg, node->line);
+    }
+    if (tamanho > MAX_ARRAY_SIZE) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Vetor '%s' muito grande: %d elementos (maximo %d)",
+                nome, tamanho, MAX_ARRAY_SIZE);
+        error_list_add(errors, error_msg, node->line);
+    }
+    if (node->data.declaracao.num_init > tamanho) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Vetor '%s' tem %d elementos, mas recebeu %d valores iniciais",
+                nome, tamanho, node->data.declaracao.num_init);
+        error_list_add(errors, error_msg, node->line);
+    }
+    
+    /* Valores iniciais vao para a memoria na carga do programa: */
+    /* so constantes sao aceitas */
+    for (int i = 0; i < node->data.declaracao.num_init; i++) {
+        ASTNode *value = node->data.declaracao.init_list[i];
+        analyze_expr(value, table, errors);
+        if (!is_constant(value)) {
+            snprintf(error_msg, sizeof(error_msg),
+                    "Valor inicial %d do vetor '%s' deve ser uma constante", i + 1, nome);
+            error_list_add(errors, error_msg, node->line);
+        } else if (!types_compatible(tipo, value->data_type)) {
+            snprintf(error_msg, sizeof(error_msg),
+                    "Tipo incompativel na inicializacao: esperado '%s', obtido '%s'",
+                    type_description(tipo), type_description(value->data_type));
+            error_list_add(errors, error_msg, node->line);
+        }
+    }
+}
+
+/* Analisar a definicao de um passo com parametros */
+static void analyze_subroutine(ASTNode *node, SymbolTable *table, SemanticErrorList *errors) {
+    char error_msg[256];
+    const char *nome = node->data.passo.nome;
+    
+    /* Chamavel de qualquer lugar: so faz sentido no nivel do programa */
+    if (table->current_scope != 0) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Passo '%s' com parametros deve ser definido no nivel do programa", nome);
+        error_list_add(errors, error_msg, node->line);
+    }
+    if (node->data.passo.num_params > MAX_STEP_PARAMS) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Passo '%s' tem %d parametros (maximo %d)",
+                nome, node->data.passo.num_params, MAX_STEP_PARAMS);
+        error_list_add(errors, error_msg, node->line);
+    }
+    
+    /* Parametros vivem no escopo do corpo, ja inicializados */
+    symtable_enter_scope(table);
+    for (int i = 0; i < node->data.passo.num_params; i++) {
+        ASTNode *param = node->data.passo.params[i];
+        if (!symtable_add(table, param->data.declaracao.nome, param->data.declaracao.tipo, 1)) {
+            snprintf(error_msg, sizeof(error_msg),
+                    "Parametro '%s' repetido no passo '%s'", param->data.declaracao.nome, nome);
+            error_list_add(errors, error_msg, param->line);
+        }
+        if (param->data.declaracao.tipo == TYPE_TEXTO) {
+            snprintf(error_msg, sizeof(error_msg),
+                    "Parametro '%s' do passo '%s': parametros de texto nao sao suportados",
+                    param->data.declaracao.nome, nome);
+            error_list_add(errors, error_msg, param->line);
+        }
+    }
+    analyze_node(node->data.passo.bloco, table, errors);
+    symtable_exit_scope(table);
+}
+
+/* Analisar uma chamada de passo: passo existente, aridade e tipos */
+static void analyze_call(ASTNode *node, SymbolTable *table, SemanticErrorList *errors) {
+    char error_msg[256];
+    const char *nome = node->data.chamada.nome;
+    
+    for (int i = 0; i < node->data.chamada.num_args; i++) {
+        analyze_expr(node->data.chamada.args[i], table, errors);
+    }
+    
+    ASTNode *passo = ast_find_passo(table->program, nome);
+    if (!passo) {
+        snprintf(error_msg, sizeof(error_msg), "Passo '%s' nao definido", nome);
+        error_list_add(errors, error_msg, node->line);
+        return;
+    }
+    if (node->data.chamada.num_args != passo->data.passo.num_params) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Passo '%s' espera %d argumento(s), recebeu %d",
+                nome, passo->data.passo.num_params, node->data.chamada.num_args);
+        error_list_add(errors, error_msg, node->line);
+        return;
+    }
+    for (int i = 0; i < node->data.chamada.num_args; i++) {
+        DataType expected = passo->data.passo.params[i]->data.declaracao.tipo;
+        DataType actual = node->data.chamada.args[i]->data_type;
+        if (!types_compatible(expected, actual)) {
+            snprintf(error_msg, sizeof(error_msg),
+                    "Argumento %d de '%s': esperado '%s', obtido '%s'",
+                    i + 1, nome, type_description(expected), type_description(actual));
+            error_list_add(errors, error_msg, node->line);
+        }
+    }
+}
+
+/* Passos com parametros sao resolvidos pelo nome: nao podem repetir */
+static void check_unique_passo(ASTNode *programa, ASTNode *item, SemanticErrorList *errors) {
+    char error_msg[256];
+    if (item->kind == NODE_PASSO && item->data.passo.subrotina &&
+        ast_find_passo(programa, item->data.passo.nome) != item) {
+        snprintf(error_msg, sizeof(error_msg),
+                "Passo '%s' ja foi definido", item->data.passo.nome);
+        error_list_add(errors, error_msg, item->line);
+    }
+}
+
 /* Analisar um no da AST */
 static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *errors) {
     if (!node) return;
@@ -337,6 +572,10 @@ static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *e
     
     switch (node->kind) {
         case NODE_PROGRAMA:
+            for (int i = 0; i < node->data.programa.num_items; i++) {
+                check_unique_passo(node, node->data.programa.top_level_items[i], errors);
+            }
+            
             /* Analisar todos os itens do programa */
             for (int i = 0; i < node->data.programa.num_items; i++) {
                 analyze_node(node->data.programa.top_level_items[i], table, errors);
@@ -344,6 +583,9 @@ static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *e
             break;
             
         case NODE_RECEITA:
+            /* Receita reaproveitada do cache ja foi validada com as mesmas globais */
+            if (node->data.receita.cached) break;
+            
             /* Entrar em novo escopo para a receita */
             symtable_enter_scope(table);
             analyze_node(node->data.receita.bloco, table, errors);
@@ -351,12 +593,21 @@ static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *e
             break;
             
         case NODE_PASSO:
+            if (node->data.passo.subrotina) {
+                analyze_subroutine(node, table, errors);
+                break;
+            }
+            
             /* Entrar em novo escopo para o passo */
             symtable_enter_scope(table);
             analyze_node(node->data.passo.bloco, table, errors);
             symtable_exit_scope(table);
             break;
             
+        case NODE_IMPORTAR:
+            /* Resolvida antes da analise: os passos do modulo ja estao no programa */
+            break;
+            
         case NODE_BLOCO:
             /* Analisar todos os statements do bloco */
             for (int i = 0; i < node->data.bloco.num_statements; i++) {
@@ -389,16 +640,42 @@ static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *e
                     error_list_add(errors, error_msg, node->line);
                 }
             }
+            
+            if (node->data.declaracao.tamanho > 0) {
+                analyze_array_declaration(node, table, errors);
+            }
             break;
         }
             
         case NODE_ATRIBUICAO: {
             /* Verificar se a variavel foi declarada */
             Symbol *sym = symtable_lookup(table, node->data.atribuicao.nome);
-            if (!sym) {
+            if (node->data.atribuicao.indice) {
+                analyze_index(node->data.atribuicao.nome, sym, node->data.atribuicao.indice,
+                              node->line, table, errors);
+                analyze_expr(node->data.atribuicao.expr, table, errors);
+                
+                DataType expr_type = node->data.atribuicao.expr->data_type;
+                if (sym && sym->array_size > 0 && !types_compatible(sym->type, expr_type)) {
+                    snprintf(error_msg, sizeof(error_msg),
+                            "Tipo incompativel na atribuicao: esperado '%s', obtido '%s'",
+                            type_description(sym->type),
+                            type_description(expr_type));
+                    error_list_add(errors, error_msg, node->line);
+                }
+            } else if (!sym) {
                 snprintf(error_msg, sizeof(error_msg),
                         "Variavel '%s' nao declarada", node->data.atribuicao.nome);
                 error_list_add(errors, error_msg, node->line);
+            } else if (sym->array_size > 0) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Vetor '%s' deve ser indexado", node->data.atribuicao.nome);
+                error_list_add(errors, error_msg, node->line);
+            } else if (sym->is_readonly) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Variavel de controle '%s' do 'para' nao pode ser atribuida",
+                        node->data.atribuicao.nome);
+                error_list_add(errors, error_msg, node->line);
             } else {
                 /* Analisar expressao */
                 analyze_expr(node->data.atribuicao.expr, table, errors);
@@ -524,6 +801,102 @@ static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *e
             symtable_exit_scope(table);
             break;
             
+        case NODE_QUANDO:
+            analyze_expr(node->data.quando.condicao, table, errors);
+            
+            if (!type_is_boolean(node->data.quando.condicao->data_type)) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Condicao do 'quando' deve ser do tipo bool, obtido '%s'",
+                        type_description(node->data.quando.condicao->data_type));
+                error_list_add(errors, error_msg, node->line);
+            }
+            
+            /* Enquanto o programa espera so os sensores mudam: sem eles */
+            /* a condicao nunca mudaria de valor */
+            if (!reads_sensor(node->data.quando.condicao)) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Condicao do 'quando' deve ler ao menos um sensor (TEMP, WEIGHT, MODE, STATE)");
+                error_list_add(errors, error_msg, node->line);
+            }
+            
+            symtable_enter_scope(table);
+            analyze_node(node->data.quando.bloco, table, errors);
+            symtable_exit_scope(table);
+            break;
+            
+        case NODE_CHAMADA:
+            analyze_call(node, table, errors);
+            break;
+            
+        case NODE_ESCOLHA:
+            analyze_expr(node->data.escolha.expr, table, errors);
+            
+            /* Os casos sao constantes inteiras: o seletor tambem deve ser */
+            if (node->data.escolha.expr->data_type != TYPE_INTEIRO) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Seletor do 'escolha' deve ser do tipo inteiro, obtido '%s'",
+                        type_description(node->data.escolha.expr->data_type));
+                error_list_add(errors, error_msg, node->line);
+            }
+            
+            for (int i = 0; i < node->data.escolha.num_casos; i++) {
+                ASTNode *caso = node->data.escolha.casos[i];
+            
+                /* Dois casos com o mesmo valor deixariam o segundo inalcancavel */
+                for (int j = 0; j < i; j++) {
+                    if (node->data.escolha.casos[j]->data.caso.valor == caso->data.caso.valor) {
+                        snprintf(error_msg, sizeof(error_msg),
+                                "Valor %d repetido no 'escolha'", caso->data.caso.valor);
+                        error_list_add(errors, error_msg, caso->line);
+                        break;
+                    }
+                }
+            
+                symtable_enter_scope(table);
+                analyze_node(caso->data.caso.bloco, table, errors);
+                symtable_exit_scope(table);
+            }
+            
+            if (node->data.escolha.padrao) {
+                symtable_enter_scope(table);
+                analyze_node(node->data.escolha.padrao, table, errors);
+                symtable_exit_scope(table);
+            }
+            break;
+            
+        case NODE_PARA: {
+            /* Limites sao avaliados uma vez, antes da primeira iteracao */
+            analyze_expr(node->data.para.inicio, table, errors);
+            analyze_expr(node->data.para.fim, table, errors);
+            if (node->data.para.inicio->data_type != TYPE_INTEIRO ||
+                node->data.para.fim->data_type != TYPE_INTEIRO) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Limites do 'para' devem ser do tipo inteiro");
+                error_list_add(errors, error_msg, node->line);
+            }
+            if (node->data.para.passo == 0) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Passo do 'para' nao pode ser zero");
+                error_list_add(errors, error_msg, node->line);
+            }
+            
+            /* A variavel de controle e declarada pelo laco; esconder uma */
+            /* variavel visivel faria as duas dividirem o mesmo registrador */
+            if (symtable_lookup(table, node->data.para.var)) {
+                snprintf(error_msg, sizeof(error_msg),
+                        "Variavel '%s' ja declarada; o 'para' declara sua propria variavel de controle",
+                        node->data.para.var);
+                error_list_add(errors, error_msg, node->line);
+            }
+            
+            symtable_enter_scope(table);
+            symtable_add(table, node->data.para.var, TYPE_INTEIRO, 1);
+            symtable_lookup(table, node->data.para.var)->is_readonly = 1;
+            analyze_node(node->data.para.bloco, table, errors);
+            symtable_exit_scope(table);
+            break;
+        }
+            
         default:
             /* Outros tipos de no (expressoes) */
             analyze_expr(node, table, errors);
@@ -531,11 +904,20 @@ static void analyze_node(ASTNode *node, SymbolTable *table, SemanticErrorList *e
     }
 }
 
+/* Analisar um item do programa com a tabela mantida pelo chamador */
+void semantic_analyze_item(SymbolTable *table, ASTNode *item, SemanticErrorList *errors) {
+    if (!table || !item || !errors) return;
+    
+    check_unique_passo(table->program, item, errors);
+    analyze_node(item, table, errors);
+}
+
 /* Realizar analise semantica completa */
 int semantic_analyze(ASTNode *root, SemanticErrorList *errors) {
     if (!root || !errors) return 0;
     
     SymbolTable *table = symtable_create();
+    table->program = root;
     
     /* Analisar a AST */
     analyze_node(root, table, errors);
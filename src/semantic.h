@@ -14,6 +14,7 @@
 #define SEMANTIC_H
 
 #include "ast.h"
+#include <stdio.h>
 
 /* Estrutura para uma entrada na tabela de simbolos */
 typedef struct Symbol {
@@ -21,14 +22,23 @@ typedef struct Symbol {
     DataType type;        /* Tipo da variavel */
     int is_initialized;   /* 1 se foi inicializada, 0 caso contrario */
     int scope_level;      /* Nivel de escopo (0 = global, 1+ = local) */
+    int array_size;       /* Numero de elementos se vetor, 0 se escalar */
+    int is_readonly;      /* 1 para a variavel de controle de um 'para' */
 } Symbol;
 
+/* Maior vetor aceito (em elementos) */
+#define MAX_ARRAY_SIZE 65536
+
+/* Parametros de um passo (um registrador A0-A3 da VM para cada) */
+#define MAX_STEP_PARAMS 4
+
 /* Estrutura para a tabela de simbolos */
 typedef struct SymbolTable {
     Symbol *symbols;      /* Array de simbolos */
     int num_symbols;      /* Numero de simbolos */
     int capacity;         /* Capacidade do array */
     int current_scope;    /* Nivel de escopo atual */
+    ASTNode *program;     /* Programa analisado (para resolver chamadas de passo) */
 } SymbolTable;
 
 /* Estrutura para armazenar erros semanticos */
@@ -76,13 +86,19 @@ void error_list_free(SemanticErrorList *list);
 /* Adicionar um erro a lista */
 void error_list_add(SemanticErrorList *list, const char *message, int line);
 
-/* Imprimir todos os erros */
-void error_list_print(SemanticErrorList *list);
+/* Imprimir todos os erros em out */
+void error_list_print(SemanticErrorList *list, FILE *out);
 
 /* Realizar analise semantica completa na AST */
 /* Retorna 1 se sucesso (sem erros), 0 se houver erros */
 int semantic_analyze(ASTNode *root, SemanticErrorList *errors);
 
+/* Analisar um unico item do nivel do programa (modo streaming) */
+/* table e mantida entre os itens (globais ficam no escopo 0) e */
+/* table->program deve conter os passos com parametros ja vistos, */
+/* inclusive item, se ele for um; os erros sao acumulados em errors */
+void semantic_analyze_item(SymbolTable *table, ASTNode *item, SemanticErrorList *errors);
+
 /* Funcoes auxiliares internas (podem ser usadas por codegen tambem) */
 
 /* Verificar se dois tipos sao compativeis para operacao */
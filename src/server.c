@@ -0,0 +1,532 @@
+/*
+ * server.c
+ * Implementacao do servidor de compilacao residente
+ */
+
+#define _GNU_SOURCE
+#include "server.h"
+#include "codegen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Memoria mantida no heap entre pedidos (nao devolvida ao sistema) */
+#define WARM_HEAP_BYTES (64 * 1024 * 1024)
+
+/* Conexoes atendidas ao mesmo tempo; as seguintes sao recusadas */
+#define MAX_CLIENTS 64
+
+/* Maior fonte aceito num COMPILE */
+#define MAX_REQUEST_SOURCE ((size_t)256 * 1024 * 1024)
+
+static volatile sig_atomic_t server_stop = 0;
+
+static void handle_stop(int sig) {
+    (void)sig;
+    server_stop = 1;
+}
+
+/* ===== E/S NO SOCKET ===== */
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+/* Preencher sockaddr_un; retorna 0 se o caminho for longo demais */
+static int make_address(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return 0;
+    strcpy(addr->sun_path, path);
+    return 1;
+}
+
+static int connect_socket(const char *path) {
+    struct sockaddr_un addr;
+    if (!make_address(&addr, path)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/* ===== SERVIDOR ===== */
+
+/* Enviar uma resposta ERRO so com a mensagem de diagnostico */
+static int send_error(int fd, const char *msg) {
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "ERRO 0 %zu\n", strlen(msg));
+    return write_all(fd, header, (size_t)header_len) && write_all(fd, msg, strlen(msg));
+}
+
+/* Compilar src e enviar a resposta; src e liberado aqui */
+static int serve_compile(int fd, SourceBuffer *src, const char *name,
+                         const CompileOptions *copts) {
+    char *code = NULL, *diag_text = NULL;
+    size_t code_len = 0, diag_len = 0;
+    FILE *output = open_memstream(&code, &code_len);
+    FILE *diag = open_memstream(&diag_text, &diag_len);
+
+    int ok = 0;
+    if (output && diag) {
+        if (src) {
+            ok = compile_source(src, name, output, copts, diag);
+        } else {
+            fprintf(diag, "Erro: nao foi possivel abrir o arquivo %s\n", name);
+        }
+    }
+    if (output) fclose(output);
+    if (diag) fclose(diag);
+    source_close(src);
+
+    /* Assembly parcial nao e util para o cliente */
+    if (!ok) code_len = 0;
+
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "%s %zu %zu\n",
+                              ok ? "OK" : "ERRO", code_len, diag_len);
+    int sent = write_all(fd, header, (size_t)header_len) &&
+               write_all(fd, code, code_len) &&
+               write_all(fd, diag_text, diag_len);
+
+    free(code);
+    free(diag_text);
+    return sent;
+}
+
+/* OPTIONS [opcao...]: opcoes dos proximos pedidos da conexao, a partir */
+/* das do servidor (OPTIONS sem argumentos volta a elas) */
+/* Retorna 1 se todas as opcoes foram aceitas; senao copts nao muda */
+static int parse_request_options(char *args, const CompileOptions *defaults,
+                                 CompileOptions *copts, char *err, size_t err_size) {
+    CompileOptions parsed = *defaults;
+    char *save = NULL;
+    for (char *opt = strtok_r(args, " ", &save); opt; opt = strtok_r(NULL, " ", &save)) {
+        if (strcmp(opt, "-peval") == 0) {
+            parsed.peval = 1;
+        } else if (strcmp(opt, "-peval-fuel") == 0) {
+            char *value = strtok_r(NULL, " ", &save);
+            if (!value) {
+                snprintf(err, err_size, "Erro: -peval-fuel exige um valor\n");
+                return 0;
+            }
+            parsed.peval = 1;
+            parsed.peval_fuel = atol(value);
+        } else if (strcmp(opt, "-stream") == 0) {
+            parsed.stream = 1;
+        } else if (strcmp(opt, "-time-report") == 0) {
+            parsed.time_report = 1;
+        } else if (strcmp(opt, "-mem-stats") == 0) {
+            parsed.mem_stats = 1;
+        } else if (strcmp(opt, "-c") == 0) {
+            parsed.module = 1;
+        } else if (strcmp(opt, "-target") == 0) {
+            char *value = strtok_r(NULL, " ", &save);
+            CodegenTarget target;
+            if (!value || !codegen_parse_target(value, &target)) {
+                snprintf(err, err_size, "Erro: arquitetura desconhecida '%s' (use airfryer ou x86-64)\n",
+                         value ? value : "");
+                return 0;
+            }
+            parsed.target = target;
+        } else {
+            snprintf(err, err_size, "Erro: opcao nao aceita pelo servidor: %s\n", opt);
+            return 0;
+        }
+    }
+    *copts = parsed;
+    return 1;
+}
+
+/* Atender todos os pedidos de uma conexao */
+/* Retorna 1 se o cliente pediu SHUTDOWN */
+static int serve_connection(int fd, const ServerOptions *opts) {
+    FILE *in = fdopen(dup(fd), "r");
+    if (!in) return 0;
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t line_len;
+    int shutdown_requested = 0;
+    CompileOptions copts = opts->compile;
+
+    while (!server_stop && (line_len = getline(&line, &line_cap, in)) > 0) {
+        if (line[line_len - 1] == '\n') line[--line_len] = '\0';
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        int keep = 1;
+        const char *name = NULL;
+        size_t size;
+        int name_pos = 0;
+
+        if (strcmp(line, "PING") == 0) {
+            keep = write_all(fd, "PONG\n", 5);
+        } else if (strcmp(line, "SHUTDOWN") == 0) {
+            write_all(fd, "OK 0 0\n", 7);
+            shutdown_requested = 1;
+            keep = 0;
+        } else if (strcmp(line, "OPTIONS") == 0 || strncmp(line, "OPTIONS ", 8) == 0) {
+            char err[256];
+            if (parse_request_options(line + 7, &opts->compile, &copts, err, sizeof(err))) {
+                keep = write_all(fd, "OK 0 0\n", 7);
+            } else {
+                keep = send_error(fd, err);
+            }
+        } else if (strncmp(line, "FILE ", 5) == 0) {
+            name = line + 5;
+            keep = serve_compile(fd, source_open(name), name, &copts);
+        } else if (sscanf(line, "COMPILE %zu %n", &size, &name_pos) == 1 && name_pos > 0) {
+            name = line + name_pos;
+            /* Ler o fonte direto para o buffer que o scanner vai usar; sem */
+            /* ler o fonte recusado, a conexao nao tem como continuar */
+            SourceBuffer *src = size <= MAX_REQUEST_SOURCE ? source_alloc(size) : NULL;
+            if (!src) {
+                char err[128];
+                snprintf(err, sizeof(err), size <= MAX_REQUEST_SOURCE ?
+                         "Erro: memoria insuficiente para %zu bytes\n" :
+                         "Erro: fonte de %zu bytes excede o limite do servidor\n", size);
+                send_error(fd, err);
+                keep = 0;
+            } else if (fread(src->data, 1, size, in) != size) {
+                source_close(src);
+                keep = 0;
+            } else {
+                keep = serve_compile(fd, src, name, &copts);
+            }
+        } else {
+            keep = send_error(fd, "Erro: pedido invalido\n");
+        }
+
+        if (opts->verbose && name) {
+            fprintf(stderr, "Servidor: %s em %.3f ms\n", name, elapsed_ms(&start));
+        }
+        if (!keep) break;
+    }
+
+    free(line);
+    fclose(in);
+    return shutdown_requested;
+}
+
+/* Estado compartilhado entre o laco de accept e as conexoes */
+typedef struct ServerState {
+    const ServerOptions *opts;
+    int listen_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t done;           /* Sinalizada quando uma conexao termina */
+    int clients[MAX_CLIENTS];      /* Sockets em atendimento (-1 = livre) */
+    int num_clients;
+} ServerState;
+
+typedef struct Connection {
+    ServerState *server;
+    int slot;
+} Connection;
+
+/* Parar de aceitar conexoes (acorda o accept bloqueado) */
+static void request_stop(ServerState *server) {
+    server_stop = 1;
+    shutdown(server->listen_fd, SHUT_RDWR);
+}
+
+static void* connection_thread(void *arg) {
+    Connection *conn = (Connection*)arg;
+    ServerState *server = conn->server;
+    int fd = server->clients[conn->slot];
+
+    if (serve_connection(fd, server->opts)) request_stop(server);
+
+    pthread_mutex_lock(&server->lock);
+    close(fd);
+    server->clients[conn->slot] = -1;
+    server->num_clients--;
+    pthread_cond_signal(&server->done);
+    pthread_mutex_unlock(&server->lock);
+    free(conn);
+    return NULL;
+}
+
+/* Atender fd numa thread propria; sem vaga, recusar */
+static void start_connection(ServerState *server, int fd) {
+    pthread_mutex_lock(&server->lock);
+    int slot = -1;
+    for (int i = 0; i < MAX_CLIENTS && slot < 0; i++) {
+        if (server->clients[i] < 0) slot = i;
+    }
+    if (slot >= 0) {
+        server->clients[slot] = fd;
+        server->num_clients++;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    if (slot < 0) {
+        send_error(fd, "Erro: servidor ocupado, tente novamente\n");
+        close(fd);
+        return;
+    }
+
+    /* Sinais ficam com a thread do accept (mascara herdada) */
+    sigset_t block, saved;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &saved);
+
+    Connection *conn = malloc(sizeof(Connection));
+    pthread_t thread;
+    int started = conn != NULL;
+    if (started) {
+        conn->server = server;
+        conn->slot = slot;
+        started = pthread_create(&thread, NULL, connection_thread, conn) == 0;
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (started) {
+        pthread_detach(thread);
+        return;
+    }
+    free(conn);
+    send_error(fd, "Erro: servidor ocupado, tente novamente\n");
+    pthread_mutex_lock(&server->lock);
+    close(fd);
+    server->clients[slot] = -1;
+    server->num_clients--;
+    pthread_mutex_unlock(&server->lock);
+}
+
+void server_options_init(ServerOptions *opts) {
+    opts->socket_path = NULL;
+    opts->verbose = 0;
+    compile_options_init(&opts->compile);
+    opts->compile.quiet = 1;
+}
+
+int server_run(const ServerOptions *opts) {
+    struct sockaddr_un addr;
+    if (!make_address(&addr, opts->socket_path)) {
+        fprintf(stderr, "Erro: caminho de socket muito longo: %s\n", opts->socket_path);
+        return 0;
+    }
+
+    /* Recusar se outro servidor ja atende no mesmo caminho; */
+    /* caso contrario, remover o socket abandonado */
+    int probe = connect_socket(opts->socket_path);
+    if (probe >= 0) {
+        close(probe);
+        fprintf(stderr, "Erro: ja existe um servidor em %s\n", opts->socket_path);
+        return 0;
+    }
+    unlink(opts->socket_path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, SOMAXCONN) != 0) {
+        fprintf(stderr, "Erro: nao foi possivel escutar em %s: %s\n",
+                opts->socket_path, strerror(errno));
+        if (listen_fd >= 0) close(listen_fd);
+        return 0;
+    }
+
+    /* Sem SA_RESTART: accept() retorna EINTR para podermos encerrar */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Manter o heap aquecido: memoria liberada ao fim de cada pedido */
+    /* fica no alocador para o proximo, em vez de voltar ao sistema */
+    mallopt(M_TRIM_THRESHOLD, WARM_HEAP_BYTES);
+    mallopt(M_MMAP_THRESHOLD, WARM_HEAP_BYTES);
+
+    ServerState server;
+    server.opts = opts;
+    server.listen_fd = listen_fd;
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.done, NULL);
+    for (int i = 0; i < MAX_CLIENTS; i++) server.clients[i] = -1;
+    server.num_clients = 0;
+
+    fprintf(stderr, "Servidor de compilacao escutando em %s\n", opts->socket_path);
+
+    /* Cada conexao tem sua thread: um editor parado numa conexao aberta */
+    /* nao atrasa os demais clientes */
+    while (!server_stop) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (server_stop || errno == EINTR) continue;
+            fprintf(stderr, "Erro: accept falhou: %s\n", strerror(errno));
+            break;
+        }
+        start_connection(&server, fd);
+    }
+
+    /* Encerrar as conexoes abertas (a leitura de cada uma ve fim de */
+    /* arquivo) e esperar as compilacoes em andamento */
+    pthread_mutex_lock(&server.lock);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (server.clients[i] >= 0) shutdown(server.clients[i], SHUT_RDWR);
+    }
+    while (server.num_clients > 0) pthread_cond_wait(&server.done, &server.lock);
+    pthread_mutex_unlock(&server.lock);
+    pthread_cond_destroy(&server.done);
+    pthread_mutex_destroy(&server.lock);
+
+    close(listen_fd);
+    unlink(opts->socket_path);
+    fprintf(stderr, "Servidor encerrado.\n");
+    return 1;
+}
+
+/* ===== CLIENTE ===== */
+
+/* Copiar len bytes do stream para out (NULL = descartar) */
+static int copy_bytes(FILE *in, FILE *out, size_t len) {
+    char buf[65536];
+    while (len > 0) {
+        size_t chunk = len < sizeof(buf) ? len : sizeof(buf);
+        if (fread(buf, 1, chunk, in) != chunk) return 0;
+        if (out) fwrite(buf, 1, chunk, out);
+        len -= chunk;
+    }
+    return 1;
+}
+
+/* Ler o cabecalho de uma resposta: status e tamanhos dos blocos */
+/* Retorna 1 se sucesso, 0 se a resposta e invalida */
+static int read_reply_header(FILE *in, int *ok, size_t *code_len, size_t *diag_len) {
+    char status[8];
+    if (fscanf(in, "%7s %zu %zu", status, code_len, diag_len) != 3 || fgetc(in) != '\n') {
+        return 0;
+    }
+    *ok = strcmp(status, "OK") == 0;
+    return 1;
+}
+
+int server_client_compile(const char *socket_path, const char *input_path,
+                          char **options, int num_options,
+                          const char *output_path, FILE *diag) {
+    /* O servidor pode estar em outro diretorio de trabalho */
+    char *path = realpath(input_path, NULL);
+    if (!path) {
+        fprintf(diag, "Erro: nao foi possivel abrir o arquivo %s\n", input_path);
+        return 0;
+    }
+
+    int fd = connect_socket(socket_path);
+    if (fd < 0) {
+        fprintf(diag, "Erro: nenhum servidor em %s\n", socket_path);
+        free(path);
+        return 0;
+    }
+
+    FILE *in = fdopen(dup(fd), "r");
+    int ok = 0, valid = in != NULL;
+    size_t code_len = 0, diag_len = 0;
+
+    /* Opcoes do pedido; se recusadas, o motivo vem nos diagnosticos */
+    if (valid && num_options > 0) {
+        char *request = NULL;
+        size_t request_size = 0;
+        FILE *req = open_memstream(&request, &request_size);
+        valid = req != NULL;
+        if (valid) {
+            fprintf(req, "OPTIONS");
+            for (int i = 0; i < num_options; i++) fprintf(req, " %s", options[i]);
+            fprintf(req, "\n");
+            fclose(req);
+            valid = write_all(fd, request, request_size) &&
+                    read_reply_header(in, &ok, &code_len, &diag_len) &&
+                    code_len == 0 && copy_bytes(in, diag, diag_len);
+        }
+        free(request);
+        if (valid && !ok) {
+            fclose(in);
+            close(fd);
+            free(path);
+            return 0;
+        }
+    }
+
+    if (valid) {
+        char *request;
+        int request_len = asprintf(&request, "FILE %s\n", path);
+        valid = request_len > 0 && write_all(fd, request, (size_t)request_len) &&
+                read_reply_header(in, &ok, &code_len, &diag_len);
+        if (request_len > 0) free(request);
+    }
+    free(path);
+    close(fd);
+    if (!valid) {
+        fprintf(diag, "Erro: resposta invalida do servidor\n");
+        if (in) fclose(in);
+        return 0;
+    }
+
+    FILE *output = stdout;
+    if (ok && output_path) {
+        output = fopen(output_path, "w");
+        if (!output) {
+            fprintf(diag, "Erro: nao foi possivel criar arquivo de saida %s\n", output_path);
+            ok = 0;
+        }
+    }
+
+    int received = copy_bytes(in, ok ? output : NULL, code_len) &&
+                   copy_bytes(in, diag, diag_len);
+    fclose(in);
+
+    if (ok && output != stdout && fclose(output) != 0) received = 0;
+    if (!received) {
+        fprintf(diag, "Erro: resposta incompleta do servidor\n");
+        if (ok && output_path) remove(output_path);
+        return 0;
+    }
+    return ok;
+}
+
+int server_client_shutdown(const char *socket_path, FILE *diag) {
+    int fd = connect_socket(socket_path);
+    if (fd < 0) {
+        fprintf(diag, "Erro: nenhum servidor em %s\n", socket_path);
+        return 0;
+    }
+
+    char reply[16];
+    int ok = write_all(fd, "SHUTDOWN\n", 9) && read(fd, reply, sizeof(reply)) > 0;
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,58 @@
+/*
+ * server.h
+ * Servidor de compilacao residente (socket Unix)
+ *
+ * Mantem o compilador carregado entre compilacoes: editores e scripts de
+ * CI conectam-se ao socket e enviam varios pedidos pela mesma conexao,
+ * sem pagar inicializacao de processo a cada arquivo.
+ *
+ * Cada conexao e atendida por uma thread propria (ate 64 ao mesmo
+ * tempo), entao uma conexao ociosa nao bloqueia as demais.
+ *
+ * Protocolo (texto + blocos com tamanho, um pedido por vez):
+ *   OPTIONS [opcao...]\n                opcoes dos proximos pedidos da conexao
+ *                                       (-peval, -peval-fuel <n>, -stream,
+ *                                       -time-report, -mem-stats, -c,
+ *                                       -target <nome>); sem opcoes, as do
+ *                                       servidor. Resposta: OK 0 0\n ou ERRO
+ *   COMPILE <tamanho> <nome>\n<fonte>   compilar o texto enviado
+ *   FILE <caminho>\n                    compilar um arquivo do servidor
+ *   PING\n                              resposta: PONG\n
+ *   SHUTDOWN\n                          encerrar o servidor
+ * Resposta de COMPILE/FILE:
+ *   OK <tam_asm> <tam_diag>\n<assembly><diagnosticos>
+ *   ERRO <tam_asm> <tam_diag>\n<assembly><diagnosticos>
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "driver.h"
+
+/* Opcoes do servidor */
+typedef struct ServerOptions {
+    const char *socket_path;   /* Caminho do socket Unix */
+    int verbose;               /* 1 para registrar cada pedido em stderr */
+    CompileOptions compile;    /* Opcoes dos pedidos (ate um OPTIONS) */
+} ServerOptions;
+
+/* Preencher opcoes com valores padrao */
+void server_options_init(ServerOptions *opts);
+
+/* Atender pedidos ate SHUTDOWN, SIGINT ou SIGTERM */
+/* Retorna 1 se encerrou normalmente, 0 se erro */
+int server_run(const ServerOptions *opts);
+
+/* Cliente: pedir ao servidor a compilacao de input_path */
+/* options (num_options palavras) vao num OPTIONS antes do pedido */
+/* O assembly vai para output_path (stdout se NULL) e os diagnosticos para diag */
+/* Retorna 1 se sucesso, 0 se erro */
+int server_client_compile(const char *socket_path, const char *input_path,
+                          char **options, int num_options,
+                          const char *output_path, FILE *diag);
+
+/* Cliente: pedir ao servidor que encerre */
+/* Retorna 1 se sucesso, 0 se erro */
+int server_client_shutdown(const char *socket_path, FILE *diag);
+
+#endif /* SERVER_H */
@@ -0,0 +1,131 @@
+/*
+ * source.c
+ * Implementacao do buffer de codigo-fonte (mmap com fallback para leitura)
+ */
+
+#include "source.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Bytes '\0' exigidos pelo yy_scan_buffer no fim do buffer */
+#define SOURCE_PADDING 2
+#define READ_CHUNK 65536
+
+/* Mapear o arquivo com os dois terminadores garantidos */
+/* Reserva uma regiao anonima (zerada) um pouco maior que o arquivo e */
+/* mapeia o arquivo por cima dela: os bytes apos o EOF sao sempre zero, */
+/* mesmo quando o tamanho do arquivo e multiplo exato da pagina. */
+/* O mapeamento e privado e gravavel porque o Flex escreve '\0' */
+/* temporariamente no fim de cada token (as paginas sao copiadas sob */
+/* demanda pelo kernel; o arquivo nunca e alterado). */
+static SourceBuffer* source_map(int fd, size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t map_size = ((size + SOURCE_PADDING + page - 1) / page) * page;
+
+    char *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             fd, 0) == MAP_FAILED) {
+        munmap(base, map_size);
+        return NULL;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    SourceBuffer *src = (SourceBuffer*)malloc(sizeof(SourceBuffer));
+    src->data = base;
+    src->size = size;
+    src->map_size = map_size;
+    return src;
+}
+
+SourceBuffer* source_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    SourceBuffer *src = NULL;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        src = source_map(fd, (size_t)st.st_size);
+    }
+
+    /* Arquivo vazio, especial ou mmap indisponivel: ler normalmente */
+    if (!src) {
+        FILE *f = fdopen(fd, "r");
+        if (!f) {
+            close(fd);
+            return NULL;
+        }
+        src = source_read(f);
+        fclose(f);
+        return src;
+    }
+
+    close(fd);  /* O mapeamento continua valido apos fechar o descritor */
+    return src;
+}
+
+SourceBuffer* source_read(FILE *input) {
+    size_t capacity = READ_CHUNK;
+    size_t size = 0;
+    char *data = (char*)malloc(capacity);
+
+    for (;;) {
+        if (capacity - size < READ_CHUNK / 2 + SOURCE_PADDING) {
+            capacity *= 2;
+            data = (char*)realloc(data, capacity);
+        }
+        size_t n = fread(data + size, 1, capacity - size - SOURCE_PADDING, input);
+        if (n == 0) break;
+        size += n;
+    }
+    if (ferror(input)) {
+        free(data);
+        return NULL;
+    }
+    memset(data + size, 0, SOURCE_PADDING);
+
+    SourceBuffer *src = (SourceBuffer*)malloc(sizeof(SourceBuffer));
+    src->data = data;
+    src->size = size;
+    src->map_size = 0;
+    return src;
+}
+
+SourceBuffer* source_alloc(size_t size) {
+    if (size > SIZE_MAX - SOURCE_PADDING) return NULL;
+    SourceBuffer *src = (SourceBuffer*)malloc(sizeof(SourceBuffer));
+    if (!src) return NULL;
+    src->data = (char*)malloc(size + SOURCE_PADDING);
+    if (!src->data) {
+        free(src);
+        return NULL;
+    }
+    memset(src->data + size, 0, SOURCE_PADDING);
+    src->size = size;
+    src->map_size = 0;
+    return src;
+}
+
+SourceBuffer* source_from_memory(const char *text, size_t size) {
+    SourceBuffer *src = source_alloc(size);
+    if (src) memcpy(src->data, text, size);
+    return src;
+}
+
+void source_close(SourceBuffer *src) {
+    if (!src) return;
+
+    if (src->map_size > 0) {
+        munmap(src->data, src->map_size);
+    } else {
+        free(src->data);
+    }
+    free(src);
+}
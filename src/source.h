@@ -0,0 +1,42 @@
+/*
+ * source.h
+ * Buffer com o codigo-fonte de um programa AirFryerScript
+ *
+ * O scanner le diretamente deste buffer (yy_scan_buffer), sem copias
+ * intermediarias: arquivos regulares sao mapeados em memoria com mmap e
+ * os tokens sao apenas (offset, tamanho) dentro do buffer.
+ */
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Codigo-fonte em memoria */
+typedef struct SourceBuffer {
+    char *data;         /* Conteudo seguido de dois '\0' (exigido pelo Flex) */
+    size_t size;        /* Tamanho do conteudo, sem os terminadores */
+    size_t map_size;    /* Tamanho do mapeamento (0 se alocado com malloc) */
+} SourceBuffer;
+
+/* Mapear um arquivo em memoria (ou ler, se nao for arquivo regular) */
+/* Retorna NULL se o arquivo nao puder ser aberto */
+SourceBuffer* source_open(const char *path);
+
+/* Ler todo o conteudo de um stream (pipes, stdin) */
+SourceBuffer* source_read(FILE *input);
+
+/* Alocar um buffer de size bytes a ser preenchido pelo chamador */
+/* Os terminadores ja sao gravados apos os size bytes */
+/* Retorna NULL se nao houver memoria */
+SourceBuffer* source_alloc(size_t size);
+
+/* Copiar um bloco de memoria para um novo buffer */
+/* Retorna NULL se nao houver memoria */
+SourceBuffer* source_from_memory(const char *text, size_t size);
+
+/* Liberar o buffer (desfaz o mapeamento) */
+void source_close(SourceBuffer *src);
+
+#endif /* SOURCE_H */
@@ -11,22 +11,45 @@ para as construcoes da linguagem AirFryerScript.
 Arquitetura:
 -----------
 - Registradores de escrita: TIME, POWER, R0, R1, R2, R3
+- Registradores tipados: cada um guarda um inteiro ou um double (frac);
+  o compilador escolhe a instrucao pelo tipo e insere ITOF/FTOI
+- Contador de lacos: CNT (usado pelo codegen do 'para')
+- Argumentos de passo: A0, A1, A2, A3 (salvos e restaurados por CALL/RET)
 - Sensores read-only: TEMP, WEIGHT, MODE, STATE
-- Memoria: pilha (stack)
+- Relogio virtual e modelo termico: TEMP so muda enquanto o programa
+  espera (WAIT/WAITCHG), seguindo a temperatura alvo da resistencia
+- Memoria: pilha (stack), pilha de quadros de chamada e memoria linear
+  de dados (vetores)
 - String table: para literais de texto
 
 Conjunto de Instrucoes (ISA):
 ----------------------------
 Instrucoes basicas (compativeis com MicrowaveVM):
-  SET R n           - Define registrador R = n
+  SET R n           - Define registrador R = n (inteiro)
+  SETF R x          - Define registrador R = x (frac, double)
   INC R             - Incrementa R
   DEC R             - Decrementa R
   DECJZ R label     - Se R == 0 vai para label, senao R = R - 1
+  DECJNZ R label    - R = R - 1; se R != 0 vai para label
   GOTO label        - Pula para label
   PUSH R            - Empilha valor de R
   POP R             - Desempilha para R
   HALT              - Para a execucao
 
+Instrucoes de subrotina (passos com parametros):
+  CALL label n      - Empilha um quadro (endereco de retorno e A0-A3 do
+                      chamador) e desempilha n valores da pilha para
+                      A0..A(n-1), o ultimo empilhado indo para A(n-1)
+  RET               - Desempilha o quadro: restaura A0-A3 e retorna
+  (chamadas em posicao de cauda sao compiladas como POP A.../GOTO e nao
+  empilham quadro)
+
+Instrucoes de memoria (vetores):
+  LOAD Rd base Ri   - Rd = memoria[base + Ri]
+  STORE Rs base Ri  - memoria[base + Ri] = Rs
+  (base deve ser o inicio de um segmento declarado com DATA; o indice
+  e verificado contra o tamanho do segmento)
+
 Instrucoes aritmeticas (inteiros):
   ADD R1 R2         - R1 = R1 + R2
   SUB R1 R2         - R1 = R1 - R2
@@ -34,13 +57,14 @@ Instrucoes aritmeticas (inteiros):
   DIV R1 R2         - R1 = R1 / R2
   MOD R1 R2         - R1 = R1 % R2
 
-Instrucoes aritmeticas (fixed-point para tipo frac):
-  ADDF R1 R2        - R1 = R1 + R2 (frac)
-  SUBF R1 R2        - R1 = R1 - R2 (frac)
-  MULF R1 R2        - R1 = (R1 * R2) / 100
-  DIVF R1 R2        - R1 = (R1 * 100) / R2
-  ITOF R            - R = R * 100
-  FTOI R            - R = R / 100
+Instrucoes aritmeticas (double para tipo frac):
+  ADDF R1 R2        - R1 = R1 + R2
+  SUBF R1 R2        - R1 = R1 - R2
+  MULF R1 R2        - R1 = R1 * R2
+  DIVF R1 R2        - R1 = R1 / R2
+  MODF R1 R2        - R1 = R1 mod R2 (sinal do divisor, como MOD)
+  ITOF R            - R = double(R)
+  FTOI R            - R = inteiro(R), truncando em direcao a zero
 
 Instrucoes de comparacao (resultado em R0):
   EQ R1 R2          - R0 = (R1 == R2)
@@ -58,27 +82,158 @@ Instrucoes logicas:
 Instrucoes de salto condicional:
   JZ R label        - Se R == 0 vai para label
   JNZ R label       - Se R != 0 vai para label
+  JTABLE R base padrao L0 .. Ln-1
+                    - Salto indexado: vai para L(R - base) se
+                      0 <= R - base < n, senao para padrao
 
 Instrucoes de impressao:
   PRINT             - Imprime TIME (compatibilidade)
   PRINTI R          - Imprime R como inteiro
-  PRINTF R          - Imprime R como frac (divide por 100)
+  PRINTF R          - Imprime R como frac (duas casas decimais)
   PRINTB R          - Imprime R como bool (verdadeiro/falso)
   SPRINT id         - Imprime string da string table
+  PRINTFMT id op... - Imprime o template id da string table, trocando em
+                      ordem cada %d (inteiro), %f (frac) e %b (bool) pelo
+                      valor de um operando e %% por %. Operando e um
+                      registrador ou STACK; os STACK usam, em ordem, os
+                      valores do topo da pilha (o mais fundo primeiro),
+                      que sao desempilhados
 
 Instrucoes de string:
   SDEF id "texto"   - Define string na string table
 
+Secao de dados:
+  DATA base n v...  - Reserva n celulas a partir de base, inicializadas
+                      com os valores dados (o restante fica em 0);
+                      valores com ponto sao frac.
+                      Processada na carga, como SDEF.
+
+Instrucoes de sensores:
+  READ R S          - R = sensor S (TEMP, WEIGHT, MODE, STATE)
+  WAIT S rel R      - Suspende ate (S rel R) valer; rel e EQ, NE, LT, LE,
+                      GT ou GE. O relogio avanca direto ate o evento.
+  WAITCHG S...      - Suspende ate algum dos sensores listados mudar
+
 Instrucoes tematicas (air fryer):
   SETMODE n         - Define modo (0=manual, 1=batata, 2=legumes, 3=nuggets, 4=esfihas)
+                      e liga a resistencia (alvo: POWER no modo 0, preset nos demais)
   PAUSE             - Pausa execucao (STATE=2)
   RESUME            - Resume execucao (STATE=1)
   STOP              - Para execucao (STATE=0, POWER=0)
+
+Motor rapido:
+------------
+  FastAirFryerVM executa o mesmo ISA com a mesma saida: na carga cada
+  instrucao vira uma funcao especializada que devolve o proximo PC, e
+  run() chama essas funcoes num laco sem consultas a atributos
+  (airfryer_vm.py --fast; comparacao em bench.py).
+
+Sensores gravados:
+-----------------
+  vm.set_sensor_source(fonte) troca o modelo termico, para os sensores
+  que a fonte fornece, por valores em funcao do relogio virtual (ver
+  sensors.py; TraceSource le um trace binario mapeado em memoria). As
+  esperas saltam o relogio direto para a proxima amostra quando o modelo
+  nao tem o que mudar.
+
+Checkpoints:
+-----------
+  vm.snapshot(path) grava o estado da execucao (registradores, sensores,
+  pilha, quadros, memoria, PC, steps, relogio virtual e o hash do
+  programa) num arquivo binario; Checkpoint.open(path) o mapeia em memoria
+  e restore(vm) o copia para uma VM com o mesmo programa carregado. Um
+  Checkpoint aberto restaura quantas VMs forem preciso (cenarios "e se"
+  a partir do mesmo ponto) sem reler o arquivo.
+
+  Formato (little-endian, secoes alinhadas em 8 bytes):
+    cabecalho   magic "AFCK", versao, sha256 do .mwasm, pc, steps, clock,
+                setpoint, halted e os tamanhos da pilha, dos quadros e
+                da memoria
+    tags        1 byte por celula: 0 = inteiro, 1 = frac
+    celulas     8 bytes por celula (int64 ou double): registradores,
+                sensores, pilha, quadros (retorno e A0-A3) e memoria
 """
 
+import hashlib
+import mmap
+import operator
+import struct
 from dataclasses import dataclass
 from typing import List, Dict, Tuple, Optional
 
+# Modelo termico (1 tique do relogio virtual = 1 segundo)
+NUM_ARG_REGS = 4                                   # A0..A3
+MAX_FRAMES = 10000                                 # Profundidade maxima de CALL
+AMBIENT_TEMP = 25                                  # Temperatura ambiente
+HEAT_RATE = 5                                      # Graus/s com a resistencia ligada
+COOL_RATE = 1                                      # Graus/s resfriando
+MODE_PRESETS = {1: 200, 2: 180, 3: 190, 4: 170}    # batata, legumes, nuggets, esfihas
+
+SENSORS = ("TEMP", "WEIGHT", "MODE", "STATE")
+REGISTERS = ("TIME", "POWER", "R0", "R1", "R2", "R3", "CNT", "A0", "A1", "A2", "A3")
+REG_INDEX = {name: i for i, name in enumerate(REGISTERS)}
+SENSOR_TEMP, SENSOR_WEIGHT, SENSOR_MODE, SENSOR_STATE = range(len(SENSORS))
+
+# Checkpoints (ver snapshot/Checkpoint)
+CHECKPOINT_MAGIC = b"AFCK"
+CHECKPOINT_VERSION = 1
+CHECKPOINT_HEADER = struct.Struct("<4sI32sqqqqIIII")
+FRAME_CELLS = 1 + NUM_ARG_REGS                     # Retorno e A0-A3 do chamador
+WAIT_RELATIONS = {
+    "EQ": operator.eq, "NE": operator.ne,
+    "LT": operator.lt, "LE": operator.le,
+    "GT": operator.gt, "GE": operator.ge,
+}
+# Operacoes de dois registradores do FastAirFryerVM
+ARITH_OPS = {
+    "ADD": operator.add, "SUB": operator.sub, "MUL": operator.mul,
+    "DIV": operator.floordiv, "MOD": operator.mod,
+    "ADDF": operator.add, "SUBF": operator.sub, "MULF": operator.mul,
+    "DIVF": operator.truediv, "MODF": operator.mod,
+}
+
+def parse_number(text: str):
+    """
+    Literal do assembly: inteiro, ou double se tiver ponto/expoente
+    """
+    try:
+        return int(text)
+    except ValueError:
+        return float(text)
+
+def format_template(template: str, values: List) -> str:
+    """
+    Troca cada %d, %f e %b de um template de PRINTFMT por um valor, em ordem
+    """
+    out = []
+    i = next_value = 0
+    while i < len(template):
+        c = template[i]
+        if c != '%' or i + 1 >= len(template):
+            out.append(c)
+            i += 1
+            continue
+        kind = template[i + 1]
+        i += 2
+        if kind == '%':
+            out.append('%')
+            continue
+        if next_value >= len(values):
+            raise RuntimeError("PRINTFMT com menos operandos que marcadores")
+        value = values[next_value]
+        next_value += 1
+        if kind == 'f':
+            out.append(f"{value:.2f}")
+        elif kind == 'b':
+            out.append("verdadeiro" if value else "falso")
+        elif kind == 'd':
+            out.append(str(value))
+        else:
+            raise RuntimeError(f"Marcador invalido no template: %{kind}")
+    if next_value != len(values):
+        raise RuntimeError("PRINTFMT com mais operandos que marcadores")
+    return ''.join(out)
+
 @dataclass
 class Instr:
     """Representa uma instrucao da VM"""
@@ -92,37 +247,69 @@ class AirFryerVM:
     """
 
     def __init__(self):
-        # Registradores de escrita
-        self.registers: Dict[str, int] = {
-            "TIME": 0,
-            "POWER": 0,
-            "R0": 0,
-            "R1": 0,
-            "R2": 0,
-            "R3": 0
-        }
+        # Registradores de escrita (TIME, POWER, R0-R3, CNT, A0-A3)
+        self.registers: Dict[str, int] = {name: 0 for name in REGISTERS}
         
         # Sensores read-only
         self.readonly_registers: Dict[str, int] = {
-            "TEMP": 0,      # Temperatura atual
+            "TEMP": AMBIENT_TEMP,  # Temperatura atual
             "WEIGHT": 100,  # Peso em gramas
             "MODE": 0,      # Modo da air fryer
             "STATE": 0      # Estado (0=parado, 1=ativo, 2=pausado)
         }
         
+        # Relogio virtual (segundos) e alvo da resistencia (0 = desligada)
+        self.clock: int = 0
+        self.setpoint: int = 0
+        
         # String table
         self.strings: Dict[int, str] = {}
         
+        # Memoria linear de dados e seus segmentos (base -> tamanho)
+        self.memory: List[int] = []
+        self.segments: Dict[int, int] = {}
+        self.max_memory: int = 1 << 20  # Limite de celulas
+        
         # Pilha
         self.stack: List[int] = []
         
+        # Quadros de chamada: (endereco de retorno, A0-A3 do chamador)
+        self.frames: List[Tuple[int, Tuple[int, ...]]] = []
+        
         # Programa e controle
         self.program: List[Instr] = []
         self.labels: Dict[str, int] = {}
+        self.program_hash: bytes = bytes(32)  # sha256 do .mwasm carregado
         self.pc: int = 0
         self.halted: bool = False
         self.steps: int = 0
         self.max_steps: int = 100000  # Limite para evitar loops infinitos
+        
+        # Destino da saida do programa (None = sys.stdout)
+        self.output = None
+        
+        # Gravador de trace binario (ver tracer.py; None = desligado)
+        self.trace = None
+        
+        # Sensores gravados (ver sensors.py; None = so o modelo termico)
+        self.sensor_source = None
+
+    def set_sensor_source(self, source):
+        """
+        Passa a ler os sensores de source (None volta ao modelo termico)
+        """
+        self.sensor_source = source
+        if source is not None:
+            self._apply_sensors()
+
+    def _apply_sensors(self):
+        """
+        Copia os valores da fonte de sensores vigentes no relogio atual
+        """
+        values = self.sensor_source.sample(self.clock)
+        if values is not None:
+            for name, value in zip(self.sensor_source.sensors, values):
+                self.readonly_registers[name] = value
 
     def load_program(self, source: str):
         """
@@ -131,18 +318,26 @@ class AirFryerVM:
         self.program.clear()
         self.labels.clear()
         self.strings.clear()
+        self.memory.clear()
+        self.segments.clear()
         self.stack.clear()
+        self.frames.clear()
+        self.program_hash = hashlib.sha256(source.encode()).digest()
         self.pc = 0
         self.halted = False
         self.steps = 0
+        self.clock = 0
+        self.setpoint = 0
         
         # Resetar registradores
         for reg in self.registers:
             self.registers[reg] = 0
-        self.readonly_registers["TEMP"] = 0
+        self.readonly_registers["TEMP"] = AMBIENT_TEMP
         self.readonly_registers["WEIGHT"] = 100
         self.readonly_registers["MODE"] = 0
         self.readonly_registers["STATE"] = 0
+        if self.sensor_source is not None:
+            self._apply_sensors()
         
         lines = source.splitlines()
         
@@ -181,13 +376,18 @@ class AirFryerVM:
                     raise ValueError(f"Linha {line_num}: Erro no SDEF: {e}")
                 continue
             
+            # DATA (segmento da memoria de dados)
+            if line.upper().startswith('DATA'):
+                self._load_data(line.split()[1:], line_num)
+                continue
+            
             # Instrucao normal
             idx += 1
         
         # Segunda passagem: parsear instrucoes
         for line_num, raw_line in enumerate(lines, 1):
             line = raw_line.split(';', 1)[0].strip()
-            if not line or line.endswith(':') or line.upper().startswith('SDEF'):
+            if not line or line.endswith(':') or line.upper().startswith(('SDEF', 'DATA')):
                 continue
             
             tokens = line.replace(',', ' ').split()
@@ -202,14 +402,56 @@ class AirFryerVM:
             
             self.program.append(Instr(op, args, line_num))
 
+    def _load_data(self, tokens: List[str], line_num: int):
+        """
+        Processa a diretiva DATA base n [valores...]
+        """
+        if len(tokens) < 2:
+            raise ValueError(f"Linha {line_num}: DATA requer base e tamanho")
+        try:
+            base, size = int(tokens[0]), int(tokens[1])
+            init = [parse_number(t) for t in tokens[2:]]
+        except ValueError:
+            raise ValueError(f"Linha {line_num}: DATA requer valores numericos")
+        
+        if base < 0 or size <= 0 or len(init) > size:
+            raise ValueError(f"Linha {line_num}: DATA invalido")
+        if base + size > self.max_memory:
+            raise ValueError(f"Linha {line_num}: Memoria de dados excede {self.max_memory} celulas")
+        for other, other_size in self.segments.items():
+            if base < other + other_size and other < base + size:
+                raise ValueError(f"Linha {line_num}: Segmento em {base} sobrepoe segmento em {other}")
+        
+        if len(self.memory) < base + size:
+            self.memory.extend([0] * (base + size - len(self.memory)))
+        self.memory[base:base + len(init)] = init
+        self.segments[base] = size
+
+    def _format(self, template: str, operands: Tuple[str, ...]) -> str:
+        """
+        Expande o template de PRINTFMT com os valores dos operandos
+        """
+        depth = sum(1 for op in operands if op.upper() == "STACK")
+        if len(self.stack) < depth:
+            raise RuntimeError("PRINTFMT sem valores suficientes na pilha")
+        stacked = self.stack[len(self.stack) - depth:]
+        del self.stack[len(self.stack) - depth:]
+        
+        values = []
+        for op in operands:
+            name = op.upper()
+            values.append(stacked.pop(0) if name == "STACK" else self.registers[name])
+        return format_template(template, values)
+
     def _validate_instruction(self, op: str, args: Tuple[str, ...], line_num: int):
         """
         Valida uma instrucao (verificacao basica)
         """
-        valid_regs = {"TIME", "POWER", "R0", "R1", "R2", "R3"}
+        valid_regs = {"TIME", "POWER", "R0", "R1", "R2", "R3", "CNT",
+                      "A0", "A1", "A2", "A3"}
         
         # Instrucoes sem argumentos
-        if op in ["HALT", "PRINT", "PAUSE", "RESUME", "STOP"]:
+        if op in ["HALT", "PRINT", "PAUSE", "RESUME", "STOP", "RET"]:
             if len(args) != 0:
                 raise ValueError(f"Linha {line_num}: {op} nao aceita argumentos")
         
@@ -231,8 +473,18 @@ class AirFryerVM:
             except ValueError:
                 raise ValueError(f"Linha {line_num}: SET requer valor inteiro")
         
+        elif op == "SETF":
+            if len(args) != 2:
+                raise ValueError(f"Linha {line_num}: SETF requer registrador e valor")
+            if args[0].upper() not in valid_regs:
+                raise ValueError(f"Linha {line_num}: Registrador invalido: {args[0]}")
+            try:
+                float(args[1])
+            except ValueError:
+                raise ValueError(f"Linha {line_num}: SETF requer valor numerico")
+        
         # Instrucoes com dois registradores
-        elif op in ["ADD", "SUB", "MUL", "DIV", "MOD", "ADDF", "SUBF", "MULF", "DIVF",
+        elif op in ["ADD", "SUB", "MUL", "DIV", "MOD", "ADDF", "SUBF", "MULF", "DIVF", "MODF",
                     "EQ", "NE", "LT", "LE", "GT", "GE", "AND", "OR"]:
             if len(args) != 2:
                 raise ValueError(f"Linha {line_num}: {op} requer 2 argumentos")
@@ -240,17 +492,79 @@ class AirFryerVM:
                 raise ValueError(f"Linha {line_num}: Argumentos devem ser registradores validos")
         
         # Instrucoes com registrador e label
-        elif op in ["DECJZ", "JZ", "JNZ"]:
+        elif op in ["DECJZ", "DECJNZ", "JZ", "JNZ"]:
             if len(args) != 2:
                 raise ValueError(f"Linha {line_num}: {op} requer registrador e label")
             if args[0].upper() not in valid_regs:
                 raise ValueError(f"Linha {line_num}: Primeiro argumento deve ser registrador")
         
+        # Leitura de sensor
+        elif op == "READ":
+            if len(args) != 2:
+                raise ValueError(f"Linha {line_num}: READ requer registrador e sensor")
+            if args[0].upper() not in valid_regs:
+                raise ValueError(f"Linha {line_num}: Registrador invalido: {args[0]}")
+            if args[1].upper() not in SENSORS:
+                raise ValueError(f"Linha {line_num}: Sensor invalido: {args[1]}")
+        
+        # Espera por sensores
+        elif op == "WAIT":
+            if len(args) != 3:
+                raise ValueError(f"Linha {line_num}: WAIT requer sensor, relacao e registrador")
+            if args[0].upper() not in SENSORS:
+                raise ValueError(f"Linha {line_num}: Sensor invalido: {args[0]}")
+            if args[1].upper() not in WAIT_RELATIONS:
+                raise ValueError(f"Linha {line_num}: Relacao invalida: {args[1]}")
+            if args[2].upper() not in valid_regs:
+                raise ValueError(f"Linha {line_num}: Registrador invalido: {args[2]}")
+        
+        elif op == "WAITCHG":
+            if len(args) == 0:
+                raise ValueError(f"Linha {line_num}: WAITCHG requer ao menos um sensor")
+            for arg in args:
+                if arg.upper() not in SENSORS:
+                    raise ValueError(f"Linha {line_num}: Sensor invalido: {arg}")
+        
+        # Acesso a memoria: registrador, base, registrador de indice
+        elif op in ["LOAD", "STORE"]:
+            if len(args) != 3:
+                raise ValueError(f"Linha {line_num}: {op} requer registrador, base e indice")
+            if args[0].upper() not in valid_regs or args[2].upper() not in valid_regs:
+                raise ValueError(f"Linha {line_num}: Argumentos devem ser registradores validos")
+            try:
+                base = int(args[1])
+            except ValueError:
+                raise ValueError(f"Linha {line_num}: {op} requer base inteira")
+            if base not in self.segments:
+                raise ValueError(f"Linha {line_num}: Nenhum segmento DATA em {base}")
+        
+        # Salto indexado: registrador, base, label padrao e tabela de labels
+        elif op == "JTABLE":
+            if len(args) < 4:
+                raise ValueError(f"Linha {line_num}: JTABLE requer registrador, base, padrao e ao menos um label")
+            if args[0].upper() not in valid_regs:
+                raise ValueError(f"Linha {line_num}: Primeiro argumento deve ser registrador")
+            try:
+                int(args[1])
+            except ValueError:
+                raise ValueError(f"Linha {line_num}: JTABLE requer base inteira")
+        
         # Instrucoes com label
         elif op == "GOTO":
             if len(args) != 1:
                 raise ValueError(f"Linha {line_num}: GOTO requer label")
         
+        # Chamada: label e numero de argumentos
+        elif op == "CALL":
+            if len(args) != 2:
+                raise ValueError(f"Linha {line_num}: CALL requer label e numero de argumentos")
+            try:
+                n = int(args[1])
+            except ValueError:
+                raise ValueError(f"Linha {line_num}: CALL requer numero de argumentos inteiro")
+            if not (0 <= n <= NUM_ARG_REGS):
+                raise ValueError(f"Linha {line_num}: CALL aceita de 0 a {NUM_ARG_REGS} argumentos")
+        
         # SETMODE requer valor
         elif op == "SETMODE":
             if len(args) != 1:
@@ -260,6 +574,18 @@ class AirFryerVM:
             except ValueError:
                 raise ValueError(f"Linha {line_num}: SETMODE requer valor inteiro")
         
+        # PRINTFMT requer id do template e um operando por marcador
+        elif op == "PRINTFMT":
+            if len(args) < 2:
+                raise ValueError(f"Linha {line_num}: PRINTFMT requer template e ao menos um operando")
+            try:
+                int(args[0])
+            except ValueError:
+                raise ValueError(f"Linha {line_num}: PRINTFMT requer id inteiro")
+            for arg in args[1:]:
+                if arg.upper() not in valid_regs and arg.upper() != "STACK":
+                    raise ValueError(f"Linha {line_num}: Operando invalido: {arg}")
+        
         # SPRINT requer id
         elif op == "SPRINT":
             if len(args) != 1:
@@ -288,11 +614,17 @@ class AirFryerVM:
             raise RuntimeError(f"Limite de steps excedido ({self.max_steps}). Possivel loop infinito.")
         
         instr = self.program[self.pc]
+        trace = self.trace
+        if trace is not None:
+            trace.before(self)
         
         try:
             self._execute_instruction(instr)
         except Exception as e:
             raise RuntimeError(f"Erro na linha {instr.line_num}: {e}")
+        
+        if trace is not None:
+            trace.after(self, instr)
 
     def _execute_instruction(self, instr: Instr):
         """
@@ -336,24 +668,94 @@ class AirFryerVM:
                 self.registers[r] -= 1
                 self.pc += 1
         
+        elif op == "DECJNZ":
+            # Fim de laco contado: decremento e salto em uma instrucao
+            r = reg(args[0])
+            self.registers[r] -= 1
+            if self.registers[r] != 0:
+                label = args[1]
+                if label not in self.labels:
+                    raise ValueError(f"Label nao encontrado: {label}")
+                self.pc = self.labels[label]
+            else:
+                self.pc += 1
+        
         elif op == "GOTO":
             label = args[0]
             if label not in self.labels:
                 raise ValueError(f"Label nao encontrado: {label}")
             self.pc = self.labels[label]
         
+        elif op == "JTABLE":
+            index = self.registers[reg(args[0])] - int(args[1])
+            table = args[3:]
+            label = table[index] if 0 <= index < len(table) else args[2]
+            if label not in self.labels:
+                raise ValueError(f"Label nao encontrado: {label}")
+            self.pc = self.labels[label]
+        
         elif op == "PUSH":
             self.stack.append(self.registers[reg(args[0])])
             self.pc += 1
         
+        elif op == "CALL":
+            label = args[0]
+            if label not in self.labels:
+                raise ValueError(f"Label nao encontrado: {label}")
+            if len(self.frames) >= MAX_FRAMES:
+                raise RuntimeError(f"Pilha de chamadas excedida ({MAX_FRAMES} quadros)")
+            n = int(args[1])
+            if len(self.stack) < n:
+                raise RuntimeError("CALL sem argumentos suficientes na pilha")
+            saved = tuple(self.registers[f"A{i}"] for i in range(NUM_ARG_REGS))
+            self.frames.append((self.pc + 1, saved))
+            for i in range(n - 1, -1, -1):
+                self.registers[f"A{i}"] = self.stack.pop()
+            self.pc = self.labels[label]
+        
+        elif op == "RET":
+            if not self.frames:
+                raise RuntimeError("RET sem CALL correspondente")
+            self.pc, saved = self.frames.pop()
+            for i, value in enumerate(saved):
+                self.registers[f"A{i}"] = value
+        
         elif op == "POP":
             if not self.stack:
                 raise RuntimeError("POP em pilha vazia")
             self.registers[reg(args[0])] = self.stack.pop()
             self.pc += 1
         
+        elif op == "LOAD":
+            self.registers[reg(args[0])] = self.memory[self._address(args[1], args[2])]
+            self.pc += 1
+        
+        elif op == "STORE":
+            self.memory[self._address(args[1], args[2])] = self.registers[reg(args[0])]
+            self.pc += 1
+        
+        # Sensores
+        elif op == "READ":
+            self.registers[reg(args[0])] = self.readonly_registers[args[1].upper()]
+            self.pc += 1
+        
+        elif op == "WAIT":
+            sensor = args[0].upper()
+            relation = WAIT_RELATIONS[args[1].upper()]
+            limit = self.registers[reg(args[2])]
+            self._wait(lambda: relation(self.readonly_registers[sensor], limit),
+                       f"{sensor} {args[1].upper()} {limit}")
+            self.pc += 1
+        
+        elif op == "WAITCHG":
+            sensors = [a.upper() for a in args]
+            before = [self.readonly_registers[x] for x in sensors]
+            self._wait(lambda: [self.readonly_registers[x] for x in sensors] != before,
+                       f"mudanca em {' '.join(sensors)}")
+            self.pc += 1
+        
         elif op == "HALT":
-            print("\n=== PROGRAMA FINALIZADO ===")
+            print("\n=== PROGRAMA FINALIZADO ===", file=self.output)
             self.halted = True
         
         # Instrucoes aritmeticas (inteiros)
@@ -383,39 +785,51 @@ class AirFryerVM:
             self.registers[reg(args[0])] %= divisor
             self.pc += 1
         
-        # Instrucoes aritmeticas (fixed-point)
+        # Instrucoes aritmeticas (frac: uma operacao de double cada)
+        elif op == "SETF":
+            self.registers[reg(args[0])] = float(args[1])
+            self.pc += 1
+        
         elif op == "ADDF":
-            self.registers[reg(args[0])] += self.registers[reg(args[1])]
+            r = reg(args[0])
+            self.registers[r] = float(self.registers[r]) + self.registers[reg(args[1])]
             self.pc += 1
         
         elif op == "SUBF":
-            self.registers[reg(args[0])] -= self.registers[reg(args[1])]
+            r = reg(args[0])
+            self.registers[r] = float(self.registers[r]) - self.registers[reg(args[1])]
             self.pc += 1
         
         elif op == "MULF":
-            # Multiplicacao fixed-point: (a * b) / 100
-            a = self.registers[reg(args[0])]
-            b = self.registers[reg(args[1])]
-            self.registers[reg(args[0])] = (a * b) // 100
+            r = reg(args[0])
+            self.registers[r] = float(self.registers[r]) * self.registers[reg(args[1])]
             self.pc += 1
         
         elif op == "DIVF":
-            # Divisao fixed-point: (a * 100) / b
-            a = self.registers[reg(args[0])]
-            b = self.registers[reg(args[1])]
-            if b == 0:
+            r = reg(args[0])
+            divisor = self.registers[reg(args[1])]
+            if divisor == 0:
                 raise RuntimeError("Divisao por zero")
-            self.registers[reg(args[0])] = (a * 100) // b
+            self.registers[r] = float(self.registers[r]) / divisor
+            self.pc += 1
+        
+        elif op == "MODF":
+            r = reg(args[0])
+            divisor = self.registers[reg(args[1])]
+            if divisor == 0:
+                raise RuntimeError("Divisao por zero")
+            self.registers[r] = float(self.registers[r]) % divisor
             self.pc += 1
         
         elif op == "ITOF":
-            # Converter int para fixed-point
-            self.registers[reg(args[0])] *= 100
+            r = reg(args[0])
+            self.registers[r] = float(self.registers[r])
             self.pc += 1
         
         elif op == "FTOI":
-            # Converter fixed-point para int
-            self.registers[reg(args[0])] //= 100
+            # Trunca em direcao a zero
+            r = reg(args[0])
+            self.registers[r] = int(self.registers[r])
             self.pc += 1
         
         # Instrucoes de comparacao (resultado no primeiro operando)
@@ -484,24 +898,24 @@ class AirFryerVM:
         # Instrucoes de impressao
         elif op == "PRINT":
             # Compatibilidade: imprime TIME
-            print(self.registers["TIME"])
+            print(self.registers["TIME"], file=self.output)
             self.pc += 1
         
         elif op == "PRINTI":
             # Imprime como inteiro
-            print(self.registers[reg(args[0])], end=' ')
+            print(self.registers[reg(args[0])], end=' ', file=self.output)
             self.pc += 1
         
         elif op == "PRINTF":
-            # Imprime como frac (fixed-point / 100)
+            # Imprime como frac
             value = self.registers[reg(args[0])]
-            print(f"{value / 100:.2f}", end=' ')
+            print(f"{value:.2f}", end=' ', file=self.output)
             self.pc += 1
         
         elif op == "PRINTB":
             # Imprime como bool
             value = self.registers[reg(args[0])]
-            print("verdadeiro" if value else "falso", end=' ')
+            print("verdadeiro" if value else "falso", end=' ', file=self.output)
             self.pc += 1
         
         elif op == "SPRINT":
@@ -509,7 +923,15 @@ class AirFryerVM:
             str_id = val(args[0])
             if str_id not in self.strings:
                 raise ValueError(f"String id {str_id} nao encontrado")
-            print(self.strings[str_id], end=' ')
+            print(self.strings[str_id], end=' ', file=self.output)
+            self.pc += 1
+        
+        elif op == "PRINTFMT":
+            # Monta a linha inteira e imprime de uma vez
+            str_id = int(args[0])
+            if str_id not in self.strings:
+                raise ValueError(f"String id {str_id} nao encontrado")
+            print(self._format(self.strings[str_id], args[1:]), end=' ', file=self.output)
             self.pc += 1
         
         # Instrucoes tematicas
@@ -517,6 +939,8 @@ class AirFryerVM:
             mode = val(args[0])
             self.readonly_registers["MODE"] = mode
             self.readonly_registers["STATE"] = 1  # Ativa
+            # Modo manual (preaquecer) usa POWER como alvo; presets tem o seu
+            self.setpoint = self.registers["POWER"] if mode == 0 else MODE_PRESETS.get(mode, 0)
             self.pc += 1
         
         elif op == "PAUSE":
@@ -530,11 +954,69 @@ class AirFryerVM:
         elif op == "STOP":
             self.readonly_registers["STATE"] = 0  # Parado
             self.registers["POWER"] = 0
+            self.setpoint = 0
             self.pc += 1
         
         else:
             raise ValueError(f"Instrucao desconhecida: {op}")
 
+    def _target_temp(self) -> int:
+        """
+        Temperatura para onde TEMP converge no estado atual
+        """
+        if self.readonly_registers["STATE"] == 1 and self.setpoint > 0:
+            return self.setpoint
+        return AMBIENT_TEMP
+
+    def _tick(self) -> bool:
+        """
+        Avanca o relogio virtual em 1 segundo; retorna False se nada mudaria
+        """
+        temp = self.readonly_registers["TEMP"]
+        target = self._target_temp()
+        source = self.sensor_source
+        if temp == target or (source is not None and "TEMP" in source.sensors):
+            # Modelo parado: so a fonte de sensores muda algo, na proxima amostra
+            if source is None:
+                return False
+            next_time = source.next_time(self.clock)
+            if next_time is None:
+                return False
+            self.clock = next_time
+            self._apply_sensors()
+            return True
+        if temp < target:
+            temp = min(target, temp + HEAT_RATE)
+        else:
+            temp = max(target, temp - COOL_RATE)
+        self.readonly_registers["TEMP"] = temp
+        self.clock += 1
+        if source is not None:
+            self._apply_sensors()
+        return True
+
+    def _wait(self, ready, description: str):
+        """
+        Suspende o programa ate ready() valer. Nenhuma instrucao roda durante
+        a espera: so o modelo termico (e a fonte de sensores) avanca. Se os
+        sensores se estabilizam antes disso, o programa nunca acordaria.
+        """
+        while not ready():
+            if not self._tick():
+                raise RuntimeError(f"Espera infinita: {description} nunca acontece "
+                                   f"(TEMP estavel em {self.readonly_registers['TEMP']})")
+
+    def _address(self, base_arg: str, index_reg: str) -> int:
+        """
+        Calcula base + indice, verificando os limites do segmento
+        """
+        base = int(base_arg)
+        index = self.registers[index_reg.upper()]
+        size = self.segments[base]
+        if not (0 <= index < size):
+            raise RuntimeError(f"Indice {index} fora do segmento em {base} (tamanho {size})")
+        return base + index
+
     def run(self):
         """
         Executa o programa ate HALT ou erro
@@ -550,11 +1032,754 @@ class AirFryerVM:
             "registers": dict(self.registers),
             "readonly": dict(self.readonly_registers),
             "stack": list(self.stack),
+            "frames": len(self.frames),
+            "memory": list(self.memory),
+            "clock": self.clock,
+            "setpoint": self.setpoint,
+            "pc": self.pc,
+            "halted": self.halted,
+            "steps": self.steps,
+            "program_hash": self.program_hash.hex()
+        }
+
+    def snapshot(self, path: str):
+        """
+        Grava o estado da execucao num checkpoint binario (ver Checkpoint)
+        """
+        with open(path, "wb") as f:
+            f.write(self.checkpoint_bytes())
+
+    def checkpoint_bytes(self) -> bytes:
+        """
+        Conteudo do checkpoint do estado atual
+        """
+        cells = [self.registers[name] for name in REGISTERS]
+        cells += [self.readonly_registers[name] for name in SENSORS]
+        cells += self.stack
+        for ret, saved in self.frames:
+            cells.append(ret)
+            cells += saved
+        cells += self.memory
+        
+        tags = bytearray(len(cells))
+        payload = bytearray(8 * len(cells))
+        for i, value in enumerate(cells):
+            if isinstance(value, float):
+                tags[i] = 1
+                struct.pack_into("<d", payload, 8 * i, value)
+            elif -(1 << 63) <= value < (1 << 63):
+                struct.pack_into("<q", payload, 8 * i, value)
+            else:
+                raise ValueError(f"Valor {value} nao cabe em 64 bits")
+        tags += bytes(-len(tags) % 8)
+        
+        header = CHECKPOINT_HEADER.pack(
+            CHECKPOINT_MAGIC, CHECKPOINT_VERSION, self.program_hash,
+            self.pc, self.steps, self.clock, self.setpoint, int(self.halted),
+            len(self.stack), len(self.frames), len(self.memory))
+        return header + bytes(tags) + bytes(payload)
+
+    def restore(self, path: str):
+        """
+        Restaura o estado gravado por snapshot (o programa ja deve estar carregado)
+        """
+        Checkpoint.open(path).restore(self)
+
+
+class Checkpoint:
+    """
+    Checkpoint mapeado em memoria. As celulas sao decodificadas uma vez, na
+    abertura; restore() so copia listas, para restaurar muitas VMs
+    (ramificacoes de cenarios) a partir do mesmo arquivo.
+    """
+
+    __slots__ = ("program_hash", "pc", "steps", "clock", "setpoint", "halted",
+                 "registers", "sensors", "stack", "frames", "memory")
+
+    @classmethod
+    def open(cls, path: str) -> "Checkpoint":
+        with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+            return cls(mm)
+
+    def __init__(self, buf):
+        size = CHECKPOINT_HEADER.size
+        if len(buf) < size:
+            raise ValueError("Checkpoint truncado")
+        (magic, version, self.program_hash, self.pc, self.steps, self.clock,
+         self.setpoint, halted, num_stack, num_frames,
+         num_memory) = CHECKPOINT_HEADER.unpack_from(buf, 0)
+        if magic != CHECKPOINT_MAGIC:
+            raise ValueError("Arquivo nao e um checkpoint da AirFryerVM")
+        if version != CHECKPOINT_VERSION:
+            raise ValueError(f"Versao de checkpoint nao suportada: {version}")
+        self.halted = bool(halted)
+        
+        n = len(REGISTERS) + len(SENSORS) + num_stack + FRAME_CELLS * num_frames + num_memory
+        tags_size = n + (-n % 8)
+        if len(buf) != size + tags_size + 8 * n:
+            raise ValueError("Checkpoint truncado")
+        
+        # Cada celula e lida como int64 e como double; a tag escolhe
+        view = memoryview(buf)
+        tags = bytes(view[size:size + n])
+        payload = view[size + tags_size:size + tags_size + 8 * n]
+        ints = payload.cast("q")
+        floats = payload.cast("d")
+        cells = [floats[i] if tag else ints[i] for i, tag in enumerate(tags)]
+        ints.release()
+        floats.release()
+        payload.release()
+        view.release()
+        
+        pos = len(REGISTERS)
+        self.registers = dict(zip(REGISTERS, cells[:pos]))
+        self.sensors = dict(zip(SENSORS, cells[pos:pos + len(SENSORS)]))
+        pos += len(SENSORS)
+        self.stack = cells[pos:pos + num_stack]
+        pos += num_stack
+        self.frames = [(cells[p], tuple(cells[p + 1:p + FRAME_CELLS]))
+                       for p in range(pos, pos + FRAME_CELLS * num_frames, FRAME_CELLS)]
+        pos += FRAME_CELLS * num_frames
+        self.memory = cells[pos:]
+
+    def restore(self, vm: AirFryerVM):
+        """
+        Copia o estado para vm, que deve ter o mesmo programa carregado
+        """
+        if vm.program_hash != self.program_hash:
+            raise ValueError("Checkpoint gravado com outro programa")
+        if len(self.memory) != len(vm.memory):
+            raise ValueError("Checkpoint com memoria de dados incompativel")
+        if isinstance(vm, FastAirFryerVM):
+            vm.regs[:] = [self.registers[name] for name in REGISTERS]
+            vm.sensors[:] = [self.sensors[name] for name in SENSORS]
+        else:
+            vm.registers.update(self.registers)
+            vm.readonly_registers.update(self.sensors)
+        vm.stack[:] = self.stack
+        vm.frames[:] = self.frames
+        vm.memory[:] = self.memory
+        vm.pc = self.pc
+        vm.steps = self.steps
+        vm.clock = self.clock
+        vm.setpoint = self.setpoint
+        vm.halted = self.halted
+
+
+class Halted(Exception):
+    """HALT executado (ou fim do programa) dentro do laco do FastAirFryerVM"""
+
+
+class FastAirFryerVM:
+    """
+    Motor rapido da AirFryerVM: mesmo conjunto de instrucoes, mesma saida e
+    mesmos erros da VM de referencia, para hosts sem a VM nativa.
+
+    Na carga cada instrucao vira uma funcao especializada (um construtor por
+    opcode em BUILDERS) que ja guarda os indices dos registradores, os
+    destinos dos saltos e as constantes e devolve o proximo PC; run() so
+    chama essas funcoes num laco com variaveis locais. Registradores e
+    sensores ficam em listas, na ordem de REGISTERS e SENSORS; registers e
+    readonly_registers devolvem copias em dicionario.
+
+    Diferencas: um label inexistente e erro de carga (e nao do salto) e nao
+    ha gancho de trace.
+    """
+
+    __slots__ = ("regs", "sensors", "clock", "setpoint", "strings", "memory",
+                 "segments", "stack", "frames", "program", "labels", "code",
+                 "program_hash", "pc", "halted", "steps", "max_steps", "output",
+                 "trace", "sensor_source", "source_indexes")
+
+    def __init__(self):
+        # As funcoes de cada instrucao guardam estas listas: o estado e
+        # sempre trocado no lugar, nunca por listas novas
+        self.regs: List = [0] * len(REGISTERS)
+        self.sensors: List = [AMBIENT_TEMP, 100, 0, 0]
+        self.clock: int = 0
+        self.setpoint: int = 0
+        self.strings: Dict[int, str] = {}
+        self.memory: List = []
+        self.segments: Dict[int, int] = {}
+        self.stack: List = []
+        self.frames: List[Tuple[int, Tuple[int, ...]]] = []
+        self.program: List[Instr] = []
+        self.labels: Dict[str, int] = {}
+        self.code: List = []
+        self.program_hash: bytes = bytes(32)
+        self.pc: int = 0
+        self.halted: bool = False
+        self.steps: int = 0
+        self.max_steps: int = 100000
+        self.output = None
+        self.trace = None
+        self.sensor_source = None
+        self.source_indexes: Tuple[int, ...] = ()
+
+    @property
+    def registers(self) -> Dict:
+        return dict(zip(REGISTERS, self.regs))
+
+    @property
+    def readonly_registers(self) -> Dict:
+        return dict(zip(SENSORS, self.sensors))
+
+    def load_program(self, source: str):
+        """
+        Carrega um programa assembly (o parser e a validacao sao os da VM
+        de referencia) e monta a funcao de cada instrucao
+        """
+        ref = AirFryerVM()
+        ref.load_program(source)
+        self.program = ref.program
+        self.labels = ref.labels
+        self.strings = ref.strings
+        self.segments = ref.segments
+        self.program_hash = ref.program_hash
+        self.memory[:] = ref.memory
+        self.stack.clear()
+        self.frames.clear()
+        self.regs[:] = [0] * len(REGISTERS)
+        self.sensors[:] = [AMBIENT_TEMP, 100, 0, 0]
+        self.pc = 0
+        self.halted = False
+        self.steps = 0
+        self.clock = 0
+        self.setpoint = 0
+        if self.sensor_source is not None:
+            self._apply_sensors()
+        
+        code = []
+        for i, instr in enumerate(self.program):
+            try:
+                code.append(self.BUILDERS[instr.op](self, instr, i))
+            except ValueError as e:
+                raise ValueError(f"Linha {instr.line_num}: {e}")
+        # Fim do programa sem HALT (tambem destino de labels no fim)
+        code.append(self._op_end(None, len(code)))
+        self.code = code
+
+    def set_sensor_source(self, source):
+        """
+        Passa a ler os sensores de source (None volta ao modelo termico)
+        """
+        self.sensor_source = source
+        self.source_indexes = () if source is None else tuple(SENSORS.index(name) for name in source.sensors)
+        if source is not None:
+            self._apply_sensors()
+
+    def _apply_sensors(self):
+        values = self.sensor_source.sample(self.clock)
+        if values is not None:
+            sensors = self.sensors
+            for s, value in zip(self.source_indexes, values):
+                sensors[s] = value
+
+    def _label(self, label: str) -> int:
+        if label not in self.labels:
+            raise ValueError(f"Label nao encontrado: {label}")
+        return self.labels[label]
+
+    # ===== EXECUCAO =====
+
+    def step(self):
+        """
+        Executa uma instrucao
+        """
+        if self.halted:
+            return
+        pc = self.pc
+        if not (0 <= pc < len(self.program)):
+            self.halted = True
+            return
+        
+        self.steps += 1
+        if self.steps > self.max_steps:
+            raise RuntimeError(f"Limite de steps excedido ({self.max_steps}). Possivel loop infinito.")
+        try:
+            self.pc = self.code[pc]()
+        except Halted:
+            self.halted = True
+        except Exception as e:
+            raise RuntimeError(f"Erro na linha {self.program[pc].line_num}: {e}")
+
+    def run(self):
+        """
+        Executa o programa ate HALT ou erro
+        """
+        if self.halted:
+            return
+        code = self.code
+        end = len(self.program)
+        pc = self.pc
+        steps = self.steps
+        if not (0 <= pc < end):
+            self.halted = True
+            return
+        try:
+            # O range conta os steps: so HALT, o fim do programa e os erros
+            # saem do laco antes do limite
+            for steps in range(steps + 1, self.max_steps + 1):
+                pc = code[pc]()
+        except Halted:
+            if pc == end:
+                steps -= 1      # Sair pelo fim do programa nao conta como step
+            self.halted = True
+            return
+        except Exception as e:
+            raise RuntimeError(f"Erro na linha {self.program[pc].line_num}: {e}")
+        finally:
+            self.pc = pc
+            self.steps = steps
+        
+        if pc < end:
+            self.steps = self.max_steps + 1
+            raise RuntimeError(f"Limite de steps excedido ({self.max_steps}). Possivel loop infinito.")
+        self.halted = True
+
+    def _tick(self) -> bool:
+        """
+        Avanca o relogio virtual em 1 segundo; retorna False se nada mudaria
+        """
+        sensors = self.sensors
+        temp = sensors[SENSOR_TEMP]
+        target = self.setpoint if sensors[SENSOR_STATE] == 1 and self.setpoint > 0 else AMBIENT_TEMP
+        source = self.sensor_source
+        if temp == target or (source is not None and SENSOR_TEMP in self.source_indexes):
+            if source is None:
+                return False
+            next_time = source.next_time(self.clock)
+            if next_time is None:
+                return False
+            self.clock = next_time
+            self._apply_sensors()
+            return True
+        if temp < target:
+            temp = min(target, temp + HEAT_RATE)
+        else:
+            temp = max(target, temp - COOL_RATE)
+        sensors[SENSOR_TEMP] = temp
+        self.clock += 1
+        if source is not None:
+            self._apply_sensors()
+        return True
+
+    def _wait(self, ready, description: str):
+        while not ready():
+            if not self._tick():
+                raise RuntimeError(f"Espera infinita: {description} nunca acontece "
+                                   f"(TEMP estavel em {self.sensors[SENSOR_TEMP]})")
+
+    # Checkpoints no mesmo formato da VM de referencia
+    checkpoint_bytes = AirFryerVM.checkpoint_bytes
+    snapshot = AirFryerVM.snapshot
+    restore = AirFryerVM.restore
+
+    def state(self) -> Dict:
+        """
+        Retorna o estado atual da VM (mesmo formato da VM de referencia)
+        """
+        return {
+            "registers": self.registers,
+            "readonly": self.readonly_registers,
+            "stack": list(self.stack),
+            "frames": len(self.frames),
+            "memory": list(self.memory),
+            "clock": self.clock,
+            "setpoint": self.setpoint,
             "pc": self.pc,
             "halted": self.halted,
-            "steps": self.steps
+            "steps": self.steps,
+            "program_hash": self.program_hash.hex()
         }
 
+    # ===== CONSTRUTORES (instrucao -> funcao que devolve o proximo PC) =====
+
+    def _op_set(self, instr, i):
+        regs, d, value, nxt = self.regs, REG_INDEX[instr.args[0].upper()], int(instr.args[1]), i + 1
+        def op():
+            regs[d] = value
+            return nxt
+        return op
+
+    def _op_setf(self, instr, i):
+        regs, d, value, nxt = self.regs, REG_INDEX[instr.args[0].upper()], float(instr.args[1]), i + 1
+        def op():
+            regs[d] = value
+            return nxt
+        return op
+
+    def _op_inc(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            regs[d] += 1
+            return nxt
+        return op
+
+    def _op_dec(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            regs[d] -= 1
+            return nxt
+        return op
+
+    def _op_decjz(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        target = self._label(instr.args[1])
+        def op():
+            if regs[d] == 0:
+                return target
+            regs[d] -= 1
+            return nxt
+        return op
+
+    def _op_decjnz(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        target = self._label(instr.args[1])
+        def op():
+            value = regs[d] - 1
+            regs[d] = value
+            return target if value != 0 else nxt
+        return op
+
+    def _op_goto(self, instr, i):
+        target = self._label(instr.args[0])
+        def op():
+            return target
+        return op
+
+    def _op_jz(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        target = self._label(instr.args[1])
+        def op():
+            return target if regs[d] == 0 else nxt
+        return op
+
+    def _op_jnz(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        target = self._label(instr.args[1])
+        def op():
+            return target if regs[d] != 0 else nxt
+        return op
+
+    def _op_jtable(self, instr, i):
+        regs, d, base = self.regs, REG_INDEX[instr.args[0].upper()], int(instr.args[1])
+        default = self._label(instr.args[2])
+        table = [self._label(label) for label in instr.args[3:]]
+        size = len(table)
+        def op():
+            index = regs[d] - base
+            return table[index] if 0 <= index < size else default
+        return op
+
+    def _op_push(self, instr, i):
+        regs, push, d, nxt = self.regs, self.stack.append, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            push(regs[d])
+            return nxt
+        return op
+
+    def _op_pop(self, instr, i):
+        regs, stack, d, nxt = self.regs, self.stack, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            if not stack:
+                raise RuntimeError("POP em pilha vazia")
+            regs[d] = stack.pop()
+            return nxt
+        return op
+
+    def _op_call(self, instr, i):
+        regs, stack, frames, nxt = self.regs, self.stack, self.frames, i + 1
+        target, n = self._label(instr.args[0]), int(instr.args[1])
+        first, last = REG_INDEX["A0"], REG_INDEX["A0"] + NUM_ARG_REGS
+        def op():
+            if len(frames) >= MAX_FRAMES:
+                raise RuntimeError(f"Pilha de chamadas excedida ({MAX_FRAMES} quadros)")
+            if len(stack) < n:
+                raise RuntimeError("CALL sem argumentos suficientes na pilha")
+            frames.append((nxt, tuple(regs[first:last])))
+            if n:
+                # O ultimo empilhado vai para A(n-1)
+                regs[first:first + n] = stack[-n:]
+                del stack[-n:]
+            return target
+        return op
+
+    def _op_ret(self, instr, i):
+        regs, frames = self.regs, self.frames
+        first, last = REG_INDEX["A0"], REG_INDEX["A0"] + NUM_ARG_REGS
+        def op():
+            if not frames:
+                raise RuntimeError("RET sem CALL correspondente")
+            ret, saved = frames.pop()
+            regs[first:last] = saved
+            return ret
+        return op
+
+    def _op_load(self, instr, i):
+        regs, memory, nxt = self.regs, self.memory, i + 1
+        d, base, index_reg = REG_INDEX[instr.args[0].upper()], int(instr.args[1]), REG_INDEX[instr.args[2].upper()]
+        size = self.segments[base]
+        def op():
+            index = regs[index_reg]
+            if not (0 <= index < size):
+                raise RuntimeError(f"Indice {index} fora do segmento em {base} (tamanho {size})")
+            regs[d] = memory[base + index]
+            return nxt
+        return op
+
+    def _op_store(self, instr, i):
+        regs, memory, nxt = self.regs, self.memory, i + 1
+        s, base, index_reg = REG_INDEX[instr.args[0].upper()], int(instr.args[1]), REG_INDEX[instr.args[2].upper()]
+        size = self.segments[base]
+        def op():
+            index = regs[index_reg]
+            if not (0 <= index < size):
+                raise RuntimeError(f"Indice {index} fora do segmento em {base} (tamanho {size})")
+            memory[base + index] = regs[s]
+            return nxt
+        return op
+
+    def _op_read(self, instr, i):
+        regs, sensors, nxt = self.regs, self.sensors, i + 1
+        d, s = REG_INDEX[instr.args[0].upper()], SENSORS.index(instr.args[1].upper())
+        def op():
+            regs[d] = sensors[s]
+            return nxt
+        return op
+
+    def _op_wait(self, instr, i):
+        regs, sensors, nxt = self.regs, self.sensors, i + 1
+        name, rel_name = instr.args[0].upper(), instr.args[1].upper()
+        s, relation, limit_reg = SENSORS.index(name), WAIT_RELATIONS[rel_name], REG_INDEX[instr.args[2].upper()]
+        def op():
+            limit = regs[limit_reg]
+            if not relation(sensors[s], limit):
+                self._wait(lambda: relation(sensors[s], limit), f"{name} {rel_name} {limit}")
+            return nxt
+        return op
+
+    def _op_waitchg(self, instr, i):
+        sensors, nxt = self.sensors, i + 1
+        names = [a.upper() for a in instr.args]
+        indexes = [SENSORS.index(name) for name in names]
+        def op():
+            before = [sensors[s] for s in indexes]
+            self._wait(lambda: [sensors[s] for s in indexes] != before,
+                       f"mudanca em {' '.join(names)}")
+            return nxt
+        return op
+
+    def _op_halt(self, instr, i):
+        def op():
+            print("\n=== PROGRAMA FINALIZADO ===", file=self.output)
+            raise Halted()
+        return op
+
+    def _op_end(self, instr, i):
+        def op():
+            raise Halted()
+        return op
+
+    def _op_arith(self, instr, i):
+        regs, nxt = self.regs, i + 1
+        a, b, f = REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], ARITH_OPS[instr.op]
+        def op():
+            regs[a] = f(regs[a], regs[b])
+            return nxt
+        return op
+
+    def _op_divide(self, instr, i):
+        regs, nxt = self.regs, i + 1
+        a, b, f = REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], ARITH_OPS[instr.op]
+        def op():
+            divisor = regs[b]
+            if divisor == 0:
+                raise RuntimeError("Divisao por zero")
+            regs[a] = f(regs[a], divisor)
+            return nxt
+        return op
+
+    def _op_dividef(self, instr, i):
+        regs, nxt = self.regs, i + 1
+        a, b, f = REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], ARITH_OPS[instr.op]
+        def op():
+            divisor = regs[b]
+            if divisor == 0:
+                raise RuntimeError("Divisao por zero")
+            regs[a] = f(float(regs[a]), divisor)
+            return nxt
+        return op
+
+    def _op_arithf(self, instr, i):
+        regs, nxt = self.regs, i + 1
+        a, b, f = REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], ARITH_OPS[instr.op]
+        def op():
+            regs[a] = f(float(regs[a]), regs[b])
+            return nxt
+        return op
+
+    def _op_itof(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            regs[d] = float(regs[d])
+            return nxt
+        return op
+
+    def _op_ftoi(self, instr, i):
+        # Trunca em direcao a zero
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            regs[d] = int(regs[d])
+            return nxt
+        return op
+
+    def _op_compare(self, instr, i):
+        regs, nxt = self.regs, i + 1
+        a, b, f = REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], WAIT_RELATIONS[instr.op]
+        def op():
+            regs[a] = 1 if f(regs[a], regs[b]) else 0
+            return nxt
+        return op
+
+    def _op_and(self, instr, i):
+        regs, a, b, nxt = self.regs, REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], i + 1
+        def op():
+            regs[a] = 1 if (regs[a] and regs[b]) else 0
+            return nxt
+        return op
+
+    def _op_or(self, instr, i):
+        regs, a, b, nxt = self.regs, REG_INDEX[instr.args[0].upper()], REG_INDEX[instr.args[1].upper()], i + 1
+        def op():
+            regs[a] = 1 if (regs[a] or regs[b]) else 0
+            return nxt
+        return op
+
+    def _op_not(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            regs[d] = 0 if regs[d] else 1
+            return nxt
+        return op
+
+    def _op_print(self, instr, i):
+        regs, time, nxt = self.regs, REG_INDEX["TIME"], i + 1
+        def op():
+            # Compatibilidade: imprime TIME
+            print(regs[time], file=self.output)
+            return nxt
+        return op
+
+    def _op_printi(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            print(regs[d], end=' ', file=self.output)
+            return nxt
+        return op
+
+    def _op_printf(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            print(f"{regs[d]:.2f}", end=' ', file=self.output)
+            return nxt
+        return op
+
+    def _op_printb(self, instr, i):
+        regs, d, nxt = self.regs, REG_INDEX[instr.args[0].upper()], i + 1
+        def op():
+            print("verdadeiro" if regs[d] else "falso", end=' ', file=self.output)
+            return nxt
+        return op
+
+    def _op_sprint(self, instr, i):
+        regs, strings, nxt = self.regs, self.strings, i + 1
+        arg = instr.args[0]
+        try:
+            str_id, d = int(arg), None
+        except ValueError:
+            str_id, d = None, REG_INDEX[arg.upper()]
+        def op():
+            key = str_id if d is None else regs[d]
+            if key not in strings:
+                raise ValueError(f"String id {key} nao encontrado")
+            print(strings[key], end=' ', file=self.output)
+            return nxt
+        return op
+
+    def _op_printfmt(self, instr, i):
+        regs, stack, strings, nxt = self.regs, self.stack, self.strings, i + 1
+        str_id = int(instr.args[0])
+        # -1 = proximo valor desempilhado
+        sources = [-1 if a.upper() == "STACK" else REG_INDEX[a.upper()] for a in instr.args[1:]]
+        depth = sources.count(-1)
+        def op():
+            if str_id not in strings:
+                raise ValueError(f"String id {str_id} nao encontrado")
+            if len(stack) < depth:
+                raise RuntimeError("PRINTFMT sem valores suficientes na pilha")
+            stacked = iter(stack[len(stack) - depth:])
+            del stack[len(stack) - depth:]
+            values = [next(stacked) if k < 0 else regs[k] for k in sources]
+            print(format_template(strings[str_id], values), end=' ', file=self.output)
+            return nxt
+        return op
+
+    def _op_setmode(self, instr, i):
+        regs, sensors, nxt = self.regs, self.sensors, i + 1
+        mode = int(instr.args[0])
+        power = REG_INDEX["POWER"]
+        def op():
+            sensors[SENSOR_MODE] = mode
+            sensors[SENSOR_STATE] = 1
+            # Modo manual (preaquecer) usa POWER como alvo; presets tem o seu
+            self.setpoint = regs[power] if mode == 0 else MODE_PRESETS.get(mode, 0)
+            return nxt
+        return op
+
+    def _op_pause(self, instr, i):
+        sensors, nxt = self.sensors, i + 1
+        def op():
+            sensors[SENSOR_STATE] = 2
+            return nxt
+        return op
+
+    def _op_resume(self, instr, i):
+        sensors, nxt = self.sensors, i + 1
+        def op():
+            sensors[SENSOR_STATE] = 1
+            return nxt
+        return op
+
+    def _op_stop(self, instr, i):
+        regs, sensors, nxt = self.regs, self.sensors, i + 1
+        power = REG_INDEX["POWER"]
+        def op():
+            sensors[SENSOR_STATE] = 0
+            regs[power] = 0
+            self.setpoint = 0
+            return nxt
+        return op
+
+    BUILDERS = {
+        "SET": _op_set, "SETF": _op_setf, "INC": _op_inc, "DEC": _op_dec,
+        "DECJZ": _op_decjz, "DECJNZ": _op_decjnz, "GOTO": _op_goto,
+        "JZ": _op_jz, "JNZ": _op_jnz, "JTABLE": _op_jtable,
+        "PUSH": _op_push, "POP": _op_pop, "CALL": _op_call, "RET": _op_ret,
+        "LOAD": _op_load, "STORE": _op_store,
+        "READ": _op_read, "WAIT": _op_wait, "WAITCHG": _op_waitchg, "HALT": _op_halt,
+        "ADD": _op_arith, "SUB": _op_arith, "MUL": _op_arith,
+        "DIV": _op_divide, "MOD": _op_divide, "DIVF": _op_dividef, "MODF": _op_dividef,
+        "ADDF": _op_arithf, "SUBF": _op_arithf, "MULF": _op_arithf,
+        "ITOF": _op_itof, "FTOI": _op_ftoi,
+        "EQ": _op_compare, "NE": _op_compare, "LT": _op_compare,
+        "LE": _op_compare, "GT": _op_compare, "GE": _op_compare,
+        "AND": _op_and, "OR": _op_or, "NOT": _op_not,
+        "PRINT": _op_print, "PRINTI": _op_printi, "PRINTF": _op_printf,
+        "PRINTB": _op_printb, "SPRINT": _op_sprint, "PRINTFMT": _op_printfmt,
+        "SETMODE": _op_setmode, "PAUSE": _op_pause, "RESUME": _op_resume, "STOP": _op_stop,
+    }
+
 
 def main():
     """
@@ -567,11 +1792,29 @@ def main():
         print("\nOpcoes:")
         print("  -v, --verbose    Modo verbose (mostra estado apos cada instrucao)")
         print("  -d, --debug      Modo debug (passo a passo)")
+        print("  --snapshot <n> <arquivo>  Grava um checkpoint apos n steps e continua")
+        print("  --restore <arquivo>       Continua a execucao a partir de um checkpoint")
+        print("  --trace <arquivo>         Grava um trace binario (ver tracer.py)")
+        print("  --fast           Usa o motor rapido (FastAirFryerVM)")
+        print("  --sensors <arquivo>       Le os sensores de um trace gravado (ver sensors.py)")
         sys.exit(1)
     
     filename = sys.argv[1]
     verbose = "-v" in sys.argv or "--verbose" in sys.argv
     debug = "-d" in sys.argv or "--debug" in sys.argv
+    fast = "--fast" in sys.argv
+    snapshot_at, snapshot_path, restore_path, trace_path = None, None, None, None
+    sensors_path = None
+    args = sys.argv[2:]
+    for i, arg in enumerate(args):
+        if arg == "--snapshot" and i + 2 < len(args):
+            snapshot_at, snapshot_path = int(args[i + 1]), args[i + 2]
+        elif arg == "--restore" and i + 1 < len(args):
+            restore_path = args[i + 1]
+        elif arg == "--trace" and i + 1 < len(args):
+            trace_path = args[i + 1]
+        elif arg == "--sensors" and i + 1 < len(args):
+            sensors_path = args[i + 1]
     
     try:
         with open(filename, 'r') as f:
@@ -580,12 +1823,24 @@ def main():
         print(f"Erro: Arquivo '{filename}' nao encontrado.")
         sys.exit(1)
     
-    vm = AirFryerVM()
+    if fast and trace_path:
+        print("Erro: --trace so funciona com a VM de referencia (sem --fast)")
+        sys.exit(1)
+    vm = FastAirFryerVM() if fast else AirFryerVM()
     
     try:
+        if sensors_path:
+            from sensors import TraceSource
+            vm.set_sensor_source(TraceSource(sensors_path))
         print(f"Carregando programa: {filename}")
         vm.load_program(program)
         print(f"Programa carregado: {len(vm.program)} instrucoes, {len(vm.strings)} strings\n")
+        if restore_path:
+            vm.restore(restore_path)
+            print(f"Checkpoint restaurado: {restore_path} (step {vm.steps}, PC={vm.pc})\n")
+        if trace_path:
+            from tracer import Tracer
+            Tracer(vm, trace_path)
         
         if debug:
             print("=== MODO DEBUG ===")
@@ -609,6 +1864,10 @@ def main():
                 if verbose:
                     print("  Regs:", vm.registers)
         else:
+            if snapshot_path:
+                while not vm.halted and vm.steps < snapshot_at:
+                    vm.step()
+                vm.snapshot(snapshot_path)
             vm.run()
         
         print("\n\n=== ESTADO FINAL ===")
@@ -617,10 +1876,19 @@ def main():
         print(f"Sensores: {vm.readonly_registers}")
         if vm.stack:
             print(f"Stack: {vm.stack}")
+        if vm.memory:
+            print(f"Memoria: {vm.memory}")
+        if vm.clock:
+            print(f"Relogio virtual: {vm.clock} s")
         
     except Exception as e:
         print(f"\nERRO: {e}")
         sys.exit(1)
+    finally:
+        if vm.trace is not None:
+            vm.trace.close()
+        if vm.sensor_source is not None:
+            vm.sensor_source.close()
 
 
 if __name__ == "__main__":
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Comparacao de desempenho dos motores Python da AirFryerVM
+=========================================================
+
+Roda cada .mwasm na AirFryerVM (referencia) e na FastAirFryerVM, repetindo
+ate somar ao menos `--min-time` segundos por motor, confere se as saidas e
+os estados finais sao iguais e imprime steps/s e o ganho de cada programa.
+
+Uso:
+  python3 vm/bench.py [--min-time s] <arquivo.mwasm>...
+"""
+
+import io
+import sys
+import time
+from typing import List, Tuple
+
+from airfryer_vm import AirFryerVM, FastAirFryerVM
+
+DEFAULT_MIN_TIME = 0.5  # Segundos medidos por motor e programa
+
+
+def measure(cls, source: str, min_time: float) -> Tuple[float, int, str, dict]:
+    """
+    (segundos por execucao, steps, saida, estado final) de um motor
+    """
+    elapsed, runs = 0.0, 0
+    while elapsed < min_time or runs == 0:
+        vm = cls()
+        vm.output = io.StringIO()
+        vm.load_program(source)
+        start = time.perf_counter()
+        vm.run()
+        elapsed += time.perf_counter() - start
+        runs += 1
+    return elapsed / runs, vm.steps, vm.output.getvalue(), vm.state()
+
+
+def main():
+    args = sys.argv[1:]
+    min_time = DEFAULT_MIN_TIME
+    if len(args) >= 2 and args[0] == "--min-time":
+        min_time = float(args[1])
+        args = args[2:]
+    if not args:
+        print("Uso: python3 bench.py [--min-time s] <arquivo.mwasm>...")
+        sys.exit(1)
+
+    print(f"{'programa':<24} {'steps':>8} {'ref (steps/s)':>14} {'fast (steps/s)':>15} {'ganho':>7}")
+    totals: List[float] = [0.0, 0.0]
+    failed = 0
+    for path in args:
+        with open(path, "r") as f:
+            source = f.read()
+        try:
+            ref = measure(AirFryerVM, source, min_time)
+            fast = measure(FastAirFryerVM, source, min_time)
+        except Exception as e:
+            print(f"{path:<24} ERRO: {e}")
+            failed += 1
+            continue
+        if ref[1:] != fast[1:]:
+            print(f"{path:<24} DIVERGENCIA entre os motores")
+            failed += 1
+            continue
+        totals[0] += ref[0]
+        totals[1] += fast[0]
+        steps = ref[1]
+        name = path.rsplit("/", 1)[-1]
+        print(f"{name:<24} {steps:>8} {steps / ref[0]:>14.0f} {steps / fast[0]:>15.0f} "
+              f"{ref[0] / fast[0]:>6.1f}x")
+
+    if totals[1] > 0:
+        print(f"\nGanho total (uma execucao de cada programa): {totals[0] / totals[1]:.1f}x")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,191 @@
+/*
+ * afrt.c
+ * Runtime dos executaveis gerados com -target x86-64
+ */
+
+#include "afrt.h"
+#include "runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+/* Tamanho das mensagens de erro de um comando */
+#define ERROR_SIZE 400
+
+/* Estado da air fryer; tempo e o que a VM deixaria em TIME depois de */
+/* cozinhar (contagem ate 0) ou aquecer, impresso por agitar */
+static Oven oven;
+static int64_t tempo;
+
+static void afrt_fail(int line, const char *fmt, ...)
+    __attribute__((noreturn, format(printf, 2, 3)));
+
+static void afrt_fail(int line, const char *fmt, ...) {
+    char msg[ERROR_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    printf("\nERRO: Erro na linha %d: %s\n", line, msg);
+    exit(1);
+}
+
+void afrt_iniciar(void) {
+    oven_init(&oven);
+    tempo = 0;
+}
+
+void afrt_finalizar(void) {
+    printf("\n");
+    fflush(stdout);
+}
+
+int64_t afrt_read(int sensor) {
+    return oven.sensors[sensor];
+}
+
+/* ===== COMANDOS ===== */
+
+void afrt_preaquecer(int64_t temperatura) {
+    Value power = value_int(temperatura);
+    oven_setmode(&oven, 0, &power);
+}
+
+void afrt_cozinhar(int64_t temperatura, int64_t t) {
+    (void)temperatura;
+    (void)t;
+    tempo = 0;
+}
+
+void afrt_aquecer(int64_t t) {
+    tempo = t;
+}
+
+void afrt_agitar(void) {
+    printf("%lld\n", (long long)tempo);
+}
+
+void afrt_modo(int64_t modo) {
+    /* Presets ignoram POWER */
+    Value power = value_int(0);
+    oven_setmode(&oven, modo, &power);
+}
+
+void afrt_pausar(void) {
+    oven_pause(&oven);
+}
+
+void afrt_continuar(void) {
+    oven_resume(&oven);
+}
+
+void afrt_parar(void) {
+    oven_stop(&oven);
+}
+
+/* ===== IMPRESSAO ===== */
+
+void afrt_print_int(int64_t x) {
+    Value v = value_int(x);
+    rt_print_int(stdout, &v);
+}
+
+void afrt_print_frac(double x) {
+    Value v = value_frac(x);
+    rt_print_frac(stdout, &v);
+}
+
+void afrt_print_bool(int64_t x) {
+    Value v = value_int(x);
+    rt_print_bool(stdout, &v);
+}
+
+void afrt_print_text(const char *text) {
+    printf("%s ", text);
+}
+
+void afrt_print_fmt(const char *tmpl, const int64_t *values, int n, int line) {
+    Value *args = malloc((n + 1) * sizeof(Value));
+    int next = 0;
+    for (const char *c = tmpl; *c && next < n; c++) {
+        if (*c != '%' || c[1] == '\0') continue;
+        c++;
+        if (*c == '%') continue;
+        if (*c == 'f') {
+            double f;
+            memcpy(&f, &values[next], sizeof(f));
+            args[next] = value_frac(f);
+        } else {
+            args[next] = value_int(values[next]);
+        }
+        next++;
+    }
+    char err[ERROR_SIZE];
+    int ok = rt_print_fmt(stdout, tmpl, args, n, err, sizeof(err));
+    free(args);
+    if (!ok) afrt_fail(line, "%s", err);
+}
+
+/* ===== SENSORES ===== */
+
+void afrt_wait(int sensor, int rel, int64_t limit, int frac, int line) {
+    Value v = value_int(limit);
+    if (frac) {
+        double f;
+        memcpy(&f, &limit, sizeof(f));
+        v = value_frac(f);
+    }
+    char err[ERROR_SIZE];
+    if (!oven_wait(&oven, sensor, rel, &v, err, sizeof(err))) afrt_fail(line, "%s", err);
+}
+
+void afrt_wait_change(unsigned mask, int line) {
+    int sensors[NUM_SENSORS];
+    int n = 0;
+    for (int s = 0; s < NUM_SENSORS; s++) {
+        if (mask & (1u << s)) sensors[n++] = s;
+    }
+    char err[ERROR_SIZE];
+    if (!oven_wait_change(&oven, sensors, n, err, sizeof(err))) afrt_fail(line, "%s", err);
+}
+
+/* ===== ARITMETICA ===== */
+
+static Value afrt_arith(Opcode op, Value a, Value b, int line) {
+    char err[ERROR_SIZE];
+    if (!rt_arith(op, &a, &b, err, sizeof(err))) afrt_fail(line, "%s", err);
+    return a;
+}
+
+int64_t afrt_div(int64_t a, int64_t b, int line) {
+    return afrt_arith(OP_DIV, value_int(a), value_int(b), line).v.i;
+}
+
+int64_t afrt_mod(int64_t a, int64_t b, int line) {
+    return afrt_arith(OP_MOD, value_int(a), value_int(b), line).v.i;
+}
+
+double afrt_fmod(double a, double b, int line) {
+    return afrt_arith(OP_MODF, value_frac(a), value_frac(b), line).v.f;
+}
+
+int64_t afrt_ftoi(double a, int line) {
+    Value v = value_frac(a);
+    char err[ERROR_SIZE];
+    if (!rt_ftoi(&v, err, sizeof(err))) afrt_fail(line, "%s", err);
+    return v.v.i;
+}
+
+void afrt_overflow(int line) {
+    afrt_fail(line, "Estouro de inteiro (64 bits)");
+}
+
+void afrt_div_zero(int line) {
+    afrt_fail(line, "Divisao por zero");
+}
+
+void afrt_bad_index(int line, int64_t index, int64_t base, int64_t size) {
+    afrt_fail(line, "Indice %lld fora do segmento em %lld (tamanho %lld)",
+              (long long)index, (long long)base, (long long)size);
+}
@@ -0,0 +1,67 @@
+/*
+ * afrt.h
+ * Runtime dos executaveis gerados com -target x86-64
+ *
+ * O assembly gerado pelo compilador (src/codegen_x86.c) guarda variaveis
+ * em registradores da maquina e chama daqui so a impressao, os sensores,
+ * os comandos da air fryer e os erros de execucao. Os argumentos sao
+ * escalares do ABI System V: inteiros e bools em int64_t, frac em double.
+ *
+ * Impressao, modelo termico e mensagens sao os de runtime.c, os mesmos
+ * da VM. Os erros citam a linha do .afs, nao a do .mwasm.
+ */
+
+#ifndef AFRT_H
+#define AFRT_H
+
+#include <stdint.h>
+
+/* Preparar o forno e a saida (chamada no inicio de main) */
+void afrt_iniciar(void);
+
+/* Terminar a ultima linha impressa e descarregar a saida */
+void afrt_finalizar(void);
+
+/* Ler um sensor (SensorKind: TEMP, WEIGHT, MODE, STATE) */
+int64_t afrt_read(int sensor);
+
+/* Comandos da air fryer */
+void afrt_preaquecer(int64_t temperatura);
+void afrt_cozinhar(int64_t temperatura, int64_t tempo);
+void afrt_aquecer(int64_t tempo);
+void afrt_agitar(void);
+void afrt_modo(int64_t modo);
+void afrt_pausar(void);
+void afrt_continuar(void);
+void afrt_parar(void);
+
+/* Impressao: cada peca seguida de um espaco, como na VM */
+void afrt_print_int(int64_t x);
+void afrt_print_frac(double x);
+void afrt_print_bool(int64_t x);
+void afrt_print_text(const char *text);
+
+/* Template de imprimir (ver codegen_print_template) com n valores de */
+/* 64 bits: os de "%f" sao os bits de um double, os demais inteiros */
+void afrt_print_fmt(const char *tmpl, const int64_t *values, int n, int line);
+
+/* quando: suspender ate (sensor rel limite) valer; rel na ordem de */
+/* VMRelation (EQ, NE, LT, LE, GT, GE), limite em bits de double se frac */
+void afrt_wait(int sensor, int rel, int64_t limit, int frac, int line);
+
+/* quando generico: suspender ate algum sensor de mask (bit = SensorKind) mudar */
+void afrt_wait_change(unsigned mask, int line);
+
+/* Caminhos lentos da aritmetica (divisor 0 ou -1, resto de frac, FTOI) */
+int64_t afrt_div(int64_t a, int64_t b, int line);
+int64_t afrt_mod(int64_t a, int64_t b, int line);
+double afrt_fmod(double a, double b, int line);
+int64_t afrt_ftoi(double a, int line);
+
+/* Erros de execucao: imprimem e encerram com status 1 */
+void afrt_overflow(int line) __attribute__((noreturn));
+void afrt_div_zero(int line) __attribute__((noreturn));
+void afrt_bad_index(int line, int64_t index, int64_t base, int64_t size)
+    __attribute__((noreturn));
+
+#endif /* AFRT_H */
@@ -0,0 +1,201 @@
+/*
+ * aot.c
+ * Runtime dos programas traduzidos por mwasm2c
+ */
+
+#include "aot.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define INITIAL_CAPACITY 16
+
+/* Tamanho das mensagens de erro de uma instrucao */
+#define ERROR_SIZE 400
+
+void aot_init(AotState *st, const AotProgram *prog, int argc, char **argv) {
+    memset(st, 0, sizeof(*st));
+    st->max_steps = AOT_DEFAULT_MAX_STEPS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+            char *end;
+            st->max_steps = strtoll(argv[++i], &end, 10);
+            if (*end || st->max_steps < 0) {
+                fprintf(stderr, "Erro: --max-steps requer um inteiro >= 0\n");
+                exit(1);
+            }
+        } else {
+            fprintf(stderr, "Uso: %s [--max-steps n]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    printf("Carregando programa: %s\n", prog->filename);
+    printf("Programa carregado: %d instrucoes, %d strings\n\n", prog->num_instrs, prog->num_strings);
+    printf("=== EXECUTANDO ===\n\n");
+
+    oven_init(&st->oven);
+    st->stack_capacity = INITIAL_CAPACITY;
+    st->stack = malloc(st->stack_capacity * sizeof(Value));
+    st->frames_capacity = INITIAL_CAPACITY;
+    st->frames = malloc(st->frames_capacity * sizeof(AotFrame));
+
+    st->memory_size = prog->memory_size;
+    st->memory = calloc(st->memory_size ? st->memory_size : 1, sizeof(Value));
+    for (int i = 0; i < prog->num_data; i++) {
+        const AotData *d = &prog->data[i];
+        st->memory[d->address] = d->frac ? value_frac(d->f) : value_int(d->i);
+    }
+}
+
+void aot_fail(int line, const char *fmt, ...) {
+    char msg[ERROR_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    printf("\nERRO: Erro na linha %d: %s\n", line, msg);
+    exit(1);
+}
+
+void aot_step_limit(const AotState *st) {
+    printf("\nERRO: Limite de steps excedido (%lld). Possivel loop infinito.\n",
+           (long long)st->max_steps);
+    exit(1);
+}
+
+void aot_halt(void) {
+    printf("\n=== PROGRAMA FINALIZADO ===\n");
+}
+
+int aot_finish(AotState *st, const Value *regs, int64_t steps) {
+    printf("\n\n=== ESTADO FINAL ===\n");
+    rt_print_state(stdout, steps, regs, &st->oven, st->stack, st->sp,
+                   st->memory, st->memory_size);
+    free(st->stack);
+    free(st->memory);
+    free(st->frames);
+    return 0;
+}
+
+/* ===== CAMINHOS LENTOS ===== */
+
+Value aot_arith(Opcode op, Value a, Value b, int line) {
+    char err[ERROR_SIZE];
+    if (!rt_arith(op, &a, &b, err, sizeof(err))) aot_fail(line, "%s", err);
+    return a;
+}
+
+Value aot_step_one(Value a, int delta, int line) {
+    if (a.frac) return value_frac(a.v.f + delta);
+    return aot_arith(OP_ADD, a, value_int(delta), line);
+}
+
+int aot_compare(Value a, Value b, int rel) {
+    return rt_compare(&a, &b, rel);
+}
+
+Value aot_ftoi(Value a, int line) {
+    char err[ERROR_SIZE];
+    if (!rt_ftoi(&a, err, sizeof(err))) aot_fail(line, "%s", err);
+    return a;
+}
+
+void aot_grow_stack(AotState *st) {
+    st->stack_capacity *= 2;
+    st->stack = realloc(st->stack, st->stack_capacity * sizeof(Value));
+}
+
+void aot_bad_index(int64_t base, int64_t size, Value index, int line) {
+    if (index.frac) {
+        if (index.v.f >= 0 && index.v.f < size) {
+            aot_fail(line, "list indices must be integers or slices, not float");
+        }
+        char text[VALUE_TEXT_SIZE];
+        rt_str(&index, text, sizeof(text));
+        aot_fail(line, "Indice %s fora do segmento em %lld (tamanho %lld)",
+                 text, (long long)base, (long long)size);
+    }
+    aot_fail(line, "Indice %lld fora do segmento em %lld (tamanho %lld)",
+             (long long)index.v.i, (long long)base, (long long)size);
+}
+
+AotFrame* aot_call(AotState *st, int ret, int num_args, int line) {
+    if (st->num_frames >= AOT_MAX_FRAMES) {
+        aot_fail(line, "Pilha de chamadas excedida (%d quadros)", AOT_MAX_FRAMES);
+    }
+    if (st->sp < num_args) {
+        aot_fail(line, "CALL sem argumentos suficientes na pilha");
+    }
+    if (st->num_frames >= st->frames_capacity) {
+        st->frames_capacity *= 2;
+        st->frames = realloc(st->frames, st->frames_capacity * sizeof(AotFrame));
+    }
+    AotFrame *frame = &st->frames[st->num_frames++];
+    frame->ret = ret;
+    return frame;
+}
+
+const AotFrame* aot_ret(AotState *st, int line) {
+    if (st->num_frames == 0) aot_fail(line, "RET sem CALL correspondente");
+    return &st->frames[--st->num_frames];
+}
+
+/* ===== SENSORES ===== */
+
+void aot_wait(AotState *st, int sensor, int rel, Value limit, int line) {
+    char err[ERROR_SIZE];
+    if (!oven_wait(&st->oven, sensor, rel, &limit, err, sizeof(err))) aot_fail(line, "%s", err);
+}
+
+void aot_wait_change(AotState *st, const int *sensors, int num_sensors, int line) {
+    char err[ERROR_SIZE];
+    if (!oven_wait_change(&st->oven, sensors, num_sensors, err, sizeof(err))) {
+        aot_fail(line, "%s", err);
+    }
+}
+
+void aot_setmode(AotState *st, int64_t mode, Value power) {
+    oven_setmode(&st->oven, mode, &power);
+}
+
+/* ===== IMPRESSAO ===== */
+
+void aot_print(Value time) {
+    char text[VALUE_TEXT_SIZE];
+    rt_str(&time, text, sizeof(text));
+    printf("%s\n", text);
+}
+
+void aot_printi(Value x) {
+    rt_print_int(stdout, &x);
+}
+
+void aot_printf(Value x) {
+    rt_print_frac(stdout, &x);
+}
+
+void aot_printb(Value x) {
+    rt_print_bool(stdout, &x);
+}
+
+void aot_sprint(const char *text) {
+    printf("%s ", text);
+}
+
+void aot_printfmt(AotState *st, const char *tmpl, Value *values,
+                  const signed char *from_stack, int num_values, int line) {
+    /* Operandos STACK usam os valores do topo, o mais fundo primeiro */
+    int depth = 0;
+    for (int i = 0; i < num_values; i++) depth += from_stack[i];
+    if (st->sp < depth) aot_fail(line, "PRINTFMT sem valores suficientes na pilha");
+    const Value *stacked = &st->stack[st->sp - depth];
+    st->sp -= depth;
+    for (int i = 0; i < num_values; i++) {
+        if (from_stack[i]) values[i] = *stacked++;
+    }
+    char err[ERROR_SIZE];
+    if (!rt_print_fmt(stdout, tmpl, values, num_values, err, sizeof(err))) {
+        aot_fail(line, "%s", err);
+    }
+}
@@ -0,0 +1,205 @@
+/*
+ * aot.h
+ * Runtime dos programas traduzidos por mwasm2c
+ *
+ * O C gerado guarda os registradores da VM em variaveis locais e chama
+ * daqui so o que nao cabe em uma linha: pilha, quadros de CALL, memoria
+ * de dados, sensores, impressao e erros. Valores passam por copia, para
+ * que o compilador C mantenha os registradores em registradores.
+ *
+ * Os caminhos rapidos (inteiros sem estouro) sao inline; o resto cai em
+ * runtime.c, com a mesma semantica e as mesmas mensagens da VM.
+ */
+
+#ifndef AOT_H
+#define AOT_H
+
+#include "asm.h"
+#include "runtime.h"
+#include <stdio.h>
+#include <stdint.h>
+
+/* Profundidade maxima de CALL e limite padrao de steps (os da VM) */
+#define AOT_MAX_FRAMES 10000
+#define AOT_DEFAULT_MAX_STEPS 100000
+
+/* Quadro de chamada: ponto de retorno e A0-A3 do chamador */
+typedef struct AotFrame {
+    int ret;
+    Value args[NUM_ARG_REGS];
+} AotFrame;
+
+/* Valor inicial de uma celula da memoria de dados */
+typedef struct AotData {
+    int64_t address;
+    int frac;
+    int64_t i;
+    double f;
+} AotData;
+
+/* Descricao estatica do programa, emitida pelo mwasm2c */
+typedef struct AotProgram {
+    const char *filename;          /* .mwasm de origem (cabecalho da saida) */
+    int num_instrs;
+    int num_strings;
+    int64_t memory_size;
+    const AotData *data;
+    int num_data;
+} AotProgram;
+
+/* Estado fora dos registradores */
+typedef struct AotState {
+    Oven oven;
+    Value *stack;
+    int64_t sp;
+    int64_t stack_capacity;
+    Value *memory;
+    int64_t memory_size;
+    AotFrame *frames;
+    int num_frames;
+    int frames_capacity;
+    int64_t max_steps;             /* 0 = sem limite */
+} AotState;
+
+/* Ler opcoes (--max-steps n), imprimir o cabecalho e preparar o estado */
+void aot_init(AotState *st, const AotProgram *prog, int argc, char **argv);
+
+/* Erro de execucao na linha do .mwasm: imprime e encerra com status 1 */
+void aot_fail(int line, const char *fmt, ...)
+    __attribute__((noreturn, format(printf, 2, 3)));
+
+/* Limite de steps excedido: imprime e encerra com status 1 */
+void aot_step_limit(const AotState *st) __attribute__((noreturn));
+
+/* HALT */
+void aot_halt(void);
+
+/* Estado final (regs na ordem de VMReg) e liberacao; retorna o status */
+int aot_finish(AotState *st, const Value *regs, int64_t steps);
+
+/* Caminhos lentos */
+Value aot_arith(Opcode op, Value a, Value b, int line);
+Value aot_step_one(Value a, int delta, int line);
+int aot_compare(Value a, Value b, int rel);
+Value aot_ftoi(Value a, int line);
+void aot_grow_stack(AotState *st);
+void aot_bad_index(int64_t base, int64_t size, Value index, int line) __attribute__((noreturn));
+AotFrame* aot_call(AotState *st, int ret, int num_args, int line);
+const AotFrame* aot_ret(AotState *st, int line);
+
+/* Sensores */
+void aot_wait(AotState *st, int sensor, int rel, Value limit, int line);
+void aot_wait_change(AotState *st, const int *sensors, int num_sensors, int line);
+void aot_setmode(AotState *st, int64_t mode, Value power);
+
+/* Impressao */
+void aot_print(Value time);
+void aot_printi(Value x);
+void aot_printf(Value x);
+void aot_printb(Value x);
+void aot_sprint(const char *text);
+
+/* PRINTFMT: values[i] vale se from_stack[i] == 0; os demais saem da pilha */
+void aot_printfmt(AotState *st, const char *tmpl, Value *values,
+                  const signed char *from_stack, int num_values, int line);
+
+/* ===== CAMINHOS RAPIDOS ===== */
+
+static inline Value aot_add(Value a, Value b, int line) {
+    int64_t r;
+    if (!(a.frac | b.frac) && !__builtin_add_overflow(a.v.i, b.v.i, &r)) return value_int(r);
+    return aot_arith(OP_ADD, a, b, line);
+}
+
+static inline Value aot_sub(Value a, Value b, int line) {
+    int64_t r;
+    if (!(a.frac | b.frac) && !__builtin_sub_overflow(a.v.i, b.v.i, &r)) return value_int(r);
+    return aot_arith(OP_SUB, a, b, line);
+}
+
+static inline Value aot_mul(Value a, Value b, int line) {
+    int64_t r;
+    if (!(a.frac | b.frac) && !__builtin_mul_overflow(a.v.i, b.v.i, &r)) return value_int(r);
+    return aot_arith(OP_MUL, a, b, line);
+}
+
+/* Divisao e resto arredondando para baixo; divisor 0 e -1 no caminho lento */
+static inline Value aot_div(Value a, Value b, int line) {
+    if (!(a.frac | b.frac) && b.v.i != 0 && b.v.i != -1) {
+        int64_t q = a.v.i / b.v.i;
+        if ((a.v.i % b.v.i != 0) && ((a.v.i < 0) != (b.v.i < 0))) q--;
+        return value_int(q);
+    }
+    return aot_arith(OP_DIV, a, b, line);
+}
+
+static inline Value aot_mod(Value a, Value b, int line) {
+    if (!(a.frac | b.frac) && b.v.i != 0 && b.v.i != -1) {
+        int64_t m = a.v.i % b.v.i;
+        if (m != 0 && ((m < 0) != (b.v.i < 0))) m += b.v.i;
+        return value_int(m);
+    }
+    return aot_arith(OP_MOD, a, b, line);
+}
+
+/* INC (+1) e DEC (-1) */
+static inline Value aot_inc(Value a, int delta, int line) {
+    int64_t r;
+    if (!a.frac && !__builtin_add_overflow(a.v.i, (int64_t)delta, &r)) return value_int(r);
+    return aot_step_one(a, delta, line);
+}
+
+static inline Value aot_cmp(Value a, Value b, int rel) {
+    if (a.frac | b.frac) return value_int(aot_compare(a, b, rel));
+    switch (rel) {
+        case REL_EQ: return value_int(a.v.i == b.v.i);
+        case REL_NE: return value_int(a.v.i != b.v.i);
+        case REL_LT: return value_int(a.v.i < b.v.i);
+        case REL_LE: return value_int(a.v.i <= b.v.i);
+        case REL_GT: return value_int(a.v.i > b.v.i);
+        default:     return value_int(a.v.i >= b.v.i);
+    }
+}
+
+static inline int aot_truthy(Value a) {
+    return value_truthy(&a);
+}
+
+static inline Value aot_itof(Value a) {
+    return value_frac(value_as_double(&a));
+}
+
+/* Indice da tabela do JTABLE, ou -1 para o label padrao */
+static inline int64_t aot_jtable(Value a, int64_t base, int64_t n, int line) {
+    int64_t index;
+    if (a.frac) {
+        double f = a.v.f - (double)base;
+        if (f >= 0 && f < n) aot_fail(line, "tuple indices must be integers or slices, not float");
+        return -1;
+    }
+    if (__builtin_sub_overflow(a.v.i, base, &index) || index < 0 || index >= n) return -1;
+    return index;
+}
+
+static inline Value aot_load(const AotState *st, int64_t base, int64_t size, Value index, int line) {
+    if (index.frac || (uint64_t)index.v.i >= (uint64_t)size) aot_bad_index(base, size, index, line);
+    return st->memory[base + index.v.i];
+}
+
+static inline void aot_store(AotState *st, int64_t base, int64_t size, Value index, Value x,
+                             int line) {
+    if (index.frac || (uint64_t)index.v.i >= (uint64_t)size) aot_bad_index(base, size, index, line);
+    st->memory[base + index.v.i] = x;
+}
+
+static inline void aot_push(AotState *st, Value x) {
+    if (st->sp >= st->stack_capacity) aot_grow_stack(st);
+    st->stack[st->sp++] = x;
+}
+
+static inline Value aot_pop(AotState *st, int line) {
+    if (st->sp == 0) aot_fail(line, "POP em pilha vazia");
+    return st->stack[--st->sp];
+}
+
+#endif /* AOT_H */
@@ -0,0 +1,595 @@
+/*
+ * asm.c
+ * Leitura do assembly AirFryerVM (.mwasm)
+ */
+
+#include "asm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdarg.h>
+
+#define INITIAL_CAPACITY 16
+#define MAX_TOKENS_INLINE 16
+
+static const char *REG_NAMES[NUM_VM_REGS] = {
+    "TIME", "POWER", "R0", "R1", "R2", "R3", "CNT", "A0", "A1", "A2", "A3"
+};
+static const char *SENSOR_NAMES[NUM_SENSORS] = { "TEMP", "WEIGHT", "MODE", "STATE" };
+static const char *RELATION_NAMES[] = { "EQ", "NE", "LT", "LE", "GT", "GE" };
+
+static const struct { const char *name; Opcode op; } OPCODES[] = {
+    {"SET", OP_SET}, {"SETF", OP_SETF}, {"INC", OP_INC}, {"DEC", OP_DEC},
+    {"DECJZ", OP_DECJZ}, {"DECJNZ", OP_DECJNZ}, {"GOTO", OP_GOTO},
+    {"PUSH", OP_PUSH}, {"POP", OP_POP}, {"HALT", OP_HALT},
+    {"CALL", OP_CALL}, {"RET", OP_RET},
+    {"LOAD", OP_LOAD}, {"STORE", OP_STORE},
+    {"ADD", OP_ADD}, {"SUB", OP_SUB}, {"MUL", OP_MUL}, {"DIV", OP_DIV}, {"MOD", OP_MOD},
+    {"ADDF", OP_ADDF}, {"SUBF", OP_SUBF}, {"MULF", OP_MULF}, {"DIVF", OP_DIVF},
+    {"MODF", OP_MODF}, {"ITOF", OP_ITOF}, {"FTOI", OP_FTOI},
+    {"EQ", OP_EQ}, {"NE", OP_NE}, {"LT", OP_LT}, {"LE", OP_LE}, {"GT", OP_GT}, {"GE", OP_GE},
+    {"AND", OP_AND}, {"OR", OP_OR}, {"NOT", OP_NOT},
+    {"JZ", OP_JZ}, {"JNZ", OP_JNZ}, {"JTABLE", OP_JTABLE},
+    {"PRINT", OP_PRINT}, {"PRINTI", OP_PRINTI}, {"PRINTF", OP_PRINTF}, {"PRINTB", OP_PRINTB},
+    {"SPRINT", OP_SPRINT}, {"PRINTFMT", OP_PRINTFMT},
+    {"READ", OP_READ}, {"WAIT", OP_WAIT}, {"WAITCHG", OP_WAITCHG},
+    {"SETMODE", OP_SETMODE}, {"PAUSE", OP_PAUSE}, {"RESUME", OP_RESUME}, {"STOP", OP_STOP},
+};
+#define NUM_OPCODES ((int)(sizeof(OPCODES) / sizeof(OPCODES[0])))
+
+const char* asm_reg_name(int reg) {
+    return (reg >= 0 && reg < NUM_VM_REGS) ? REG_NAMES[reg] : "?";
+}
+
+const char* asm_sensor_name(int sensor) {
+    return (sensor >= 0 && sensor < NUM_SENSORS) ? SENSOR_NAMES[sensor] : "?";
+}
+
+const char* asm_relation_name(int rel) {
+    return (rel >= REL_EQ && rel <= REL_GE) ? RELATION_NAMES[rel] : "?";
+}
+
+const char* asm_op_name(Opcode op) {
+    for (int i = 0; i < NUM_OPCODES; i++) {
+        if (OPCODES[i].op == op) return OPCODES[i].name;
+    }
+    return "?";
+}
+
+/* Indice de name em names (sem diferenciar maiusculas), ou -1 */
+static int lookup(const char *name, const char **names, int n) {
+    for (int i = 0; i < n; i++) {
+        if (strcasecmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static int parse_reg(const char *s)      { return lookup(s, REG_NAMES, NUM_VM_REGS); }
+static int parse_sensor(const char *s)   { return lookup(s, SENSOR_NAMES, NUM_SENSORS); }
+static int parse_relation(const char *s) { return lookup(s, RELATION_NAMES, 6); }
+
+/* Inteiro decimal completo (como int() do Python, sem '_') */
+static int parse_int(const char *s, int64_t *out) {
+    char *end;
+    if (!*s) return 0;
+    *out = strtoll(s, &end, 10);
+    return *end == '\0';
+}
+
+/* Numero completo: inteiro, ou double se tiver ponto/expoente */
+static int parse_double(const char *s, double *out) {
+    char *end;
+    if (!*s) return 0;
+    *out = strtod(s, &end);
+    return *end == '\0';
+}
+
+/* ===== TABELA DE LABELS ===== */
+
+typedef struct LabelTable {
+    struct { char *name; int index; } *slots;
+    int capacity;
+    int count;
+} LabelTable;
+
+static unsigned long label_hash(const char *s) {
+    unsigned long h = 1469598103934665603UL;
+    for (; *s; s++) {
+        h = (h ^ (unsigned char)*s) * 1099511628211UL;
+    }
+    return h;
+}
+
+static void labels_init(LabelTable *t) {
+    t->capacity = INITIAL_CAPACITY;
+    t->count = 0;
+    t->slots = calloc(t->capacity, sizeof(*t->slots));
+}
+
+static int labels_find(const LabelTable *t, const char *name) {
+    unsigned long i = label_hash(name) & (t->capacity - 1);
+    while (t->slots[i].name) {
+        if (strcmp(t->slots[i].name, name) == 0) return t->slots[i].index;
+        i = (i + 1) & (t->capacity - 1);
+    }
+    return -1;
+}
+
+static void labels_put(LabelTable *t, char *name, int index);
+
+static void labels_grow(LabelTable *t) {
+    LabelTable bigger;
+    bigger.capacity = t->capacity * 2;
+    bigger.count = 0;
+    bigger.slots = calloc(bigger.capacity, sizeof(*bigger.slots));
+    for (int i = 0; i < t->capacity; i++) {
+        if (t->slots[i].name) labels_put(&bigger, t->slots[i].name, t->slots[i].index);
+    }
+    free(t->slots);
+    *t = bigger;
+}
+
+/* Inserir (o nome passa a ser da tabela) */
+static void labels_put(LabelTable *t, char *name, int index) {
+    if (2 * (t->count + 1) > t->capacity) labels_grow(t);
+    unsigned long i = label_hash(name) & (t->capacity - 1);
+    while (t->slots[i].name) i = (i + 1) & (t->capacity - 1);
+    t->slots[i].name = name;
+    t->slots[i].index = index;
+    t->count++;
+}
+
+static void labels_free(LabelTable *t) {
+    for (int i = 0; i < t->capacity; i++) free(t->slots[i].name);
+    free(t->slots);
+}
+
+/* ===== LINHAS ===== */
+
+/* Linha sem comentario e sem espacos nas pontas (modifica buf) */
+static char* clean_line(char *buf) {
+    char *semi = strchr(buf, ';');
+    if (semi) *semi = '\0';
+    while (isspace((unsigned char)*buf)) buf++;
+    char *end = buf + strlen(buf);
+    while (end > buf && isspace((unsigned char)end[-1])) *--end = '\0';
+    return buf;
+}
+
+/* Prefixo sem diferenciar maiusculas */
+static int starts_with(const char *s, const char *prefix) {
+    return strncasecmp(s, prefix, strlen(prefix)) == 0;
+}
+
+/* Separar em tokens por espaco (e virgula, se commas); modifica line */
+static int split_tokens(char *line, int commas, char ***tokens, int *capacity) {
+    int n = 0;
+    if (commas) {
+        for (char *p = line; *p; p++) if (*p == ',') *p = ' ';
+    }
+    char *p = line;
+    while (*p) {
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        if (n >= *capacity) {
+            *capacity *= 2;
+            *tokens = realloc(*tokens, *capacity * sizeof(char*));
+        }
+        (*tokens)[n++] = p;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        if (*p) *p++ = '\0';
+    }
+    return n;
+}
+
+static void set_error(char *err, size_t size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(err, size, fmt, ap);
+    va_end(ap);
+}
+
+/* ===== SDEF E DATA ===== */
+
+static int load_sdef(Program *prog, char *line, int line_num, char *err, size_t err_size) {
+    /* SDEF id "texto": o texto e o resto da linha, entre aspas */
+    char *p = line + 4;
+    while (*p && !isspace((unsigned char)*p)) p++;
+    while (isspace((unsigned char)*p)) p++;
+    char *id_text = p;
+    while (*p && !isspace((unsigned char)*p)) p++;
+    if (!*id_text || !*p) {
+        set_error(err, err_size, "Linha %d: SDEF requer id e texto", line_num);
+        return 0;
+    }
+    *p++ = '\0';
+    while (isspace((unsigned char)*p)) p++;
+
+    int64_t id;
+    if (!parse_int(id_text, &id) || id < 0 || id > MAX_MEMORY) {
+        set_error(err, err_size, "Linha %d: Erro no SDEF: id invalido: '%s'", line_num, id_text);
+        return 0;
+    }
+    size_t len = strlen(p);
+    if (len == 0 || p[0] != '"' || p[len - 1] != '"') {
+        set_error(err, err_size, "Linha %d: Erro no SDEF: String deve estar entre aspas", line_num);
+        return 0;
+    }
+
+    if (id >= prog->strings_size) {
+        int size = prog->strings_size ? prog->strings_size : INITIAL_CAPACITY;
+        while (size <= id) size *= 2;
+        prog->strings = realloc(prog->strings, size * sizeof(char*));
+        memset(prog->strings + prog->strings_size, 0,
+               (size - prog->strings_size) * sizeof(char*));
+        prog->strings_size = size;
+    }
+    if (prog->strings[id]) {
+        free(prog->strings[id]);
+    } else {
+        prog->num_strings++;
+    }
+    prog->strings[id] = len >= 2 ? strndup(p + 1, len - 2) : strdup("");
+    return 1;
+}
+
+static int load_data(Program *prog, char **tokens, int n, int line_num,
+                     char *err, size_t err_size) {
+    /* tokens[0] e o proprio DATA */
+    if (n < 3) {
+        set_error(err, err_size, "Linha %d: DATA requer base e tamanho", line_num);
+        return 0;
+    }
+    int64_t base, size;
+    int ok = parse_int(tokens[1], &base) && parse_int(tokens[2], &size);
+    for (int i = 3; ok && i < n; i++) {
+        int64_t iv;
+        double fv;
+        ok = parse_int(tokens[i], &iv) || parse_double(tokens[i], &fv);
+    }
+    if (!ok) {
+        set_error(err, err_size, "Linha %d: DATA requer valores numericos", line_num);
+        return 0;
+    }
+    if (base < 0 || size <= 0 || n - 3 > size) {
+        set_error(err, err_size, "Linha %d: DATA invalido", line_num);
+        return 0;
+    }
+    if (base + size > MAX_MEMORY) {
+        set_error(err, err_size, "Linha %d: Memoria de dados excede %d celulas", line_num, MAX_MEMORY);
+        return 0;
+    }
+    for (int i = 0; i < prog->num_segments; i++) {
+        DataSegment *other = &prog->segments[i];
+        if (base < other->base + other->size && other->base < base + size) {
+            set_error(err, err_size, "Linha %d: Segmento em %lld sobrepoe segmento em %lld",
+                      line_num, (long long)base, (long long)other->base);
+            return 0;
+        }
+    }
+
+    if (prog->num_segments >= prog->segments_capacity) {
+        prog->segments_capacity = prog->segments_capacity ? prog->segments_capacity * 2 : INITIAL_CAPACITY;
+        prog->segments = realloc(prog->segments, prog->segments_capacity * sizeof(DataSegment));
+    }
+    prog->segments[prog->num_segments].base = base;
+    prog->segments[prog->num_segments].size = size;
+    prog->num_segments++;
+    if (base + size > prog->memory_size) prog->memory_size = base + size;
+
+    for (int i = 3; i < n; i++) {
+        if (prog->num_data >= prog->data_capacity) {
+            prog->data_capacity = prog->data_capacity ? prog->data_capacity * 2 : INITIAL_CAPACITY;
+            prog->data = realloc(prog->data, prog->data_capacity * sizeof(DataInit));
+        }
+        DataInit *d = &prog->data[prog->num_data++];
+        d->address = base + (i - 3);
+        d->frac = !parse_int(tokens[i], &d->i);
+        d->f = 0.0;
+        if (d->frac) parse_double(tokens[i], &d->f);
+    }
+    return 1;
+}
+
+int64_t asm_segment_size(const Program *prog, int64_t base) {
+    for (int i = 0; i < prog->num_segments; i++) {
+        if (prog->segments[i].base == base) return prog->segments[i].size;
+    }
+    return -1;
+}
+
+/* ===== INSTRUCOES ===== */
+
+/* Validar e decodificar uma instrucao (mesmas regras e mensagens da VM */
+/* em Python). Retorna 1 se sucesso, 0 se erro */
+static int decode(Program *prog, const LabelTable *labels, Instr *in,
+                  char **tok, int n, int line_num, char *err, size_t err_size) {
+    const char *opname = tok[0];
+    char **args = tok + 1;
+    int nargs = n - 1;
+
+    memset(in, 0, sizeof(*in));
+    in->line = line_num;
+    in->target = -1;
+
+    int op = -1;
+    for (int i = 0; i < NUM_OPCODES; i++) {
+        if (strcasecmp(opname, OPCODES[i].name) == 0) {
+            op = OPCODES[i].op;
+            break;
+        }
+    }
+    if (op < 0) {
+        char upper[64];
+        snprintf(upper, sizeof(upper), "%s", opname);
+        for (char *c = upper; *c; c++) *c = toupper((unsigned char)*c);
+        set_error(err, err_size, "Linha %d: Instrucao desconhecida: %s", line_num, upper);
+        return 0;
+    }
+    in->op = op;
+    const char *name = asm_op_name(op);
+
+#define FAIL(...) do { set_error(err, err_size, __VA_ARGS__); return 0; } while (0)
+
+    switch (in->op) {
+        case OP_HALT: case OP_PRINT: case OP_PAUSE: case OP_RESUME: case OP_STOP: case OP_RET:
+            if (nargs != 0) FAIL("Linha %d: %s nao aceita argumentos", line_num, name);
+            break;
+
+        case OP_INC: case OP_DEC: case OP_PUSH: case OP_POP: case OP_NOT:
+        case OP_ITOF: case OP_FTOI: case OP_PRINTI: case OP_PRINTF: case OP_PRINTB:
+            if (nargs != 1) FAIL("Linha %d: %s requer 1 argumento", line_num, name);
+            if ((in->a = parse_reg(args[0])) < 0)
+                FAIL("Linha %d: Registrador invalido: %s", line_num, args[0]);
+            break;
+
+        case OP_SET:
+            if (nargs != 2) FAIL("Linha %d: SET requer registrador e valor", line_num);
+            if ((in->a = parse_reg(args[0])) < 0)
+                FAIL("Linha %d: Registrador invalido: %s", line_num, args[0]);
+            if (!parse_int(args[1], &in->imm))
+                FAIL("Linha %d: SET requer valor inteiro", line_num);
+            break;
+
+        case OP_SETF:
+            if (nargs != 2) FAIL("Linha %d: SETF requer registrador e valor", line_num);
+            if ((in->a = parse_reg(args[0])) < 0)
+                FAIL("Linha %d: Registrador invalido: %s", line_num, args[0]);
+            if (!parse_double(args[1], &in->fimm))
+                FAIL("Linha %d: SETF requer valor numerico", line_num);
+            break;
+
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_ADDF: case OP_SUBF: case OP_MULF: case OP_DIVF: case OP_MODF:
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+        case OP_AND: case OP_OR:
+            if (nargs != 2) FAIL("Linha %d: %s requer 2 argumentos", line_num, name);
+            in->a = parse_reg(args[0]);
+            in->b = parse_reg(args[1]);
+            if (in->a < 0 || in->b < 0)
+                FAIL("Linha %d: Argumentos devem ser registradores validos", line_num);
+            break;
+
+        case OP_DECJZ: case OP_DECJNZ: case OP_JZ: case OP_JNZ:
+            if (nargs != 2) FAIL("Linha %d: %s requer registrador e label", line_num, name);
+            if ((in->a = parse_reg(args[0])) < 0)
+                FAIL("Linha %d: Primeiro argumento deve ser registrador", line_num);
+            in->label = strdup(args[1]);
+            break;
+
+        case OP_READ:
+            if (nargs != 2) FAIL("Linha %d: READ requer registrador e sensor", line_num);
+            if ((in->a = parse_reg(args[0])) < 0)
+                FAIL("Linha %d: Registrador invalido: %s", line_num, args[0]);
+            if ((in->b = parse_sensor(args[1])) < 0)
+                FAIL("Linha %d: Sensor invalido: %s", line_num, args[1]);
+            break;
+
+        case OP_WAIT:
+            if (nargs != 3) FAIL("Linha %d: WAIT requer sensor, relacao e registrador", line_num);
+            if ((in->b = parse_sensor(args[0])) < 0)
+                FAIL("Linha %d: Sensor invalido: %s", line_num, args[0]);
+            if ((in->imm = parse_relation(args[1])) < 0)
+                FAIL("Linha %d: Relacao invalida: %s", line_num, args[1]);
+            if ((in->a = parse_reg(args[2])) < 0)
+                FAIL("Linha %d: Registrador invalido: %s", line_num, args[2]);
+            break;
+
+        case OP_WAITCHG:
+            if (nargs == 0) FAIL("Linha %d: WAITCHG requer ao menos um sensor", line_num);
+            in->list = malloc(nargs * sizeof(int));
+            in->list_len = nargs;
+            for (int i = 0; i < nargs; i++) {
+                if ((in->list[i] = parse_sensor(args[i])) < 0)
+                    FAIL("Linha %d: Sensor invalido: %s", line_num, args[i]);
+            }
+            break;
+
+        case OP_LOAD: case OP_STORE:
+            if (nargs != 3) FAIL("Linha %d: %s requer registrador, base e indice", line_num, name);
+            in->a = parse_reg(args[0]);
+            in->b = parse_reg(args[2]);
+            if (in->a < 0 || in->b < 0)
+                FAIL("Linha %d: Argumentos devem ser registradores validos", line_num);
+            if (!parse_int(args[1], &in->imm))
+                FAIL("Linha %d: %s requer base inteira", line_num, name);
+            if (asm_segment_size(prog, in->imm) < 0)
+                FAIL("Linha %d: Nenhum segmento DATA em %lld", line_num, (long long)in->imm);
+            break;
+
+        case OP_JTABLE:
+            if (nargs < 4)
+                FAIL("Linha %d: JTABLE requer registrador, base, padrao e ao menos um label", line_num);
+            if ((in->a = parse_reg(args[0])) < 0)
+                FAIL("Linha %d: Primeiro argumento deve ser registrador", line_num);
+            if (!parse_int(args[1], &in->imm))
+                FAIL("Linha %d: JTABLE requer base inteira", line_num);
+            in->label = strdup(args[2]);
+            in->list_len = nargs - 3;
+            in->list = malloc(in->list_len * sizeof(int));
+            in->names = malloc(in->list_len * sizeof(char*));
+            for (int i = 0; i < in->list_len; i++) {
+                in->names[i] = strdup(args[3 + i]);
+                in->list[i] = labels_find(labels, args[3 + i]);
+            }
+            break;
+
+        case OP_GOTO:
+            if (nargs != 1) FAIL("Linha %d: GOTO requer label", line_num);
+            in->label = strdup(args[0]);
+            break;
+
+        case OP_CALL:
+            if (nargs != 2) FAIL("Linha %d: CALL requer label e numero de argumentos", line_num);
+            if (!parse_int(args[1], &in->imm))
+                FAIL("Linha %d: CALL requer numero de argumentos inteiro", line_num);
+            if (in->imm < 0 || in->imm > NUM_ARG_REGS)
+                FAIL("Linha %d: CALL aceita de 0 a %d argumentos", line_num, NUM_ARG_REGS);
+            in->label = strdup(args[0]);
+            break;
+
+        case OP_SETMODE:
+            if (nargs != 1) FAIL("Linha %d: SETMODE requer valor", line_num);
+            if (!parse_int(args[0], &in->imm))
+                FAIL("Linha %d: SETMODE requer valor inteiro", line_num);
+            break;
+
+        case OP_PRINTFMT:
+            if (nargs < 2)
+                FAIL("Linha %d: PRINTFMT requer template e ao menos um operando", line_num);
+            if (!parse_int(args[0], &in->imm))
+                FAIL("Linha %d: PRINTFMT requer id inteiro", line_num);
+            in->list_len = nargs - 1;
+            in->list = malloc(in->list_len * sizeof(int));
+            for (int i = 0; i < in->list_len; i++) {
+                if (strcasecmp(args[1 + i], "STACK") == 0) {
+                    in->list[i] = OPERAND_STACK;
+                } else if ((in->list[i] = parse_reg(args[1 + i])) < 0) {
+                    FAIL("Linha %d: Operando invalido: %s", line_num, args[1 + i]);
+                }
+            }
+            break;
+
+        case OP_SPRINT:
+            if (nargs != 1) FAIL("Linha %d: SPRINT requer id da string", line_num);
+            if (!parse_int(args[0], &in->imm))
+                FAIL("Linha %d: SPRINT requer id inteiro", line_num);
+            break;
+    }
+#undef FAIL
+
+    if (in->label) in->target = labels_find(labels, in->label);
+    return 1;
+}
+
+static void instr_free(Instr *in) {
+    free(in->label);
+    free(in->list);
+    if (in->names) {
+        for (int i = 0; i < in->list_len; i++) free(in->names[i]);
+        free(in->names);
+    }
+}
+
+/* ===== CARGA ===== */
+
+Program* asm_load(const char *source, size_t size, char *err, size_t err_size) {
+    Program *prog = calloc(1, sizeof(Program));
+    LabelTable labels;
+    labels_init(&labels);
+
+    int tokens_capacity = MAX_TOKENS_INLINE;
+    char **tokens = malloc(tokens_capacity * sizeof(char*));
+    size_t line_capacity = 256;
+    char *buf = malloc(line_capacity);
+    int ok = 1;
+
+    /* Primeira passagem: labels, SDEF e DATA; segunda: instrucoes */
+    for (int pass = 0; pass < 2 && ok; pass++) {
+        size_t pos = 0;
+        int line_num = 0;
+        int idx = 0;
+        while (pos < size && ok) {
+            const char *nl = memchr(source + pos, '\n', size - pos);
+            size_t len = nl ? (size_t)(nl - (source + pos)) : size - pos;
+            if (len + 1 > line_capacity) {
+                while (len + 1 > line_capacity) line_capacity *= 2;
+                buf = realloc(buf, line_capacity);
+            }
+            memcpy(buf, source + pos, len);
+            buf[len] = '\0';
+            pos += len + 1;
+            line_num++;
+
+            char *line = clean_line(buf);
+            size_t line_len = strlen(line);
+            if (line_len == 0) continue;
+
+            if (line[line_len - 1] == ':') {
+                if (pass == 0) {
+                    line[line_len - 1] = '\0';
+                    char *label = clean_line(line);
+                    if (*label) {
+                        if (labels_find(&labels, label) >= 0) {
+                            set_error(err, err_size, "Linha %d: Label duplicado: %s", line_num, label);
+                            ok = 0;
+                        } else {
+                            labels_put(&labels, strdup(label), idx);
+                        }
+                    }
+                }
+                continue;
+            }
+
+            if (starts_with(line, "SDEF")) {
+                if (pass == 0) ok = load_sdef(prog, line, line_num, err, err_size);
+                continue;
+            }
+            if (starts_with(line, "DATA")) {
+                if (pass == 0) {
+                    int n = split_tokens(line, 0, &tokens, &tokens_capacity);
+                    ok = load_data(prog, tokens, n, line_num, err, err_size);
+                }
+                continue;
+            }
+
+            if (pass == 0) {
+                idx++;
+                continue;
+            }
+
+            int n = split_tokens(line, 1, &tokens, &tokens_capacity);
+            if (n == 0) continue;
+            if (prog->num_instrs >= prog->code_capacity) {
+                prog->code_capacity = prog->code_capacity ? prog->code_capacity * 2 : INITIAL_CAPACITY;
+                prog->code = realloc(prog->code, prog->code_capacity * sizeof(Instr));
+            }
+            Instr *in = &prog->code[prog->num_instrs];
+            ok = decode(prog, &labels, in, tokens, n, line_num, err, err_size);
+            /* Instrucao invalida tambem e liberada por asm_free */
+            prog->num_instrs++;
+        }
+    }
+
+    free(buf);
+    free(tokens);
+    labels_free(&labels);
+    if (!ok) {
+        asm_free(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+void asm_free(Program *prog) {
+    if (!prog) return;
+    for (int i = 0; i < prog->num_instrs; i++) instr_free(&prog->code[i]);
+    free(prog->code);
+    for (int i = 0; i < prog->strings_size; i++) free(prog->strings[i]);
+    free(prog->strings);
+    free(prog->segments);
+    free(prog->data);
+    free(prog);
+}
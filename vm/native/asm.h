@@ -0,0 +1,122 @@
+/*
+ * asm.h
+ * Leitura do assembly AirFryerVM (.mwasm)
+ *
+ * Decodifica o texto gerado pelo compilador em um programa pronto para o
+ * interpretador nativo: registradores, sensores e labels ja resolvidos
+ * para indices. As regras de validacao e as mensagens de erro sao as da
+ * VM em Python (vm/airfryer_vm.py).
+ */
+
+#ifndef ASM_H
+#define ASM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Registradores de escrita, na ordem em que a VM os imprime */
+typedef enum {
+    REG_TIME, REG_POWER,
+    REG_R0, REG_R1, REG_R2, REG_R3,
+    REG_CNT,
+    REG_A0, REG_A1, REG_A2, REG_A3,
+    NUM_VM_REGS
+} VMReg;
+
+/* Registradores de argumento de passo (A0-A3) */
+#define NUM_ARG_REGS 4
+
+/* Sensores read-only */
+typedef enum {
+    SENSOR_TEMP, SENSOR_WEIGHT, SENSOR_MODE, SENSOR_STATE,
+    NUM_SENSORS
+} VMSensor;
+
+/* Relacoes do WAIT */
+typedef enum { REL_EQ, REL_NE, REL_LT, REL_LE, REL_GT, REL_GE } VMRelation;
+
+/* Operando STACK do PRINTFMT */
+#define OPERAND_STACK (-1)
+
+typedef enum {
+    OP_SET, OP_SETF, OP_INC, OP_DEC, OP_DECJZ, OP_DECJNZ, OP_GOTO,
+    OP_PUSH, OP_POP, OP_HALT, OP_CALL, OP_RET,
+    OP_LOAD, OP_STORE,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+    OP_ADDF, OP_SUBF, OP_MULF, OP_DIVF, OP_MODF, OP_ITOF, OP_FTOI,
+    OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE,
+    OP_AND, OP_OR, OP_NOT,
+    OP_JZ, OP_JNZ, OP_JTABLE,
+    OP_PRINT, OP_PRINTI, OP_PRINTF, OP_PRINTB, OP_SPRINT, OP_PRINTFMT,
+    OP_READ, OP_WAIT, OP_WAITCHG,
+    OP_SETMODE, OP_PAUSE, OP_RESUME, OP_STOP
+} Opcode;
+
+/* Instrucao decodificada */
+typedef struct Instr {
+    Opcode op;
+    int line;                  /* Linha no .mwasm, para mensagens */
+    int a, b;                  /* Registradores (ou sensor/relacao) */
+    int64_t imm;               /* SET, SETMODE, ids de string, bases, CALL n */
+    double fimm;               /* SETF */
+    int target;                /* Label resolvido; -1 se nao existe */
+    char *label;               /* Nome do label (mensagens de erro) */
+    int *list;                 /* JTABLE: alvos; WAITCHG: sensores; */
+                               /* PRINTFMT: registradores ou OPERAND_STACK */
+    char **names;              /* JTABLE: nomes dos labels */
+    int list_len;
+} Instr;
+
+/* Segmento da memoria de dados (DATA) */
+typedef struct DataSegment {
+    int64_t base;
+    int64_t size;
+} DataSegment;
+
+/* Valor inicial de uma celula (DATA) */
+typedef struct DataInit {
+    int64_t address;
+    int frac;
+    int64_t i;
+    double f;
+} DataInit;
+
+/* Programa carregado */
+typedef struct Program {
+    Instr *code;
+    int num_instrs;
+    int code_capacity;
+
+    char **strings;            /* Indexado pelo id do SDEF (NULL = ausente) */
+    int strings_size;
+    int num_strings;           /* Ids definidos */
+
+    DataSegment *segments;
+    int num_segments;
+    int segments_capacity;
+    DataInit *data;
+    int num_data;
+    int data_capacity;
+    int64_t memory_size;       /* Maior base + tamanho */
+} Program;
+
+/* Limite de celulas da memoria de dados */
+#define MAX_MEMORY (1 << 20)
+
+/* Carregar o assembly em source (size bytes) */
+/* Retorna o programa ou NULL com a mensagem em err */
+Program* asm_load(const char *source, size_t size, char *err, size_t err_size);
+
+/* Tamanho do segmento que comeca em base, ou -1 */
+int64_t asm_segment_size(const Program *prog, int64_t base);
+
+/* Nome de um registrador, sensor ou opcode */
+const char* asm_reg_name(int reg);
+const char* asm_sensor_name(int sensor);
+const char* asm_relation_name(int rel);
+const char* asm_op_name(Opcode op);
+
+/* Liberar um programa */
+void asm_free(Program *prog);
+
+#endif /* ASM_H */
@@ -0,0 +1,779 @@
+/*
+ * jit.c
+ * JIT de lacos quentes da AirFryerVM nativa (x86-64)
+ *
+ * Layout do codigo de uma regiao:
+ *
+ *   prologo   salva os registradores do host, carrega os registradores
+ *             da VM usados e steps, e salta para a entrada pedida
+ *   corpo     uma entrada por instrucao da VM; cada uma faz primeiro as
+ *             verificacoes (que saem sem mudar nada), depois conta o
+ *             step e executa
+ *   saidas    "mov eax, pc; jmp epilogo" para cada ponto de saida
+ *   epilogo   devolve registradores, steps e pc a VM
+ *
+ * Registradores do host: rdi = VM*, r15 = steps, rax/rcx/rdx livres,
+ * e os registradores da VM usados na regiao em rbx, rbp, rsi, r8-r14.
+ */
+
+#include "jit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define INITIAL_CAPACITY 16
+
+/* Desvios para tras ate um laco ser compilado */
+#define HOT_THRESHOLD 64
+
+/* Falhas de guarda (registrador frac) ate a regiao ser descartada */
+#define MAX_GUARD_FAILURES 1024
+
+/* Offset de uma instrucao que nao tem entrada */
+#define NO_ENTRY ((size_t)-1)
+
+_Static_assert(sizeof(Value) == 16, "o JIT indexa pilha e memoria com shl 4");
+
+/* Registradores do host */
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/* Registradores do host para os da VM, em ordem de uso */
+static const int HOST_POOL[] = { RBX, RBP, RSI, R8, R9, R10, R11, R12, R13, R14 };
+#define HOST_POOL_SIZE ((int)(sizeof(HOST_POOL) / sizeof(HOST_POOL[0])))
+
+/* Registradores salvos pelo prologo (callee-saved do System V) */
+static const int SAVED[] = { RBX, RBP, R12, R13, R14, R15 };
+#define NUM_SAVED ((int)(sizeof(SAVED) / sizeof(SAVED[0])))
+
+/* Condicoes do jcc/setcc */
+enum {
+    CC_O = 0x0, CC_E = 0x4, CC_NE = 0x5, CC_NS = 0x9,
+    CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF,
+    CC_AE = 0x3, CC_ALWAYS = -1
+};
+
+/* Offsets do estado da VM lido pelo codigo gerado */
+#define OFF_REG(r)     ((int32_t)(offsetof(VM, regs) + (r) * sizeof(Value)))
+#define OFF_TAG        ((int32_t)offsetof(Value, frac))
+#define OFF_SENSOR(s)  ((int32_t)(offsetof(VM, oven) + offsetof(Oven, sensors) + (s) * sizeof(int64_t)))
+#define OFF_STACK      ((int32_t)offsetof(VM, stack))
+#define OFF_SP         ((int32_t)offsetof(VM, sp))
+#define OFF_STACK_CAP  ((int32_t)offsetof(VM, stack_capacity))
+#define OFF_PC         ((int32_t)offsetof(VM, pc))
+#define OFF_STEPS      ((int32_t)offsetof(VM, steps))
+
+/* Codigo nativo de um laco [start, end] */
+typedef struct Region {
+    int start, end;
+    unsigned char *code;           /* mmap, so leitura e execucao */
+    size_t code_size;
+    size_t *offsets;               /* Entrada de cada instrucao, ou NO_ENTRY */
+    unsigned used;                 /* Registradores da VM usados (bits) */
+    int64_t step_limit;            /* Maior steps com que se pode entrar */
+    int guard_failures;
+    struct Region *next;
+} Region;
+
+typedef void (*RegionFn)(VM *vm, void *entry);
+
+struct Jit {
+    int num_instrs;
+    int *counters;                 /* Desvios para tras por alvo */
+    Region **region_of;            /* Regiao que cobre cada instrucao */
+    Region *regions;               /* Todas as regioes (para liberar) */
+
+    long compiled;
+    long rejected;
+    long discarded;
+    long entries;
+    long guard_failures;
+};
+
+/* ===== EMISSOR ===== */
+
+/* Referencia a resolver: rel32 em at aponta para uma instrucao ou saida */
+typedef enum { FIX_INSTR, FIX_EXIT, FIX_EPILOGUE } FixKind;
+
+typedef struct Fixup {
+    size_t at;
+    FixKind kind;
+    int value;                     /* Indice na regiao ou pc da saida */
+} Fixup;
+
+typedef struct Emitter {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+
+    Fixup *fixups;
+    int num_fixups;
+    int fixups_capacity;
+
+    int host[NUM_VM_REGS];         /* Registrador do host de cada um da VM */
+    int start, end;
+    int64_t step_limit;
+} Emitter;
+
+static void emit8(Emitter *e, unsigned x) {
+    if (e->size >= e->capacity) {
+        e->capacity *= 2;
+        e->data = realloc(e->data, e->capacity);
+    }
+    e->data[e->size++] = (unsigned char)x;
+}
+
+static void emit32(Emitter *e, int32_t x) {
+    uint32_t u = (uint32_t)x;
+    for (int i = 0; i < 4; i++) emit8(e, (u >> (8 * i)) & 0xFF);
+}
+
+static void emit64(Emitter *e, int64_t x) {
+    uint64_t u = (uint64_t)x;
+    for (int i = 0; i < 8; i++) emit8(e, (u >> (8 * i)) & 0xFF);
+}
+
+static void patch32(Emitter *e, size_t at, int32_t x) {
+    uint32_t u = (uint32_t)x;
+    for (int i = 0; i < 4; i++) e->data[at + i] = (u >> (8 * i)) & 0xFF;
+}
+
+static void add_fixup(Emitter *e, FixKind kind, int value) {
+    if (e->num_fixups >= e->fixups_capacity) {
+        e->fixups_capacity *= 2;
+        e->fixups = realloc(e->fixups, e->fixups_capacity * sizeof(Fixup));
+    }
+    Fixup *f = &e->fixups[e->num_fixups++];
+    f->at = e->size;
+    f->kind = kind;
+    f->value = value;
+    emit32(e, 0);
+}
+
+/* Prefixo REX (omitido quando vazio) */
+static void rex(Emitter *e, int w, int reg, int rm) {
+    unsigned x = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (x != 0x40) emit8(e, x);
+}
+
+static void modrm_reg(Emitter *e, int reg, int rm) {
+    emit8(e, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* [base + disp32]; base nunca e rsp/r12 (exigiriam SIB) */
+static void modrm_mem(Emitter *e, int reg, int base, int32_t disp) {
+    emit8(e, 0x80 | ((reg & 7) << 3) | (base & 7));
+    emit32(e, disp);
+}
+
+/* op r/m64, r64 (mov 89, add 01, sub 29, cmp 39, test 85, xor 31) */
+static void op_rr(Emitter *e, unsigned opcode, int rm, int reg) {
+    rex(e, 1, reg, rm);
+    emit8(e, opcode);
+    modrm_reg(e, reg, rm);
+}
+
+static void mov_rr(Emitter *e, int dst, int src) {
+    if (dst != src) op_rr(e, 0x89, dst, src);
+}
+
+/* mov r64, [base + disp] */
+static void load(Emitter *e, int dst, int base, int32_t disp) {
+    rex(e, 1, dst, base);
+    emit8(e, 0x8B);
+    modrm_mem(e, dst, base, disp);
+}
+
+/* mov [base + disp], r64 */
+static void store(Emitter *e, int base, int32_t disp, int src) {
+    rex(e, 1, src, base);
+    emit8(e, 0x89);
+    modrm_mem(e, src, base, disp);
+}
+
+/* op r64, [base + disp] (add 03, cmp 3B) */
+static void op_rm(Emitter *e, unsigned opcode, int reg, int base, int32_t disp) {
+    rex(e, 1, reg, base);
+    emit8(e, opcode);
+    modrm_mem(e, reg, base, disp);
+}
+
+/* mov qword [base + disp], imm32 */
+static void store_imm(Emitter *e, int base, int32_t disp, int32_t imm) {
+    rex(e, 1, 0, base);
+    emit8(e, 0xC7);
+    modrm_mem(e, 0, base, disp);
+    emit32(e, imm);
+}
+
+/* cmp dword [base + disp], imm8 */
+static void cmp_mem32_imm8(Emitter *e, int base, int32_t disp, int8_t imm) {
+    rex(e, 0, 0, base);
+    emit8(e, 0x83);
+    modrm_mem(e, 7, base, disp);
+    emit8(e, (uint8_t)imm);
+}
+
+/* inc/dec qword [base + disp] (ext 0 ou 1) */
+static void incdec_mem(Emitter *e, int ext, int base, int32_t disp) {
+    rex(e, 1, 0, base);
+    emit8(e, 0xFF);
+    modrm_mem(e, ext, base, disp);
+}
+
+static void mov_imm(Emitter *e, int dst, int64_t imm) {
+    if (imm >= INT32_MIN && imm <= INT32_MAX) {
+        rex(e, 1, 0, dst);
+        emit8(e, 0xC7);
+        modrm_reg(e, 0, dst);
+        emit32(e, (int32_t)imm);
+    } else {
+        rex(e, 1, 0, dst);
+        emit8(e, 0xB8 + (dst & 7));
+        emit64(e, imm);
+    }
+}
+
+/* add/sub/cmp r64, imm32 (ext 0, 5, 7) */
+static void op_imm(Emitter *e, int ext, int dst, int32_t imm) {
+    rex(e, 1, 0, dst);
+    emit8(e, 0x81);
+    modrm_reg(e, ext, dst);
+    emit32(e, imm);
+}
+
+static void inc_reg(Emitter *e, int r) {
+    rex(e, 1, 0, r);
+    emit8(e, 0xFF);
+    modrm_reg(e, 0, r);
+}
+
+static void shl_imm(Emitter *e, int r, int count) {
+    rex(e, 1, 0, r);
+    emit8(e, 0xC1);
+    modrm_reg(e, 4, r);
+    emit8(e, count);
+}
+
+/* dst = 0/1 conforme a condicao cc, usando cl (flags ja prontas) */
+static void setcc_rcx(Emitter *e, int cc) {
+    emit8(e, 0x0F);
+    emit8(e, 0x90 + cc);
+    modrm_reg(e, 0, RCX);
+}
+
+static void push_reg(Emitter *e, int r) {
+    if (r >= 8) emit8(e, 0x41);
+    emit8(e, 0x50 + (r & 7));
+}
+
+static void pop_reg(Emitter *e, int r) {
+    if (r >= 8) emit8(e, 0x41);
+    emit8(e, 0x58 + (r & 7));
+}
+
+/* jcc/jmp para uma instrucao da regiao ou para uma saida */
+static void jump_to(Emitter *e, int cc, FixKind kind, int value) {
+    if (cc == CC_ALWAYS) {
+        emit8(e, 0xE9);
+    } else {
+        emit8(e, 0x0F);
+        emit8(e, 0x80 + cc);
+    }
+    add_fixup(e, kind, value);
+}
+
+/* Sair para o interpretador em pc se cc valer */
+static void exit_if(Emitter *e, int cc, int64_t pc) {
+    jump_to(e, cc, FIX_EXIT, (int)pc);
+}
+
+/* ===== TRADUCAO ===== */
+
+/* Registradores da VM lidos ou escritos por uma instrucao traduzida */
+static unsigned regs_of(const Instr *in) {
+    switch (in->op) {
+        case OP_SET: case OP_INC: case OP_DEC: case OP_DECJZ: case OP_DECJNZ:
+        case OP_NOT: case OP_JZ: case OP_JNZ: case OP_PUSH: case OP_POP: case OP_READ:
+            return 1u << in->a;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+        case OP_AND: case OP_OR: case OP_LOAD: case OP_STORE:
+            return (1u << in->a) | (1u << in->b);
+        default:
+            return 0;
+    }
+}
+
+/* A instrucao tem traducao? (as demais saem para o interpretador) */
+static int translatable(const Program *prog, const Instr *in) {
+    switch (in->op) {
+        case OP_DECJZ: case OP_DECJNZ: case OP_GOTO: case OP_JZ: case OP_JNZ:
+            return in->target >= 0;
+        case OP_LOAD: case OP_STORE:
+            return asm_segment_size(prog, in->imm) > 0;
+        case OP_SET: case OP_INC: case OP_DEC:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+        case OP_AND: case OP_OR: case OP_NOT:
+        case OP_PUSH: case OP_POP: case OP_READ:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Desvio (ja contado) da instrucao pc para target se cc valer */
+static void branch(Emitter *e, int cc, int64_t pc, int target) {
+    if (target < e->start || target > e->end) {
+        exit_if(e, cc, target);
+        return;
+    }
+    if (target > pc) {
+        jump_to(e, cc, FIX_INSTR, target - e->start);
+        return;
+    }
+
+    /* Para tras: so continua se ainda cabe uma volta inteira no limite */
+    size_t skip = 0;
+    if (cc != CC_ALWAYS) {
+        emit8(e, 0x70 + (cc ^ 1));
+        skip = e->size;
+        emit8(e, 0);
+    }
+    mov_imm(e, RCX, e->step_limit);
+    op_rr(e, 0x39, R15, RCX);
+    exit_if(e, CC_G, target);
+    jump_to(e, CC_ALWAYS, FIX_INSTR, target - e->start);
+    if (cc != CC_ALWAYS) e->data[skip] = (unsigned char)(e->size - skip - 1);
+}
+
+/* Endereco de memory[base + indice] em rcx; sai se fora do segmento */
+static void data_address(Emitter *e, const VM *vm, const Instr *in, int64_t pc) {
+    int index = e->host[in->b];
+    int64_t size = asm_segment_size(vm->prog, in->imm);
+    op_imm(e, 7, index, (int32_t)size);
+    exit_if(e, CC_AE, pc);
+    mov_rr(e, RCX, index);
+    shl_imm(e, RCX, 4);
+    mov_imm(e, RDX, (int64_t)(intptr_t)(vm->memory + in->imm));
+    op_rr(e, 0x01, RCX, RDX);
+}
+
+static void translate(Emitter *e, const VM *vm, const Instr *in, int64_t pc) {
+    int a = e->host[in->a];
+    int b = e->host[in->b];
+
+    switch (in->op) {
+        case OP_SET:
+            inc_reg(e, R15);
+            mov_imm(e, a, in->imm);
+            break;
+
+        case OP_INC: case OP_DEC:
+            mov_rr(e, RCX, a);
+            op_imm(e, in->op == OP_INC ? 0 : 5, RCX, 1);
+            exit_if(e, CC_O, pc);
+            inc_reg(e, R15);
+            mov_rr(e, a, RCX);
+            break;
+
+        case OP_ADD: case OP_SUB: case OP_MUL:
+            mov_rr(e, RCX, a);
+            if (in->op == OP_MUL) {
+                rex(e, 1, RCX, b);
+                emit8(e, 0x0F);
+                emit8(e, 0xAF);
+                modrm_reg(e, RCX, b);
+            } else {
+                op_rr(e, in->op == OP_ADD ? 0x01 : 0x29, RCX, b);
+            }
+            exit_if(e, CC_O, pc);
+            inc_reg(e, R15);
+            mov_rr(e, a, RCX);
+            break;
+
+        case OP_DIV: case OP_MOD: {
+            /* Divisor 0 (erro) e -1 (estouro do idiv) ficam com o interpretador */
+            op_rr(e, 0x85, b, b);
+            exit_if(e, CC_E, pc);
+            op_imm(e, 7, b, -1);
+            exit_if(e, CC_E, pc);
+            mov_rr(e, RAX, a);
+            emit8(e, 0x48);            /* cqo */
+            emit8(e, 0x99);
+            rex(e, 1, 0, b);           /* idiv b */
+            emit8(e, 0xF7);
+            modrm_reg(e, 7, b);
+
+            /* Arredondar para baixo: resto com sinal do divisor */
+            op_rr(e, 0x85, RDX, RDX);
+            emit8(e, 0x74);            /* jz fim */
+            size_t done1 = e->size;
+            emit8(e, 0);
+            mov_rr(e, RCX, RDX);
+            op_rr(e, 0x31, RCX, b);
+            emit8(e, 0x79);            /* jns fim */
+            size_t done2 = e->size;
+            emit8(e, 0);
+            op_imm(e, 5, RAX, 1);
+            op_rr(e, 0x01, RDX, b);
+            e->data[done1] = (unsigned char)(e->size - done1 - 1);
+            e->data[done2] = (unsigned char)(e->size - done2 - 1);
+
+            inc_reg(e, R15);
+            mov_rr(e, a, in->op == OP_DIV ? RAX : RDX);
+            break;
+        }
+
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE: {
+            static const int CC_OF[] = {
+                [OP_EQ] = CC_E, [OP_NE] = CC_NE, [OP_LT] = CC_L,
+                [OP_LE] = CC_LE, [OP_GT] = CC_G, [OP_GE] = CC_GE
+            };
+            inc_reg(e, R15);
+            emit8(e, 0x31);            /* xor ecx, ecx */
+            emit8(e, 0xC9);
+            op_rr(e, 0x39, a, b);
+            setcc_rcx(e, CC_OF[in->op]);
+            mov_rr(e, a, RCX);
+            break;
+        }
+
+        case OP_AND: case OP_OR:
+            inc_reg(e, R15);
+            emit8(e, 0x31);            /* xor ecx, ecx */
+            emit8(e, 0xC9);
+            emit8(e, 0x31);            /* xor edx, edx */
+            emit8(e, 0xD2);
+            op_rr(e, 0x85, a, a);
+            setcc_rcx(e, CC_NE);
+            op_rr(e, 0x85, b, b);
+            emit8(e, 0x0F);            /* setne dl */
+            emit8(e, 0x95);
+            modrm_reg(e, 0, RDX);
+            emit8(e, in->op == OP_AND ? 0x21 : 0x09);   /* and/or ecx, edx */
+            emit8(e, 0xD1);
+            mov_rr(e, a, RCX);
+            break;
+
+        case OP_NOT:
+            inc_reg(e, R15);
+            emit8(e, 0x31);            /* xor ecx, ecx */
+            emit8(e, 0xC9);
+            op_rr(e, 0x85, a, a);
+            setcc_rcx(e, CC_E);
+            mov_rr(e, a, RCX);
+            break;
+
+        case OP_GOTO:
+            inc_reg(e, R15);
+            branch(e, CC_ALWAYS, pc, in->target);
+            break;
+
+        case OP_JZ: case OP_JNZ:
+            inc_reg(e, R15);
+            op_rr(e, 0x85, a, a);
+            branch(e, in->op == OP_JZ ? CC_E : CC_NE, pc, in->target);
+            break;
+
+        case OP_DECJNZ:
+            mov_rr(e, RCX, a);
+            op_imm(e, 5, RCX, 1);
+            exit_if(e, CC_O, pc);
+            inc_reg(e, R15);
+            mov_rr(e, a, RCX);
+            op_rr(e, 0x85, a, a);
+            branch(e, CC_NE, pc, in->target);
+            break;
+
+        case OP_DECJZ:
+            /* So decrementa quando nao salta */
+            mov_rr(e, RCX, a);
+            op_imm(e, 5, RCX, 1);
+            exit_if(e, CC_O, pc);
+            inc_reg(e, R15);
+            op_rr(e, 0x85, a, a);
+            branch(e, CC_E, pc, in->target);
+            mov_rr(e, a, RCX);
+            break;
+
+        case OP_PUSH:
+            load(e, RCX, RDI, OFF_SP);
+            op_rm(e, 0x3B, RCX, RDI, OFF_STACK_CAP);
+            exit_if(e, CC_GE, pc);
+            inc_reg(e, R15);
+            shl_imm(e, RCX, 4);
+            op_rm(e, 0x03, RCX, RDI, OFF_STACK);
+            store(e, RCX, 0, a);
+            store_imm(e, RCX, OFF_TAG, 0);
+            incdec_mem(e, 0, RDI, OFF_SP);
+            break;
+
+        case OP_POP:
+            load(e, RCX, RDI, OFF_SP);
+            op_rr(e, 0x85, RCX, RCX);
+            exit_if(e, CC_E, pc);
+            op_imm(e, 5, RCX, 1);
+            shl_imm(e, RCX, 4);
+            op_rm(e, 0x03, RCX, RDI, OFF_STACK);
+            cmp_mem32_imm8(e, RCX, OFF_TAG, 0);
+            exit_if(e, CC_NE, pc);
+            inc_reg(e, R15);
+            load(e, a, RCX, 0);
+            incdec_mem(e, 1, RDI, OFF_SP);
+            break;
+
+        case OP_LOAD:
+            data_address(e, vm, in, pc);
+            cmp_mem32_imm8(e, RCX, OFF_TAG, 0);
+            exit_if(e, CC_NE, pc);
+            inc_reg(e, R15);
+            load(e, a, RCX, 0);
+            break;
+
+        case OP_STORE:
+            data_address(e, vm, in, pc);
+            inc_reg(e, R15);
+            store(e, RCX, 0, a);
+            store_imm(e, RCX, OFF_TAG, 0);
+            break;
+
+        case OP_READ:
+            inc_reg(e, R15);
+            load(e, a, RDI, OFF_SENSOR(in->b));
+            break;
+
+        default:
+            exit_if(e, CC_ALWAYS, pc);
+            break;
+    }
+}
+
+/* Compilar [start, end]; retorna NULL se a regiao nao cabe no host */
+static Region* compile(const VM *vm, int start, int end) {
+    const Program *prog = vm->prog;
+    int64_t max_steps = vm->max_steps ? vm->max_steps : INT64_MAX;
+    int len = end - start + 1;
+    if (max_steps < len) return NULL;
+
+    /* Registradores usados pelas instrucoes traduzidas */
+    unsigned used = 0;
+    for (int pc = start; pc <= end; pc++) {
+        const Instr *in = &prog->code[pc];
+        if (translatable(prog, in)) used |= regs_of(in);
+    }
+
+    Emitter e = {0};
+    e.start = start;
+    e.end = end;
+    e.step_limit = max_steps - len;
+    int num_mapped = 0;
+    for (int r = 0; r < NUM_VM_REGS; r++) {
+        e.host[r] = -1;
+        if (!(used & (1u << r))) continue;
+        if (num_mapped >= HOST_POOL_SIZE) return NULL;
+        e.host[r] = HOST_POOL[num_mapped++];
+    }
+    e.capacity = 256;
+    e.data = malloc(e.capacity);
+    e.fixups_capacity = INITIAL_CAPACITY;
+    e.fixups = malloc(e.fixups_capacity * sizeof(Fixup));
+
+    /* Prologo: fn(vm, entrada) */
+    for (int i = 0; i < NUM_SAVED; i++) push_reg(&e, SAVED[i]);
+    mov_rr(&e, RAX, RSI);
+    load(&e, R15, RDI, OFF_STEPS);
+    for (int r = 0; r < NUM_VM_REGS; r++) {
+        if (e.host[r] >= 0) load(&e, e.host[r], RDI, OFF_REG(r));
+    }
+    emit8(&e, 0xFF);                   /* jmp rax */
+    modrm_reg(&e, 4, RAX);
+
+    /* Corpo */
+    size_t *offsets = malloc(len * sizeof(size_t));
+    size_t *labels = malloc(len * sizeof(size_t));
+    for (int pc = start; pc <= end; pc++) {
+        const Instr *in = &prog->code[pc];
+        labels[pc - start] = e.size;
+        offsets[pc - start] = translatable(prog, in) ? e.size : NO_ENTRY;
+        translate(&e, vm, in, pc);
+    }
+    exit_if(&e, CC_ALWAYS, end + 1);
+
+    /* Epilogo */
+    size_t epilogue = e.size;
+    for (int r = 0; r < NUM_VM_REGS; r++) {
+        if (e.host[r] >= 0) store(&e, RDI, OFF_REG(r), e.host[r]);
+    }
+    store(&e, RDI, OFF_STEPS, R15);
+    store(&e, RDI, OFF_PC, RAX);
+    for (int i = NUM_SAVED - 1; i >= 0; i--) pop_reg(&e, SAVED[i]);
+    emit8(&e, 0xC3);
+
+    /* Saidas e resolucao dos desvios */
+    int num_fixups = e.num_fixups;
+    for (int i = 0; i < num_fixups; i++) {
+        Fixup *f = &e.fixups[i];
+        size_t dest;
+        if (f->kind == FIX_INSTR) {
+            dest = labels[f->value];
+        } else {
+            dest = e.size;
+            emit8(&e, 0xB8);           /* mov eax, pc */
+            emit32(&e, f->value);
+            emit8(&e, 0xE9);           /* jmp epilogo */
+            emit32(&e, (int32_t)(epilogue - (e.size + 4)));
+        }
+        patch32(&e, f->at, (int32_t)(dest - (f->at + 4)));
+    }
+    free(labels);
+    free(e.fixups);
+
+    /* Copiar para paginas executaveis (nunca escrita e execucao juntas) */
+    long page = sysconf(_SC_PAGESIZE);
+    size_t code_size = (e.size + page - 1) / page * page;
+    unsigned char *code = mmap(NULL, code_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        free(e.data);
+        free(offsets);
+        return NULL;
+    }
+    memcpy(code, e.data, e.size);
+    free(e.data);
+    if (mprotect(code, code_size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, code_size);
+        free(offsets);
+        return NULL;
+    }
+
+    Region *region = calloc(1, sizeof(Region));
+    region->start = start;
+    region->end = end;
+    region->code = code;
+    region->code_size = code_size;
+    region->offsets = offsets;
+    region->used = used;
+    region->step_limit = max_steps - len;
+    return region;
+}
+
+/* ===== API ===== */
+
+Jit* jit_create(VM *vm) {
+    Jit *jit = calloc(1, sizeof(Jit));
+    jit->num_instrs = vm->prog->num_instrs;
+    jit->counters = calloc(jit->num_instrs + 1, sizeof(int));
+    jit->region_of = calloc(jit->num_instrs + 1, sizeof(Region*));
+    return jit;
+}
+
+void jit_backedge(Jit *jit, VM *vm, int64_t pc, int64_t target) {
+    if (++jit->counters[target] != HOT_THRESHOLD) return;
+
+    /* Laco ja dentro de uma regiao maior */
+    Region *current = jit->region_of[target];
+    if (current && current->start <= target && current->end >= pc) return;
+
+    Region *region = compile(vm, (int)target, (int)pc);
+    if (!region) {
+        jit->rejected++;
+        return;
+    }
+    region->next = jit->regions;
+    jit->regions = region;
+    jit->compiled++;
+
+    /* Um laco externo substitui os internos que contem */
+    for (int64_t i = target; i <= pc; i++) jit->region_of[i] = region;
+}
+
+/* Descartar uma regiao que quase sempre falha na guarda */
+static void discard(Jit *jit, Region *region) {
+    for (int i = region->start; i <= region->end; i++) {
+        if (jit->region_of[i] == region) jit->region_of[i] = NULL;
+    }
+    jit->discarded++;
+}
+
+int jit_enter(Jit *jit, VM *vm) {
+    int64_t pc = vm->pc;
+    if (pc < 0 || pc >= jit->num_instrs) return 0;
+    Region *region = jit->region_of[pc];
+    if (!region) return 0;
+    size_t offset = region->offsets[pc - region->start];
+    if (offset == NO_ENTRY) return 0;
+
+    /* Perto do limite de steps o interpretador termina sozinho */
+    if (vm->steps > region->step_limit) return 0;
+
+    /* O codigo nativo so conhece inteiros */
+    for (int r = 0; r < NUM_VM_REGS; r++) {
+        if ((region->used & (1u << r)) && vm->regs[r].frac) {
+            jit->guard_failures++;
+            if (++region->guard_failures >= MAX_GUARD_FAILURES) discard(jit, region);
+            return 0;
+        }
+    }
+
+    jit->entries++;
+    ((RegionFn)(void *)region->code)(vm, region->code + offset);
+    return 1;
+}
+
+void jit_stats(const Jit *jit, FILE *out) {
+    fprintf(out, "JIT: %ld regioes compiladas, %ld recusadas, %ld descartadas\n",
+            jit->compiled, jit->rejected, jit->discarded);
+    fprintf(out, "JIT: %ld entradas no codigo nativo, %ld falhas de guarda\n",
+            jit->entries, jit->guard_failures);
+}
+
+void jit_free(Jit *jit) {
+    if (!jit) return;
+    Region *region = jit->regions;
+    while (region) {
+        Region *next = region->next;
+        munmap(region->code, region->code_size);
+        free(region->offsets);
+        free(region);
+        region = next;
+    }
+    free(jit->counters);
+    free(jit->region_of);
+    free(jit);
+}
+
+#else /* Sem JIT nesta plataforma */
+
+Jit* jit_create(VM *vm) {
+    (void)vm;
+    return NULL;
+}
+
+void jit_backedge(Jit *jit, VM *vm, int64_t pc, int64_t target) {
+    (void)jit; (void)vm; (void)pc; (void)target;
+}
+
+int jit_enter(Jit *jit, VM *vm) {
+    (void)jit; (void)vm;
+    return 0;
+}
+
+void jit_stats(const Jit *jit, FILE *out) {
+    (void)jit;
+    fprintf(out, "JIT: indisponivel nesta plataforma\n");
+}
+
+void jit_free(Jit *jit) {
+    (void)jit;
+}
+
+#endif
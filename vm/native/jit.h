@@ -0,0 +1,43 @@
+/*
+ * jit.h
+ * JIT de lacos quentes da AirFryerVM nativa (x86-64)
+ *
+ * O interpretador avisa cada desvio para tras (jit_backedge). Quando um
+ * laco passa de um limite de execucoes, o trecho [inicio, fim do laco] e
+ * traduzido para codigo de maquina: registradores da VM em registradores
+ * do host, uma instrucao da VM por poucas instrucoes nativas.
+ *
+ * So registradores inteiros sao traduzidos. Qualquer coisa fora disso
+ * (frac, impressao, CALL, WAIT, estouro, divisao por zero, indice fora do
+ * segmento...) sai do codigo nativo e o interpretador executa a
+ * instrucao, com a mesma saida e os mesmos erros. O limite de steps e
+ * verificado a cada volta do laco.
+ *
+ * Fora de x86-64 Linux, jit_create retorna NULL e tudo e interpretado.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "vm.h"
+#include <stdio.h>
+
+typedef struct Jit Jit;
+
+/* Criar o JIT de vm (NULL se a plataforma nao e suportada) */
+Jit* jit_create(VM *vm);
+
+/* Desvio para tras de pc para target executado pelo interpretador */
+void jit_backedge(Jit *jit, VM *vm, int64_t pc, int64_t target);
+
+/* Executar codigo nativo a partir de vm->pc, se houver */
+/* Retorna 1 se executou (vm->pc aponta para onde parou), 0 se nao */
+int jit_enter(Jit *jit, VM *vm);
+
+/* Imprimir contadores do JIT */
+void jit_stats(const Jit *jit, FILE *out);
+
+/* Liberar o JIT e o codigo gerado */
+void jit_free(Jit *jit);
+
+#endif /* JIT_H */
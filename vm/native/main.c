@@ -0,0 +1,114 @@
+/*
+ * main.c
+ * Ponto de entrada da AirFryerVM nativa
+ *
+ * Mesma saida da VM em Python (python3 vm/airfryer_vm.py arquivo.mwasm),
+ * com o JIT de lacos ligado por padrao.
+ */
+
+#include "asm.h"
+#include "vm.h"
+#include "jit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void print_usage(const char *prog) {
+    printf("Uso: %s <arquivo.mwasm> [opcoes]\n", prog);
+    printf("\nOpcoes:\n");
+    printf("  --no-jit          Apenas o interpretador\n");
+    printf("  --max-steps n     Limite de instrucoes executadas (padrao %d, 0 = sem limite)\n",
+           DEFAULT_MAX_STEPS);
+    printf("  --jit-stats       Contadores do JIT em stderr ao terminar\n");
+}
+
+/* Ler o arquivo inteiro; retorna NULL se nao existe */
+static char* read_file(const char *filename, size_t *size) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(length + 1);
+    *size = fread(data, 1, length, f);
+    data[*size] = '\0';
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char **argv) {
+    const char *filename = NULL;
+    int use_jit = 1;
+    int show_stats = 0;
+    long long max_steps = DEFAULT_MAX_STEPS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-jit") == 0) {
+            use_jit = 0;
+        } else if (strcmp(argv[i], "--jit-stats") == 0) {
+            show_stats = 1;
+        } else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+            char *end;
+            max_steps = strtoll(argv[++i], &end, 10);
+            if (*end || max_steps < 0) {
+                fprintf(stderr, "Erro: --max-steps requer um inteiro >= 0\n");
+                return 1;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Erro: opcao desconhecida '%s'\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        } else if (!filename) {
+            filename = argv[i];
+        }
+    }
+
+    if (!filename) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    size_t size;
+    char *source = read_file(filename, &size);
+    if (!source) {
+        printf("Erro: Arquivo '%s' nao encontrado.\n", filename);
+        return 1;
+    }
+
+    printf("Carregando programa: %s\n", filename);
+    char err[512];
+    Program *prog = asm_load(source, size, err, sizeof(err));
+    free(source);
+    if (!prog) {
+        printf("\nERRO: %s\n", err);
+        return 1;
+    }
+    printf("Programa carregado: %d instrucoes, %d strings\n\n", prog->num_instrs, prog->num_strings);
+    printf("=== EXECUTANDO ===\n\n");
+
+    VM *vm = vm_create(prog, stdout);
+    vm->max_steps = max_steps;
+    if (use_jit) vm->jit = jit_create(vm);
+
+    int ok = vm_run(vm);
+    if (ok) {
+        printf("\n\n=== ESTADO FINAL ===\n");
+        vm_print_state(vm, stdout);
+    } else {
+        printf("\nERRO: %s\n", vm->error);
+    }
+
+    if (show_stats) {
+        fflush(stdout);
+        if (vm->jit) {
+            jit_stats(vm->jit, stderr);
+        } else {
+            fprintf(stderr, "JIT: desligado\n");
+        }
+    }
+
+    jit_free(vm->jit);
+    vm_free(vm);
+    asm_free(prog);
+    return ok ? 0 : 1;
+}
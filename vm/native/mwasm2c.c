@@ -0,0 +1,538 @@
+/*
+ * mwasm2c.c
+ * Tradutor antecipado de assembly AirFryerVM (.mwasm) para C
+ *
+ * Cada label do assembly vira um label C e cada instrucao um comando C
+ * sobre variaveis locais (uma por registrador da VM). A string table e a
+ * memoria de dados viram dados estaticos; pilha, CALL/RET, sensores e
+ * impressao ficam no runtime (aot.h, runtime.h). O executavel gerado
+ * imprime exatamente o que a VM imprimiria para o mesmo .mwasm:
+ *
+ *   mwasm2c prog.mwasm -o prog.c
+ *   gcc -O2 -Ivm/native prog.c build/libairfryer_rt.a -lm -o prog
+ */
+
+#include "asm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+static const char *CMP_RELATIONS[] = {
+    [OP_EQ] = "REL_EQ", [OP_NE] = "REL_NE", [OP_LT] = "REL_LT",
+    [OP_LE] = "REL_LE", [OP_GT] = "REL_GT", [OP_GE] = "REL_GE"
+};
+
+static const char *RELATION_CONSTANTS[] = {
+    "REL_EQ", "REL_NE", "REL_LT", "REL_LE", "REL_GT", "REL_GE"
+};
+
+static const char *SENSOR_CONSTANTS[] = {
+    "SENSOR_TEMP", "SENSOR_WEIGHT", "SENSOR_MODE", "SENSOR_STATE"
+};
+
+/* Labels C de cada instrucao */
+typedef struct Labels {
+    char **names;                  /* Label C de cada alvo de desvio (ou NULL) */
+    char *returns;                 /* 1 se a instrucao segue um CALL */
+} Labels;
+
+/* ===== TEXTO C ===== */
+
+/* Literal de string C (bytes fora do ASCII visivel em octal) */
+static void emit_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *)s; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20 || *c >= 0x7F || *c == '?') {
+            /* '?' evita trigrafos */
+            fprintf(out, "\\%03o", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void emit_int(FILE *out, int64_t x) {
+    if (x == INT64_MIN) {
+        fprintf(out, "INT64_MIN");
+    } else {
+        fprintf(out, "INT64_C(%lld)", (long long)x);
+    }
+}
+
+/* Literal double exato */
+static void emit_double(FILE *out, double x) {
+    if (isnan(x)) {
+        fprintf(out, "NAN");
+    } else if (isinf(x)) {
+        fprintf(out, x > 0 ? "HUGE_VAL" : "(-HUGE_VAL)");
+    } else {
+        fprintf(out, "%a", x);
+    }
+}
+
+/* Label C de um label do assembly: L_nome, ou L<pc> se o nome nao e */
+/* um identificador C */
+static char* c_label(const char *name, int pc) {
+    int valid = *name != '\0';
+    for (const char *c = name; *c; c++) {
+        if (!isalnum((unsigned char)*c) && *c != '_') valid = 0;
+    }
+    char *label = malloc(strlen(name) + 24);
+    if (valid) {
+        sprintf(label, "L_%s", name);
+    } else {
+        sprintf(label, "L%d", pc);
+    }
+    return label;
+}
+
+static Labels collect_labels(const Program *prog) {
+    Labels labels;
+    labels.names = calloc(prog->num_instrs + 1, sizeof(char*));
+    labels.returns = calloc(prog->num_instrs + 1, 1);
+    for (int pc = 0; pc < prog->num_instrs; pc++) {
+        const Instr *in = &prog->code[pc];
+        if (in->target >= 0 && !labels.names[in->target]) {
+            labels.names[in->target] = c_label(in->label, in->target);
+        }
+        if (in->op == OP_JTABLE) {
+            for (int i = 0; i < in->list_len; i++) {
+                if (in->list[i] >= 0 && !labels.names[in->list[i]]) {
+                    labels.names[in->list[i]] = c_label(in->names[i], in->list[i]);
+                }
+            }
+        }
+        if (in->op == OP_CALL) labels.returns[pc + 1] = 1;
+    }
+    return labels;
+}
+
+static void free_labels(Labels *labels, int num_instrs) {
+    for (int pc = 0; pc <= num_instrs; pc++) free(labels->names[pc]);
+    free(labels->names);
+    free(labels->returns);
+}
+
+/* Destino de um desvio ja resolvido: label C ou o fim do programa */
+static const char* target_label(const Labels *labels, const Program *prog, int target) {
+    return target >= prog->num_instrs ? "halted" : labels->names[target];
+}
+
+/* Desvio para label (condicional se cond != NULL) */
+static void emit_jump(FILE *out, const Labels *labels, const Program *prog, const Instr *in,
+                      int target, const char *label, const char *cond) {
+    if (cond) fprintf(out, "    if (%s) ", cond);
+    else fprintf(out, "    ");
+    if (target < 0) {
+        fprintf(out, "aot_fail(%d, \"Label nao encontrado: %%s\", ", in->line);
+        emit_string(out, label);
+        fprintf(out, ");\n");
+    } else {
+        fprintf(out, "goto %s;\n", target_label(labels, prog, target));
+    }
+}
+
+/* ===== INSTRUCOES ===== */
+
+static void emit_instr(FILE *out, const Program *prog, const Labels *labels, int pc) {
+    const Instr *in = &prog->code[pc];
+    const char *a = asm_reg_name(in->a);
+    const char *b = asm_reg_name(in->b);
+    int line = in->line;
+
+    fprintf(out, "    STEP();\n");
+    switch (in->op) {
+        case OP_SET:
+            fprintf(out, "    %s = value_int(", a);
+            emit_int(out, in->imm);
+            fprintf(out, ");\n");
+            break;
+
+        case OP_SETF:
+            fprintf(out, "    %s = value_frac(", a);
+            emit_double(out, in->fimm);
+            fprintf(out, ");\n");
+            break;
+
+        case OP_INC:
+            fprintf(out, "    %s = aot_inc(%s, 1, %d);\n", a, a, line);
+            break;
+
+        case OP_DEC:
+            fprintf(out, "    %s = aot_inc(%s, -1, %d);\n", a, a, line);
+            break;
+
+        case OP_DECJZ: {
+            char cond[64];
+            snprintf(cond, sizeof(cond), "!aot_truthy(%s)", a);
+            emit_jump(out, labels, prog, in, in->target, in->label, cond);
+            fprintf(out, "    %s = aot_inc(%s, -1, %d);\n", a, a, line);
+            break;
+        }
+
+        case OP_DECJNZ: {
+            char cond[64];
+            snprintf(cond, sizeof(cond), "aot_truthy(%s)", a);
+            fprintf(out, "    %s = aot_inc(%s, -1, %d);\n", a, a, line);
+            emit_jump(out, labels, prog, in, in->target, in->label, cond);
+            break;
+        }
+
+        case OP_JZ: case OP_JNZ: {
+            char cond[64];
+            snprintf(cond, sizeof(cond), "%saot_truthy(%s)", in->op == OP_JZ ? "!" : "", a);
+            emit_jump(out, labels, prog, in, in->target, in->label, cond);
+            break;
+        }
+
+        case OP_GOTO:
+            emit_jump(out, labels, prog, in, in->target, in->label, NULL);
+            break;
+
+        case OP_JTABLE:
+            fprintf(out, "    switch (aot_jtable(%s, ", a);
+            emit_int(out, in->imm);
+            fprintf(out, ", %d, %d)) {\n", in->list_len, line);
+            for (int i = 0; i < in->list_len; i++) {
+                fprintf(out, "    case %d:\n    ", i);
+                emit_jump(out, labels, prog, in, in->list[i], in->names[i], NULL);
+            }
+            fprintf(out, "    default:\n    ");
+            emit_jump(out, labels, prog, in, in->target, in->label, NULL);
+            fprintf(out, "    }\n");
+            break;
+
+        case OP_PUSH:
+            fprintf(out, "    aot_push(&st, %s);\n", a);
+            break;
+
+        case OP_POP:
+            fprintf(out, "    %s = aot_pop(&st, %d);\n", a, line);
+            break;
+
+        case OP_CALL:
+            if (in->target < 0) {
+                emit_jump(out, labels, prog, in, in->target, in->label, NULL);
+                break;
+            }
+            fprintf(out, "    {\n");
+            fprintf(out, "        AotFrame *frame = aot_call(&st, %d, %lld, %d);\n",
+                    pc + 1, (long long)in->imm, line);
+            for (int i = 0; i < NUM_ARG_REGS; i++) {
+                fprintf(out, "        frame->args[%d] = %s;\n", i, asm_reg_name(REG_A0 + i));
+            }
+            for (int i = (int)in->imm - 1; i >= 0; i--) {
+                fprintf(out, "        %s = st.stack[--st.sp];\n", asm_reg_name(REG_A0 + i));
+            }
+            fprintf(out, "    }\n");
+            fprintf(out, "    goto %s;\n", target_label(labels, prog, in->target));
+            break;
+
+        case OP_RET:
+            fprintf(out, "    {\n");
+            fprintf(out, "        const AotFrame *frame = aot_ret(&st, %d);\n", line);
+            for (int i = 0; i < NUM_ARG_REGS; i++) {
+                fprintf(out, "        %s = frame->args[%d];\n", asm_reg_name(REG_A0 + i), i);
+            }
+            fprintf(out, "        switch (frame->ret) {\n");
+            for (int r = 0; r < prog->num_instrs; r++) {
+                if (labels->returns[r]) fprintf(out, "        case %d: goto R%d;\n", r, r);
+            }
+            fprintf(out, "        default: goto halted;\n");
+            fprintf(out, "        }\n");
+            fprintf(out, "    }\n");
+            break;
+
+        case OP_HALT:
+            fprintf(out, "    aot_halt();\n");
+            fprintf(out, "    goto halted;\n");
+            break;
+
+        case OP_LOAD:
+            fprintf(out, "    %s = aot_load(&st, %lld, %lld, %s, %d);\n", a, (long long)in->imm,
+                    (long long)asm_segment_size(prog, in->imm), b, line);
+            break;
+
+        case OP_STORE:
+            fprintf(out, "    aot_store(&st, %lld, %lld, %s, %s, %d);\n", (long long)in->imm,
+                    (long long)asm_segment_size(prog, in->imm), b, a, line);
+            break;
+
+        case OP_READ:
+            fprintf(out, "    %s = value_int(st.oven.sensors[%s]);\n", a, SENSOR_CONSTANTS[in->b]);
+            break;
+
+        case OP_WAIT:
+            fprintf(out, "    aot_wait(&st, %s, %s, %s, %d);\n", SENSOR_CONSTANTS[in->b],
+                    RELATION_CONSTANTS[in->imm], a, line);
+            break;
+
+        case OP_WAITCHG:
+            fprintf(out, "    {\n");
+            fprintf(out, "        static const int sensors[] = {");
+            for (int i = 0; i < in->list_len; i++) {
+                fprintf(out, "%s%s", i ? ", " : " ", SENSOR_CONSTANTS[in->list[i]]);
+            }
+            fprintf(out, " };\n");
+            fprintf(out, "        aot_wait_change(&st, sensors, %d, %d);\n", in->list_len, line);
+            fprintf(out, "    }\n");
+            break;
+
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD: {
+            static const char *FAST[] = {
+                [OP_ADD] = "aot_add", [OP_SUB] = "aot_sub", [OP_MUL] = "aot_mul",
+                [OP_DIV] = "aot_div", [OP_MOD] = "aot_mod"
+            };
+            fprintf(out, "    %s = %s(%s, %s, %d);\n", a, FAST[in->op], a, b, line);
+            break;
+        }
+
+        case OP_ADDF: case OP_SUBF: case OP_MULF: case OP_DIVF: case OP_MODF:
+            fprintf(out, "    %s = aot_arith(OP_%s, %s, %s, %d);\n", a, asm_op_name(in->op), a, b, line);
+            break;
+
+        case OP_ITOF:
+            fprintf(out, "    %s = aot_itof(%s);\n", a, a);
+            break;
+
+        case OP_FTOI:
+            fprintf(out, "    %s = aot_ftoi(%s, %d);\n", a, a, line);
+            break;
+
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+            fprintf(out, "    %s = aot_cmp(%s, %s, %s);\n", a, a, b, CMP_RELATIONS[in->op]);
+            break;
+
+        case OP_AND:
+            fprintf(out, "    %s = value_int(aot_truthy(%s) && aot_truthy(%s));\n", a, a, b);
+            break;
+
+        case OP_OR:
+            fprintf(out, "    %s = value_int(aot_truthy(%s) || aot_truthy(%s));\n", a, a, b);
+            break;
+
+        case OP_NOT:
+            fprintf(out, "    %s = value_int(!aot_truthy(%s));\n", a, a);
+            break;
+
+        case OP_PRINT:
+            fprintf(out, "    aot_print(TIME);\n");
+            break;
+
+        case OP_PRINTI:
+            fprintf(out, "    aot_printi(%s);\n", a);
+            break;
+
+        case OP_PRINTF:
+            fprintf(out, "    aot_printf(%s);\n", a);
+            break;
+
+        case OP_PRINTB:
+            fprintf(out, "    aot_printb(%s);\n", a);
+            break;
+
+        case OP_SPRINT: case OP_PRINTFMT: {
+            int defined = in->imm >= 0 && in->imm < prog->strings_size && prog->strings[in->imm];
+            if (!defined) {
+                fprintf(out, "    aot_fail(%d, \"String id %%lld nao encontrado\", %lldLL);\n",
+                        line, (long long)in->imm);
+                break;
+            }
+            if (in->op == OP_SPRINT) {
+                fprintf(out, "    aot_sprint(STRINGS[%lld]);\n", (long long)in->imm);
+                break;
+            }
+            fprintf(out, "    {\n");
+            fprintf(out, "        Value values[] = {");
+            for (int i = 0; i < in->list_len; i++) {
+                const char *value = in->list[i] == OPERAND_STACK ? "value_int(0)"
+                                                                  : asm_reg_name(in->list[i]);
+                fprintf(out, "%s%s", i ? ", " : " ", value);
+            }
+            fprintf(out, " };\n");
+            fprintf(out, "        static const signed char from_stack[] = {");
+            for (int i = 0; i < in->list_len; i++) {
+                fprintf(out, "%s%d", i ? ", " : " ", in->list[i] == OPERAND_STACK);
+            }
+            fprintf(out, " };\n");
+            fprintf(out, "        aot_printfmt(&st, STRINGS[%lld], values, from_stack, %d, %d);\n",
+                    (long long)in->imm, in->list_len, line);
+            fprintf(out, "    }\n");
+            break;
+        }
+
+        case OP_SETMODE:
+            fprintf(out, "    aot_setmode(&st, ");
+            emit_int(out, in->imm);
+            fprintf(out, ", POWER);\n");
+            break;
+
+        case OP_PAUSE:
+            fprintf(out, "    oven_pause(&st.oven);\n");
+            break;
+
+        case OP_RESUME:
+            fprintf(out, "    oven_resume(&st.oven);\n");
+            break;
+
+        case OP_STOP:
+            fprintf(out, "    oven_stop(&st.oven);\n");
+            fprintf(out, "    POWER = value_int(0);\n");
+            break;
+    }
+}
+
+/* ===== PROGRAMA ===== */
+
+static void emit_program(FILE *out, const Program *prog, const char *filename) {
+    Labels labels = collect_labels(prog);
+
+    fprintf(out, "/*\n * Gerado por mwasm2c a partir de %s\n", filename);
+    fprintf(out, " * gcc -O2 -Ivm/native <este arquivo> build/libairfryer_rt.a -lm\n */\n\n");
+    fprintf(out, "#include \"aot.h\"\n#include <math.h>\n\n");
+    fprintf(out, "#pragma GCC diagnostic ignored \"-Wunused-label\"\n\n");
+
+    /* String table */
+    if (prog->num_strings > 0) {
+        fprintf(out, "static const char *const STRINGS[%d] = {\n", prog->strings_size);
+        for (int i = 0; i < prog->strings_size; i++) {
+            if (!prog->strings[i]) continue;
+            fprintf(out, "    [%d] = ", i);
+            emit_string(out, prog->strings[i]);
+            fprintf(out, ",\n");
+        }
+        fprintf(out, "};\n\n");
+    }
+
+    /* Memoria de dados */
+    if (prog->num_data > 0) {
+        fprintf(out, "static const AotData DATA[%d] = {\n", prog->num_data);
+        for (int i = 0; i < prog->num_data; i++) {
+            const DataInit *d = &prog->data[i];
+            fprintf(out, "    { %lld, %d, ", (long long)d->address, d->frac);
+            emit_int(out, d->i);
+            fprintf(out, ", ");
+            emit_double(out, d->f);
+            fprintf(out, " },\n");
+        }
+        fprintf(out, "};\n\n");
+    }
+
+    fprintf(out, "static const AotProgram PROGRAM = { ");
+    emit_string(out, filename);
+    fprintf(out, ", %d, %d, %lld, %s, %d };\n\n", prog->num_instrs, prog->num_strings,
+            (long long)prog->memory_size, prog->num_data > 0 ? "DATA" : "NULL", prog->num_data);
+
+    fprintf(out, "int main(int argc, char **argv) {\n");
+    fprintf(out, "    AotState st;\n");
+    fprintf(out, "    aot_init(&st, &PROGRAM, argc, argv);\n");
+    fprintf(out, "    const int64_t max_steps = st.max_steps ? st.max_steps : INT64_MAX;\n");
+    fprintf(out, "    int64_t steps = 0;\n");
+    fprintf(out, "    Value");
+    for (int r = 0; r < NUM_VM_REGS; r++) {
+        fprintf(out, "%s%s = value_int(0)", r ? ", " : " ", asm_reg_name(r));
+    }
+    fprintf(out, ";\n\n");
+    fprintf(out, "#define STEP() do { if (__builtin_expect(++steps > max_steps, 0)) "
+                 "aot_step_limit(&st); } while (0)\n\n");
+
+    for (int pc = 0; pc < prog->num_instrs; pc++) {
+        if (labels.names[pc]) fprintf(out, "%s:\n", labels.names[pc]);
+        if (labels.returns[pc]) fprintf(out, "R%d:\n", pc);
+        fprintf(out, "    /* %d: %s (linha %d) */\n", pc, asm_op_name(prog->code[pc].op),
+                prog->code[pc].line);
+        emit_instr(out, prog, &labels, pc);
+    }
+
+    fprintf(out, "\nhalted:;\n");
+    fprintf(out, "    const Value regs[NUM_VM_REGS] = {");
+    for (int r = 0; r < NUM_VM_REGS; r++) fprintf(out, "%s%s", r ? ", " : " ", asm_reg_name(r));
+    fprintf(out, " };\n");
+    fprintf(out, "    return aot_finish(&st, regs, steps);\n");
+    fprintf(out, "}\n");
+
+    free_labels(&labels, prog->num_instrs);
+}
+
+/* ===== MAIN ===== */
+
+static void print_usage(const char *prog) {
+    printf("Uso: %s <arquivo.mwasm> [-o saida.c]\n", prog);
+    printf("\nGera um programa C equivalente ao assembly. Para compilar:\n");
+    printf("  gcc -O2 -Ivm/native saida.c build/libairfryer_rt.a -lm -o programa\n");
+}
+
+static char* default_output(const char *input) {
+    size_t len = strlen(input);
+    char *output = malloc(len + 3);
+    strcpy(output, input);
+    char *dot = strrchr(output, '.');
+    char *slash = strrchr(output, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strcat(output, ".c");
+    return output;
+}
+
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Erro: opcao desconhecida '%s'\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        } else if (!input) {
+            input = argv[i];
+        }
+    }
+    if (!input) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(input, "rb");
+    if (!f) {
+        fprintf(stderr, "Erro: Arquivo '%s' nao encontrado.\n", input);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *source = malloc(size + 1);
+    size_t got = fread(source, 1, size, f);
+    source[got] = '\0';
+    fclose(f);
+
+    char err[512];
+    Program *prog = asm_load(source, got, err, sizeof(err));
+    free(source);
+    if (!prog) {
+        fprintf(stderr, "Erro: %s\n", err);
+        return 1;
+    }
+
+    char *owned = output ? NULL : default_output(input);
+    if (!output) output = owned;
+    FILE *out = fopen(output, "w");
+    if (!out) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'\n", output);
+        free(owned);
+        asm_free(prog);
+        return 1;
+    }
+    emit_program(out, prog, input);
+    fclose(out);
+
+    printf("C gerado: %s (%d instrucoes)\n", output, prog->num_instrs);
+    free(owned);
+    asm_free(prog);
+    return 0;
+}
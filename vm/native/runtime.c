@@ -0,0 +1,432 @@
+/*
+ * runtime.c
+ * Valores, impressao e modelo termico da AirFryerVM nativa
+ */
+
+#include "runtime.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Alvo da resistencia por modo: batata, legumes, nuggets, esfihas */
+static const int64_t MODE_PRESETS[] = { 0, 200, 180, 190, 170 };
+#define NUM_MODE_PRESETS ((int64_t)(sizeof(MODE_PRESETS) / sizeof(MODE_PRESETS[0])))
+
+/* ===== ARITMETICA ===== */
+
+int rt_compare(const Value *a, const Value *b, int rel) {
+    int lt, eq;
+    if (!a->frac && !b->frac) {
+        lt = a->v.i < b->v.i;
+        eq = a->v.i == b->v.i;
+    } else {
+        /* long double guarda qualquer int64 sem perda */
+        long double x = a->frac ? (long double)a->v.f : (long double)a->v.i;
+        long double y = b->frac ? (long double)b->v.f : (long double)b->v.i;
+        if (isnan(x) || isnan(y)) return rel == REL_NE;
+        lt = x < y;
+        eq = x == y;
+    }
+    switch (rel) {
+        case REL_EQ: return eq;
+        case REL_NE: return !eq;
+        case REL_LT: return lt;
+        case REL_LE: return lt || eq;
+        case REL_GT: return !lt && !eq;
+        default:     return !lt;
+    }
+}
+
+/* Resto com o sinal do divisor (float.__mod__ e float.__floordiv__) */
+static double float_mod(double x, double y) {
+    double mod = fmod(x, y);
+    if (mod != 0.0) {
+        if ((y < 0) != (mod < 0)) mod += y;
+    } else {
+        mod = copysign(0.0, y);
+    }
+    return mod;
+}
+
+static double float_floordiv(double x, double y) {
+    double mod = fmod(x, y);
+    double div = (x - mod) / y;
+    if (mod != 0.0 && (y < 0) != (mod < 0)) {
+        div -= 1.0;
+    }
+    if (div != 0.0) {
+        double floordiv = floor(div);
+        if (div - floordiv > 0.5) floordiv += 1.0;
+        return floordiv;
+    }
+    return copysign(0.0, x / y);
+}
+
+int rt_arith(Opcode op, Value *a, const Value *b, char *err, size_t err_size) {
+    int is_float = op == OP_ADDF || op == OP_SUBF || op == OP_MULF ||
+                   op == OP_DIVF || op == OP_MODF;
+
+    if ((op == OP_DIV || op == OP_MOD || op == OP_DIVF || op == OP_MODF) && !value_truthy(b)) {
+        snprintf(err, err_size, "Divisao por zero");
+        return 0;
+    }
+
+    if (!is_float && !a->frac && !b->frac) {
+        int64_t x = a->v.i, y = b->v.i, r = 0;
+        int overflow = 0;
+        switch (op) {
+            case OP_ADD: overflow = __builtin_add_overflow(x, y, &r); break;
+            case OP_SUB: overflow = __builtin_sub_overflow(x, y, &r); break;
+            case OP_MUL: overflow = __builtin_mul_overflow(x, y, &r); break;
+            case OP_DIV:
+                if (x == INT64_MIN && y == -1) {
+                    overflow = 1;
+                    break;
+                }
+                r = x / y;
+                if ((x % y != 0) && ((x < 0) != (y < 0))) r--;
+                break;
+            case OP_MOD:
+                if (y == -1) {
+                    r = 0;
+                    break;
+                }
+                r = x % y;
+                if (r != 0 && ((r < 0) != (y < 0))) r += y;
+                break;
+            default:
+                break;
+        }
+        if (overflow) {
+            snprintf(err, err_size, "Estouro de inteiro (64 bits)");
+            return 0;
+        }
+        *a = value_int(r);
+        return 1;
+    }
+
+    double x = value_as_double(a), y = value_as_double(b), r;
+    switch (op) {
+        case OP_ADD: case OP_ADDF: r = x + y; break;
+        case OP_SUB: case OP_SUBF: r = x - y; break;
+        case OP_MUL: case OP_MULF: r = x * y; break;
+        case OP_DIVF:              r = x / y; break;
+        case OP_DIV:               r = float_floordiv(x, y); break;
+        default:                   r = float_mod(x, y); break;
+    }
+    *a = value_frac(r);
+    return 1;
+}
+
+int rt_ftoi(Value *a, char *err, size_t err_size) {
+    if (!a->frac) return 1;
+    double f = a->v.f;
+    if (isnan(f)) {
+        snprintf(err, err_size, "cannot convert float NaN to integer");
+        return 0;
+    }
+    if (isinf(f)) {
+        snprintf(err, err_size, "cannot convert float infinity to integer");
+        return 0;
+    }
+    f = trunc(f);
+    if (f >= 9223372036854775808.0 || f < -9223372036854775808.0) {
+        snprintf(err, err_size, "Estouro de inteiro (64 bits)");
+        return 0;
+    }
+    *a = value_int((int64_t)f);
+    return 1;
+}
+
+/* ===== TEXTO ===== */
+
+void rt_repr_double(double x, char *buf, size_t size) {
+    if (isnan(x)) {
+        snprintf(buf, size, "nan");
+        return;
+    }
+    if (isinf(x)) {
+        snprintf(buf, size, x < 0 ? "-inf" : "inf");
+        return;
+    }
+
+    /* Menor numero de digitos significativos que volta ao mesmo double */
+    char sci[40];
+    for (int p = 1; p <= 17; p++) {
+        snprintf(sci, sizeof(sci), "%.*e", p - 1, x);
+        if (strtod(sci, NULL) == x) break;
+    }
+
+    /* Separar sinal, digitos e expoente de "-d.ddde+XX" */
+    char digits[24];
+    int nd = 0;
+    const char *p = sci;
+    int negative = *p == '-';
+    if (negative) p++;
+    for (; *p && *p != 'e'; p++) {
+        if (*p != '.') digits[nd++] = *p;
+    }
+    int exp = atoi(p + 1);
+    while (nd > 1 && digits[nd - 1] == '0') nd--;
+    digits[nd] = '\0';
+
+    /* Como o repr do Python: notacao fixa se -4 <= exp < 16 */
+    char out[64];
+    int n = 0;
+    if (negative) out[n++] = '-';
+    if (exp >= 16 || exp < -4) {
+        out[n++] = digits[0];
+        if (nd > 1) {
+            out[n++] = '.';
+            memcpy(out + n, digits + 1, nd - 1);
+            n += nd - 1;
+        }
+        n += snprintf(out + n, sizeof(out) - n, "e%c%02d", exp < 0 ? '-' : '+', abs(exp));
+    } else if (exp >= 0) {
+        for (int i = 0; i <= exp; i++) out[n++] = i < nd ? digits[i] : '0';
+        out[n++] = '.';
+        if (nd > exp + 1) {
+            memcpy(out + n, digits + exp + 1, nd - exp - 1);
+            n += nd - exp - 1;
+        } else {
+            out[n++] = '0';
+        }
+        out[n] = '\0';
+    } else {
+        out[n++] = '0';
+        out[n++] = '.';
+        for (int i = 0; i < -exp - 1; i++) out[n++] = '0';
+        memcpy(out + n, digits, nd);
+        n += nd;
+        out[n] = '\0';
+    }
+    snprintf(buf, size, "%s", out);
+}
+
+void rt_str(const Value *x, char *buf, size_t size) {
+    if (x->frac) {
+        rt_repr_double(x->v.f, buf, size);
+    } else {
+        snprintf(buf, size, "%lld", (long long)x->v.i);
+    }
+}
+
+/* f"{value:.2f}" */
+static void format_frac2(const Value *x, char *buf, size_t size) {
+    double f = value_as_double(x);
+    if (isnan(f)) {
+        snprintf(buf, size, "nan");
+    } else {
+        snprintf(buf, size, "%.2f", f);
+    }
+}
+
+static const char* bool_text(const Value *x) {
+    return value_truthy(x) ? "verdadeiro" : "falso";
+}
+
+void rt_print_int(FILE *out, const Value *x) {
+    char text[VALUE_TEXT_SIZE];
+    rt_str(x, text, sizeof(text));
+    fprintf(out, "%s ", text);
+}
+
+void rt_print_frac(FILE *out, const Value *x) {
+    char text[VALUE_TEXT_SIZE];
+    format_frac2(x, text, sizeof(text));
+    fprintf(out, "%s ", text);
+}
+
+void rt_print_bool(FILE *out, const Value *x) {
+    fprintf(out, "%s ", bool_text(x));
+}
+
+int rt_print_fmt(FILE *out, const char *tmpl, const Value *values, int num_values,
+                 char *err, size_t err_size) {
+    size_t capacity = strlen(tmpl) + (size_t)num_values * VALUE_TEXT_SIZE + 2;
+    char *line = malloc(capacity);
+    size_t n = 0;
+    int next = 0;
+
+    for (const char *c = tmpl; *c; c++) {
+        if (*c != '%' || c[1] == '\0') {
+            line[n++] = *c;
+            continue;
+        }
+        char kind = *++c;
+        if (kind == '%') {
+            line[n++] = '%';
+            continue;
+        }
+        if (next >= num_values) {
+            snprintf(err, err_size, "PRINTFMT com menos operandos que marcadores");
+            free(line);
+            return 0;
+        }
+        const Value *x = &values[next++];
+        char text[VALUE_TEXT_SIZE];
+        if (kind == 'f') {
+            format_frac2(x, text, sizeof(text));
+        } else if (kind == 'b') {
+            snprintf(text, sizeof(text), "%s", bool_text(x));
+        } else if (kind == 'd') {
+            rt_str(x, text, sizeof(text));
+        } else {
+            snprintf(err, err_size, "Marcador invalido no template: %%%c", kind);
+            free(line);
+            return 0;
+        }
+        size_t len = strlen(text);
+        memcpy(line + n, text, len);
+        n += len;
+    }
+    if (next != num_values) {
+        snprintf(err, err_size, "PRINTFMT com mais operandos que marcadores");
+        free(line);
+        return 0;
+    }
+
+    line[n++] = ' ';
+    fwrite(line, 1, n, out);
+    free(line);
+    return 1;
+}
+
+static void print_values(FILE *out, const Value *values, int64_t n) {
+    char text[VALUE_TEXT_SIZE];
+    fputc('[', out);
+    for (int64_t i = 0; i < n; i++) {
+        rt_str(&values[i], text, sizeof(text));
+        fprintf(out, i ? ", %s" : "%s", text);
+    }
+    fputc(']', out);
+}
+
+void rt_print_state(FILE *out, int64_t steps, const Value *regs, const Oven *oven,
+                    const Value *stack, int64_t sp, const Value *memory, int64_t memory_size) {
+    char text[VALUE_TEXT_SIZE];
+
+    fprintf(out, "Steps executados: %lld\n", (long long)steps);
+
+    fprintf(out, "Registradores: {");
+    for (int i = 0; i < NUM_VM_REGS; i++) {
+        rt_str(&regs[i], text, sizeof(text));
+        fprintf(out, "%s'%s': %s", i ? ", " : "", asm_reg_name(i), text);
+    }
+    fprintf(out, "}\n");
+
+    fprintf(out, "Sensores: {");
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        fprintf(out, "%s'%s': %lld", i ? ", " : "", asm_sensor_name(i),
+                (long long)oven->sensors[i]);
+    }
+    fprintf(out, "}\n");
+
+    if (sp > 0) {
+        fprintf(out, "Stack: ");
+        print_values(out, stack, sp);
+        fputc('\n', out);
+    }
+    if (memory_size > 0) {
+        fprintf(out, "Memoria: ");
+        print_values(out, memory, memory_size);
+        fputc('\n', out);
+    }
+    if (oven->clock) {
+        fprintf(out, "Relogio virtual: %lld s\n", (long long)oven->clock);
+    }
+}
+
+/* ===== MODELO TERMICO ===== */
+
+void oven_init(Oven *oven) {
+    oven->sensors[SENSOR_TEMP] = AMBIENT_TEMP;
+    oven->sensors[SENSOR_WEIGHT] = 100;
+    oven->sensors[SENSOR_MODE] = 0;
+    oven->sensors[SENSOR_STATE] = 0;
+    oven->clock = 0;
+    oven->setpoint = 0;
+}
+
+void oven_setmode(Oven *oven, int64_t mode, const Value *power) {
+    oven->sensors[SENSOR_MODE] = mode;
+    oven->sensors[SENSOR_STATE] = 1;
+    /* Modo manual (preaquecer) usa POWER como alvo; presets tem o seu */
+    if (mode == 0) {
+        oven->setpoint = power->frac ? (int64_t)power->v.f : power->v.i;
+    } else {
+        oven->setpoint = (mode > 0 && mode < NUM_MODE_PRESETS) ? MODE_PRESETS[mode] : 0;
+    }
+}
+
+void oven_pause(Oven *oven) {
+    oven->sensors[SENSOR_STATE] = 2;
+}
+
+void oven_resume(Oven *oven) {
+    oven->sensors[SENSOR_STATE] = 1;
+}
+
+void oven_stop(Oven *oven) {
+    oven->sensors[SENSOR_STATE] = 0;
+    oven->setpoint = 0;
+}
+
+/* Temperatura para onde TEMP converge no estado atual */
+static int64_t oven_target(const Oven *oven) {
+    if (oven->sensors[SENSOR_STATE] == 1 && oven->setpoint > 0) {
+        return oven->setpoint;
+    }
+    return AMBIENT_TEMP;
+}
+
+/* Avancar o relogio em 1 segundo; retorna 0 se nada mudaria */
+static int oven_tick(Oven *oven) {
+    int64_t temp = oven->sensors[SENSOR_TEMP];
+    int64_t target = oven_target(oven);
+    if (temp == target) return 0;
+    if (temp < target) {
+        temp = temp + HEAT_RATE < target ? temp + HEAT_RATE : target;
+    } else {
+        temp = temp - COOL_RATE > target ? temp - COOL_RATE : target;
+    }
+    oven->sensors[SENSOR_TEMP] = temp;
+    oven->clock++;
+    return 1;
+}
+
+int oven_wait(Oven *oven, int sensor, int rel, const Value *limit,
+              char *err, size_t err_size) {
+    for (;;) {
+        Value current = value_int(oven->sensors[sensor]);
+        if (rt_compare(&current, limit, rel)) return 1;
+        if (!oven_tick(oven)) break;
+    }
+    char text[VALUE_TEXT_SIZE];
+    rt_str(limit, text, sizeof(text));
+    snprintf(err, err_size, "Espera infinita: %s %s %s nunca acontece (TEMP estavel em %lld)",
+             asm_sensor_name(sensor), asm_relation_name(rel), text,
+             (long long)oven->sensors[SENSOR_TEMP]);
+    return 0;
+}
+
+int oven_wait_change(Oven *oven, const int *sensors, int num_sensors,
+                     char *err, size_t err_size) {
+    int64_t before[NUM_SENSORS];
+    memcpy(before, oven->sensors, sizeof(before));
+    for (;;) {
+        for (int i = 0; i < num_sensors; i++) {
+            if (oven->sensors[sensors[i]] != before[sensors[i]]) return 1;
+        }
+        if (!oven_tick(oven)) break;
+    }
+    size_t n = snprintf(err, err_size, "Espera infinita: mudanca em");
+    for (int i = 0; i < num_sensors && n < err_size; i++) {
+        n += snprintf(err + n, err_size - n, " %s", asm_sensor_name(sensors[i]));
+    }
+    if (n < err_size) {
+        snprintf(err + n, err_size - n, " nunca acontece (TEMP estavel em %lld)",
+                 (long long)oven->sensors[SENSOR_TEMP]);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * runtime.h
+ * Valores, impressao e modelo termico da AirFryerVM nativa
+ *
+ * Tudo aqui reproduz a VM em Python (vm/airfryer_vm.py): registradores
+ * tipados (inteiro ou double), divisao e resto com arredondamento para
+ * baixo, textos impressos com str()/repr() do Python e o mesmo modelo
+ * termico. Diferenca: inteiros tem 64 bits e um estouro e erro, onde o
+ * Python cresceria sem limite.
+ */
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "asm.h"
+#include <stdio.h>
+#include <stdint.h>
+
+/* Valor de registrador, pilha ou memoria (16 bytes: o JIT depende disso) */
+typedef struct Value {
+    union {
+        int64_t i;
+        double f;
+    } v;
+    int32_t frac;              /* 1 se v.f vale, 0 se v.i */
+    int32_t unused;
+} Value;
+
+/* Modelo termico (1 tique do relogio virtual = 1 segundo) */
+#define AMBIENT_TEMP 25        /* Temperatura ambiente */
+#define HEAT_RATE 5            /* Graus/s com a resistencia ligada */
+#define COOL_RATE 1            /* Graus/s resfriando */
+
+/* Sensores, relogio virtual e alvo da resistencia (0 = desligada) */
+typedef struct Oven {
+    int64_t sensors[NUM_SENSORS];
+    int64_t clock;
+    int64_t setpoint;
+} Oven;
+
+/* Tamanho dos textos de um valor (cabe "%.2f" do maior double) */
+#define VALUE_TEXT_SIZE 330
+
+/* Construtores */
+static inline Value value_int(int64_t i) {
+    Value v = { .v.i = i, .frac = 0, .unused = 0 };
+    return v;
+}
+
+static inline Value value_frac(double f) {
+    Value v = { .v.f = f, .frac = 1, .unused = 0 };
+    return v;
+}
+
+/* Valor como double (promocao de inteiro) */
+static inline double value_as_double(const Value *x) {
+    return x->frac ? x->v.f : (double)x->v.i;
+}
+
+/* Verdadeiro no sentido do Python (diferente de zero) */
+static inline int value_truthy(const Value *x) {
+    return x->frac ? x->v.f != 0.0 : x->v.i != 0;
+}
+
+/* Comparar a e b como o Python compara numeros (exato entre int e double) */
+/* rel e uma VMRelation; retorna 1 ou 0 */
+int rt_compare(const Value *a, const Value *b, int rel);
+
+/* Operacao aritmetica a = a op b (ADD..MOD, ADDF..MODF) */
+/* Retorna 1 se sucesso, 0 se erro (mensagem em err) */
+int rt_arith(Opcode op, Value *a, const Value *b, char *err, size_t err_size);
+
+/* Converter para inteiro truncando (FTOI) */
+/* Retorna 1 se sucesso, 0 se erro */
+int rt_ftoi(Value *a, char *err, size_t err_size);
+
+/* str() de um valor: inteiro em decimal, double como repr() */
+void rt_str(const Value *x, char *buf, size_t size);
+
+/* repr() de um double do Python (menor texto que volta ao mesmo valor) */
+void rt_repr_double(double x, char *buf, size_t size);
+
+/* Impressao: cada peca seguida de um espaco, como print(..., end=' ') */
+void rt_print_int(FILE *out, const Value *x);      /* PRINTI */
+void rt_print_frac(FILE *out, const Value *x);     /* PRINTF */
+void rt_print_bool(FILE *out, const Value *x);     /* PRINTB */
+
+/* PRINTFMT: expandir o template com values e escrever a linha de uma vez */
+/* Retorna 1 se sucesso, 0 se erro */
+int rt_print_fmt(FILE *out, const char *tmpl, const Value *values, int num_values,
+                 char *err, size_t err_size);
+
+/* Modelo termico */
+void oven_init(Oven *oven);
+void oven_setmode(Oven *oven, int64_t mode, const Value *power);
+void oven_pause(Oven *oven);
+void oven_resume(Oven *oven);
+void oven_stop(Oven *oven);
+
+/* Suspender ate (sensor rel limit) valer, avancando o relogio virtual */
+/* Retorna 1 se sucesso, 0 se a espera nunca terminaria */
+int oven_wait(Oven *oven, int sensor, int rel, const Value *limit,
+              char *err, size_t err_size);
+
+/* Suspender ate algum dos sensores mudar */
+/* Retorna 1 se sucesso, 0 se a espera nunca terminaria */
+int oven_wait_change(Oven *oven, const int *sensors, int num_sensors,
+                     char *err, size_t err_size);
+
+/* Estado final como a VM em Python (regs na ordem de VMReg) */
+void rt_print_state(FILE *out, int64_t steps, const Value *regs, const Oven *oven,
+                    const Value *stack, int64_t sp, const Value *memory, int64_t memory_size);
+
+#endif /* RUNTIME_H */
@@ -0,0 +1,438 @@
+/*
+ * vm.c
+ * Interpretador nativo da AirFryerVM
+ */
+
+#include "vm.h"
+#include "jit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define INITIAL_CAPACITY 16
+
+/* Tamanho das mensagens de erro de uma instrucao */
+#define ERROR_SIZE 400
+
+VM* vm_create(const Program *prog, FILE *out) {
+    VM *vm = calloc(1, sizeof(VM));
+    for (int i = 0; i < NUM_VM_REGS; i++) vm->regs[i] = value_int(0);
+    oven_init(&vm->oven);
+
+    vm->stack_capacity = INITIAL_CAPACITY;
+    vm->stack = malloc(vm->stack_capacity * sizeof(Value));
+    vm->sp = 0;
+
+    /* Memoria de dados com os valores iniciais dos DATA */
+    vm->memory_size = prog->memory_size;
+    vm->memory = calloc(vm->memory_size ? vm->memory_size : 1, sizeof(Value));
+    for (int i = 0; i < prog->num_data; i++) {
+        const DataInit *d = &prog->data[i];
+        vm->memory[d->address] = d->frac ? value_frac(d->f) : value_int(d->i);
+    }
+
+    vm->max_steps = DEFAULT_MAX_STEPS;
+    vm->frames_capacity = INITIAL_CAPACITY;
+    vm->frames = malloc(vm->frames_capacity * sizeof(Frame));
+    vm->prog = prog;
+    vm->out = out;
+    return vm;
+}
+
+void vm_free(VM *vm) {
+    if (!vm) return;
+    free(vm->stack);
+    free(vm->memory);
+    free(vm->frames);
+    free(vm);
+}
+
+/* ===== PILHA ===== */
+
+static void push(VM *vm, Value x) {
+    if (vm->sp >= vm->stack_capacity) {
+        vm->stack_capacity *= 2;
+        vm->stack = realloc(vm->stack, vm->stack_capacity * sizeof(Value));
+    }
+    vm->stack[vm->sp++] = x;
+}
+
+/* ===== EXECUCAO ===== */
+
+/* Desviar para target; conta desvios para tras para o JIT */
+static int jump(VM *vm, int target, const char *label, char *err) {
+    if (target < 0) {
+        snprintf(err, ERROR_SIZE, "Label nao encontrado: %s", label);
+        return 0;
+    }
+    if (vm->jit && target <= vm->pc) {
+        jit_backedge(vm->jit, vm, vm->pc, target);
+    }
+    vm->pc = target;
+    return 1;
+}
+
+/* Endereco base + indice, verificando o segmento */
+static int address(VM *vm, const Instr *in, int64_t *addr, char *err) {
+    int64_t size = asm_segment_size(vm->prog, in->imm);
+    const Value *index = &vm->regs[in->b];
+    if (index->frac) {
+        if (!(index->v.f >= 0 && index->v.f < size)) {
+            char text[VALUE_TEXT_SIZE];
+            rt_str(index, text, sizeof(text));
+            snprintf(err, ERROR_SIZE, "Indice %s fora do segmento em %lld (tamanho %lld)",
+                     text, (long long)in->imm, (long long)size);
+        } else {
+            snprintf(err, ERROR_SIZE, "list indices must be integers or slices, not float");
+        }
+        return 0;
+    }
+    if (index->v.i < 0 || index->v.i >= size) {
+        snprintf(err, ERROR_SIZE, "Indice %lld fora do segmento em %lld (tamanho %lld)",
+                 (long long)index->v.i, (long long)in->imm, (long long)size);
+        return 0;
+    }
+    *addr = in->imm + index->v.i;
+    return 1;
+}
+
+/* Avisar quem embute a VM de um comando da air fryer */
+static void actuate(VM *vm, Opcode op, int64_t arg) {
+    if (vm->hooks.actuator) vm->hooks.actuator(vm->hooks.user, op, arg);
+}
+
+/* Somar delta (+1 ou -1) a um registrador */
+static int add_one(Value *x, int delta, char *err) {
+    if (x->frac) {
+        x->v.f += delta;
+        return 1;
+    }
+    if (__builtin_add_overflow(x->v.i, (int64_t)delta, &x->v.i)) {
+        snprintf(err, ERROR_SIZE, "Estouro de inteiro (64 bits)");
+        return 0;
+    }
+    return 1;
+}
+
+static int is_zero(const Value *x) {
+    return !value_truthy(x);
+}
+
+static int relation_of(Opcode op) {
+    switch (op) {
+        case OP_EQ: return REL_EQ;
+        case OP_NE: return REL_NE;
+        case OP_LT: return REL_LT;
+        case OP_LE: return REL_LE;
+        case OP_GT: return REL_GT;
+        default:    return REL_GE;
+    }
+}
+
+static const char* string_at(const VM *vm, int64_t id) {
+    if (id < 0 || id >= vm->prog->strings_size) return NULL;
+    return vm->prog->strings[id];
+}
+
+/* Executar in; retorna 1 se sucesso, 0 se erro (mensagem em err) */
+static int execute(VM *vm, const Instr *in, char *err) {
+    Value *regs = vm->regs;
+    Value *a = &regs[in->a];
+
+    switch (in->op) {
+        case OP_SET:
+            *a = value_int(in->imm);
+            break;
+
+        case OP_SETF:
+            *a = value_frac(in->fimm);
+            break;
+
+        case OP_INC:
+            if (!add_one(a, 1, err)) return 0;
+            break;
+
+        case OP_DEC:
+            if (!add_one(a, -1, err)) return 0;
+            break;
+
+        case OP_DECJZ:
+            if (is_zero(a)) return jump(vm, in->target, in->label, err);
+            if (!add_one(a, -1, err)) return 0;
+            break;
+
+        case OP_DECJNZ:
+            /* Fim de laco contado: decremento e salto em uma instrucao */
+            if (!add_one(a, -1, err)) return 0;
+            if (!is_zero(a)) return jump(vm, in->target, in->label, err);
+            break;
+
+        case OP_GOTO:
+            return jump(vm, in->target, in->label, err);
+
+        case OP_JTABLE: {
+            int target = in->target;
+            const char *label = in->label;
+            if (a->frac) {
+                double index = a->v.f - (double)in->imm;
+                if (index >= 0 && index < in->list_len) {
+                    snprintf(err, ERROR_SIZE, "tuple indices must be integers or slices, not float");
+                    return 0;
+                }
+            } else {
+                int64_t index;
+                if (!__builtin_sub_overflow(a->v.i, in->imm, &index) &&
+                    index >= 0 && index < in->list_len) {
+                    target = in->list[index];
+                    label = in->names[index];
+                }
+            }
+            return jump(vm, target, label, err);
+        }
+
+        case OP_PUSH:
+            push(vm, *a);
+            break;
+
+        case OP_POP:
+            if (vm->sp == 0) {
+                snprintf(err, ERROR_SIZE, "POP em pilha vazia");
+                return 0;
+            }
+            *a = vm->stack[--vm->sp];
+            break;
+
+        case OP_CALL: {
+            if (in->target < 0) {
+                snprintf(err, ERROR_SIZE, "Label nao encontrado: %s", in->label);
+                return 0;
+            }
+            if (vm->num_frames >= MAX_FRAMES) {
+                snprintf(err, ERROR_SIZE, "Pilha de chamadas excedida (%d quadros)", MAX_FRAMES);
+                return 0;
+            }
+            int n = (int)in->imm;
+            if (vm->sp < n) {
+                snprintf(err, ERROR_SIZE, "CALL sem argumentos suficientes na pilha");
+                return 0;
+            }
+            if (vm->num_frames >= vm->frames_capacity) {
+                vm->frames_capacity *= 2;
+                vm->frames = realloc(vm->frames, vm->frames_capacity * sizeof(Frame));
+            }
+            Frame *frame = &vm->frames[vm->num_frames++];
+            frame->ret = vm->pc + 1;
+            memcpy(frame->args, &regs[REG_A0], sizeof(frame->args));
+            for (int i = n - 1; i >= 0; i--) {
+                regs[REG_A0 + i] = vm->stack[--vm->sp];
+            }
+            vm->pc = in->target;
+            return 1;
+        }
+
+        case OP_RET: {
+            if (vm->num_frames == 0) {
+                snprintf(err, ERROR_SIZE, "RET sem CALL correspondente");
+                return 0;
+            }
+            Frame *frame = &vm->frames[--vm->num_frames];
+            vm->pc = frame->ret;
+            memcpy(&regs[REG_A0], frame->args, sizeof(frame->args));
+            return 1;
+        }
+
+        case OP_HALT:
+            fprintf(vm->out, "\n=== PROGRAMA FINALIZADO ===\n");
+            vm->halted = 1;
+            return 1;
+
+        case OP_LOAD: {
+            int64_t addr;
+            if (!address(vm, in, &addr, err)) return 0;
+            *a = vm->memory[addr];
+            break;
+        }
+
+        case OP_STORE: {
+            int64_t addr;
+            if (!address(vm, in, &addr, err)) return 0;
+            vm->memory[addr] = *a;
+            break;
+        }
+
+        case OP_READ: {
+            int64_t value = vm->oven.sensors[in->b];
+            if (vm->hooks.sensor) value = vm->hooks.sensor(vm->hooks.user, in->b, value);
+            *a = value_int(value);
+            break;
+        }
+
+        case OP_WAIT:
+            if (!oven_wait(&vm->oven, in->b, (int)in->imm, a, err, ERROR_SIZE)) return 0;
+            break;
+
+        case OP_WAITCHG:
+            if (!oven_wait_change(&vm->oven, in->list, in->list_len, err, ERROR_SIZE)) return 0;
+            break;
+
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_ADDF: case OP_SUBF: case OP_MULF: case OP_DIVF: case OP_MODF:
+            if (!rt_arith(in->op, a, &regs[in->b], err, ERROR_SIZE)) return 0;
+            break;
+
+        case OP_ITOF:
+            *a = value_frac(value_as_double(a));
+            break;
+
+        case OP_FTOI:
+            /* Trunca em direcao a zero */
+            if (!rt_ftoi(a, err, ERROR_SIZE)) return 0;
+            break;
+
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+            *a = value_int(rt_compare(a, &regs[in->b], relation_of(in->op)));
+            break;
+
+        case OP_AND:
+            *a = value_int(value_truthy(a) && value_truthy(&regs[in->b]));
+            break;
+
+        case OP_OR:
+            *a = value_int(value_truthy(a) || value_truthy(&regs[in->b]));
+            break;
+
+        case OP_NOT:
+            *a = value_int(!value_truthy(a));
+            break;
+
+        case OP_JZ:
+            if (is_zero(a)) return jump(vm, in->target, in->label, err);
+            break;
+
+        case OP_JNZ:
+            if (!is_zero(a)) return jump(vm, in->target, in->label, err);
+            break;
+
+        case OP_PRINT: {
+            /* Compatibilidade: imprime TIME */
+            char text[VALUE_TEXT_SIZE];
+            rt_str(&regs[REG_TIME], text, sizeof(text));
+            fprintf(vm->out, "%s\n", text);
+            break;
+        }
+
+        case OP_PRINTI:
+            rt_print_int(vm->out, a);
+            break;
+
+        case OP_PRINTF:
+            rt_print_frac(vm->out, a);
+            break;
+
+        case OP_PRINTB:
+            rt_print_bool(vm->out, a);
+            break;
+
+        case OP_SPRINT: {
+            const char *text = string_at(vm, in->imm);
+            if (!text) {
+                snprintf(err, ERROR_SIZE, "String id %lld nao encontrado", (long long)in->imm);
+                return 0;
+            }
+            fprintf(vm->out, "%s ", text);
+            break;
+        }
+
+        case OP_PRINTFMT: {
+            const char *tmpl = string_at(vm, in->imm);
+            if (!tmpl) {
+                snprintf(err, ERROR_SIZE, "String id %lld nao encontrado", (long long)in->imm);
+                return 0;
+            }
+            /* Operandos STACK usam os valores do topo, o mais fundo primeiro */
+            int depth = 0;
+            for (int i = 0; i < in->list_len; i++) depth += in->list[i] == OPERAND_STACK;
+            if (vm->sp < depth) {
+                snprintf(err, ERROR_SIZE, "PRINTFMT sem valores suficientes na pilha");
+                return 0;
+            }
+            Value values[in->list_len];
+            const Value *stacked = &vm->stack[vm->sp - depth];
+            vm->sp -= depth;
+            for (int i = 0; i < in->list_len; i++) {
+                values[i] = in->list[i] == OPERAND_STACK ? *stacked++ : regs[in->list[i]];
+            }
+            if (!rt_print_fmt(vm->out, tmpl, values, in->list_len, err, ERROR_SIZE)) return 0;
+            break;
+        }
+
+        case OP_SETMODE:
+            oven_setmode(&vm->oven, in->imm, &regs[REG_POWER]);
+            actuate(vm, in->op, in->imm);
+            break;
+
+        case OP_PAUSE:
+            oven_pause(&vm->oven);
+            actuate(vm, in->op, 0);
+            break;
+
+        case OP_RESUME:
+            oven_resume(&vm->oven);
+            actuate(vm, in->op, 0);
+            break;
+
+        case OP_STOP:
+            oven_stop(&vm->oven);
+            regs[REG_POWER] = value_int(0);
+            actuate(vm, in->op, 0);
+            break;
+    }
+
+    vm->pc++;
+    return 1;
+}
+
+int vm_step(VM *vm) {
+    if (vm->halted) return 1;
+
+    if (vm->pc < 0 || vm->pc >= vm->prog->num_instrs) {
+        vm->halted = 1;
+        return 1;
+    }
+
+    vm->steps++;
+    if (vm->max_steps && vm->steps > vm->max_steps) {
+        snprintf(vm->error, sizeof(vm->error),
+                 "Limite de steps excedido (%lld). Possivel loop infinito.",
+                 (long long)vm->max_steps);
+        return 0;
+    }
+
+    const Instr *in = &vm->prog->code[vm->pc];
+    char err[ERROR_SIZE];
+    if (!execute(vm, in, err)) {
+        snprintf(vm->error, sizeof(vm->error), "Erro na linha %d: %s", in->line, err);
+        return 0;
+    }
+    return 1;
+}
+
+int vm_run(VM *vm) {
+    /* Depois de sair do codigo nativo, a instrucao seguinte e sempre */
+    /* interpretada: e por ela que o JIT devolve o controle */
+    int from_jit = 0;
+    while (!vm->halted) {
+        if (vm->jit && !from_jit && jit_enter(vm->jit, vm)) {
+            from_jit = 1;
+            continue;
+        }
+        from_jit = 0;
+        if (!vm_step(vm)) return 0;
+    }
+    return 1;
+}
+
+void vm_print_state(const VM *vm, FILE *out) {
+    rt_print_state(out, vm->steps, vm->regs, &vm->oven, vm->stack, vm->sp,
+                   vm->memory, vm->memory_size);
+}
@@ -0,0 +1,84 @@
+/*
+ * vm.h
+ * Interpretador nativo da AirFryerVM
+ *
+ * Executa um programa carregado por asm_load com a mesma semantica, a
+ * mesma saida e os mesmos erros da VM em Python. Lacos quentes podem ser
+ * entregues ao JIT (jit.h), que devolve o controle ao interpretador em
+ * qualquer instrucao que nao traduz.
+ */
+
+#ifndef VM_H
+#define VM_H
+
+#include "asm.h"
+#include "runtime.h"
+#include <stdio.h>
+
+/* Profundidade maxima de CALL */
+#define MAX_FRAMES 10000
+
+/* Limite padrao de instrucoes executadas (o mesmo da VM em Python) */
+#define DEFAULT_MAX_STEPS 100000
+
+/* Quadro de chamada: endereco de retorno e A0-A3 do chamador */
+typedef struct Frame {
+    int64_t ret;
+    Value args[NUM_ARG_REGS];
+} Frame;
+
+struct Jit;
+
+/* Ganchos de quem embute a VM (ver src/libairfryer.h); NULL = so o modelo */
+typedef struct VMHooks {
+    /* READ: valor lido do sensor; recebe o valor do modelo termico */
+    /* (o JIT traduz READ: com este gancho, criar a VM sem JIT) */
+    int64_t (*sensor)(void *user, int sensor, int64_t value);
+    /* SETMODE (arg = modo), PAUSE, RESUME e STOP, depois do modelo */
+    void (*actuator)(void *user, Opcode op, int64_t arg);
+    void *user;
+} VMHooks;
+
+typedef struct VM {
+    /* Estado lido e escrito pelo codigo do JIT (ver jit.c) */
+    Value regs[NUM_VM_REGS];
+    Oven oven;
+    Value *stack;
+    int64_t sp;
+    int64_t stack_capacity;
+    Value *memory;                 /* Nao muda de lugar depois de vm_create */
+    int64_t memory_size;
+    int64_t pc;
+    int64_t steps;
+
+    int64_t max_steps;             /* 0 = sem limite */
+    Frame *frames;
+    int num_frames;
+    int frames_capacity;
+    int halted;
+
+    const Program *prog;
+    FILE *out;
+    struct Jit *jit;               /* NULL = so interpretador */
+    VMHooks hooks;
+    char error[512];
+} VM;
+
+/* Criar uma VM para prog com a memoria de dados ja inicializada */
+VM* vm_create(const Program *prog, FILE *out);
+
+/* Executar uma instrucao no interpretador */
+/* Retorna 1 se sucesso, 0 se erro (mensagem em vm->error) */
+int vm_step(VM *vm);
+
+/* Executar ate HALT, o fim do programa ou um erro */
+/* Retorna 1 se sucesso, 0 se erro (mensagem em vm->error) */
+int vm_run(VM *vm);
+
+/* Imprimir o estado final como a VM em Python */
+void vm_print_state(const VM *vm, FILE *out);
+
+/* Liberar a VM (nao libera o programa nem o JIT) */
+void vm_free(VM *vm);
+
+#endif /* VM_H */
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Escalonador de AirFryerVMs
+==========================
+
+Roda muitos programas .mwasm no mesmo processo, cada um numa AirFryerVM
+propria, intercalados por fatias de instrucoes (quantum):
+
+- cada tarefa executa ate `quantum` instrucoes e volta para a fila;
+- PAUSE, WAIT e WAITCHG encerram a fatia mais cedo (pontos de cessao,
+  como num coroutine): a espera avanca so o relogio virtual da propria VM;
+- a saida de cada VM vai para um buffer da tarefa; com o buffer cheio a
+  tarefa fica bloqueada ate a saida ser consumida (contrapressao);
+- cada tarefa tem orcamento de steps (max_steps da VM) e de tempo virtual.
+
+Politicas:
+  rr          - round-robin: todas as tarefas prontas em rodizio
+  prioridade  - sempre a tarefa pronta de menor valor de prioridade;
+                empates em rodizio (prioridades altas podem esperar
+                indefinidamente enquanto houver tarefas mais urgentes)
+
+Varias threads podem compartilhar a fila (run(threads=n)): uma tarefa so
+roda numa thread por vez. Com o GIL isso nao acelera o interpretador, mas
+deixa threads livres enquanto um consumidor de saida (sink) bloqueia.
+
+Uso:
+  python3 vm/scheduler.py [-q quantum] [-j threads] [-p rr|prioridade]
+                          [--max-steps n] [--max-clock s] <arquivo.mwasm>...
+"""
+
+import collections
+import heapq
+import threading
+from typing import Callable, Dict, List, Optional
+
+from airfryer_vm import AirFryerVM
+
+DEFAULT_QUANTUM = 1000          # Instrucoes por fatia
+DEFAULT_OUTPUT_LIMIT = 1 << 16  # Caracteres de saida pendentes por tarefa
+YIELD_OPS = frozenset(("PAUSE", "WAIT", "WAITCHG"))
+POLICIES = ("rr", "prioridade")
+
+# Estados de uma tarefa
+PRONTA = "pronta"
+RODANDO = "rodando"
+BLOQUEADA = "bloqueada"         # Buffer de saida cheio
+FINALIZADA = "finalizada"
+ERRO = "erro"
+
+
+class OutputBuffer:
+    """
+    Saida de uma VM (recebe os print(file=...) da VM)
+    """
+
+    def __init__(self, limit: int):
+        self.parts: List[str] = []
+        self.size = 0
+        self.limit = limit
+
+    def write(self, text: str) -> int:
+        # A VM nao pode parar no meio de uma instrucao: a escrita sempre
+        # cabe e o escalonador confere full() depois do step
+        self.parts.append(text)
+        self.size += len(text)
+        return len(text)
+
+    def flush(self):
+        pass
+
+    def full(self) -> bool:
+        return self.limit > 0 and self.size >= self.limit
+
+    def drain(self) -> str:
+        text = "".join(self.parts)
+        self.parts.clear()
+        self.size = 0
+        return text
+
+
+class Task:
+    """
+    Um programa sob o escalonador
+    """
+
+    def __init__(self, vm: AirFryerVM, name: str, priority: int,
+                 max_clock: Optional[int], output_limit: int):
+        self.vm = vm
+        self.name = name
+        self.priority = priority
+        self.max_clock = max_clock
+        self.output = OutputBuffer(output_limit)
+        self.state = PRONTA
+        self.error: Optional[str] = None
+        self.slices = 0
+        self.yields = 0           # Fatias encerradas por PAUSE/WAIT/WAITCHG
+        vm.output = self.output
+
+    @property
+    def done(self) -> bool:
+        return self.state in (FINALIZADA, ERRO)
+
+
+class Scheduler:
+    """
+    Fila de tarefas e o laco de fatias
+    """
+
+    def __init__(self, quantum: int = DEFAULT_QUANTUM, policy: str = "rr",
+                 sink: Optional[Callable[[Task, str], None]] = None):
+        if quantum <= 0:
+            raise ValueError("quantum deve ser positivo")
+        if policy not in POLICIES:
+            raise ValueError(f"Politica desconhecida: {policy} (use {' ou '.join(POLICIES)})")
+        self.quantum = quantum
+        self.policy = policy
+        self.sink = sink
+        self.tasks: List[Task] = []
+        self._ready = collections.deque()     # rr: tarefas
+        self._heap: List = []                 # prioridade: (prioridade, seq, tarefa)
+        self._seq = 0
+        self._running = 0
+        self._cond = threading.Condition()
+
+    # ===== TAREFAS =====
+
+    def add(self, source: str, name: Optional[str] = None, priority: int = 0,
+            max_steps: Optional[int] = None, max_clock: Optional[int] = None,
+            output_limit: int = DEFAULT_OUTPUT_LIMIT) -> Task:
+        """
+        Carrega um programa numa VM nova e o coloca na fila
+        max_steps substitui o limite padrao da VM; max_clock limita o
+        relogio virtual (segundos)
+        """
+        vm = AirFryerVM()
+        vm.load_program(source)
+        if max_steps is not None:
+            vm.max_steps = max_steps
+        task = Task(vm, name or f"vm{len(self.tasks)}", priority, max_clock, output_limit)
+        with self._cond:
+            self.tasks.append(task)
+            self._push(task)
+            self._cond.notify()
+        return task
+
+    def read_output(self, task: Task) -> str:
+        """
+        Consumir a saida pendente; desbloqueia a tarefa se estava cheia
+        """
+        with self._cond:
+            text = task.output.drain()
+            if task.state == BLOQUEADA:
+                task.state = PRONTA
+                self._push(task)
+                self._cond.notify()
+        return text
+
+    def _push(self, task: Task):
+        if self.policy == "rr":
+            self._ready.append(task)
+        else:
+            self._seq += 1
+            heapq.heappush(self._heap, (task.priority, self._seq, task))
+
+    def _pop(self) -> Optional[Task]:
+        if self.policy == "rr":
+            return self._ready.popleft() if self._ready else None
+        return heapq.heappop(self._heap)[2] if self._heap else None
+
+    # ===== EXECUCAO =====
+
+    def _slice(self, task: Task):
+        """
+        Executar uma fatia de task (fora do lock)
+        """
+        vm = task.vm
+        program = vm.program
+        output = task.output
+        task.slices += 1
+        try:
+            for _ in range(self.quantum):
+                if vm.halted:
+                    break
+                pc = vm.pc
+                vm.step()
+                if output.full():
+                    break
+                if 0 <= pc < len(program) and program[pc].op in YIELD_OPS:
+                    task.yields += 1
+                    break
+            if task.max_clock is not None and vm.clock > task.max_clock:
+                raise RuntimeError(f"Orcamento de tempo virtual excedido ({task.max_clock} s)")
+        except Exception as e:
+            task.error = str(e)
+
+    def _finish_slice(self, task: Task):
+        """
+        Decidir o proximo estado de task (com o lock)
+        """
+        if task.error is not None:
+            task.state = ERRO
+        elif task.vm.halted:
+            task.state = FINALIZADA
+        elif task.output.full() and self.sink is None:
+            task.state = BLOQUEADA
+        else:
+            task.state = PRONTA
+            self._push(task)
+
+    def _worker(self):
+        while True:
+            with self._cond:
+                task = self._pop()
+                while task is None:
+                    # Sem tarefas prontas nem rodando: nada mais muda
+                    if self._running == 0:
+                        self._cond.notify_all()
+                        return
+                    self._cond.wait()
+                    task = self._pop()
+                task.state = RODANDO
+                self._running += 1
+
+            self._slice(task)
+            if self.sink and (task.output.size or task.error is not None or task.vm.halted):
+                self.sink(task, task.output.drain())
+
+            with self._cond:
+                self._running -= 1
+                self._finish_slice(task)
+                self._cond.notify_all()
+
+    def run(self, threads: int = 1):
+        """
+        Rodar ate todas as tarefas terminarem ou ficarem bloqueadas na saida
+        """
+        workers = [threading.Thread(target=self._worker) for _ in range(threads - 1)]
+        for w in workers:
+            w.start()
+        self._worker()
+        for w in workers:
+            w.join()
+
+
+def main():
+    """
+    Rodar varios .mwasm sob o escalonador e imprimir a saida de cada um
+    """
+    import sys
+
+    args = sys.argv[1:]
+    if not args:
+        print("Uso: python3 scheduler.py [-q quantum] [-j threads] [-p rr|prioridade] "
+              "[--max-steps n] [--max-clock s] <arquivo.mwasm>...")
+        sys.exit(1)
+
+    quantum, threads, policy = DEFAULT_QUANTUM, 1, "rr"
+    max_steps: Optional[int] = None
+    max_clock: Optional[int] = None
+    files: List[str] = []
+    i = 0
+    try:
+        while i < len(args):
+            if args[i] == "-q" and i + 1 < len(args):
+                quantum = int(args[i + 1]); i += 1
+            elif args[i] == "-j" and i + 1 < len(args):
+                threads = max(1, int(args[i + 1])); i += 1
+            elif args[i] == "-p" and i + 1 < len(args):
+                policy = args[i + 1]; i += 1
+            elif args[i] == "--max-steps" and i + 1 < len(args):
+                max_steps = int(args[i + 1]); i += 1
+            elif args[i] == "--max-clock" and i + 1 < len(args):
+                max_clock = int(args[i + 1]); i += 1
+            else:
+                files.append(args[i])
+            i += 1
+    except ValueError:
+        print("Erro: opcao numerica invalida")
+        sys.exit(1)
+
+    # A saida de cada programa e juntada e impressa ao fim, na ordem dos arquivos
+    outputs: Dict[Task, List[str]] = {}
+    lock = threading.Lock()
+
+    def sink(task: Task, text: str):
+        with lock:
+            outputs.setdefault(task, []).append(text)
+
+    try:
+        scheduler = Scheduler(quantum, policy, sink)
+        for path in files:
+            with open(path, "r") as f:
+                scheduler.add(f.read(), path, max_steps=max_steps, max_clock=max_clock)
+    except (OSError, ValueError) as e:
+        print(f"Erro: {e}")
+        sys.exit(1)
+
+    scheduler.run(threads)
+
+    failed = 0
+    for task in scheduler.tasks:
+        print(f"=== {task.name} ===")
+        print("".join(outputs.get(task, [])))
+        if task.error is not None:
+            failed += 1
+            print(f"ERRO: {task.error}")
+        print(f"[{task.state}: {task.vm.steps} steps, {task.slices} fatias, "
+              f"{task.yields} cessoes, relogio {task.vm.clock} s]\n")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Fontes de sensores da AirFryerVM
+================================
+
+Por padrao os sensores (TEMP, WEIGHT, MODE, STATE) seguem o modelo termico
+da VM. Uma fonte de sensores (vm.set_sensor_source) fornece valores
+gravados para alguns deles em funcao do relogio virtual:
+
+  sensors                  nomes dos sensores fornecidos (em SENSORS)
+  sample(clock)            valores vigentes em clock (tupla na ordem de
+                           sensors) ou None antes da primeira amostra
+  next_time(clock)         instante da proxima amostra depois de clock ou
+                           None se o trace acabou
+
+Os valores sao degraus: cada amostra vale ate a seguinte. Durante WAIT e
+WAITCHG, se o modelo termico nao tem o que mudar (ou a fonte fornece
+TEMP), o relogio salta direto para a proxima amostra; esperar dias de
+gravacao custa uma leitura por amostra, sem tiques de 1 segundo.
+
+TraceSource le um trace binario mapeado em memoria. As colunas sao
+vetores int64 lidos por memoryview, sem copias nem analise de texto; o
+cursor avanca uma amostra por vez e saltos (restore de checkpoint, relogio
+voltando) usam busca binaria nos instantes.
+
+Formato (little-endian, secoes alinhadas em 8 bytes):
+  cabecalho   magic "AFSS", versao, numero de colunas, numero de amostras
+  colunas     1 byte por coluna: indice do sensor em SENSORS
+  instantes   int64 por amostra, estritamente crescentes (segundos)
+  valores     int64 por amostra, uma coluna inteira apos a outra
+
+Traces em CSV (primeira coluna o instante em segundos, as demais com o
+nome do sensor no cabecalho) sao convertidos uma vez:
+
+  python3 vm/sensors.py converter gravacao.csv gravacao.afss
+  python3 vm/sensors.py info gravacao.afss
+  python3 vm/airfryer_vm.py programa.mwasm --sensors gravacao.afss
+"""
+
+import bisect
+import csv
+import mmap
+import struct
+import sys
+from array import array
+from typing import Iterable, List, Optional, Sequence, Tuple
+
+from airfryer_vm import SENSORS
+
+SENSOR_TRACE_MAGIC = b"AFSS"
+SENSOR_TRACE_VERSION = 1
+SENSOR_TRACE_HEADER = struct.Struct("<4sIIxxxxq")  # magic, versao, colunas, amostras
+
+
+def _align(n: int) -> int:
+    return (n + 7) & ~7
+
+
+class TraceSource:
+    """
+    Fonte de sensores lida de um trace binario mapeado em memoria
+    """
+
+    def __init__(self, path: str):
+        if sys.byteorder != "little":
+            raise ValueError("Traces de sensores so sao lidos em hosts little-endian")
+        with open(path, "rb") as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        try:
+            self._open(path)
+        except Exception:
+            self._map.close()
+            raise
+        self.cursor = -1    # Amostra vigente (-1 = antes da primeira)
+
+    def _open(self, path: str):
+        mm = self._map
+        if len(mm) < SENSOR_TRACE_HEADER.size:
+            raise ValueError(f"{path}: trace de sensores truncado")
+        magic, version, num_columns, count = SENSOR_TRACE_HEADER.unpack_from(mm, 0)
+        if magic != SENSOR_TRACE_MAGIC:
+            raise ValueError(f"{path}: nao e um trace de sensores")
+        if version != SENSOR_TRACE_VERSION:
+            raise ValueError(f"{path}: versao {version} de trace de sensores nao suportada")
+        pos = SENSOR_TRACE_HEADER.size
+        ids = mm[pos:pos + num_columns]
+        if num_columns == 0 or any(i >= len(SENSORS) for i in ids):
+            raise ValueError(f"{path}: colunas de sensores invalidas")
+        pos += _align(num_columns)
+        if len(mm) != pos + 8 * count * (1 + num_columns):
+            raise ValueError(f"{path}: tamanho nao confere com o cabecalho")
+
+        view = memoryview(mm)
+        self.sensors: Tuple[str, ...] = tuple(SENSORS[i] for i in ids)
+        self.count: int = count
+        self.times = view[pos:pos + 8 * count].cast("q")
+        pos += 8 * count
+        self.columns = []
+        for _ in ids:
+            self.columns.append(view[pos:pos + 8 * count].cast("q"))
+            pos += 8 * count
+        view.release()
+
+    def _seek(self, clock: int) -> int:
+        """
+        Indice da ultima amostra com instante <= clock (-1 se nenhuma)
+        """
+        i, times, count = self.cursor, self.times, self.count
+        if i + 1 < count and times[i + 1] <= clock:
+            # Caso comum: o relogio avancou ate a amostra seguinte
+            i += 1
+            if i + 1 < count and times[i + 1] <= clock:
+                i = bisect.bisect_right(times, clock, i + 1) - 1
+        elif i >= 0 and times[i] > clock:
+            i = bisect.bisect_right(times, clock, 0, i) - 1
+        self.cursor = i
+        return i
+
+    def sample(self, clock: int) -> Optional[Tuple[int, ...]]:
+        i = self._seek(clock)
+        if i < 0:
+            return None
+        return tuple(column[i] for column in self.columns)
+
+    def next_time(self, clock: int) -> Optional[int]:
+        i = self._seek(clock) + 1
+        return self.times[i] if i < self.count else None
+
+    def close(self):
+        """
+        Desfaz o mapeamento (a fonte nao pode mais ser usada)
+        """
+        for column in self.columns:
+            column.release()
+        self.times.release()
+        self._map.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def write_trace(path: str, sensors: Sequence[str], times: Sequence[int],
+                columns: Sequence[Sequence[int]]):
+    """
+    Grava um trace binario; columns tem uma sequencia de valores por sensor
+    """
+    ids = []
+    for name in sensors:
+        if name.upper() not in SENSORS:
+            raise ValueError(f"Sensor desconhecido: {name}")
+        ids.append(SENSORS.index(name.upper()))
+    if not ids or len(set(ids)) != len(ids):
+        raise ValueError("O trace precisa de sensores distintos")
+    if any(len(column) != len(times) for column in columns):
+        raise ValueError("Colunas com numero de amostras diferente dos instantes")
+    if any(t < 0 for t in times[:1]) or any(a >= b for a, b in zip(times, times[1:])):
+        raise ValueError("Instantes devem ser >= 0 e estritamente crescentes")
+
+    with open(path, "wb") as f:
+        f.write(SENSOR_TRACE_HEADER.pack(SENSOR_TRACE_MAGIC, SENSOR_TRACE_VERSION,
+                                         len(ids), len(times)))
+        f.write(bytes(ids).ljust(_align(len(ids)), b"\0"))
+        for values in (times, *columns):
+            data = array("q", values)
+            if sys.byteorder != "little":
+                data.byteswap()
+            f.write(data.tobytes())
+
+
+def convert_csv(csv_path: str, path: str) -> int:
+    """
+    Converte um trace CSV (instante, sensor...) para o formato binario
+    Retorna o numero de amostras
+    """
+    with open(csv_path, "r", newline="") as f:
+        rows: Iterable[List[str]] = csv.reader(f)
+        header = next(rows, None)
+        if not header or len(header) < 2:
+            raise ValueError(f"{csv_path}: cabecalho deve ser instante,sensor...")
+        sensors = [name.strip() for name in header[1:]]
+        times = array("q")
+        columns = [array("q") for _ in sensors]
+        for line_num, row in enumerate(rows, 2):
+            if not row:
+                continue
+            if len(row) != len(header):
+                raise ValueError(f"{csv_path}: linha {line_num}: esperados {len(header)} campos")
+            try:
+                times.append(int(row[0]))
+                for column, value in zip(columns, row[1:]):
+                    column.append(int(value))
+            except ValueError:
+                raise ValueError(f"{csv_path}: linha {line_num}: valor inteiro invalido")
+    write_trace(path, sensors, times, columns)
+    return len(times)
+
+
+def main():
+    """
+    Converter traces CSV e mostrar o resumo de um trace binario
+    """
+    args = sys.argv[1:]
+    try:
+        if len(args) == 3 and args[0] == "converter":
+            count = convert_csv(args[1], args[2])
+            print(f"{args[2]}: {count} amostras")
+        elif len(args) == 2 and args[0] == "info":
+            with TraceSource(args[1]) as source:
+                print(f"Sensores: {' '.join(source.sensors)}")
+                print(f"Amostras: {source.count}")
+                if source.count:
+                    print(f"Instantes: {source.times[0]} a {source.times[-1]} s")
+        else:
+            print("Uso: python3 sensors.py converter <trace.csv> <trace.afss>")
+            print("     python3 sensors.py info <trace.afss>")
+            sys.exit(1)
+    except (OSError, ValueError) as e:
+        print(f"Erro: {e}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
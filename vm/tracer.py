@@ -0,0 +1,456 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Trace binario de execucao da AirFryerVM
+=======================================
+
+Tracer grava, para cada instrucao executada, registros de tamanho fixo
+(24 bytes) num buffer circular da VM, escrito no arquivo em blocos
+grandes quando enche. Cada registro descreve uma mudanca de estado:
+
+  pc      uint32  instrucao executada
+  op      uint8   indice em OPCODES
+  alvo    uint8   registrador (REGISTERS), sensor (SENSORS) ou T_*
+  flags   uint8   F_FRAC (valor double), F_CONT (mesma instrucao do
+                  registro anterior), F_WRAP (inteiro alem de 64 bits),
+                  F_POP (valor desempilhado para o registrador)
+  indice  uint32  endereco (T_MEM) ou quantidade (T_POP)
+  valor   8 bytes int64 ou double
+
+Cada instrucao comeca exatamente um grupo de registros; o PC seguinte e o
+do grupo seguinte (ou o do registro T_END, gravado ao fechar). O destino
+de cada instrucao e resolvido na carga (plan_instruction): a maioria grava
+um unico registro sem comparar estados; so CALL, RET, WAIT, SETMODE e
+semelhantes comparam o estado antes e depois.
+
+O arquivo comeca com um checkpoint do estado inicial (ver Checkpoint em
+airfryer_vm.py): a partir dele e dos registros, o estado em qualquer step
+e reconstruido sem reexecutar.
+
+Uso:
+  python3 vm/airfryer_vm.py programa.mwasm --trace programa.trace
+  python3 vm/tracer.py dump <trace> [inicio [fim]]
+  python3 vm/tracer.py state <trace> <step>
+  python3 vm/tracer.py diff <trace_a> <trace_b>
+"""
+
+import mmap
+import struct
+from typing import Dict, Iterator, List, Optional, Tuple
+
+from airfryer_vm import AirFryerVM, Checkpoint, REGISTERS, SENSORS
+
+TRACE_MAGIC = b"AFTR"
+TRACE_VERSION = 1
+TRACE_HEADER = struct.Struct("<4sIII")        # magic, versao, registro, checkpoint
+DEFAULT_CAPACITY = 1 << 16                    # Registros no buffer (1,5 MB)
+
+RECORD_INT = struct.Struct("<IBBBxI4xq")
+RECORD_FRAC = struct.Struct("<IBBBxI4xd")
+RECORD_RAW = struct.Struct("<IBBBxI4x8s")
+RECORD_SIZE = RECORD_RAW.size
+
+OPCODES = (
+    "SET", "SETF", "INC", "DEC", "DECJZ", "DECJNZ", "GOTO", "PUSH", "POP", "HALT",
+    "CALL", "RET", "LOAD", "STORE", "ADD", "SUB", "MUL", "DIV", "MOD",
+    "ADDF", "SUBF", "MULF", "DIVF", "MODF", "ITOF", "FTOI",
+    "EQ", "NE", "LT", "LE", "GT", "GE", "AND", "OR", "NOT",
+    "JZ", "JNZ", "JTABLE", "PRINT", "PRINTI", "PRINTF", "PRINTB", "SPRINT", "PRINTFMT",
+    "READ", "WAIT", "WAITCHG", "SETMODE", "PAUSE", "RESUME", "STOP",
+)
+OPCODE_INDEX = {op: i for i, op in enumerate(OPCODES)}
+
+# Instrucoes cujo unico efeito e escrever o primeiro operando
+DEST_OPS = frozenset((
+    "SET", "SETF", "INC", "DEC", "DECJZ", "DECJNZ", "LOAD", "READ",
+    "ADD", "SUB", "MUL", "DIV", "MOD", "ADDF", "SUBF", "MULF", "DIVF", "MODF",
+    "ITOF", "FTOI", "EQ", "NE", "LT", "LE", "GT", "GE", "AND", "OR", "NOT",
+))
+# Instrucoes sem efeito alem do PC (e da saida)
+NO_EFFECT_OPS = frozenset((
+    "GOTO", "JZ", "JNZ", "JTABLE", "HALT",
+    "PRINT", "PRINTI", "PRINTF", "PRINTB", "SPRINT",
+))
+
+# Como gravar cada instrucao (ver plan_instruction)
+K_REG, K_NONE, K_POP, K_PUSH, K_STORE, K_DIFF = range(6)
+
+# Alvos alem dos registradores (0-10) e sensores (11-14)
+T_CLOCK = len(REGISTERS) + len(SENSORS)       # Relogio virtual (WAIT/WAITCHG)
+T_MEM = T_CLOCK + 1                           # memoria[indice] = valor
+T_PUSH = T_CLOCK + 2                          # Empilhou valor
+T_POP = T_CLOCK + 3                           # Desempilhou indice valores
+T_END = T_CLOCK + 4                           # PC final (valor: 1 se HALT)
+T_NONE = 255
+
+F_FRAC = 1
+F_CONT = 2
+F_WRAP = 4
+F_POP = 8
+
+INT64_MIN = -(1 << 63)
+INT64_MAX = (1 << 63) - 1
+
+
+def target_name(target: int) -> str:
+    if target < len(REGISTERS):
+        return REGISTERS[target]
+    if target < T_CLOCK:
+        return SENSORS[target - len(REGISTERS)]
+    return {T_CLOCK: "CLOCK", T_MEM: "MEM", T_PUSH: "PUSH", T_POP: "POP",
+            T_END: "FIM", T_NONE: "-"}.get(target, f"?{target}")
+
+
+def plan_instruction(instr) -> Tuple:
+    """
+    (K_*, op, alvo, argumento) de uma instrucao carregada
+    """
+    op = OPCODE_INDEX.get(instr.op, 255)
+    args = instr.args
+    if instr.op in DEST_OPS:
+        name = args[0].upper()
+        return K_REG, op, REGISTERS.index(name), name
+    if instr.op in NO_EFFECT_OPS or (instr.op == "PRINTFMT" and
+                                     all(a.upper() != "STACK" for a in args[1:])):
+        return K_NONE, op, T_NONE, None
+    if instr.op == "POP":
+        name = args[0].upper()
+        return K_POP, op, REGISTERS.index(name), name
+    if instr.op == "PUSH":
+        return K_PUSH, op, T_PUSH, None
+    if instr.op == "STORE":
+        return K_STORE, op, int(args[1]), args[2].upper()
+    return K_DIFF, op, T_NONE, None
+
+
+class Tracer:
+    """
+    Gravador ligado a uma VM (vm.trace); sem path, o buffer e um anel com
+    os ultimos `capacity` registros (ver records())
+    """
+
+    def __init__(self, vm: AirFryerVM, path: Optional[str] = None,
+                 capacity: int = DEFAULT_CAPACITY):
+        self.vm = vm
+        self.capacity = capacity
+        self.buf = bytearray(capacity * RECORD_SIZE)
+        self.count = 0             # Registros no buffer
+        self.wrapped = False
+        self.file = None
+        if path:
+            checkpoint = vm.checkpoint_bytes()
+            self.file = open(path, "wb")
+            self.file.write(TRACE_HEADER.pack(TRACE_MAGIC, TRACE_VERSION,
+                                              RECORD_SIZE, len(checkpoint)))
+            self.file.write(checkpoint)
+        self.plan = [plan_instruction(instr) for instr in vm.program]
+        self._pc = 0
+        self._regs: Tuple = ()
+        self._sensors: Tuple = ()
+        self._depth = 0
+        self._clock = 0
+        vm.trace = self
+
+    # ===== GRAVACAO =====
+
+    def before(self, vm: AirFryerVM):
+        pc = self._pc = vm.pc
+        if self.plan[pc][0] == K_DIFF:
+            self._regs = tuple(vm.registers.values())
+            self._sensors = tuple(vm.readonly_registers.values())
+            self._depth = len(vm.stack)
+            self._clock = vm.clock
+
+    def after(self, vm: AirFryerVM, instr):
+        pc = self._pc
+        kind, op, target, arg = self.plan[pc]
+        if kind == K_REG:
+            value = vm.registers[arg]
+            count = self.count
+            # Caminho rapido: inteiro de 64 bits sem encher o buffer
+            if value.__class__ is int and INT64_MIN <= value <= INT64_MAX and count + 1 < self.capacity:
+                RECORD_INT.pack_into(self.buf, count * RECORD_SIZE, pc, op, target, 0, 0, value)
+                self.count = count + 1
+            else:
+                self._emit(pc, op, target, 0, 0, value)
+        elif kind == K_NONE:
+            self._emit(pc, op, T_NONE, 0, 0, 0)
+        elif kind == K_POP:
+            self._emit(pc, op, target, F_POP, 0, vm.registers[arg])
+        elif kind == K_PUSH:
+            self._emit(pc, op, T_PUSH, 0, 0, vm.stack[-1])
+        elif kind == K_STORE:
+            address = target + vm.registers[arg]
+            self._emit(pc, op, T_MEM, 0, address, vm.memory[address])
+        else:
+            self._diff(vm, pc, op)
+
+    def _diff(self, vm: AirFryerVM, pc: int, op: int):
+        """
+        Registros de uma instrucao com varios efeitos (CALL, RET, WAIT...)
+        """
+        flags = 0
+        emit = self._emit
+
+        # Identidade, nao igualdade: 1 == 1.0, mas a mudanca de tipo conta
+        regs = tuple(vm.registers.values())
+        for i, value in enumerate(regs):
+            if value is not self._regs[i]:
+                emit(pc, op, i, flags, 0, value)
+                flags = F_CONT
+
+        base = len(REGISTERS)
+        for i, value in enumerate(vm.readonly_registers.values()):
+            if value != self._sensors[i]:
+                emit(pc, op, base + i, flags, 0, value)
+                flags = F_CONT
+        if vm.clock != self._clock:
+            emit(pc, op, T_CLOCK, flags, 0, vm.clock)
+            flags = F_CONT
+
+        depth = len(vm.stack)
+        if depth > self._depth:
+            for value in vm.stack[self._depth:]:
+                emit(pc, op, T_PUSH, flags, 0, value)
+                flags = F_CONT
+        elif depth < self._depth:
+            emit(pc, op, T_POP, flags, self._depth - depth, 0)
+            flags = F_CONT
+
+        if not flags:
+            emit(pc, op, T_NONE, 0, 0, 0)
+
+    def _emit(self, pc: int, op: int, target: int, flags: int, index: int, value):
+        offset = self.count * RECORD_SIZE
+        if value.__class__ is float:
+            RECORD_FRAC.pack_into(self.buf, offset, pc, op, target, flags | F_FRAC, index, value)
+        else:
+            if not INT64_MIN <= value <= INT64_MAX:
+                value = ((value + (1 << 63)) & ((1 << 64) - 1)) - (1 << 63)
+                flags |= F_WRAP
+            RECORD_INT.pack_into(self.buf, offset, pc, op, target, flags, index, value)
+        self.count += 1
+        if self.count == self.capacity:
+            self.flush()
+
+    def flush(self):
+        """
+        Escrever o buffer no arquivo (sem arquivo: recomecar o anel)
+        """
+        if self.file:
+            self.file.write(memoryview(self.buf)[:self.count * RECORD_SIZE])
+        elif self.count == self.capacity:
+            self.wrapped = True
+        self.count = 0
+
+    def close(self):
+        """
+        Gravar o PC final (registro T_END) e fechar o arquivo
+        """
+        if self.file:
+            self._emit(self.vm.pc, T_NONE, T_END, 0, 0, int(self.vm.halted))
+            self.flush()
+            self.file.close()
+            self.file = None
+
+    def records(self) -> List[Tuple]:
+        """
+        Registros ainda no buffer, do mais antigo ao mais recente
+        """
+        size = RECORD_SIZE
+        order = list(range(self.count))
+        if self.wrapped and not self.file:
+            order = list(range(self.count, self.capacity)) + order
+        return [decode(RECORD_RAW.unpack_from(self.buf, i * size)) for i in order]
+
+
+def decode(raw: Tuple) -> Tuple:
+    """
+    (pc, op, alvo, flags, indice, valor) com o valor ja decodificado
+    """
+    pc, op, target, flags, index, value = raw
+    value = struct.unpack("<d" if flags & F_FRAC else "<q", value)[0]
+    return pc, op, target, flags, index, value
+
+
+# ===== LEITURA =====
+
+class TraceFile:
+    """
+    Trace gravado: checkpoint inicial e grupos de registros por step
+    """
+
+    def __init__(self, path: str):
+        with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+            if len(mm) < TRACE_HEADER.size:
+                raise ValueError("Trace truncado")
+            magic, version, record_size, checkpoint_size = TRACE_HEADER.unpack_from(mm, 0)
+            if magic != TRACE_MAGIC:
+                raise ValueError("Arquivo nao e um trace da AirFryerVM")
+            if version != TRACE_VERSION or record_size != RECORD_SIZE:
+                raise ValueError(f"Versao de trace nao suportada: {version}")
+            start = TRACE_HEADER.size + checkpoint_size
+            self.checkpoint = Checkpoint(mm[TRACE_HEADER.size:start])
+            if (len(mm) - start) % record_size:
+                raise ValueError("Trace truncado")
+            self.records = [decode(r) for r in RECORD_RAW.iter_unpack(mm[start:])]
+
+        # PC final; sem T_END (gravacao interrompida), o do ultimo step
+        self.final_pc: Optional[int] = None
+        self.halted = False
+        if self.records and self.records[-1][2] == T_END:
+            end = self.records.pop()
+            self.final_pc, self.halted = end[0], bool(end[5])
+
+        # Inicio de cada step (registro sem F_CONT)
+        self.starts = [i for i, r in enumerate(self.records) if not r[3] & F_CONT]
+        self.starts.append(len(self.records))
+
+    @property
+    def first_step(self) -> int:
+        return self.checkpoint.steps
+
+    @property
+    def num_steps(self) -> int:
+        return len(self.starts) - 1
+
+    def group(self, k: int) -> List[Tuple]:
+        """
+        Registros do k-esimo step gravado (0 = primeiro)
+        """
+        return self.records[self.starts[k]:self.starts[k + 1]]
+
+    def state(self, step: int) -> Dict:
+        """
+        Estado da VM apos `step` steps (contados desde o inicio da execucao)
+        """
+        ck = self.checkpoint
+        n = step - ck.steps
+        if not 0 <= n <= self.num_steps:
+            raise ValueError(f"Step {step} fora do trace ({ck.steps}..{ck.steps + self.num_steps})")
+        registers = dict(ck.registers)
+        sensors = dict(ck.sensors)
+        stack = list(ck.stack)
+        memory = list(ck.memory)
+        clock = ck.clock
+        for _, _, target, flags, index, value in self.records[:self.starts[n]]:
+            if target < len(REGISTERS):
+                if flags & F_POP:
+                    stack.pop()
+                registers[REGISTERS[target]] = value
+            elif target < T_CLOCK:
+                sensors[SENSORS[target - len(REGISTERS)]] = value
+            elif target == T_CLOCK:
+                clock = value
+            elif target == T_MEM:
+                memory[index] = value
+            elif target == T_PUSH:
+                stack.append(value)
+            elif target == T_POP:
+                del stack[len(stack) - index:]
+
+        if n < self.num_steps:
+            pc = self.records[self.starts[n]][0]
+        elif self.final_pc is not None:
+            pc = self.final_pc
+        else:
+            pc = self.records[-1][0] + 1 if self.records else ck.pc
+        return {"steps": step, "pc": pc, "clock": clock, "registers": registers,
+                "readonly": sensors, "stack": stack, "memory": memory}
+
+
+def format_group(group: List[Tuple]) -> str:
+    pc, op = group[0][0], group[0][1]
+    name = OPCODES[op] if op < len(OPCODES) else "?"
+    changes = []
+    for _, _, target, flags, index, value in group:
+        if target == T_NONE:
+            continue
+        label = target_name(target)
+        if target == T_MEM:
+            label = f"MEM[{index}]"
+        elif flags & F_POP:
+            label += "<-POP"
+        elif target == T_POP:
+            changes.append(f"POP {index}")
+            continue
+        text = f"{value:.6g}" if flags & F_FRAC else str(value)
+        changes.append(f"{label}={text}{'~' if flags & F_WRAP else ''}")
+    return f"PC={pc:<5} {name:<8} {' '.join(changes)}"
+
+
+def iter_groups(trace: TraceFile, begin: int = 0, end: Optional[int] = None) -> Iterator[Tuple[int, List]]:
+    end = trace.num_steps if end is None else min(end, trace.num_steps)
+    for k in range(max(0, begin), end):
+        yield trace.first_step + k + 1, trace.group(k)
+
+
+def print_state(state: Dict):
+    print(f"Step {state['steps']}: PC={state['pc']}, relogio {state['clock']} s")
+    print(f"Registradores: {state['registers']}")
+    print(f"Sensores: {state['readonly']}")
+    if state["stack"]:
+        print(f"Stack: {state['stack']}")
+    if state["memory"]:
+        print(f"Memoria: {state['memory']}")
+
+
+def diff(a: TraceFile, b: TraceFile) -> int:
+    """
+    Imprime o primeiro step em que os traces divergem; retorna 1 se ha diferenca
+    """
+    if a.first_step != b.first_step or a.checkpoint.program_hash != b.checkpoint.program_hash:
+        print("Traces de pontos de partida ou programas diferentes")
+        return 1
+    n = min(a.num_steps, b.num_steps)
+    for k in range(n):
+        ga, gb = a.group(k), b.group(k)
+        if ga != gb:
+            step = a.first_step + k + 1
+            print(f"Divergencia no step {step}:")
+            print(f"  a: {format_group(ga)}")
+            print(f"  b: {format_group(gb)}")
+            print("\nEstado antes do step (a):")
+            print_state(a.state(step - 1))
+            return 1
+    if a.num_steps != b.num_steps:
+        print(f"Traces iguais ate o step {a.first_step + n}; a tem {a.num_steps} steps, "
+              f"b tem {b.num_steps}")
+        return 1
+    print(f"Traces iguais ({n} steps)")
+    return 0
+
+
+def main():
+    import sys
+
+    args = sys.argv[1:]
+    usage = ("Uso: python3 tracer.py dump <trace> [inicio [fim]]\n"
+             "     python3 tracer.py state <trace> <step>\n"
+             "     python3 tracer.py diff <trace_a> <trace_b>")
+    if len(args) < 2:
+        print(usage)
+        sys.exit(1)
+
+    try:
+        if args[0] == "dump":
+            trace = TraceFile(args[1])
+            begin = int(args[2]) - trace.first_step - 1 if len(args) > 2 else 0
+            end = int(args[3]) - trace.first_step if len(args) > 3 else None
+            for step, group in iter_groups(trace, begin, end):
+                print(f"{step:>8}  {format_group(group)}")
+        elif args[0] == "state" and len(args) > 2:
+            print_state(TraceFile(args[1]).state(int(args[2])))
+        elif args[0] == "diff" and len(args) > 2:
+            sys.exit(diff(TraceFile(args[1]), TraceFile(args[2])))
+        else:
+            print(usage)
+            sys.exit(1)
+    except (OSError, ValueError) as e:
+        print(f"Erro: {e}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()